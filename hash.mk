@@ -19,11 +19,15 @@
 # SOFTWARE.
 #
 
-ALL=$(LIBNAME) hash_test mac_test
+ALL=$(LIBNAME) hash_test mac_test kdf_test hash_hpp_test \
+    hash_constexpr_test hash_async_test
 all: $(ALL)
 
-HASH_OBJ=hash.o mac.o hash_sha1.o hash_sha256.o hash_sha512.o hash_sha3.o \
-         hash_sha3_block.o hash_blake2b.o hash_blake2s.o random.o
+HASH_OBJ=hash.o mac.o hash_cpu.o hash_openssl.o hash_afalg.o hash_sha1.o \
+         hash_sha256.o hash_sha256_avx2.o hash_sha512.o hash_sha_ni.o \
+         hash_sha3.o hash_sha3_block.o hash_blake2b.o hash_blake2s.o \
+         hash_xxh3.o hash_crc32c.o hash_multi.o hash_cdc.o mac_poly1305.o \
+         mac_siphash.o kdf.o kdf_scrypt.o kdf_argon2.o random.o
 
 %.o: src/%.c src/*.h include/*.h
 	$(CC) -c $(CFLAGS) -o $@ $<
@@ -46,6 +50,26 @@ mac_test.o: test/mac_test.c
 mac_test: mac_test.o $(LIBNAME)
 	$(CC) -o $@ $^ $(LIBS)
 
+kdf_test.o: test/kdf_test.c
+	$(CC) -c $(CFLAGS) -Isrc -o $@ $<
+kdf_test: kdf_test.o $(LIBNAME)
+	$(CC) -o $@ $^ $(LIBS)
+
+hash_hpp_test.o: test/hash_hpp_test.cpp include/*.hpp include/*.h src/*.h
+	$(CXX) -c $(CXXFLAGS) -Isrc -o $@ $<
+hash_hpp_test: hash_hpp_test.o $(LIBNAME)
+	$(CXX) -o $@ $^ $(LIBS)
+
+hash_constexpr_test.o: test/hash_constexpr_test.cpp include/*.hpp include/*.h
+	$(CXX) -c $(CXXFLAGS) -o $@ $<
+hash_constexpr_test: hash_constexpr_test.o $(LIBNAME)
+	$(CXX) -o $@ $^ $(LIBS)
+
+hash_async_test.o: test/hash_async_test.cpp include/*.hpp include/*.h src/*.h
+	$(CXX) -c $(CXXFLAGS) -Isrc -o $@ $<
+hash_async_test: hash_async_test.o $(LIBNAME)
+	$(CXX) -o $@ $^ $(LIBS)
+
 clean:
 	rm -f *.o
 	rm -f $(ALL)
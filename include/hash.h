@@ -20,6 +20,16 @@
  * SOFTWARE.
  */
 
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* Error codes */
 /** Failed to find the requested data. */
 #define HASH_ERR_NOT_FOUND      1
@@ -35,6 +45,10 @@
 #define HASH_ERR_ALLOC          20
 /** Failed to generate require random data. */
 #define HASH_ERR_RANDOM         30
+/** The implementation does not support the operation. */
+#define HASH_ERR_NOT_SUPPORTED  40
+/** Failed to read or write a file. */
+#define HASH_ERR_IO             50
 
 /** The hash algorithm identifier for SHA-1. */
 #define HASH_ID_SHA1			0
@@ -74,8 +88,72 @@
 /** The hash algorithm identifier for BLAKE2S with 256-bit output. */
 #define HASH_ID_BLAKE2S_256		16
 
+/** The hash algorithm identifier for SHAKE128 with 256-bit output. */
+#define HASH_ID_SHAKE128		17
+/** The hash algorithm identifier for SHAKE256 with 512-bit output. */
+#define HASH_ID_SHAKE256		18
+
+/**
+ * The hash algorithm identifier for XXH3 with 64-bit output.
+ * Non-cryptographic: only found with HASH_METH_FLAG_NONCRYPTO.
+ */
+#define HASH_ID_XXH3_64			19
+/**
+ * The hash algorithm identifier for XXH3 with 128-bit output.
+ * Non-cryptographic: only found with HASH_METH_FLAG_NONCRYPTO.
+ */
+#define HASH_ID_XXH3_128		20
+/**
+ * The hash algorithm identifier for CRC32C - the Castagnoli CRC.
+ * The digest is the CRC in big-endian order.
+ * Non-cryptographic: only found with HASH_METH_FLAG_NONCRYPTO.
+ */
+#define HASH_ID_CRC32C			21
+
 /** Flag indicates the method implementation is internal code. */
 #define HASH_METH_FLAG_INTERNAL		0x01
+/** Flag indicates the method implementation uses SSE4.1 instructions. */
+#define HASH_METH_FLAG_SSE41		0x02
+/** Flag indicates the method implementation uses AVX2 instructions. */
+#define HASH_METH_FLAG_AVX2		0x04
+/** Flag indicates the method implementation uses AVX-512 instructions. */
+#define HASH_METH_FLAG_AVX512		0x08
+/** Flag indicates the method implementation uses SHA-NI instructions. */
+#define HASH_METH_FLAG_SHANI		0x10
+/** Flag indicates the method implementation uses BMI2 instructions. */
+#define HASH_METH_FLAG_BMI2		0x20
+/** Flag indicates the method implementation calls OpenSSL. */
+#define HASH_METH_FLAG_OPENSSL		0x40
+/** Flag indicates the method implementation calls the Linux kernel. */
+#define HASH_METH_FLAG_AFALG		0x80
+/**
+ * Flag indicates the hash algorithm is not cryptographic - fast but collisions
+ * are easy to find. These methods are only used when the flag is required.
+ */
+#define HASH_METH_FLAG_NONCRYPTO	0x100
+/** Flag indicates the method implementation uses SSE4.2 instructions. */
+#define HASH_METH_FLAG_SSE42		0x200
+/** Flag indicates the method implementation uses PCLMULQDQ instructions. */
+#define HASH_METH_FLAG_PCLMUL		0x400
+/** The flags of method implementations that require CPU features. */
+#define HASH_METH_FLAG_CPU						\
+    (HASH_METH_FLAG_SSE41 | HASH_METH_FLAG_AVX2 | HASH_METH_FLAG_AVX512 |	\
+     HASH_METH_FLAG_SHANI | HASH_METH_FLAG_BMI2 | HASH_METH_FLAG_SSE42 |	\
+     HASH_METH_FLAG_PCLMUL)
+/**
+ * Excludes method implementations with any of the flags.
+ * e.g. HASH_METH_FLAG_EXCLUDE(HASH_METH_FLAG_CPU) for portable C code only.
+ */
+#define HASH_METH_FLAG_EXCLUDE(f)	((f) << 16)
+
+/** The version of the exported hash state format. */
+#define HASH_STATE_VERSION		1
+/** The maximum length of an exported hash state. */
+#define HASH_STATE_MAX_LEN		403
+/** The maximum length of a message digest. */
+#define HASH_MAX_LEN			64
+/** The maximum number of implementations that can be registered. */
+#define HASH_METH_REG_MAX		32
 
 
 /** The hash algorithm identifier type. */
@@ -83,17 +161,161 @@ typedef int HASH_ID;
 
 /** The hash algorithm strucutre. */
 typedef struct hash_st HASH;
+/** The multi-hash structure: one stream of data, many hash algorithms. */
+typedef struct hash_multi_st HASH_MULTI;
+/** The content-defined chunker structure: chunks a stream and digests each. */
+typedef struct hash_cdc_st HASH_CDC;
 
+/** A chunk found by the content-defined chunker. */
+typedef struct hash_cdc_chunk_st
+{
+    /** The offset of the chunk in the stream. */
+    uint64_t off;
+    /** The length of the chunk. */
+    size_t len;
+    /** The chunk's data - only valid during the callback. */
+    const unsigned char *data;
+    /** The digest of the chunk - only valid during the callback. */
+    const unsigned char *md;
+} HASH_CDC_CHUNK;
 
+/**
+ * The chunk callback prototype: argument, chunk.
+ * Returns 0 to continue - anything else stops the chunker and is returned.
+ */
+typedef int HASH_CDC_CB(void *, const HASH_CDC_CHUNK *);
+
+/**
+ * A fragment of message data.
+ * The layout matches struct iovec so an array of them can be cast.
+ */
+typedef struct hash_iovec_st
+{
+    /** The fragment's data. */
+    const void *data;
+    /** The length of the fragment's data. */
+    size_t len;
+} HASH_IOVEC;
+
+/** The hash initialization function prototype. */
+typedef int HASH_INIT(void *);
+/** The hash update function prototype. */
+typedef int HASH_UPDATE(void *, const void *, size_t);
+/** The hash final function prototype. */
+typedef int HASH_FINAL(unsigned char *, void *);
+/** The hash state export function prototype. */
+typedef int HASH_EXPORT(unsigned char *, void *);
+/** The hash state import function prototype. */
+typedef int HASH_IMPORT(void *, const unsigned char *);
+/** The hash one-shot digest function prototype. */
+typedef int HASH_DIGEST(unsigned char *, const void *, size_t);
+/**
+ * The hash batch function prototype: digest of each message, in one call.
+ * Parameters: messages, lengths of messages, count, digest buffers.
+ */
+typedef int HASH_BATCH(const unsigned char **, const size_t *, int,
+    unsigned char **);
+/** The hash context duplicate function prototype: destination, source. */
+typedef int HASH_DUP(void *, const void *);
+/** The hash context cleanup function prototype: frees what the context owns. */
+typedef void HASH_CLEANUP(void *);
+
+/**
+ * The method table entry for hash functions.
+ * Functions return 1 on success and 0 on failure.
+ * Contexts are zeroed before the first call to init so that an implementation
+ * can allocate on first use and reuse on later calls.
+ */
+typedef struct hash_meth_st
+{
+    /** Name of implementation. */
+    char *name;
+    /** Flags of the implementaiton. */
+    int flags;
+    /** Priority of the implementation - highest is used first. */
+    int priority;
+    /** The hash algorithm identifier. */
+    HASH_ID id;
+    /** The length of the hash algorithm output. */
+    int len;
+    /** The length of the context required for the hash algorithm. */
+    int ctx_len;
+    /** The alignment of the context. 0 for that of malloc. */
+    int align;
+    /** The initialization function of the hash algorithm. */
+    HASH_INIT *init;
+    /** The update function of the hash algorithm. */
+    HASH_UPDATE *update;
+    /** The finalization function of the hash algorithm. */
+    HASH_FINAL *final;
+    /** The length of the exported state. 0 when not supported. */
+    int state_len;
+    /** The state export function of the hash algorithm. May be NULL. */
+    HASH_EXPORT *export_state;
+    /** The state import function of the hash algorithm. May be NULL. */
+    HASH_IMPORT *import_state;
+    /** The one-shot digest function of the hash algorithm. May be NULL. */
+    HASH_DIGEST *digest;
+    /** The batch digest function of the hash algorithm. May be NULL. */
+    HASH_BATCH *batch;
+    /** The context duplicate function. NULL to copy the context's bytes. */
+    HASH_DUP *dup;
+    /**
+     * The context cleanup function called before the context is freed. May be
+     * NULL. Requires dup.
+     */
+    HASH_CLEANUP *cleanup;
+} HASH_METH;
+
+
+int HASH_METH_register(const HASH_METH *meth);
 int HASH_METH_get_len(HASH_ID id, int *len);
+int HASH_calibrate(const char *file);
 
 int HASH_new(HASH_ID id, int flags, HASH **hash);
+int HASH_new_impl(HASH_ID id, int idx, HASH **hash);
 void HASH_free(HASH *hash);
+int HASH_dup(HASH *hash, HASH **dup);
 
 int HASH_init(HASH *hash);
-int HASH_update(HASH *hash, const unsigned char *msg, int len);
+int HASH_update(HASH *hash, const unsigned char *msg, size_t len);
+int HASH_updatev(HASH *hash, const HASH_IOVEC *iov, int cnt);
 int HASH_final(HASH *hash, unsigned char *data);
 
 int HASH_get_len(HASH *hash, int *len);
 int HASH_get_impl_name(HASH *hash, char **name);
 
+int HASH_digest(HASH_ID id, const unsigned char *msg, size_t len,
+    unsigned char *data);
+int HASH_digest_fd(HASH_ID id, int fd, unsigned char *data);
+int HASH_batch(HASH_ID id, int flags, const unsigned char **msgs,
+    const size_t *lens, int cnt, unsigned char **data);
+
+int HASH_MULTI_new(const HASH_ID *ids, int cnt, int flags,
+    HASH_MULTI **multi);
+void HASH_MULTI_free(HASH_MULTI *multi);
+int HASH_MULTI_init(HASH_MULTI *multi);
+int HASH_MULTI_update(HASH_MULTI *multi, const unsigned char *msg,
+    size_t len);
+int HASH_MULTI_final(HASH_MULTI *multi, unsigned char **data);
+
+int HASH_CDC_new(HASH_ID id, int flags, size_t avg, int threads,
+    HASH_CDC_CB *cb, void *arg, HASH_CDC **cdc);
+void HASH_CDC_free(HASH_CDC *cdc);
+int HASH_CDC_init(HASH_CDC *cdc);
+int HASH_CDC_update(HASH_CDC *cdc, const unsigned char *msg, size_t len);
+int HASH_CDC_final(HASH_CDC *cdc);
+
+int HASH_get_state_len(HASH *hash, int *len);
+int HASH_export_state(HASH *hash, unsigned char *data, int *len);
+int HASH_import_state(HASH *hash, const unsigned char *data, int len);
+
+uint32_t HASH_crc32c(uint32_t crc, const unsigned char *data, size_t len);
+uint32_t HASH_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
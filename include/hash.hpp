@@ -0,0 +1,502 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * C++ wrapper of the hash and MAC algorithms.
+ * The algorithm is chosen at compile time and the context is held by value so
+ * the implementation's functions are called directly - no method table.
+ * Requires C++20 and the src directory on the include path.
+ */
+
+#ifndef HASH_HPP
+#define HASH_HPP
+
+/* Include the C library headers before the C code sees them. */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+extern "C" {
+#include "hash.h"
+#include "mac.h"
+#include "hash_sha1.h"
+#include "hash_sha2.h"
+#include "hash_sha3.h"
+#include "hash_blake2b.h"
+#include "hash_blake2s.h"
+#include "hash_xxh3.h"
+#include "hash_crc32c.h"
+#include "mac_poly1305.h"
+#include "mac_siphash.h"
+}
+
+namespace hash {
+
+/** Defines the traits of a hash algorithm. */
+#define HASH_HPP_HASH(name, ctx_t, dlen, hid, init_f, update_f, final_f)    \
+struct name                                                                 \
+{                                                                           \
+    /** The context of the implementation. */                              \
+    using Context = ctx_t;                                                  \
+    /** The length of the digest in bytes. */                               \
+    static constexpr std::size_t len = dlen;                                \
+    /** The hash algorithm identifier. */                                   \
+    static constexpr HASH_ID id = hid;                                      \
+                                                                            \
+    static void init(Context &ctx) { init_f(&ctx); }                        \
+    static void update(Context &ctx, const unsigned char *msg,             \
+        std::size_t n) { update_f(&ctx, msg, n); }                          \
+    static void final(unsigned char *md, Context &ctx) { final_f(md, &ctx); } \
+}
+
+/** SHA-1 hash algorithm. */
+HASH_HPP_HASH(Sha1, HASH_SHA1, HASH_SHA1_LEN, HASH_ID_SHA1,
+    hash_sha1_init, hash_sha1_update, hash_sha1_final);
+/** SHA-224 hash algorithm. */
+HASH_HPP_HASH(Sha224, HASH_SHA256, HASH_SHA224_LEN, HASH_ID_SHA224,
+    hash_sha224_init, hash_sha224_update, hash_sha224_final);
+/** SHA-256 hash algorithm. */
+HASH_HPP_HASH(Sha256, HASH_SHA256, HASH_SHA256_LEN, HASH_ID_SHA256,
+    hash_sha256_init, hash_sha256_update, hash_sha256_final);
+/** SHA-384 hash algorithm. */
+HASH_HPP_HASH(Sha384, HASH_SHA512, HASH_SHA384_LEN, HASH_ID_SHA384,
+    hash_sha384_init, hash_sha384_update, hash_sha384_final);
+/** SHA-512 hash algorithm. */
+HASH_HPP_HASH(Sha512, HASH_SHA512, HASH_SHA512_LEN, HASH_ID_SHA512,
+    hash_sha512_init, hash_sha512_update, hash_sha512_final);
+/** SHA-512_224 hash algorithm. */
+HASH_HPP_HASH(Sha512_224, HASH_SHA512, HASH_SHA512_224_LEN,
+    HASH_ID_SHA512_224, hash_sha512_224_init, hash_sha512_224_update,
+    hash_sha512_224_final);
+/** SHA-512_256 hash algorithm. */
+HASH_HPP_HASH(Sha512_256, HASH_SHA512, HASH_SHA512_256_LEN,
+    HASH_ID_SHA512_256, hash_sha512_256_init, hash_sha512_256_update,
+    hash_sha512_256_final);
+/** SHA3-224 hash algorithm. */
+HASH_HPP_HASH(Sha3_224, HASH_SHA3, HASH_SHA3_224_LEN, HASH_ID_SHA3_224,
+    hash_sha3_init, hash_sha3_224_update, hash_sha3_224_final);
+/** SHA3-256 hash algorithm. */
+HASH_HPP_HASH(Sha3_256, HASH_SHA3, HASH_SHA3_256_LEN, HASH_ID_SHA3_256,
+    hash_sha3_init, hash_sha3_256_update, hash_sha3_256_final);
+/** SHA3-384 hash algorithm. */
+HASH_HPP_HASH(Sha3_384, HASH_SHA3, HASH_SHA3_384_LEN, HASH_ID_SHA3_384,
+    hash_sha3_init, hash_sha3_384_update, hash_sha3_384_final);
+/** SHA3-512 hash algorithm. */
+HASH_HPP_HASH(Sha3_512, HASH_SHA3, HASH_SHA3_512_LEN, HASH_ID_SHA3_512,
+    hash_sha3_init, hash_sha3_512_update, hash_sha3_512_final);
+/** SHAKE128 hash algorithm with 256-bit output. */
+HASH_HPP_HASH(Shake128, HASH_SHA3, HASH_SHAKE128_LEN, HASH_ID_SHAKE128,
+    hash_sha3_init, hash_shake128_update, hash_shake128_final);
+/** SHAKE256 hash algorithm with 512-bit output. */
+HASH_HPP_HASH(Shake256, HASH_SHA3, HASH_SHAKE256_LEN, HASH_ID_SHAKE256,
+    hash_sha3_init, hash_shake256_update, hash_shake256_final);
+/** XXH3 non-cryptographic hash with 64-bit output. */
+HASH_HPP_HASH(Xxh3_64, HASH_XXH3, HASH_XXH3_64_LEN, HASH_ID_XXH3_64,
+    hash_xxh3_init, hash_xxh3_update, hash_xxh3_64_final);
+/** XXH3 non-cryptographic hash with 128-bit output. */
+HASH_HPP_HASH(Xxh3_128, HASH_XXH3, HASH_XXH3_128_LEN, HASH_ID_XXH3_128,
+    hash_xxh3_init, hash_xxh3_update, hash_xxh3_128_final);
+/** CRC32C non-cryptographic checksum. */
+HASH_HPP_HASH(Crc32c, HASH_CRC32C, HASH_CRC32C_LEN, HASH_ID_CRC32C,
+    hash_crc32c_init, hash_crc32c_update, hash_crc32c_final);
+
+#undef HASH_HPP_HASH
+
+/**
+ * BLAKE2b hash algorithm.
+ *
+ * @tparam N  The length of the digest in bytes: 28, 32, 48 or 64.
+ */
+template <std::size_t N>
+struct Blake2b
+{
+    static_assert(N == 28 || N == 32 || N == 48 || N == 64,
+        "BLAKE2b digest length must be 28, 32, 48 or 64");
+
+    /** The context of the implementation. */
+    using Context = HASH_BLAKE2B;
+    /** The length of the digest in bytes. */
+    static constexpr std::size_t len = N;
+    /** The hash algorithm identifier. */
+    static constexpr HASH_ID id = (N == 28) ? HASH_ID_BLAKE2B_224 :
+                                  (N == 32) ? HASH_ID_BLAKE2B_256 :
+                                  (N == 48) ? HASH_ID_BLAKE2B_384 :
+                                              HASH_ID_BLAKE2B_512;
+
+    static void init(Context &ctx)
+    {
+        if constexpr (N == 28) hash_blake2b_224_init(&ctx);
+        else if constexpr (N == 32) hash_blake2b_256_init(&ctx);
+        else if constexpr (N == 48) hash_blake2b_384_init(&ctx);
+        else hash_blake2b_512_init(&ctx);
+    }
+    static void update(Context &ctx, const unsigned char *msg, std::size_t n)
+    {
+        hash_blake2b_update(&ctx, msg, n);
+    }
+    static void final(unsigned char *md, Context &ctx)
+    {
+        if constexpr (N == 28) hash_blake2b_224_final(md, &ctx);
+        else if constexpr (N == 32) hash_blake2b_256_final(md, &ctx);
+        else if constexpr (N == 48) hash_blake2b_384_final(md, &ctx);
+        else hash_blake2b_512_final(md, &ctx);
+    }
+};
+
+/**
+ * BLAKE2s hash algorithm.
+ *
+ * @tparam N  The length of the digest in bytes: 28 or 32.
+ */
+template <std::size_t N>
+struct Blake2s
+{
+    static_assert(N == 28 || N == 32,
+        "BLAKE2s digest length must be 28 or 32");
+
+    /** The context of the implementation. */
+    using Context = HASH_BLAKE2S;
+    /** The length of the digest in bytes. */
+    static constexpr std::size_t len = N;
+    /** The hash algorithm identifier. */
+    static constexpr HASH_ID id = (N == 28) ? HASH_ID_BLAKE2S_224 :
+                                              HASH_ID_BLAKE2S_256;
+
+    static void init(Context &ctx)
+    {
+        if constexpr (N == 28) hash_blake2s_224_init(&ctx);
+        else hash_blake2s_256_init(&ctx);
+    }
+    static void update(Context &ctx, const unsigned char *msg, std::size_t n)
+    {
+        hash_blake2s_update(&ctx, msg, n);
+    }
+    static void final(unsigned char *md, Context &ctx)
+    {
+        if constexpr (N == 28) hash_blake2s_224_final(md, &ctx);
+        else hash_blake2s_256_final(md, &ctx);
+    }
+};
+
+/**
+ * Hash operation using the algorithm Alg.
+ * Copying the object copies the state of the operation.
+ *
+ * @tparam Alg  The hash algorithm, e.g. Sha256 or Blake2b<64>.
+ */
+template <typename Alg>
+class Hasher
+{
+public:
+    /** The message digest type. */
+    using Digest = std::array<unsigned char, Alg::len>;
+
+    /** Create a hash operation ready to be updated. */
+    Hasher() { Alg::init(ctx_); }
+
+    /** Restart the hash operation. */
+    void init() { Alg::init(ctx_); }
+
+    /**
+     * Update the hash operation with message data.
+     *
+     * @param [in] msg  The message data to digest.
+     * @return  This object.
+     */
+    Hasher &update(std::span<const unsigned char> msg)
+    {
+        Alg::update(ctx_, msg.data(), msg.size());
+        return *this;
+    }
+    /**
+     * Update the hash operation with message data.
+     *
+     * @param [in] msg  The message data to digest.
+     * @return  This object.
+     */
+    Hasher &update(std::span<const std::byte> msg)
+    {
+        Alg::update(ctx_, reinterpret_cast<const unsigned char *>(msg.data()),
+            msg.size());
+        return *this;
+    }
+    /**
+     * Update the hash operation with the characters of a string.
+     *
+     * @param [in] msg  The message data to digest.
+     * @return  This object.
+     */
+    Hasher &update(std::string_view msg)
+    {
+        Alg::update(ctx_, reinterpret_cast<const unsigned char *>(msg.data()),
+            msg.size());
+        return *this;
+    }
+
+    /**
+     * Finalize the hash operation.
+     * Call init() before using the object again.
+     *
+     * @return  The message digest.
+     */
+    Digest final()
+    {
+        Digest md;
+        Alg::final(md.data(), ctx_);
+        return md;
+    }
+
+    /**
+     * Calculate the digest of a message.
+     *
+     * @param [in] msg  The message data to digest.
+     * @return  The message digest.
+     */
+    static Digest digest(std::span<const unsigned char> msg)
+    {
+        Hasher h;
+        return h.update(msg).final();
+    }
+
+private:
+    /** The context of the implementation. */
+    typename Alg::Context ctx_;
+};
+
+/** Defines the traits of a MAC algorithm. */
+#define HASH_HPP_MAC(name, ctx_t, cnt, mlen, mid, init_f, update_f, final_f) \
+struct name                                                                 \
+{                                                                           \
+    /** The context of the implementation. */                              \
+    using Context = std::array<ctx_t, cnt>;                                 \
+    /** The length of the MAC in bytes. */                                  \
+    static constexpr std::size_t len = mlen;                                \
+    /** The MAC algorithm identifier. */                                    \
+    static constexpr MAC_ID id = mid;                                       \
+                                                                            \
+    static bool init(Context &ctx, const unsigned char *key, std::size_t n) \
+    {                                                                       \
+        return init_f(ctx.data(), key, n) == 1;                             \
+    }                                                                       \
+    static void update(Context &ctx, const unsigned char *msg,             \
+        std::size_t n) { update_f(ctx.data(), msg, n); }                    \
+    static void final(unsigned char *md, Context &ctx)                      \
+    {                                                                       \
+        final_f(md, ctx.data());                                            \
+    }                                                                       \
+}
+
+/** HMAC-SHA-1 MAC algorithm. */
+HASH_HPP_MAC(HmacSha1, HASH_SHA1, 2, HASH_SHA1_LEN, MAC_ID_SHA1,
+    hmac_sha1_init, hash_sha1_update, hmac_sha1_final);
+/** HMAC-SHA-224 MAC algorithm. */
+HASH_HPP_MAC(HmacSha224, HASH_SHA256, 2, HASH_SHA224_LEN, MAC_ID_SHA224,
+    hmac_sha224_init, hash_sha256_update, hmac_sha224_final);
+/** HMAC-SHA-256 MAC algorithm. */
+HASH_HPP_MAC(HmacSha256, HASH_SHA256, 2, HASH_SHA256_LEN, MAC_ID_SHA256,
+    hmac_sha256_init, hash_sha256_update, hmac_sha256_final);
+/** HMAC-SHA-384 MAC algorithm. */
+HASH_HPP_MAC(HmacSha384, HASH_SHA512, 2, HASH_SHA384_LEN, MAC_ID_SHA384,
+    hmac_sha384_init, hash_sha512_update, hmac_sha384_final);
+/** HMAC-SHA-512 MAC algorithm. */
+HASH_HPP_MAC(HmacSha512, HASH_SHA512, 2, HASH_SHA512_LEN, MAC_ID_SHA512,
+    hmac_sha512_init, hash_sha512_update, hmac_sha512_final);
+/** HMAC-SHA-512_224 MAC algorithm. */
+HASH_HPP_MAC(HmacSha512_224, HASH_SHA512, 2, HASH_SHA512_224_LEN,
+    MAC_ID_SHA512_224, hmac_sha512_224_init, hash_sha512_update,
+    hmac_sha512_224_final);
+/** HMAC-SHA-512_256 MAC algorithm. */
+HASH_HPP_MAC(HmacSha512_256, HASH_SHA512, 2, HASH_SHA512_256_LEN,
+    MAC_ID_SHA512_256, hmac_sha512_256_init, hash_sha512_update,
+    hmac_sha512_256_final);
+/** SHA3-224 MAC algorithm. */
+HASH_HPP_MAC(MacSha3_224, HASH_SHA3, 1, HASH_SHA3_224_LEN, MAC_ID_SHA3_224,
+    hash_sha3_224_mac_init, hash_sha3_224_update, hash_sha3_224_final);
+/** SHA3-256 MAC algorithm. */
+HASH_HPP_MAC(MacSha3_256, HASH_SHA3, 1, HASH_SHA3_256_LEN, MAC_ID_SHA3_256,
+    hash_sha3_256_mac_init, hash_sha3_256_update, hash_sha3_256_final);
+/** SHA3-384 MAC algorithm. */
+HASH_HPP_MAC(MacSha3_384, HASH_SHA3, 1, HASH_SHA3_384_LEN, MAC_ID_SHA3_384,
+    hash_sha3_384_mac_init, hash_sha3_384_update, hash_sha3_384_final);
+/** SHA3-512 MAC algorithm. */
+HASH_HPP_MAC(MacSha3_512, HASH_SHA3, 1, HASH_SHA3_512_LEN, MAC_ID_SHA3_512,
+    hash_sha3_512_mac_init, hash_sha3_512_update, hash_sha3_512_final);
+/** BLAKE2b-224 MAC algorithm. */
+HASH_HPP_MAC(Blake2b_224Mac, HASH_BLAKE2B, 1, HASH_BLAKE2B_224_LEN,
+    MAC_ID_BLAKE2B_224, hash_blake2b_224_mac_init, hash_blake2b_update,
+    hash_blake2b_224_final);
+/** BLAKE2b-256 MAC algorithm. */
+HASH_HPP_MAC(Blake2b_256Mac, HASH_BLAKE2B, 1, HASH_BLAKE2B_256_LEN,
+    MAC_ID_BLAKE2B_256, hash_blake2b_256_mac_init, hash_blake2b_update,
+    hash_blake2b_256_final);
+/** BLAKE2b-384 MAC algorithm. */
+HASH_HPP_MAC(Blake2b_384Mac, HASH_BLAKE2B, 1, HASH_BLAKE2B_384_LEN,
+    MAC_ID_BLAKE2B_384, hash_blake2b_384_mac_init, hash_blake2b_update,
+    hash_blake2b_384_final);
+/** BLAKE2b-512 MAC algorithm. */
+HASH_HPP_MAC(Blake2b_512Mac, HASH_BLAKE2B, 1, HASH_BLAKE2B_512_LEN,
+    MAC_ID_BLAKE2B_512, hash_blake2b_512_mac_init, hash_blake2b_update,
+    hash_blake2b_512_final);
+/** BLAKE2s-224 MAC algorithm. */
+HASH_HPP_MAC(Blake2s_224Mac, HASH_BLAKE2S, 1, HASH_BLAKE2S_224_LEN,
+    MAC_ID_BLAKE2S_224, hash_blake2s_224_mac_init, hash_blake2s_update,
+    hash_blake2s_224_final);
+/** BLAKE2s-256 MAC algorithm. */
+HASH_HPP_MAC(Blake2s_256Mac, HASH_BLAKE2S, 1, HASH_BLAKE2S_256_LEN,
+    MAC_ID_BLAKE2S_256, hash_blake2s_256_mac_init, hash_blake2s_update,
+    hash_blake2s_256_final);
+/** Poly1305 one-time MAC algorithm - the key must be 32 bytes. */
+HASH_HPP_MAC(Poly1305Mac, MAC_POLY1305, 1, MAC_POLY1305_LEN,
+    MAC_ID_POLY1305, mac_poly1305_init, mac_poly1305_update,
+    mac_poly1305_final);
+/** SipHash-2-4 keyed hash - the key must be 16 bytes. */
+HASH_HPP_MAC(SipHash24Mac, MAC_SIPHASH, 1, MAC_SIPHASH_LEN,
+    MAC_ID_SIPHASH_2_4, mac_siphash_2_4_init, mac_siphash_update,
+    mac_siphash_final);
+/** SipHash-1-3 keyed hash - the key must be 16 bytes. */
+HASH_HPP_MAC(SipHash13Mac, MAC_SIPHASH, 1, MAC_SIPHASH_LEN,
+    MAC_ID_SIPHASH_1_3, mac_siphash_1_3_init, mac_siphash_update,
+    mac_siphash_final);
+/** HalfSipHash-2-4 keyed hash - the key must be 8 bytes. */
+HASH_HPP_MAC(HalfSipHashMac, MAC_HALFSIPHASH, 1, MAC_HALFSIPHASH_LEN,
+    MAC_ID_HALFSIPHASH_2_4, mac_halfsiphash_init, mac_halfsiphash_update,
+    mac_halfsiphash_final);
+
+#undef HASH_HPP_MAC
+
+/**
+ * MAC operation using the algorithm Alg.
+ * Copying the object copies the state of the operation - copy after
+ * construction to reuse the keyed state for many messages.
+ *
+ * @tparam Alg  The MAC algorithm, e.g. HmacSha256.
+ */
+template <typename Alg>
+class Mac
+{
+public:
+    /** The MAC data type. */
+    using Tag = std::array<unsigned char, Alg::len>;
+
+    /**
+     * Create a MAC operation with a key.
+     *
+     * @param [in] key  The key to use in the MAC.
+     * @throws std::invalid_argument when the key is not valid for the
+     *         algorithm.
+     */
+    explicit Mac(std::span<const unsigned char> key) { init(key); }
+
+    /**
+     * Restart the MAC operation with a key.
+     *
+     * @param [in] key  The key to use in the MAC.
+     * @throws std::invalid_argument when the key is not valid for the
+     *         algorithm.
+     */
+    void init(std::span<const unsigned char> key)
+    {
+        if (!Alg::init(ctx_, key.data(), key.size()))
+            throw std::invalid_argument("invalid MAC key");
+    }
+
+    /**
+     * Update the MAC operation with message data.
+     *
+     * @param [in] msg  The message data.
+     * @return  This object.
+     */
+    Mac &update(std::span<const unsigned char> msg)
+    {
+        Alg::update(ctx_, msg.data(), msg.size());
+        return *this;
+    }
+    /**
+     * Update the MAC operation with message data.
+     *
+     * @param [in] msg  The message data.
+     * @return  This object.
+     */
+    Mac &update(std::span<const std::byte> msg)
+    {
+        Alg::update(ctx_, reinterpret_cast<const unsigned char *>(msg.data()),
+            msg.size());
+        return *this;
+    }
+    /**
+     * Update the MAC operation with the characters of a string.
+     *
+     * @param [in] msg  The message data.
+     * @return  This object.
+     */
+    Mac &update(std::string_view msg)
+    {
+        Alg::update(ctx_, reinterpret_cast<const unsigned char *>(msg.data()),
+            msg.size());
+        return *this;
+    }
+
+    /**
+     * Finalize the MAC operation.
+     *
+     * @return  The MAC data.
+     */
+    Tag final()
+    {
+        Tag tag;
+        Alg::final(tag.data(), ctx_);
+        return tag;
+    }
+
+    /**
+     * Finalize the MAC operation and compare with the expected MAC.
+     * The comparison takes the same time whatever the data.
+     *
+     * @param [in] expected  The expected MAC data.
+     * @return  true when the MAC matches.<br>
+     *          false otherwise.
+     */
+    bool verify(std::span<const unsigned char> expected)
+    {
+        Tag tag = final();
+        unsigned char diff = expected.size() != tag.size();
+
+        for (std::size_t i = 0; i < tag.size() && i < expected.size(); i++)
+            diff |= tag[i] ^ expected[i];
+        return diff == 0;
+    }
+
+private:
+    /** The context of the implementation. */
+    typename Alg::Context ctx_;
+};
+
+} /* namespace hash */
+
+#endif
+
@@ -0,0 +1,847 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * C++20 coroutine adaptor to hash or MAC the data read from a file descriptor.
+ *
+ * A Reactor reads the data on its own threads: sockets and pipes are waited
+ * on with epoll and regular files, which epoll can't wait on, are read by
+ * worker threads. Each Stream reads ahead into a fixed number of buffers and
+ * stops reading when all are full. The coroutine is resumed on the executor
+ * with a full buffer and hashes it, so the executor is never blocked on I/O
+ * and the memory in use is bounded.
+ *
+ *   hash::async::Reactor reactor([&](std::coroutine_handle<> h) {
+ *       pool.post(h);
+ *   });
+ *   std::vector<unsigned char> md =
+ *       co_await hash::async::digest(reactor, HASH_ID_SHA256, fd);
+ *
+ * Linux only. Requires C++20.
+ */
+
+#ifndef HASH_ASYNC_HPP
+#define HASH_ASYNC_HPP
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hash.h"
+#include "mac.h"
+
+namespace hash {
+namespace async {
+
+/**
+ * Lazily started coroutine that produces a value of type T.
+ * The coroutine runs when awaited and resumes the awaiter when complete.
+ *
+ * @tparam T  The type of the result.
+ */
+template <typename T>
+class Task;
+
+namespace detail {
+
+/* The parts of the promise common to all result types. */
+struct PromiseBase
+{
+    /* The coroutine to resume on completion. */
+    std::coroutine_handle<> cont;
+    /* The exception thrown by the coroutine. */
+    std::exception_ptr error;
+
+    /* Transfers to the awaiting coroutine on completion. */
+    struct Final
+    {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h)
+            noexcept
+        {
+            std::coroutine_handle<> c = h.promise().cont;
+            return c ? c : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    Final final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+/* The promise of a Task that returns a value. */
+template <typename T>
+struct Promise : PromiseBase
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T v) { value.emplace(std::move(v)); }
+    T result()
+    {
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+/* The promise of a Task that returns nothing. */
+template <>
+struct Promise<void> : PromiseBase
+{
+    Task<void> get_return_object();
+    void return_void() {}
+    void result()
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+} /* namespace detail */
+
+template <typename T>
+class Task
+{
+public:
+    using promise_type = detail::Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> h) : h_(h) {}
+    Task(Task &&o) noexcept : h_(std::exchange(o.h_, nullptr)) {}
+    Task &operator=(Task &&o) noexcept
+    {
+        if (this != &o)
+        {
+            if (h_)
+                h_.destroy();
+            h_ = std::exchange(o.h_, nullptr);
+        }
+        return *this;
+    }
+    ~Task()
+    {
+        if (h_)
+            h_.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) noexcept
+    {
+        h_.promise().cont = h;
+        return h_;
+    }
+    T await_resume() { return h_.promise().result(); }
+
+private:
+    std::coroutine_handle<promise_type> h_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(
+        *this));
+}
+
+/* Coroutine that signals a semaphore when complete - used by sync_wait. */
+struct SyncTask
+{
+    struct promise_type
+    {
+        std::binary_semaphore *done = nullptr;
+
+        SyncTask get_return_object()
+        {
+            return { std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept
+        {
+            struct Signal
+            {
+                bool await_ready() noexcept { return false; }
+                void await_suspend(std::coroutine_handle<promise_type> h)
+                    noexcept
+                {
+                    h.promise().done->release();
+                }
+                void await_resume() noexcept {}
+            };
+            return Signal{};
+        }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> h;
+};
+
+/* Storage for the result of sync_wait. */
+template <typename T>
+struct SyncResult
+{
+    std::optional<std::conditional_t<std::is_void_v<T>, char, T>> value;
+    std::exception_ptr error;
+};
+
+template <typename T>
+SyncTask sync_run(Task<T> &task, SyncResult<T> &res)
+{
+    try
+    {
+        if constexpr (std::is_void_v<T>)
+            co_await task;
+        else
+            res.value.emplace(co_await task);
+    }
+    catch (...)
+    {
+        res.error = std::current_exception();
+    }
+}
+
+} /* namespace detail */
+
+/**
+ * Run a task and block the calling thread until it completes.
+ * For use outside of the executor - e.g. in main or tests.
+ *
+ * @param [in] task  The task to run.
+ * @return  The result of the task.
+ */
+template <typename T>
+T sync_wait(Task<T> task)
+{
+    std::binary_semaphore done(0);
+    detail::SyncResult<T> res;
+    detail::SyncTask run = detail::sync_run(task, res);
+
+    run.h.promise().done = &done;
+    run.h.resume();
+    done.acquire();
+    run.h.destroy();
+
+    if (res.error)
+        std::rethrow_exception(res.error);
+    if constexpr (!std::is_void_v<T>)
+        return std::move(*res.value);
+}
+
+/** Schedules a coroutine to be resumed on the executor. */
+using Schedule = std::function<void(std::coroutine_handle<>)>;
+
+class Stream;
+
+/**
+ * Reads data for Streams on background threads and schedules the waiting
+ * coroutines on the executor.
+ * Must outlive all Streams created with it.
+ */
+class Reactor
+{
+public:
+    /**
+     * Create a reactor and start its threads.
+     *
+     * @param [in] schedule  Resumes a coroutine on the executor. When empty,
+     *                       coroutines are resumed on the reactor's thread.
+     * @param [in] workers   The number of threads reading regular files.
+     * @throws std::system_error when epoll or threads can't be created.
+     */
+    explicit Reactor(Schedule schedule = {}, int workers = 1)
+        : schedule_(std::move(schedule))
+    {
+        epoll_event ev{};
+
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd_ < 0)
+            throw std::system_error(errno, std::generic_category(), "epoll");
+        evfd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (evfd_ < 0)
+        {
+            close(epfd_);
+            throw std::system_error(errno, std::generic_category(), "eventfd");
+        }
+        ev.events = EPOLLIN;
+        ev.data.u64 = 0;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, evfd_, &ev);
+
+        poller_ = std::thread([this] { poll(); });
+        for (int i = 0; i < workers; i++)
+            workers_.emplace_back([this] { work(); });
+    }
+    Reactor(const Reactor &) = delete;
+    Reactor &operator=(const Reactor &) = delete;
+
+    /** Stop the threads of the reactor. */
+    ~Reactor()
+    {
+        uint64_t one = 1;
+
+        {
+            std::lock_guard<std::mutex> l(lock_);
+            stop_ = true;
+        }
+        work_cond_.notify_all();
+        if (write(evfd_, &one, sizeof(one)) < 0)
+        {
+            /* Wake-up already pending. */
+        }
+        poller_.join();
+        for (std::thread &t : workers_)
+            t.join();
+        close(evfd_);
+        close(epfd_);
+    }
+
+    /**
+     * Resume a coroutine on the executor.
+     *
+     * @param [in] h  The coroutine to resume.
+     */
+    void schedule(std::coroutine_handle<> h)
+    {
+        if (schedule_)
+            schedule_(h);
+        else
+            h.resume();
+    }
+
+private:
+    friend class Stream;
+
+    /* Register a stream and find whether its fd can be used with epoll. */
+    void add(Stream *s);
+
+    /* Unregister a stream and wait for its read to complete. */
+    void remove(uint64_t id, int fd, bool polled);
+
+    /* Read once when the fd of the stream is readable. */
+    void arm(uint64_t id, int fd, bool polled)
+    {
+        if (polled)
+        {
+            epoll_event ev{};
+
+            ev.events = EPOLLIN | EPOLLONESHOT;
+            ev.data.u64 = id;
+            epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev);
+        }
+        else
+        {
+            {
+                std::lock_guard<std::mutex> l(lock_);
+                work_.push_back(id);
+            }
+            work_cond_.notify_one();
+        }
+    }
+
+    /* Read for the stream - unless it has been removed. */
+    void run(uint64_t id);
+
+    /* Thread waiting on sockets and pipes. */
+    void poll()
+    {
+        epoll_event ev[16];
+        uint64_t cnt;
+        int n, i;
+
+        for (;;)
+        {
+            n = epoll_wait(epfd_, ev, 16, -1);
+            if (n < 0 && errno == EINTR)
+                continue;
+            for (i = 0; i < n; i++)
+            {
+                if (ev[i].data.u64 == 0)
+                {
+                    if (read(evfd_, &cnt, sizeof(cnt)) < 0)
+                    {
+                        /* Counter already cleared. */
+                    }
+                    std::lock_guard<std::mutex> l(lock_);
+                    if (stop_)
+                        return;
+                    continue;
+                }
+                run(ev[i].data.u64);
+            }
+        }
+    }
+
+    /* Thread reading regular files. */
+    void work()
+    {
+        uint64_t id;
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> l(lock_);
+                work_cond_.wait(l, [&] { return stop_ || !work_.empty(); });
+                if (stop_)
+                    return;
+                id = work_.front();
+                work_.pop_front();
+            }
+            run(id);
+        }
+    }
+
+    /* Resumes coroutines on the executor. */
+    Schedule schedule_;
+    /* The epoll instance. */
+    int epfd_;
+    /* Event used to wake the polling thread. */
+    int evfd_;
+    /* Thread waiting on sockets and pipes. */
+    std::thread poller_;
+    /* Threads reading regular files. */
+    std::vector<std::thread> workers_;
+    /* Protects the following fields. */
+    std::mutex lock_;
+    /* Signals that a stream's read has completed. */
+    std::condition_variable idle_;
+    /* Signals that there is work for the file readers. */
+    std::condition_variable work_cond_;
+    /* Streams waiting to be read by the file readers. */
+    std::deque<uint64_t> work_;
+    /* The registered streams. */
+    std::unordered_map<uint64_t, Stream *> streams_;
+    /* The identifier of the last stream registered. */
+    uint64_t next_id_ = 0;
+    /* Whether the threads are to stop. */
+    bool stop_ = false;
+};
+
+/**
+ * The data read from a file descriptor, chunk by chunk.
+ * Reading ahead stops when all buffers are waiting to be consumed.
+ */
+class Stream
+{
+public:
+    /** The default number of buffers. */
+    static constexpr std::size_t BUFFERS = 4;
+    /** The default size of a buffer. */
+    static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+    /**
+     * Start reading from a file descriptor.
+     * The file descriptor is read from its current position until end of
+     * file and is not closed.
+     *
+     * @param [in] r        The reactor to read with.
+     * @param [in] fd       The file descriptor to read.
+     * @param [in] buffers  The number of buffers to read ahead into.
+     * @param [in] size     The size of each buffer.
+     */
+    Stream(Reactor &r, int fd, std::size_t buffers = BUFFERS,
+        std::size_t size = BUFFER_SIZE)
+        : r_(r), fd_(fd), size_(size), mem_(buffers * size)
+    {
+        if (buffers == 0 || size == 0)
+            throw std::invalid_argument("no buffers to read into");
+        for (std::size_t i = 0; i < buffers; i++)
+            free_.push_back({ mem_.data() + i * size, 0 });
+        r_.add(this);
+        r_.arm(id_, fd_, polled_);
+    }
+    Stream(const Stream &) = delete;
+    Stream &operator=(const Stream &) = delete;
+
+    /** Stop reading - waits for a read in progress to complete. */
+    ~Stream() { r_.remove(id_, fd_, polled_); }
+
+    /** Awaitable for the next chunk of data. */
+    class Next
+    {
+    public:
+        explicit Next(Stream &s) : s_(s) {}
+
+        bool await_ready() { return s_.ready(); }
+        bool await_suspend(std::coroutine_handle<> h)
+        {
+            std::lock_guard<std::mutex> l(s_.lock_);
+
+            if (!s_.filled_.empty() || s_.done_)
+                return false;
+            s_.waiter_ = h;
+            return true;
+        }
+        std::span<const unsigned char> await_resume() { return s_.take(); }
+
+    private:
+        Stream &s_;
+    };
+
+    /**
+     * Get the next chunk of data.
+     * The chunk is valid until next() is called again.
+     *
+     * @return  Awaitable that resumes with the chunk of data. An empty chunk
+     *          indicates the end of the data.
+     * @throws std::system_error when reading failed.
+     */
+    Next next() { return Next(*this); }
+
+private:
+    friend class Reactor;
+
+    /* A buffer and the length of data in it. */
+    struct Chunk
+    {
+        unsigned char *data;
+        std::size_t len;
+    };
+
+    /* Release the current chunk and check whether another is available. */
+    bool ready()
+    {
+        bool rearm = false;
+        bool ret;
+
+        {
+            std::lock_guard<std::mutex> l(lock_);
+
+            if (cur_)
+            {
+                free_.push_back(*cur_);
+                cur_.reset();
+                if (stalled_)
+                {
+                    stalled_ = false;
+                    rearm = true;
+                }
+            }
+            ret = !filled_.empty() || done_;
+        }
+        if (rearm)
+            r_.arm(id_, fd_, polled_);
+        return ret;
+    }
+
+    /* Take the next chunk of data. */
+    std::span<const unsigned char> take()
+    {
+        std::lock_guard<std::mutex> l(lock_);
+
+        if (!filled_.empty())
+        {
+            cur_ = filled_.front();
+            filled_.pop_front();
+            return { cur_->data, cur_->len };
+        }
+        if (err_ != 0)
+            throw std::system_error(err_, std::generic_category(), "read");
+        return {};
+    }
+
+    /* Read a chunk - called on a reactor thread. Returns the coroutine to
+     * resume. */
+    std::coroutine_handle<> fill()
+    {
+        std::coroutine_handle<> h;
+        Chunk c;
+        ssize_t n;
+        bool more;
+
+        {
+            std::lock_guard<std::mutex> l(lock_);
+            c = free_.front();
+            free_.pop_front();
+        }
+
+        do
+            n = read(fd_, c.data, size_);
+        while (n < 0 && errno == EINTR);
+
+        std::lock_guard<std::mutex> l(lock_);
+        if (n > 0)
+        {
+            c.len = n;
+            filled_.push_back(c);
+        }
+        else
+        {
+            free_.push_front(c);
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                err_ = errno;
+                done_ = true;
+            }
+            else if (n == 0)
+                done_ = true;
+        }
+        more = !done_ && !free_.empty();
+        if (!more && !done_)
+            stalled_ = true;
+        if (more)
+            r_.arm(id_, fd_, polled_);
+        if (!filled_.empty() || done_)
+            h = std::exchange(waiter_, nullptr);
+        return h;
+    }
+
+    /* The reactor reading the data. */
+    Reactor &r_;
+    /* The file descriptor being read. */
+    int fd_;
+    /* The size of each buffer. */
+    std::size_t size_;
+    /* The memory of the buffers. */
+    std::vector<unsigned char> mem_;
+    /* The identifier of the stream in the reactor. */
+    uint64_t id_ = 0;
+    /* Whether the file descriptor is waited on with epoll. */
+    bool polled_ = false;
+    /* The number of reactor threads in fill() - protected by the reactor's
+     * lock. */
+    int busy_ = 0;
+    /* Protects the following fields. */
+    std::mutex lock_;
+    /* Buffers that can be read into. */
+    std::deque<Chunk> free_;
+    /* Buffers with data, in order, waiting to be consumed. */
+    std::deque<Chunk> filled_;
+    /* The chunk being consumed. */
+    std::optional<Chunk> cur_;
+    /* The coroutine waiting for a chunk. */
+    std::coroutine_handle<> waiter_;
+    /* Reading stopped as no buffers were free. */
+    bool stalled_ = false;
+    /* End of file or error reached. */
+    bool done_ = false;
+    /* The error that occurred on reading. */
+    int err_ = 0;
+};
+
+inline void Reactor::add(Stream *s)
+{
+    std::lock_guard<std::mutex> l(lock_);
+    epoll_event ev{};
+
+    s->id_ = ++next_id_;
+    ev.events = 0;
+    ev.data.u64 = s->id_;
+    s->polled_ = (epoll_ctl(epfd_, EPOLL_CTL_ADD, s->fd_, &ev) == 0);
+    streams_[s->id_] = s;
+}
+
+inline void Reactor::remove(uint64_t id, int fd, bool polled)
+{
+    std::unique_lock<std::mutex> l(lock_);
+    auto it = streams_.find(id);
+    Stream *s = it->second;
+
+    streams_.erase(it);
+    idle_.wait(l, [&] { return s->busy_ == 0; });
+    if (polled)
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+inline void Reactor::run(uint64_t id)
+{
+    std::coroutine_handle<> h;
+    Stream *s;
+
+    {
+        std::unique_lock<std::mutex> l(lock_);
+        auto it = streams_.find(id);
+        if (it == streams_.end())
+            return;
+        s = it->second;
+        s->busy_++;
+    }
+    h = s->fill();
+    {
+        std::lock_guard<std::mutex> l(lock_);
+        s->busy_--;
+    }
+    idle_.notify_all();
+    /* The stream may be destroyed once the coroutine is resumed. */
+    if (h)
+        schedule(h);
+}
+
+/**
+ * Update an operation with all the data read from a file descriptor.
+ * Works with anything that has an update(std::span<const unsigned char>)
+ * method, e.g. hash::Hasher and hash::Mac. The operation must outlive the
+ * task.
+ *
+ * @param [in] r        The reactor to read with.
+ * @param [in] fd       The file descriptor to read.
+ * @param [in] op       The operation to update.
+ * @param [in] buffers  The number of buffers to read ahead into.
+ * @param [in] size     The size of each buffer.
+ * @throws std::system_error when reading failed.
+ */
+template <typename Op>
+Task<void> update(Reactor &r, int fd, Op &op,
+    std::size_t buffers = Stream::BUFFERS,
+    std::size_t size = Stream::BUFFER_SIZE)
+{
+    Stream s(r, fd, buffers, size);
+
+    for (;;)
+    {
+        std::span<const unsigned char> c = co_await s.next();
+        if (c.empty())
+            break;
+        op.update(c);
+    }
+}
+
+/**
+ * Calculate the digest of all the data read from a file descriptor.
+ *
+ * @param [in] r        The reactor to read with.
+ * @param [in] id       The hash algorithm identifier.
+ * @param [in] fd       The file descriptor to read.
+ * @param [in] buffers  The number of buffers to read ahead into.
+ * @param [in] size     The size of each buffer.
+ * @return  The message digest.
+ * @throws std::system_error when reading failed.
+ * @throws std::runtime_error when hashing failed.
+ */
+inline Task<std::vector<unsigned char>> digest(Reactor &r, HASH_ID id, int fd,
+    std::size_t buffers = Stream::BUFFERS,
+    std::size_t size = Stream::BUFFER_SIZE)
+{
+    std::unique_ptr<HASH, void (*)(HASH *)> hash(nullptr, &HASH_free);
+    std::vector<unsigned char> md;
+    HASH *h = NULL;
+    int len = 0;
+
+    if (HASH_new(id, 0, &h) != 0)
+        throw std::runtime_error("hash algorithm not available");
+    hash.reset(h);
+    if (HASH_init(h) != 0 || HASH_get_len(h, &len) != 0)
+        throw std::runtime_error("hash initialization failed");
+
+    {
+        Stream s(r, fd, buffers, size);
+
+        for (;;)
+        {
+            std::span<const unsigned char> c = co_await s.next();
+            if (c.empty())
+                break;
+            if (HASH_update(h, c.data(), c.size()) != 0)
+                throw std::runtime_error("hash update failed");
+        }
+    }
+
+    md.resize(len);
+    if (HASH_final(h, md.data()) != 0)
+        throw std::runtime_error("hash final failed");
+    co_return md;
+}
+
+/**
+ * Calculate the MAC of all the data read from a file descriptor.
+ *
+ * @param [in] r        The reactor to read with.
+ * @param [in] id       The MAC algorithm identifier.
+ * @param [in] key      The key to use in the MAC.
+ * @param [in] fd       The file descriptor to read.
+ * @param [in] buffers  The number of buffers to read ahead into.
+ * @param [in] size     The size of each buffer.
+ * @return  The MAC data.
+ * @throws std::system_error when reading failed.
+ * @throws std::runtime_error when the MAC operation failed.
+ */
+inline Task<std::vector<unsigned char>> mac(Reactor &r, MAC_ID id,
+    std::vector<unsigned char> key, int fd,
+    std::size_t buffers = Stream::BUFFERS,
+    std::size_t size = Stream::BUFFER_SIZE)
+{
+    std::unique_ptr<MAC, void (*)(MAC *)> mac(nullptr, &MAC_free);
+    std::vector<unsigned char> tag;
+    MAC *m = NULL;
+    int len = 0;
+
+    if (MAC_new(id, 0, &m) != 0)
+        throw std::runtime_error("MAC algorithm not available");
+    mac.reset(m);
+    if (MAC_sign_init(m, key.data(), (int)key.size()) != 0 ||
+        MAC_get_len(m, &len) != 0)
+    {
+        throw std::runtime_error("MAC initialization failed");
+    }
+
+    {
+        Stream s(r, fd, buffers, size);
+
+        for (;;)
+        {
+            std::span<const unsigned char> c = co_await s.next();
+            if (c.empty())
+                break;
+            if (MAC_sign_update(m, c.data(), c.size()) != 0)
+                throw std::runtime_error("MAC update failed");
+        }
+    }
+
+    tag.resize(len);
+    if (MAC_sign_final(m, tag.data()) != 0)
+        throw std::runtime_error("MAC final failed");
+    co_return tag;
+}
+
+} /* namespace async */
+} /* namespace hash */
+
+#endif
+
@@ -0,0 +1,563 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * constexpr implementations of SHA-256, SHA-3 and BLAKE2s.
+ * Digests of fixed data can be calculated at compile time:
+ *   constexpr auto label = hash::ct::sha256("protocol label");
+ * The code is written for the compiler to evaluate, not for speed - use the
+ * library for data only known at run time.
+ * Requires C++20.
+ */
+
+#ifndef HASH_CONSTEXPR_HPP
+#define HASH_CONSTEXPR_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace hash {
+namespace ct {
+
+namespace detail {
+
+/* Rotate a 32-bit value right. */
+constexpr uint32_t rotr32(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+/* Rotate a 64-bit value left. */
+constexpr uint64_t rotl64(uint64_t x, int n)
+{
+    return (n == 0) ? x : ((x << n) | (x >> (64 - n)));
+}
+
+} /* namespace detail */
+
+/** constexpr SHA-256 hash operation. */
+class Sha256
+{
+public:
+    /** The length of the digest in bytes. */
+    static constexpr std::size_t len = 32;
+    /** The message digest type. */
+    using Digest = std::array<unsigned char, len>;
+
+    constexpr Sha256()
+        : h_{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+              0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 },
+          m_{}, o_(0), len_(0)
+    {
+    }
+
+    /** Update the hash operation with message data. */
+    constexpr Sha256 &update(std::span<const unsigned char> msg)
+    {
+        for (unsigned char b : msg)
+            absorb(b);
+        return *this;
+    }
+    /** Update the hash operation with the characters of a string. */
+    constexpr Sha256 &update(std::string_view msg)
+    {
+        for (char c : msg)
+            absorb(static_cast<unsigned char>(c));
+        return *this;
+    }
+
+    /** Finalize the hash operation and return the digest. */
+    constexpr Digest final()
+    {
+        Digest md{};
+        uint64_t bits = len_ * 8;
+        std::size_t i;
+
+        m_[o_++] = 0x80;
+        if (o_ > 56)
+        {
+            while (o_ < 64)
+                m_[o_++] = 0;
+            block();
+            o_ = 0;
+        }
+        while (o_ < 56)
+            m_[o_++] = 0;
+        for (i = 0; i < 8; i++)
+            m_[56 + i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+        block();
+
+        for (i = 0; i < len; i++)
+            md[i] = static_cast<unsigned char>(h_[i / 4] >> (24 - 8 * (i % 4)));
+        return md;
+    }
+
+private:
+    /* Add a byte of message and process the block when full. */
+    constexpr void absorb(unsigned char b)
+    {
+        m_[o_++] = b;
+        len_++;
+        if (o_ == 64)
+        {
+            block();
+            o_ = 0;
+        }
+    }
+
+    /* Process the block of message in m_. */
+    constexpr void block()
+    {
+        constexpr uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+            0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+            0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+            0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+            0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+            0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+            0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+            0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+            0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+        uint32_t w[64] = {};
+        uint32_t s[8] = {};
+        uint32_t t0, t1;
+        int i;
+
+        for (i = 0; i < 16; i++)
+        {
+            w[i] = (uint32_t(m_[4 * i + 0]) << 24) |
+                   (uint32_t(m_[4 * i + 1]) << 16) |
+                   (uint32_t(m_[4 * i + 2]) <<  8) |
+                   (uint32_t(m_[4 * i + 3])      );
+        }
+        for (; i < 64; i++)
+        {
+            t0 = detail::rotr32(w[i - 15], 7) ^ detail::rotr32(w[i - 15], 18) ^
+                 (w[i - 15] >> 3);
+            t1 = detail::rotr32(w[i - 2], 17) ^ detail::rotr32(w[i - 2], 19) ^
+                 (w[i - 2] >> 10);
+            w[i] = w[i - 16] + t0 + w[i - 7] + t1;
+        }
+
+        for (i = 0; i < 8; i++)
+            s[i] = h_[i];
+        for (i = 0; i < 64; i++)
+        {
+            t0 = s[7] + (detail::rotr32(s[4], 6) ^ detail::rotr32(s[4], 11) ^
+                         detail::rotr32(s[4], 25)) +
+                 ((s[4] & s[5]) ^ (~s[4] & s[6])) + k[i] + w[i];
+            t1 = (detail::rotr32(s[0], 2) ^ detail::rotr32(s[0], 13) ^
+                  detail::rotr32(s[0], 22)) +
+                 ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+            s[7] = s[6];
+            s[6] = s[5];
+            s[5] = s[4];
+            s[4] = s[3] + t0;
+            s[3] = s[2];
+            s[2] = s[1];
+            s[1] = s[0];
+            s[0] = t0 + t1;
+        }
+        for (i = 0; i < 8; i++)
+            h_[i] += s[i];
+    }
+
+    /* The hash state. */
+    std::array<uint32_t, 8> h_;
+    /* The partial block of message. */
+    std::array<unsigned char, 64> m_;
+    /* The number of bytes in the partial block. */
+    std::size_t o_;
+    /* The number of bytes hashed. */
+    uint64_t len_;
+};
+
+/**
+ * constexpr SHA-3 hash operation.
+ *
+ * @tparam N  The length of the digest in bytes: 28, 32, 48 or 64.
+ */
+template <std::size_t N>
+class Sha3
+{
+    static_assert(N == 28 || N == 32 || N == 48 || N == 64,
+        "SHA-3 digest length must be 28, 32, 48 or 64");
+
+public:
+    /** The length of the digest in bytes. */
+    static constexpr std::size_t len = N;
+    /** The message digest type. */
+    using Digest = std::array<unsigned char, len>;
+
+    constexpr Sha3() : s_{}, i_(0) {}
+
+    /** Update the hash operation with message data. */
+    constexpr Sha3 &update(std::span<const unsigned char> msg)
+    {
+        for (unsigned char b : msg)
+            absorb(b);
+        return *this;
+    }
+    /** Update the hash operation with the characters of a string. */
+    constexpr Sha3 &update(std::string_view msg)
+    {
+        for (char c : msg)
+            absorb(static_cast<unsigned char>(c));
+        return *this;
+    }
+
+    /** Finalize the hash operation and return the digest. */
+    constexpr Digest final()
+    {
+        Digest md{};
+        std::size_t i;
+
+        s_[i_ / 8] ^= uint64_t(0x06) << (8 * (i_ % 8));
+        s_[(rate - 1) / 8] ^= uint64_t(0x80) << (8 * ((rate - 1) % 8));
+        block();
+
+        for (i = 0; i < len; i++)
+            md[i] = static_cast<unsigned char>(s_[i / 8] >> (8 * (i % 8)));
+        return md;
+    }
+
+private:
+    /* The number of bytes absorbed in each block. */
+    static constexpr std::size_t rate = 200 - 2 * N;
+
+    /* XOR a byte of message into the state and permute when block full. */
+    constexpr void absorb(unsigned char b)
+    {
+        s_[i_ / 8] ^= uint64_t(b) << (8 * (i_ % 8));
+        if (++i_ == rate)
+        {
+            block();
+            i_ = 0;
+        }
+    }
+
+    /* The Keccak-f[1600] permutation. */
+    constexpr void block()
+    {
+        constexpr uint64_t rc[24] = {
+            0x0000000000000001ULL, 0x0000000000008082ULL,
+            0x800000000000808aULL, 0x8000000080008000ULL,
+            0x000000000000808bULL, 0x0000000080000001ULL,
+            0x8000000080008081ULL, 0x8000000000008009ULL,
+            0x000000000000008aULL, 0x0000000000000088ULL,
+            0x0000000080008009ULL, 0x000000008000000aULL,
+            0x000000008000808bULL, 0x800000000000008bULL,
+            0x8000000000008089ULL, 0x8000000000008003ULL,
+            0x8000000000008002ULL, 0x8000000000000080ULL,
+            0x000000000000800aULL, 0x800000008000000aULL,
+            0x8000000080008081ULL, 0x8000000000008080ULL,
+            0x0000000080000001ULL, 0x8000000080008008ULL
+        };
+        constexpr int rho[25] = {
+             0,  1, 62, 28, 27,
+            36, 44,  6, 55, 20,
+             3, 10, 43, 25, 39,
+            41, 45, 15, 21,  8,
+            18,  2, 61, 56, 14
+        };
+        uint64_t b[25] = {};
+        uint64_t c[5] = {};
+        uint64_t d;
+        int r, x, y;
+
+        for (r = 0; r < 24; r++)
+        {
+            /* Theta */
+            for (x = 0; x < 5; x++)
+            {
+                c[x] = s_[x] ^ s_[x + 5] ^ s_[x + 10] ^ s_[x + 15] ^
+                       s_[x + 20];
+            }
+            for (x = 0; x < 5; x++)
+            {
+                d = c[(x + 4) % 5] ^ detail::rotl64(c[(x + 1) % 5], 1);
+                for (y = 0; y < 25; y += 5)
+                    s_[x + y] ^= d;
+            }
+            /* Rho and Pi */
+            for (x = 0; x < 5; x++)
+            {
+                for (y = 0; y < 5; y++)
+                {
+                    b[y + 5 * ((2 * x + 3 * y) % 5)] =
+                        detail::rotl64(s_[x + 5 * y], rho[x + 5 * y]);
+                }
+            }
+            /* Chi */
+            for (y = 0; y < 25; y += 5)
+            {
+                for (x = 0; x < 5; x++)
+                {
+                    s_[x + y] = b[x + y] ^
+                                (~b[(x + 1) % 5 + y] & b[(x + 2) % 5 + y]);
+                }
+            }
+            /* Iota */
+            s_[0] ^= rc[r];
+        }
+    }
+
+    /* The Keccak state. */
+    std::array<uint64_t, 25> s_;
+    /* The index into the block of the next byte of message. */
+    std::size_t i_;
+};
+
+/** constexpr SHA3-256 hash operation. */
+using Sha3_256 = Sha3<32>;
+
+/**
+ * constexpr BLAKE2s hash operation.
+ *
+ * @tparam N  The length of the digest in bytes: 28 or 32.
+ */
+template <std::size_t N>
+class Blake2s
+{
+    static_assert(N == 28 || N == 32,
+        "BLAKE2s digest length must be 28 or 32");
+
+public:
+    /** The length of the digest in bytes. */
+    static constexpr std::size_t len = N;
+    /** The message digest type. */
+    using Digest = std::array<unsigned char, len>;
+
+    constexpr Blake2s()
+        : h_{ iv[0], iv[1], iv[2], iv[3], iv[4], iv[5], iv[6], iv[7] },
+          m_{}, o_(0), t_(0)
+    {
+        h_[0] ^= 0x01010000 ^ N;
+    }
+
+    /** Update the hash operation with message data. */
+    constexpr Blake2s &update(std::span<const unsigned char> msg)
+    {
+        for (unsigned char b : msg)
+            absorb(b);
+        return *this;
+    }
+    /** Update the hash operation with the characters of a string. */
+    constexpr Blake2s &update(std::string_view msg)
+    {
+        for (char c : msg)
+            absorb(static_cast<unsigned char>(c));
+        return *this;
+    }
+
+    /** Finalize the hash operation and return the digest. */
+    constexpr Digest final()
+    {
+        Digest md{};
+        std::size_t i;
+
+        t_ += o_;
+        for (i = o_; i < 64; i++)
+            m_[i] = 0;
+        compress(true);
+
+        for (i = 0; i < len; i++)
+            md[i] = static_cast<unsigned char>(h_[i / 4] >> (8 * (i % 4)));
+        return md;
+    }
+
+private:
+    /* The initialization vector - same as SHA-256. */
+    static constexpr uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    /* Add a byte of message - the last block is only compressed in final. */
+    constexpr void absorb(unsigned char b)
+    {
+        if (o_ == 64)
+        {
+            t_ += 64;
+            compress(false);
+            o_ = 0;
+        }
+        m_[o_++] = b;
+    }
+
+    /* Compress the block of message in m_. */
+    constexpr void compress(bool last)
+    {
+        constexpr uint8_t sigma[10][16] = {
+            {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+            { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+            { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+            {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+            {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+            {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+            { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+            { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+            {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+            { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+        };
+        /* Indices into v of the columns then diagonals. */
+        constexpr uint8_t g[8][4] = {
+            { 0, 4,  8, 12 }, { 1, 5,  9, 13 }, { 2, 6, 10, 14 }, { 3, 7, 11, 15 },
+            { 0, 5, 10, 15 }, { 1, 6, 11, 12 }, { 2, 7,  8, 13 }, { 3, 4,  9, 14 }
+        };
+        uint32_t m[16] = {};
+        uint32_t v[16] = {};
+        int i, r;
+
+        for (i = 0; i < 16; i++)
+        {
+            m[i] = (uint32_t(m_[4 * i + 0])      ) |
+                   (uint32_t(m_[4 * i + 1]) <<  8) |
+                   (uint32_t(m_[4 * i + 2]) << 16) |
+                   (uint32_t(m_[4 * i + 3]) << 24);
+        }
+        for (i = 0; i < 8; i++)
+        {
+            v[i] = h_[i];
+            v[i + 8] = iv[i];
+        }
+        v[12] ^= static_cast<uint32_t>(t_);
+        v[13] ^= static_cast<uint32_t>(t_ >> 32);
+        if (last)
+            v[14] = ~v[14];
+
+        for (r = 0; r < 10; r++)
+        {
+            for (i = 0; i < 8; i++)
+            {
+                uint32_t &a = v[g[i][0]];
+                uint32_t &b = v[g[i][1]];
+                uint32_t &c = v[g[i][2]];
+                uint32_t &d = v[g[i][3]];
+
+                a = a + b + m[sigma[r][2 * i + 0]];
+                d = detail::rotr32(d ^ a, 16);
+                c = c + d;
+                b = detail::rotr32(b ^ c, 12);
+                a = a + b + m[sigma[r][2 * i + 1]];
+                d = detail::rotr32(d ^ a, 8);
+                c = c + d;
+                b = detail::rotr32(b ^ c, 7);
+            }
+        }
+
+        for (i = 0; i < 8; i++)
+            h_[i] ^= v[i] ^ v[i + 8];
+    }
+
+    /* The hash state. */
+    std::array<uint32_t, 8> h_;
+    /* The partial block of message. */
+    std::array<unsigned char, 64> m_;
+    /* The number of bytes in the partial block. */
+    std::size_t o_;
+    /* The number of bytes compressed. */
+    uint64_t t_;
+};
+
+/** constexpr BLAKE2s-256 hash operation. */
+using Blake2s_256 = Blake2s<32>;
+
+/**
+ * Calculate the SHA-256 digest of a string.
+ *
+ * @param [in] msg  The message data to digest.
+ * @return  The message digest.
+ */
+constexpr Sha256::Digest sha256(std::string_view msg)
+{
+    return Sha256().update(msg).final();
+}
+/**
+ * Calculate the SHA-256 digest of data.
+ *
+ * @param [in] msg  The message data to digest.
+ * @return  The message digest.
+ */
+constexpr Sha256::Digest sha256(std::span<const unsigned char> msg)
+{
+    return Sha256().update(msg).final();
+}
+
+/**
+ * Calculate the SHA3-256 digest of a string.
+ *
+ * @param [in] msg  The message data to digest.
+ * @return  The message digest.
+ */
+constexpr Sha3_256::Digest sha3_256(std::string_view msg)
+{
+    return Sha3_256().update(msg).final();
+}
+/**
+ * Calculate the SHA3-256 digest of data.
+ *
+ * @param [in] msg  The message data to digest.
+ * @return  The message digest.
+ */
+constexpr Sha3_256::Digest sha3_256(std::span<const unsigned char> msg)
+{
+    return Sha3_256().update(msg).final();
+}
+
+/**
+ * Calculate the BLAKE2s-256 digest of a string.
+ *
+ * @param [in] msg  The message data to digest.
+ * @return  The message digest.
+ */
+constexpr Blake2s_256::Digest blake2s_256(std::string_view msg)
+{
+    return Blake2s_256().update(msg).final();
+}
+/**
+ * Calculate the BLAKE2s-256 digest of data.
+ *
+ * @param [in] msg  The message data to digest.
+ * @return  The message digest.
+ */
+constexpr Blake2s_256::Digest blake2s_256(std::span<const unsigned char> msg)
+{
+    return Blake2s_256().update(msg).final();
+}
+
+} /* namespace ct */
+} /* namespace hash */
+
+#endif
+
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KDF_H
+#define KDF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mac.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Argon2d: data-dependent memory access. */
+#define KDF_ARGON2_D		0
+/** Argon2i: data-independent memory access. */
+#define KDF_ARGON2_I		1
+/** Argon2id: data-independent for the first half of the first pass. */
+#define KDF_ARGON2_ID		2
+
+int KDF_pbkdf2(MAC_ID id, const unsigned char *pwd, int plen,
+    const unsigned char *salt, size_t slen, unsigned int iter,
+    unsigned char *key, size_t klen);
+int KDF_pbkdf2_batch(MAC_ID id, int flags, const unsigned char **pwds,
+    const int *plens, const unsigned char **salts, const size_t *slens,
+    unsigned int iter, int cnt, unsigned char **keys, size_t klen);
+int KDF_pbkdf2_batch_verify(MAC_ID id, int flags, const unsigned char **pwds,
+    const int *plens, const unsigned char **salts, const size_t *slens,
+    unsigned int iter, int cnt, unsigned char **keys, size_t klen,
+    unsigned char *verified);
+
+int KDF_hkdf_extract(MAC_ID id, const unsigned char *salt, int slen,
+    const unsigned char *ikm, size_t ilen, unsigned char *prk);
+int KDF_hkdf_expand(MAC_ID id, const unsigned char *prk, int plen,
+    const unsigned char *info, size_t ilen, unsigned char *okm, size_t olen);
+int KDF_hkdf_expand_batch(MAC_ID id, const unsigned char *prk, int plen,
+    const unsigned char **infos, const size_t *ilens, int cnt,
+    unsigned char **okms, const size_t *olens);
+int KDF_hkdf(MAC_ID id, const unsigned char *salt, int slen,
+    const unsigned char *ikm, size_t klen, const unsigned char *info,
+    size_t ilen, unsigned char *okm, size_t olen);
+
+int KDF_scrypt(const unsigned char *pwd, int plen, const unsigned char *salt,
+    size_t slen, uint64_t n, uint32_t r, uint32_t p, int threads,
+    unsigned char *key, size_t klen);
+
+int KDF_argon2(int type, int flags, const unsigned char *pwd, int plen,
+    const unsigned char *salt, size_t slen, const unsigned char *secret,
+    size_t klen, const unsigned char *ad, size_t alen, uint32_t t,
+    uint32_t m, uint32_t p, int threads, unsigned char *tag, size_t tlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -20,6 +20,17 @@
  * SOFTWARE.
  */
 
+#ifndef MAC_H
+#define MAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /** The MAC algorithm identifier for HMAC-SHA-1. */
 #define MAC_ID_SHA1			0
 /** The MAC algorithm identifier for HMAC-SHA-224. */
@@ -58,9 +69,40 @@
 /** The MAC algorithm identifier for BLAKE2S with 256-bit output. */
 #define MAC_ID_BLAKE2S_256		16
 
+/** The MAC algorithm identifier for the Poly1305 one-time authenticator. */
+#define MAC_ID_POLY1305			17
+
+/** The MAC algorithm identifier for SipHash-2-4. */
+#define MAC_ID_SIPHASH_2_4		18
+/** The MAC algorithm identifier for SipHash-1-3. */
+#define MAC_ID_SIPHASH_1_3		19
+/** The MAC algorithm identifier for HalfSipHash-2-4 with 32-bit output. */
+#define MAC_ID_HALFSIPHASH_2_4		20
+
+/** The length of a SipHash key in bytes. */
+#define MAC_SIPHASH_KEY_LEN		16
+/** The length of a HalfSipHash key in bytes. */
+#define MAC_HALFSIPHASH_KEY_LEN		8
+
 
 /** Flag indicates the method implementation is internal code. */
-#define MAC_METH_FLAG_INTERNAL		0x01
+#define MAC_METH_FLAG_INTERNAL		HASH_METH_FLAG_INTERNAL
+/** Flag indicates the method implementation uses SSE4.1 instructions. */
+#define MAC_METH_FLAG_SSE41		HASH_METH_FLAG_SSE41
+/** Flag indicates the method implementation uses AVX2 instructions. */
+#define MAC_METH_FLAG_AVX2		HASH_METH_FLAG_AVX2
+/** Flag indicates the method implementation uses AVX-512 instructions. */
+#define MAC_METH_FLAG_AVX512		HASH_METH_FLAG_AVX512
+/** Flag indicates the method implementation uses SHA-NI instructions. */
+#define MAC_METH_FLAG_SHANI		HASH_METH_FLAG_SHANI
+/** Flag indicates the method implementation uses BMI2 instructions. */
+#define MAC_METH_FLAG_BMI2		HASH_METH_FLAG_BMI2
+/** Flag indicates the method implementation calls OpenSSL. */
+#define MAC_METH_FLAG_OPENSSL		HASH_METH_FLAG_OPENSSL
+/** The flags of method implementations that require CPU features. */
+#define MAC_METH_FLAG_CPU		HASH_METH_FLAG_CPU
+/** Excludes method implementations with any of the flags. */
+#define MAC_METH_FLAG_EXCLUDE(f)	HASH_METH_FLAG_EXCLUDE(f)
 
  
 /** The MAC algorithm identifier type. */
@@ -68,19 +110,127 @@ typedef int MAC_ID;
 
 /** The MAC algorithm strucutre. */
 typedef struct mac_st MAC;
+/** The MAC key structure: a key processed for an implementation. */
+typedef struct mac_key_st MAC_KEY;
+
+/** The MAC initialization function prototype: context, key, key length. */
+typedef int MAC_INIT(void *, const void *, size_t);
+/** The MAC update function prototype. */
+typedef int MAC_UPDATE(void *, const void *, size_t);
+/** The MAC final function prototype. */
+typedef int MAC_FINAL(unsigned char *, void *);
+/**
+ * The MAC batch function prototype: MAC of each message, in one call.
+ * Parameters: keys, lengths of keys, messages, lengths of messages, count,
+ * MAC buffers.
+ */
+typedef int MAC_BATCH(const unsigned char **, const int *,
+    const unsigned char **, const size_t *, int, unsigned char **);
+/**
+ * The MAC iterate function prototype: for each context, initialized with a
+ * key and only read, MAC the data repeatedly, XORing each MAC into the data.
+ * Parameters: contexts, MAC length buffers, count, number of MACs.
+ */
+typedef int MAC_ITERATE(void **, unsigned char **, int, unsigned int);
+/** The MAC context duplicate function prototype: destination, source. */
+typedef int MAC_DUP(void *, const void *);
+/** The MAC context cleanup function prototype: frees what the context owns. */
+typedef void MAC_CLEANUP(void *);
+
+/**
+ * The method table entry for MAC functions.
+ * Functions return 1 on success and 0 on failure.
+ * Contexts are zeroed before the first call to init so that an implementation
+ * can allocate on first use and reuse on later calls.
+ */
+typedef struct mac_meth_st
+{
+    /** Name of implementation. */
+    char *name;
+    /** Flags of the implementaiton. */
+    int flags;
+    /** Priority of the implementation - highest is used first. */
+    int priority;
+    /** The MAC algorithm identifier. */
+    MAC_ID id;
+    /** The length of the MAC algorithm output. */
+    int len;
+    /** The length of the context required for the MAC algorithm. */
+    int ctx_len;
+    /** The alignment of the context. 0 for that of malloc. */
+    int align;
+    /** The initialization function of the MAC algorithm. */
+    MAC_INIT *init;
+    /** The update function of the MAC algorithm. */
+    MAC_UPDATE *update;
+    /** The finalization function of the MAC algorithm. */
+    MAC_FINAL *final;
+    /** The batch MAC function of the MAC algorithm. May be NULL. */
+    MAC_BATCH *batch;
+    /** The PBKDF2 iteration function of the MAC algorithm. May be NULL. */
+    MAC_ITERATE *iterate;
+    /** The context duplicate function. NULL to copy the context's bytes. */
+    MAC_DUP *dup;
+    /**
+     * The context cleanup function called before the context is freed. May be
+     * NULL. Requires dup.
+     */
+    MAC_CLEANUP *cleanup;
+} MAC_METH;
+
+
+int MAC_METH_register(const MAC_METH *meth);
+int MAC_METH_get_len(MAC_ID id, int *len);
 
 
 int MAC_new(MAC_ID id, int flags, MAC **mac);
+int MAC_new_impl(MAC_ID id, int idx, MAC **mac);
 void MAC_free(MAC *mac);
+int MAC_dup(MAC *mac, MAC **dup);
+
+int MAC_KEY_new(MAC *mac, const unsigned char *key, int len, MAC_KEY **mkey);
+void MAC_KEY_free(MAC_KEY *mkey);
+int MAC_KEY_iterate(MAC_KEY **mkeys, unsigned char **data, int cnt,
+    unsigned int iter);
 
 int MAC_sign_init(MAC *mac, const unsigned char *key, int len);
-int MAC_sign_update(MAC *mac, const unsigned char *msg, int len);
+int MAC_sign_init_key(MAC *mac, const MAC_KEY *mkey);
+int MAC_sign_update(MAC *mac, const unsigned char *msg, size_t len);
+int MAC_sign_updatev(MAC *mac, const HASH_IOVEC *iov, int cnt);
 int MAC_sign_final(MAC *mac, unsigned char *data);
 
 int MAC_verify_init(MAC *mac, const unsigned char *key, int len);
-int MAC_verify_update(MAC *mac, const unsigned char *msg, int len);
+int MAC_verify_init_key(MAC *mac, const MAC_KEY *mkey);
+int MAC_verify_update(MAC *mac, const unsigned char *msg, size_t len);
+int MAC_verify_updatev(MAC *mac, const HASH_IOVEC *iov, int cnt);
 int MAC_verify_final(MAC *mac, unsigned char *data, int *verified);
 
+int MAC_compute(MAC_ID id, const unsigned char *key, int klen,
+    const unsigned char *msg, size_t len, unsigned char *data);
+
+int MAC_batch_sign(MAC_ID id, int flags, const unsigned char **keys,
+    const int *klens, const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **data);
+int MAC_batch_verify(MAC_ID id, int flags, const unsigned char **keys,
+    const int *klens, const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **data, unsigned char *verified);
+
+uint64_t MAC_siphash_2_4(const unsigned char *key, const void *msg,
+    size_t len);
+uint64_t MAC_siphash_1_3(const unsigned char *key, const void *msg,
+    size_t len);
+uint32_t MAC_halfsiphash_2_4(const unsigned char *key, const void *msg,
+    size_t len);
+int MAC_siphash_batch(MAC_ID id, const unsigned char *key,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    uint64_t *hashes);
+
 int MAC_get_len(MAC *mac, int *len);
 int MAC_get_impl_name(MAC *mac, char **name);
 
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -20,45 +20,25 @@
  * SOFTWARE.
  */
 
+#include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
 #include "hash.h"
-#ifdef OPT_HASH_OPENSSL
-#include "openssl/sha.h"
-#endif
 #include "hash_sha1.h"
 #include "hash_sha2.h"
 #include "hash_sha3.h"
 #include "hash_blake2b.h"
 #include "hash_blake2s.h"
-
-/** The hash initialization function prototype. */
-typedef int HASH_INIT(void *);
-/** The hash update function prototype. */
-typedef int HASH_UPDATE(void *, const void *, size_t);
-/** The hash final function prototype. */
-typedef int HASH_FINAL(unsigned char *, void *);
-
-/** The method table entry for hash functions. */
-typedef struct hash_meth_st
-{
-    /** Name of implementation. */
-    char *name;
-    /** Flags of the implementaiton. */
-    uint8_t flags;
-    /** The hash algorithm identifier. */
-    HASH_ID id;
-    /** The length of the hash algorithm output. */
-    int len;
-    /** The length of the context required for the hash algorithm. */
-    int ctx_len;
-    /** The initialization function of the hash algorithm. */
-    HASH_INIT *init;
-    /** The update function of the hash algorithm. */
-    HASH_UPDATE *update;
-    /** The finalization function of the hash algorithm. */
-    HASH_FINAL *final;
-} HASH_METH;
+#include "hash_xxh3.h"
+#include "hash_crc32c.h"
+#include "hash_openssl.h"
+#include "hash_afalg.h"
+#include "hash_cpu.h"
+#include "hash_meth.h"
 
 /** The hash structure. */
 struct hash_st
@@ -71,149 +51,739 @@ struct hash_st
 
 /**
  * The hash algorithm implementations.
- * The first entry with the matching identifier is used.
+ * Implementations are ranked by priority and those needing CPU features that
+ * are not available are never used.
  */
 static HASH_METH hash_meths[] =
 {
 #ifdef OPT_HASH_OPENSSL
     /* OpenSSL implementation of SHA-1. */
-    { "SHA-224 OpenSSL", 0,
-      HASH_ID_SHA1, 160/8, sizeof(SHA_CTX),
-      (HASH_INIT *)&SHA1_Init, (HASH_UPDATE *)&SHA1_Update,
-      (HASH_FINAL *)&SHA1_Final },
+    { "SHA-1 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA1, HASH_SHA1_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha1_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
     /* OpenSSL implementation of SHA-224. */
-    { "SHA-224 OpenSSL", 0,
-      HASH_ID_SHA224, 224/8, sizeof(SHA256_CTX),
-      (HASH_INIT *)&SHA224_Init, (HASH_UPDATE *)&SHA224_Update,
-      (HASH_FINAL *)&SHA224_Final },
+    { "SHA-224 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA224, HASH_SHA224_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha224_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
     /* OpenSSL implementation of SHA-256. */
-    { "SHA-256 OpenSSL", 0,
-      HASH_ID_SHA256, 256/8, sizeof(SHA256_CTX),
-      (HASH_INIT *)&SHA256_Init, (HASH_UPDATE *)&SHA256_Update,
-      (HASH_FINAL *)&SHA256_Final },
+    { "SHA-256 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA256, HASH_SHA256_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha256_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
     /* OpenSSL implementation of SHA-384. */
-    { "SHA-384 OpenSSL", 0,
-      HASH_ID_SHA384, 384/8, sizeof(SHA512_CTX),
-      (HASH_INIT *)&SHA384_Init, (HASH_UPDATE *)&SHA384_Update,
-      (HASH_FINAL *)&SHA384_Final },
+    { "SHA-384 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA384, HASH_SHA384_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha384_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
     /* OpenSSL implementation of SHA-512. */
-    { "SHA-512 OpenSSL", 0,
-      HASH_ID_SHA512, 512/8, sizeof(SHA512_CTX),
-      (HASH_INIT *)&SHA512_Init, (HASH_UPDATE *)&SHA512_Update,
-      (HASH_FINAL *)&SHA512_Final },
+    { "SHA-512 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA512, HASH_SHA512_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha512_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHA-512_224. */
+    { "SHA-512_224 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA512_224, HASH_SHA512_224_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha512_224_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHA-512_256. */
+    { "SHA-512_256 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA512_256, HASH_SHA512_256_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha512_256_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHA3-224. */
+    { "SHA-3_224 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA3_224, HASH_SHA3_224_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha3_224_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHA3-256. */
+    { "SHA-3_256 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA3_256, HASH_SHA3_256_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha3_256_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHA3-384. */
+    { "SHA-3_384 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA3_384, HASH_SHA3_384_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha3_384_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHA3-512. */
+    { "SHA-3_512 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHA3_512, HASH_SHA3_512_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_sha3_512_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of BLAKE2B with 512-bit output. */
+    { "BLAKE2b_512 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_BLAKE2B_512, HASH_BLAKE2B_512_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_blake2b_512_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of BLAKE2S with 256-bit output. */
+    { "BLAKE2s_256 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_BLAKE2S_256, HASH_BLAKE2S_256_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_blake2s_256_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHAKE128. */
+    { "SHAKE128 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHAKE128, HASH_SHAKE128_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_shake128_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHAKE256. */
+    { "SHAKE256 OpenSSL", HASH_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      HASH_ID_SHAKE256, HASH_SHAKE256_LEN, sizeof(HASH_OPENSSL), 0,
+      (HASH_INIT *)&hash_openssl_shake256_init,
+      (HASH_UPDATE *)&hash_openssl_update,
+      (HASH_FINAL *)&hash_openssl_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_openssl_dup,
+      (HASH_CLEANUP *)&hash_openssl_cleanup },
+#endif
+#ifdef OPT_HASH_AFALG
+    /* Linux kernel implementation of SHA-1. */
+    { "SHA-1 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_SHA1, HASH_SHA1_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_sha1_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of SHA-224. */
+    { "SHA-224 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_SHA224, HASH_SHA224_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_sha224_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of SHA-256. */
+    { "SHA-256 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_SHA256, HASH_SHA256_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_sha256_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of SHA-384. */
+    { "SHA-384 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_SHA384, HASH_SHA384_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_sha384_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of SHA-512. */
+    { "SHA-512 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_SHA512, HASH_SHA512_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_sha512_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of SHA3-224. */
+    { "SHA-3_224 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_SHA3_224, HASH_SHA3_224_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_sha3_224_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of SHA3-256. */
+    { "SHA-3_256 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_SHA3_256, HASH_SHA3_256_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_sha3_256_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of SHA3-384. */
+    { "SHA-3_384 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_SHA3_384, HASH_SHA3_384_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_sha3_384_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of SHA3-512. */
+    { "SHA-3_512 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_SHA3_512, HASH_SHA3_512_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_sha3_512_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of BLAKE2B with 256-bit output. */
+    { "BLAKE2b_256 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_BLAKE2B_256, HASH_BLAKE2B_256_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_blake2b_256_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of BLAKE2B with 384-bit output. */
+    { "BLAKE2b_384 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_BLAKE2B_384, HASH_BLAKE2B_384_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_blake2b_384_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+    /* Linux kernel implementation of BLAKE2B with 512-bit output. */
+    { "BLAKE2b_512 AF_ALG", HASH_METH_FLAG_AFALG, HASH_METH_PRIO_AFALG,
+      HASH_ID_BLAKE2B_512, HASH_BLAKE2B_512_LEN, sizeof(HASH_AFALG), 0,
+      (HASH_INIT *)&hash_afalg_blake2b_512_init,
+      (HASH_UPDATE *)&hash_afalg_update,
+      (HASH_FINAL *)&hash_afalg_final,
+      0, NULL, NULL,
+      NULL, NULL,
+      (HASH_DUP *)&hash_afalg_dup,
+      (HASH_CLEANUP *)&hash_afalg_cleanup },
+#endif
+#ifdef CPU_X86_64
+    /* Implementation of SHA-1 using the SHA extensions. */
+    { "SHA-1 SHA-NI", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_SHANI,
+      HASH_METH_PRIO_CPU,
+      HASH_ID_SHA1, HASH_SHA1_LEN, sizeof(HASH_SHA1), 0,
+      (HASH_INIT *)&hash_sha1_init,
+      (HASH_UPDATE *)&hash_sha1_ni_update,
+      (HASH_FINAL *)&hash_sha1_ni_final,
+      HASH_SHA1_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha1_export,
+      (HASH_IMPORT *)&hash_sha1_import,
+      NULL, NULL, NULL, NULL },
+    /* Implementation of SHA-224 using the SHA extensions. */
+    { "SHA-224 SHA-NI", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_SHANI,
+      HASH_METH_PRIO_CPU,
+      HASH_ID_SHA224, HASH_SHA224_LEN, sizeof(HASH_SHA256), 0,
+      (HASH_INIT *)&hash_sha224_init,
+      (HASH_UPDATE *)&hash_sha256_ni_update,
+      (HASH_FINAL *)&hash_sha224_ni_final,
+      HASH_SHA256_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha256_export,
+      (HASH_IMPORT *)&hash_sha256_import,
+      NULL, NULL, NULL, NULL },
+    /* Implementation of SHA-256 using the SHA extensions. */
+    { "SHA-256 SHA-NI", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_SHANI,
+      HASH_METH_PRIO_CPU,
+      HASH_ID_SHA256, HASH_SHA256_LEN, sizeof(HASH_SHA256), 0,
+      (HASH_INIT *)&hash_sha256_init,
+      (HASH_UPDATE *)&hash_sha256_ni_update,
+      (HASH_FINAL *)&hash_sha256_ni_final,
+      HASH_SHA256_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha256_export,
+      (HASH_IMPORT *)&hash_sha256_import,
+      NULL, NULL, NULL, NULL },
+    /* SHA-224 with many messages digested at once using AVX2 - batch only. */
+    { "SHA-224 AVX2 batch", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_AVX2,
+      HASH_METH_PRIO_BATCH,
+      HASH_ID_SHA224, HASH_SHA224_LEN, sizeof(HASH_SHA256), 0,
+      (HASH_INIT *)&hash_sha224_init,
+      (HASH_UPDATE *)&hash_sha224_update,
+      (HASH_FINAL *)&hash_sha224_final,
+      HASH_SHA256_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha256_export,
+      (HASH_IMPORT *)&hash_sha256_import,
+      NULL,
+      (HASH_BATCH *)&hash_sha224_avx2_batch,
+      NULL, NULL },
+    /* SHA-256 with many messages digested at once using AVX2 - batch only. */
+    { "SHA-256 AVX2 batch", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_AVX2,
+      HASH_METH_PRIO_BATCH,
+      HASH_ID_SHA256, HASH_SHA256_LEN, sizeof(HASH_SHA256), 0,
+      (HASH_INIT *)&hash_sha256_init,
+      (HASH_UPDATE *)&hash_sha256_update,
+      (HASH_FINAL *)&hash_sha256_final,
+      HASH_SHA256_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha256_export,
+      (HASH_IMPORT *)&hash_sha256_import,
+      NULL,
+      (HASH_BATCH *)&hash_sha256_avx2_batch,
+      NULL, NULL },
+    /* Implementation of XXH3 with 64-bit output using AVX2. */
+    { "XXH3-64 AVX2", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_NONCRYPTO |
+      HASH_METH_FLAG_AVX2,
+      HASH_METH_PRIO_CPU,
+      HASH_ID_XXH3_64, HASH_XXH3_64_LEN, sizeof(HASH_XXH3), 0,
+      (HASH_INIT *)&hash_xxh3_init,
+      (HASH_UPDATE *)&hash_xxh3_avx2_update,
+      (HASH_FINAL *)&hash_xxh3_64_avx2_final,
+      HASH_XXH3_STATE_LEN,
+      (HASH_EXPORT *)&hash_xxh3_export,
+      (HASH_IMPORT *)&hash_xxh3_import,
+      (HASH_DIGEST *)&hash_xxh3_64_avx2_digest, NULL, NULL, NULL },
+    /* Implementation of XXH3 with 128-bit output using AVX2. */
+    { "XXH3-128 AVX2", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_NONCRYPTO |
+      HASH_METH_FLAG_AVX2,
+      HASH_METH_PRIO_CPU,
+      HASH_ID_XXH3_128, HASH_XXH3_128_LEN, sizeof(HASH_XXH3), 0,
+      (HASH_INIT *)&hash_xxh3_init,
+      (HASH_UPDATE *)&hash_xxh3_avx2_update,
+      (HASH_FINAL *)&hash_xxh3_128_avx2_final,
+      HASH_XXH3_STATE_LEN,
+      (HASH_EXPORT *)&hash_xxh3_export,
+      (HASH_IMPORT *)&hash_xxh3_import,
+      (HASH_DIGEST *)&hash_xxh3_128_avx2_digest, NULL, NULL, NULL },
+    /* Implementation of XXH3 with 64-bit output using SSE2. */
+    { "XXH3-64 SSE2", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_NONCRYPTO,
+      HASH_METH_PRIO_CPU,
+      HASH_ID_XXH3_64, HASH_XXH3_64_LEN, sizeof(HASH_XXH3), 0,
+      (HASH_INIT *)&hash_xxh3_init,
+      (HASH_UPDATE *)&hash_xxh3_sse2_update,
+      (HASH_FINAL *)&hash_xxh3_64_sse2_final,
+      HASH_XXH3_STATE_LEN,
+      (HASH_EXPORT *)&hash_xxh3_export,
+      (HASH_IMPORT *)&hash_xxh3_import,
+      (HASH_DIGEST *)&hash_xxh3_64_sse2_digest, NULL, NULL, NULL },
+    /* Implementation of XXH3 with 128-bit output using SSE2. */
+    { "XXH3-128 SSE2", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_NONCRYPTO,
+      HASH_METH_PRIO_CPU,
+      HASH_ID_XXH3_128, HASH_XXH3_128_LEN, sizeof(HASH_XXH3), 0,
+      (HASH_INIT *)&hash_xxh3_init,
+      (HASH_UPDATE *)&hash_xxh3_sse2_update,
+      (HASH_FINAL *)&hash_xxh3_128_sse2_final,
+      HASH_XXH3_STATE_LEN,
+      (HASH_EXPORT *)&hash_xxh3_export,
+      (HASH_IMPORT *)&hash_xxh3_import,
+      (HASH_DIGEST *)&hash_xxh3_128_sse2_digest, NULL, NULL, NULL },
+    /* Implementation of CRC32C folding with PCLMULQDQ. */
+    { "CRC32C PCLMUL", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_NONCRYPTO |
+      HASH_METH_FLAG_SSE42 | HASH_METH_FLAG_PCLMUL,
+      HASH_METH_PRIO_CPU,
+      HASH_ID_CRC32C, HASH_CRC32C_LEN, sizeof(HASH_CRC32C), 0,
+      (HASH_INIT *)&hash_crc32c_init,
+      (HASH_UPDATE *)&hash_crc32c_pclmul_update,
+      (HASH_FINAL *)&hash_crc32c_final,
+      HASH_CRC32C_STATE_LEN,
+      (HASH_EXPORT *)&hash_crc32c_export,
+      (HASH_IMPORT *)&hash_crc32c_import,
+      (HASH_DIGEST *)&hash_crc32c_pclmul_digest, NULL, NULL, NULL },
+    /* Implementation of CRC32C with three streams of SSE4.2 crc32. */
+    { "CRC32C SSE4.2", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_NONCRYPTO |
+      HASH_METH_FLAG_SSE42,
+      HASH_METH_PRIO_CPU,
+      HASH_ID_CRC32C, HASH_CRC32C_LEN, sizeof(HASH_CRC32C), 0,
+      (HASH_INIT *)&hash_crc32c_init,
+      (HASH_UPDATE *)&hash_crc32c_sse42_update,
+      (HASH_FINAL *)&hash_crc32c_final,
+      HASH_CRC32C_STATE_LEN,
+      (HASH_EXPORT *)&hash_crc32c_export,
+      (HASH_IMPORT *)&hash_crc32c_import,
+      (HASH_DIGEST *)&hash_crc32c_sse42_digest, NULL, NULL, NULL },
 #endif
     /* Implementation of SHA-1. */
-    { "SHA-1 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA1, HASH_SHA1_LEN, sizeof(HASH_SHA1),
+    { "SHA-1 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA1, HASH_SHA1_LEN, sizeof(HASH_SHA1), 0,
       (HASH_INIT *)&hash_sha1_init,
       (HASH_UPDATE *)&hash_sha1_update,
-      (HASH_FINAL *)&hash_sha1_final },
+      (HASH_FINAL *)&hash_sha1_final,
+      HASH_SHA1_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha1_export,
+      (HASH_IMPORT *)&hash_sha1_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of SHA-224. */
-    { "SHA-224 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA224, HASH_SHA224_LEN, sizeof(HASH_SHA256),
+    { "SHA-224 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA224, HASH_SHA224_LEN, sizeof(HASH_SHA256), 0,
       (HASH_INIT *)&hash_sha224_init,
       (HASH_UPDATE *)&hash_sha256_update,
-      (HASH_FINAL *)&hash_sha224_final },
+      (HASH_FINAL *)&hash_sha224_final,
+      HASH_SHA256_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha256_export,
+      (HASH_IMPORT *)&hash_sha256_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of SHA-256. */
-    { "SHA-256 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA256, HASH_SHA256_LEN, sizeof(HASH_SHA256),
+    { "SHA-256 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA256, HASH_SHA256_LEN, sizeof(HASH_SHA256), 0,
       (HASH_INIT *)&hash_sha256_init,
       (HASH_UPDATE *)&hash_sha256_update,
-      (HASH_FINAL *)&hash_sha256_final },
+      (HASH_FINAL *)&hash_sha256_final,
+      HASH_SHA256_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha256_export,
+      (HASH_IMPORT *)&hash_sha256_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of SHA-384. */
-    { "SHA-384 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA384, HASH_SHA384_LEN, sizeof(HASH_SHA512),
+    { "SHA-384 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA384, HASH_SHA384_LEN, sizeof(HASH_SHA512), 0,
       (HASH_INIT *)&hash_sha384_init,
       (HASH_UPDATE *)&hash_sha512_update,
-      (HASH_FINAL *)&hash_sha384_final },
+      (HASH_FINAL *)&hash_sha384_final,
+      HASH_SHA512_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha512_export,
+      (HASH_IMPORT *)&hash_sha512_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of SHA-512. */
-    { "SHA-512 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA512, HASH_SHA512_LEN, sizeof(HASH_SHA512),
+    { "SHA-512 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA512, HASH_SHA512_LEN, sizeof(HASH_SHA512), 0,
       (HASH_INIT *)&hash_sha512_init,
       (HASH_UPDATE *)&hash_sha512_update,
-      (HASH_FINAL *)&hash_sha512_final },
+      (HASH_FINAL *)&hash_sha512_final,
+      HASH_SHA512_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha512_export,
+      (HASH_IMPORT *)&hash_sha512_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of SHA-512_224. */
-    { "SHA-512_224 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA512_224, HASH_SHA512_224_LEN, sizeof(HASH_SHA512),
+    { "SHA-512_224 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA512_224, HASH_SHA512_224_LEN, sizeof(HASH_SHA512), 0,
       (HASH_INIT *)&hash_sha512_224_init,
       (HASH_UPDATE *)&hash_sha512_update,
-      (HASH_FINAL *)&hash_sha512_224_final },
+      (HASH_FINAL *)&hash_sha512_224_final,
+      HASH_SHA512_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha512_export,
+      (HASH_IMPORT *)&hash_sha512_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of SHA-512_256. */
-    { "SHA-512_256 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA512_256, HASH_SHA512_256_LEN, sizeof(HASH_SHA512),
+    { "SHA-512_256 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA512_256, HASH_SHA512_256_LEN, sizeof(HASH_SHA512), 0,
       (HASH_INIT *)&hash_sha512_256_init,
       (HASH_UPDATE *)&hash_sha512_update,
-      (HASH_FINAL *)&hash_sha512_256_final },
+      (HASH_FINAL *)&hash_sha512_256_final,
+      HASH_SHA512_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha512_export,
+      (HASH_IMPORT *)&hash_sha512_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of SHA3-224. */
-    { "SHA-3_224 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA3_224, HASH_SHA3_224_LEN, sizeof(HASH_SHA3),
+    { "SHA-3_224 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA3_224, HASH_SHA3_224_LEN, sizeof(HASH_SHA3), 0,
       (HASH_INIT *)&hash_sha3_init,
       (HASH_UPDATE *)&hash_sha3_224_update,
-      (HASH_FINAL *)&hash_sha3_224_final },
+      (HASH_FINAL *)&hash_sha3_224_final,
+      HASH_SHA3_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha3_export,
+      (HASH_IMPORT *)&hash_sha3_224_import,
+      (HASH_DIGEST *)&hash_sha3_224, NULL, NULL, NULL },
     /* Implementation of SHA3-256. */
-    { "SHA-3_256 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA3_256, HASH_SHA3_256_LEN, sizeof(HASH_SHA3),
+    { "SHA-3_256 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA3_256, HASH_SHA3_256_LEN, sizeof(HASH_SHA3), 0,
       (HASH_INIT *)&hash_sha3_init,
       (HASH_UPDATE *)&hash_sha3_256_update,
-      (HASH_FINAL *)&hash_sha3_256_final },
+      (HASH_FINAL *)&hash_sha3_256_final,
+      HASH_SHA3_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha3_export,
+      (HASH_IMPORT *)&hash_sha3_256_import,
+      (HASH_DIGEST *)&hash_sha3_256, NULL, NULL, NULL },
     /* Implementation of SHA3-384. */
-    { "SHA-3_384 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA3_384, HASH_SHA3_384_LEN, sizeof(HASH_SHA3),
+    { "SHA-3_384 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA3_384, HASH_SHA3_384_LEN, sizeof(HASH_SHA3), 0,
       (HASH_INIT *)&hash_sha3_init,
       (HASH_UPDATE *)&hash_sha3_384_update,
-      (HASH_FINAL *)&hash_sha3_384_final },
+      (HASH_FINAL *)&hash_sha3_384_final,
+      HASH_SHA3_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha3_export,
+      (HASH_IMPORT *)&hash_sha3_384_import,
+      (HASH_DIGEST *)&hash_sha3_384, NULL, NULL, NULL },
     /* Implementation of SHA3-512. */
-    { "SHA-3_512 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_SHA3_512, HASH_SHA3_512_LEN, sizeof(HASH_SHA3),
+    { "SHA-3_512 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHA3_512, HASH_SHA3_512_LEN, sizeof(HASH_SHA3), 0,
       (HASH_INIT *)&hash_sha3_init,
       (HASH_UPDATE *)&hash_sha3_512_update,
-      (HASH_FINAL *)&hash_sha3_512_final },
+      (HASH_FINAL *)&hash_sha3_512_final,
+      HASH_SHA3_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha3_export,
+      (HASH_IMPORT *)&hash_sha3_512_import,
+      (HASH_DIGEST *)&hash_sha3_512, NULL, NULL, NULL },
     /* Implementation of BLAKE2B with 224-bit output. */
-    { "BLAKE2b_224 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_BLAKE2B_224, HASH_BLAKE2B_224_LEN, sizeof(HASH_BLAKE2B),
+    { "BLAKE2b_224 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_BLAKE2B_224, HASH_BLAKE2B_224_LEN, sizeof(HASH_BLAKE2B), 0,
       (HASH_INIT *)&hash_blake2b_224_init,
       (HASH_UPDATE *)&hash_blake2b_update,
-      (HASH_FINAL *)&hash_blake2b_224_final },
+      (HASH_FINAL *)&hash_blake2b_224_final,
+      HASH_BLAKE2B_STATE_LEN,
+      (HASH_EXPORT *)&hash_blake2b_export,
+      (HASH_IMPORT *)&hash_blake2b_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2B with 256-bit output. */
-    { "BLAKE2b_256 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_BLAKE2B_256, HASH_BLAKE2B_256_LEN, sizeof(HASH_BLAKE2B),
+    { "BLAKE2b_256 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_BLAKE2B_256, HASH_BLAKE2B_256_LEN, sizeof(HASH_BLAKE2B), 0,
       (HASH_INIT *)&hash_blake2b_256_init,
       (HASH_UPDATE *)&hash_blake2b_update,
-      (HASH_FINAL *)&hash_blake2b_256_final },
+      (HASH_FINAL *)&hash_blake2b_256_final,
+      HASH_BLAKE2B_STATE_LEN,
+      (HASH_EXPORT *)&hash_blake2b_export,
+      (HASH_IMPORT *)&hash_blake2b_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2B with 384-bit output. */
-    { "BLAKE2b_384 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_BLAKE2B_384, HASH_BLAKE2B_384_LEN, sizeof(HASH_BLAKE2B),
+    { "BLAKE2b_384 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_BLAKE2B_384, HASH_BLAKE2B_384_LEN, sizeof(HASH_BLAKE2B), 0,
       (HASH_INIT *)&hash_blake2b_384_init,
       (HASH_UPDATE *)&hash_blake2b_update,
-      (HASH_FINAL *)&hash_blake2b_384_final },
+      (HASH_FINAL *)&hash_blake2b_384_final,
+      HASH_BLAKE2B_STATE_LEN,
+      (HASH_EXPORT *)&hash_blake2b_export,
+      (HASH_IMPORT *)&hash_blake2b_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2B with 512-bit output. */
-    { "BLAKE2b_512 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_BLAKE2B_512, HASH_BLAKE2B_512_LEN, sizeof(HASH_BLAKE2B),
+    { "BLAKE2b_512 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_BLAKE2B_512, HASH_BLAKE2B_512_LEN, sizeof(HASH_BLAKE2B), 0,
       (HASH_INIT *)&hash_blake2b_512_init,
       (HASH_UPDATE *)&hash_blake2b_update,
-      (HASH_FINAL *)&hash_blake2b_512_final },
+      (HASH_FINAL *)&hash_blake2b_512_final,
+      HASH_BLAKE2B_STATE_LEN,
+      (HASH_EXPORT *)&hash_blake2b_export,
+      (HASH_IMPORT *)&hash_blake2b_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2S with 224-bit output. */
-    { "BLAKE2s_224 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_BLAKE2S_224, HASH_BLAKE2S_224_LEN, sizeof(HASH_BLAKE2S),
+    { "BLAKE2s_224 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_BLAKE2S_224, HASH_BLAKE2S_224_LEN, sizeof(HASH_BLAKE2S), 0,
       (HASH_INIT *)&hash_blake2s_224_init,
       (HASH_UPDATE *)&hash_blake2s_update,
-      (HASH_FINAL *)&hash_blake2s_224_final },
+      (HASH_FINAL *)&hash_blake2s_224_final,
+      HASH_BLAKE2S_STATE_LEN,
+      (HASH_EXPORT *)&hash_blake2s_export,
+      (HASH_IMPORT *)&hash_blake2s_import,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2S with 256-bit output. */
-    { "BLAKE2s_256 C", HASH_METH_FLAG_INTERNAL,
-      HASH_ID_BLAKE2S_256, HASH_BLAKE2S_256_LEN, sizeof(HASH_BLAKE2S),
+    { "BLAKE2s_256 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_BLAKE2S_256, HASH_BLAKE2S_256_LEN, sizeof(HASH_BLAKE2S), 0,
       (HASH_INIT *)&hash_blake2s_256_init,
       (HASH_UPDATE *)&hash_blake2s_update,
-      (HASH_FINAL *)&hash_blake2s_256_final },
+      (HASH_FINAL *)&hash_blake2s_256_final,
+      HASH_BLAKE2S_STATE_LEN,
+      (HASH_EXPORT *)&hash_blake2s_export,
+      (HASH_IMPORT *)&hash_blake2s_import,
+      NULL, NULL, NULL, NULL },
+    /* Implementation of SHAKE128 with 256-bit output. */
+    { "SHAKE128 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHAKE128, HASH_SHAKE128_LEN, sizeof(HASH_SHA3), 0,
+      (HASH_INIT *)&hash_sha3_init,
+      (HASH_UPDATE *)&hash_shake128_update,
+      (HASH_FINAL *)&hash_shake128_final,
+      HASH_SHA3_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha3_export,
+      (HASH_IMPORT *)&hash_shake128_import,
+      (HASH_DIGEST *)&hash_shake128_digest, NULL, NULL, NULL },
+    /* Implementation of SHAKE256 with 512-bit output. */
+    { "SHAKE256 C", HASH_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      HASH_ID_SHAKE256, HASH_SHAKE256_LEN, sizeof(HASH_SHA3), 0,
+      (HASH_INIT *)&hash_sha3_init,
+      (HASH_UPDATE *)&hash_shake256_update,
+      (HASH_FINAL *)&hash_shake256_final,
+      HASH_SHA3_STATE_LEN,
+      (HASH_EXPORT *)&hash_sha3_export,
+      (HASH_IMPORT *)&hash_shake256_import,
+      (HASH_DIGEST *)&hash_shake256_digest, NULL, NULL, NULL },
+    /* Implementation of XXH3 with 64-bit output. */
+    { "XXH3-64 C", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_NONCRYPTO,
+      HASH_METH_PRIO_C,
+      HASH_ID_XXH3_64, HASH_XXH3_64_LEN, sizeof(HASH_XXH3), 0,
+      (HASH_INIT *)&hash_xxh3_init,
+      (HASH_UPDATE *)&hash_xxh3_update,
+      (HASH_FINAL *)&hash_xxh3_64_final,
+      HASH_XXH3_STATE_LEN,
+      (HASH_EXPORT *)&hash_xxh3_export,
+      (HASH_IMPORT *)&hash_xxh3_import,
+      (HASH_DIGEST *)&hash_xxh3_64_digest, NULL, NULL, NULL },
+    /* Implementation of XXH3 with 128-bit output. */
+    { "XXH3-128 C", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_NONCRYPTO,
+      HASH_METH_PRIO_C,
+      HASH_ID_XXH3_128, HASH_XXH3_128_LEN, sizeof(HASH_XXH3), 0,
+      (HASH_INIT *)&hash_xxh3_init,
+      (HASH_UPDATE *)&hash_xxh3_update,
+      (HASH_FINAL *)&hash_xxh3_128_final,
+      HASH_XXH3_STATE_LEN,
+      (HASH_EXPORT *)&hash_xxh3_export,
+      (HASH_IMPORT *)&hash_xxh3_import,
+      (HASH_DIGEST *)&hash_xxh3_128_digest, NULL, NULL, NULL },
+    /* Implementation of CRC32C. */
+    { "CRC32C C", HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_NONCRYPTO,
+      HASH_METH_PRIO_C,
+      HASH_ID_CRC32C, HASH_CRC32C_LEN, sizeof(HASH_CRC32C), 0,
+      (HASH_INIT *)&hash_crc32c_init,
+      (HASH_UPDATE *)&hash_crc32c_update,
+      (HASH_FINAL *)&hash_crc32c_final,
+      HASH_CRC32C_STATE_LEN,
+      (HASH_EXPORT *)&hash_crc32c_export,
+      (HASH_IMPORT *)&hash_crc32c_import,
+      (HASH_DIGEST *)&hash_crc32c_digest, NULL, NULL, NULL },
 };
 /** The number of hash algorithm implementations. */
 #define HASH_METHS_LEN   ((int)(sizeof(hash_meths)/sizeof(*hash_meths)))
 
+/** The number of hash algorithm identifiers. */
+#define HASH_ID_NUM	(HASH_ID_CRC32C + 1)
+
+/** The length of the header on an exported state: version and identifier. */
+#define HASH_STATE_HDR_LEN	2
+/** The alignment that a context on the stack is guaranteed to have. */
+#define HASH_STACK_ALIGN	8
+/** The size of the buffer that data read from a file descriptor is put in. */
+#define HASH_FD_BUF_LEN		(64 * 1024)
+
+/**
+ * The implementations of each hash algorithm that the CPU supports, ordered by
+ * priority. NULL terminated.
+ */
+static HASH_METH *hash_meth_rank[HASH_ID_NUM][HASH_METHS_LEN +
+    HASH_METH_REG_MAX + 1];
+/** Ensures the implementations are only ranked once. */
+static pthread_once_t hash_meth_rank_once = PTHREAD_ONCE_INIT;
+
+/** The implementations registered by the application. */
+static HASH_METH hash_meth_reg[HASH_METH_REG_MAX];
+/** The number of implementations registered by the application. */
+static int hash_meth_reg_cnt = 0;
+/** Serializes registering implementations. */
+static pthread_mutex_t hash_meth_reg_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Add an implementation into the ranking of its hash algorithm.
+ * Placed after the implementations of the same or higher priority.
+ *
+ * @param [in] meth  The hash algorithm method.
+ */
+static void hash_meth_rank_add(HASH_METH *meth)
+{
+    int j;
+    HASH_METH **rank = hash_meth_rank[meth->id];
+
+    for (j=0; rank[j] != NULL; j++)
+        ;
+    for (; (j > 0) && (rank[j-1]->priority < meth->priority); j--)
+        rank[j] = rank[j-1];
+    rank[j] = meth;
+}
+
+/**
+ * Rank the implementations of each hash algorithm.
+ * Implementations of the same priority stay in table order.
+ */
+static void hash_meth_rank_init(void)
+{
+    int cpu = hash_cpu_flags();
+    int i;
+
+    for (i=0; i<HASH_METHS_LEN; i++)
+    {
+        /* Skip implementations that need features the CPU doesn't have. */
+        if ((hash_meths[i].flags & HASH_METH_FLAG_CPU & ~cpu) != 0)
+            continue;
+#ifdef OPT_HASH_AFALG
+        /* Skip algorithms the kernel doesn't have - internal code is used. */
+        if (((hash_meths[i].flags & HASH_METH_FLAG_AFALG) != 0) &&
+            !hash_afalg_available(hash_meths[i].id))
+        {
+            continue;
+        }
+#endif
+        hash_meth_rank_add(&hash_meths[i]);
+    }
+}
+
+/**
+ * Get the ranked implementations of the hash algorithm.
+ *
+ * @param [in] id  The hash algorithm identifier.
+ * @return  NULL when the identifier is not valid.<br>
+ *          NULL terminated array of methods, best first, otherwise.
+ */
+static HASH_METH **hash_meth_ranked(HASH_ID id)
+{
+    if ((id < 0) || (id >= HASH_ID_NUM))
+        return NULL;
+
+    pthread_once(&hash_meth_rank_once, hash_meth_rank_init);
+    return hash_meth_rank[id];
+}
+
 /**
  * Get the hash algorithm method by id.
+ * The highest priority implementation that has all the required flags and
+ * none of the excluded flags is used. Non-cryptographic implementations are
+ * only used when HASH_METH_FLAG_NONCRYPTO is required.
  *
  * @param [in]  id     The hash algorithm identifier.
- * @param [in]  flags  The method implementation flags required.
- * @parma [out] meth   The hash algorithm method.
+ * @param [in]  flags  The method implementation flags required and, shifted
+ *                     with HASH_METH_FLAG_EXCLUDE, the flags excluded.
+ * @param [out] meth   The hash algorithm method.
  * @return  HASH_ERR_NOT_FOUND when there is no implementation for the hash
  *          algorithm.<br>
  *          0 otherwise.
@@ -221,224 +791,1005 @@ static HASH_METH hash_meths[] =
 int hash_meth_get(HASH_ID id, int flags, HASH_METH **meth)
 {
     int ret = 0;
-    int i;
+    int req = flags & 0xffff;
+    int excl = (flags >> 16) & 0xffff;
+    HASH_METH **rank;
+
+    /* Never hand out a non-cryptographic hash by accident. */
+    if ((req & HASH_METH_FLAG_NONCRYPTO) == 0)
+        excl |= HASH_METH_FLAG_NONCRYPTO;
 
     *meth = NULL;
-    /* Find the first matching method. */
-    for (i=0; i<HASH_METHS_LEN; i++)
+    rank = hash_meth_ranked(id);
+    if (rank == NULL)
+    {
+        ret = HASH_ERR_NOT_FOUND;
+        goto end;
+    }
+
+    /* Find the best matching method. */
+    for (; *rank != NULL; rank++)
     {
-        if ((hash_meths[i].id == id) &&
-            ((hash_meths[i].flags & flags) == flags))
+        if ((((*rank)->flags & req) == req) && (((*rank)->flags & excl) == 0))
         {
-            *meth = &hash_meths[i];
+            *meth = *rank;
             break;
         }
     }
 
     if (*meth == NULL)
         ret = HASH_ERR_NOT_FOUND;
-
+end:
     return ret;
 }
 
 /**
- * Get the length of the digest that will be calculated using the hash
- * algorithm.
+ * Allocate a zeroed context for the method with the alignment it requires.
  *
- * @param [in]  hash  The hash algorithm identifier.
- * @param [out] len   The length of a message digest.
- * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
- *          HASH_ERR_NOT_FOUND when there is no implementation for the hash
- *          algorithm.<br>
- *          0 otherwise.
+ * @param [in] meth  The hash algorithm method.
+ * @return  NULL when allocating dynamic memory failed.<br>
+ *          The context otherwise. Free with hash_ctx_free().
  */
-int HASH_METH_get_len(HASH_ID id, int *len)
+static void *hash_ctx_alloc(HASH_METH *meth)
+{
+    void *ctx = NULL;
+
+    if (meth->align <= (int)sizeof(void *))
+        ctx = malloc(meth->ctx_len);
+    else if (posix_memalign(&ctx, meth->align, meth->ctx_len) != 0)
+        ctx = NULL;
+    if (ctx != NULL)
+        memset(ctx, 0, meth->ctx_len);
+
+    return ctx;
+}
+
+/**
+ * Free a context allocated for the method and what the context owns.
+ *
+ * @param [in] meth  The hash algorithm method.
+ * @param [in] ctx   The context. May be NULL.
+ */
+static void hash_ctx_free(HASH_METH *meth, void *ctx)
+{
+    if (ctx != NULL)
+    {
+        if (meth->cleanup != NULL)
+            meth->cleanup(ctx);
+        free(ctx);
+    }
+}
+
+/** The number of message size buckets that implementations are tuned for. */
+#define HASH_TUNE_BUCKETS	6
+/** The version of the calibration cache file format. */
+#define HASH_TUNE_VERSION	2
+/** The number of messages in a batch when calibrating batch functions. */
+#define HASH_TUNE_BATCH		16
+/** The largest message length of each size bucket. The last has no limit. */
+static const size_t hash_tune_len[HASH_TUNE_BUCKETS] =
+{
+    16, 64, 256, 1024, 8192, 16384
+};
+
+/**
+ * The fastest implementations of a hash algorithm for each size bucket.
+ * NULL when not calibrated - use the highest ranked implementation.
+ */
+typedef struct hash_tune_st
+{
+    /** For one message - used by HASH_digest. */
+    HASH_METH *digest[HASH_TUNE_BUCKETS];
+    /**
+     * For a batch of messages - an implementation with a batch function or
+     * the one digesting each message in turn. Used by HASH_batch.
+     */
+    HASH_METH *batch[HASH_TUNE_BUCKETS];
+} HASH_TUNE;
+
+/** The calibrated implementations of each hash algorithm. */
+static HASH_TUNE hash_meth_tuned[HASH_ID_NUM];
+/** Serializes calibrations. */
+static pthread_mutex_t hash_tune_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Get the size bucket of a message length.
+ *
+ * @param [in] len  The length of the message.
+ * @return  The index of the size bucket.
+ */
+static int hash_tune_bucket(size_t len)
 {
-    int ret = HASH_ERR_NOT_FOUND;
     int i;
 
-    /* Find the first matching method. */
-    for (i=0; i<HASH_METHS_LEN; i++)
+    for (i=0; i<HASH_TUNE_BUCKETS-1; i++)
     {
-        if (hash_meths[i].id == id)
-        {
-            *len = hash_meths[i].len;
-            ret = 0;
+        if (len <= hash_tune_len[i])
             break;
-        }
     }
 
+    return i;
+}
+
+/**
+ * Get the hash algorithm method to digest a message of the length.
+ * Uses the calibrated implementation for the size when available.
+ *
+ * @param [in]  id    The hash algorithm identifier.
+ * @param [in]  len   The length of the message.
+ * @param [out] meth  The hash algorithm method.
+ * @return  HASH_ERR_NOT_FOUND when there is no implementation for the hash
+ *          algorithm.<br>
+ *          0 otherwise.
+ */
+static int hash_meth_get_size(HASH_ID id, size_t len, HASH_METH **meth)
+{
+    int ret = 0;
+
+    if ((id >= 0) && (id < HASH_ID_NUM))
+        *meth = hash_meth_tuned[id].digest[hash_tune_bucket(len)];
+    else
+        *meth = NULL;
+    /* Calibration tunes every algorithm - only digest cryptographic ones. */
+    if ((*meth != NULL) && (((*meth)->flags & HASH_METH_FLAG_NONCRYPTO) != 0))
+        *meth = NULL;
+    if (*meth == NULL)
+        ret = hash_meth_get(id, 0, meth);
+
     return ret;
 }
 
 /**
- * Create an hash algorithm object.
+ * Get the hash algorithm method to digest a batch of messages.
+ * Without flags, the calibrated implementation for the size is used when
+ * available - a batch function or digesting each message in turn. Otherwise
+ * the method is as for hash_meth_get: the batch function of an implementation
+ * is used when it is the highest ranked or required by the flags, e.g.
+ * HASH_METH_FLAG_AVX2.
  *
  * @param [in]  id     The hash algorithm identifier.
- * @param [in]  flags  The method implementation flags required.
- * @param [out] hash   The hash algorithm object.
- * @return  HASH_ERR_PARAM_NULL when hash is NULL.<br>
- *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
- *          HASH_ERR_NOT_FOUND when there is no implementation for the
+ * @param [in]  flags  The method implementation flags required and, shifted
+ *                     with HASH_METH_FLAG_EXCLUDE, the flags excluded.
+ * @param [in]  len    The average length of the messages.
+ * @param [out] meth   The hash algorithm method.
+ * @return  HASH_ERR_NOT_FOUND when there is no implementation for the hash
  *          algorithm.<br>
  *          0 otherwise.
  */
-int HASH_new(HASH_ID id, int flags, HASH **hash)
+int hash_meth_get_batch(HASH_ID id, int flags, size_t len, HASH_METH **meth)
 {
     int ret = 0;
-    HASH *nh = NULL;
 
-    if (hash == NULL)
+    *meth = NULL;
+    if ((flags == 0) && (id >= 0) && (id < HASH_ID_NUM))
+        *meth = hash_meth_tuned[id].batch[hash_tune_bucket(len)];
+    /* Calibration tunes every algorithm - only digest cryptographic ones. */
+    if ((*meth != NULL) && (((*meth)->flags & HASH_METH_FLAG_NONCRYPTO) != 0))
+        *meth = NULL;
+    if (*meth == NULL)
+        ret = hash_meth_get(id, flags, meth);
+
+    return ret;
+}
+
+/**
+ * Check whether calibration found a batch function fastest for a batch of
+ * messages of the length.
+ *
+ * @param [in] id   The hash algorithm identifier.
+ * @param [in] len  The average length of the messages.
+ * @return  1 when a batch function is fastest.<br>
+ *          0 when not calibrated or digesting in turn is fastest.
+ */
+int hash_meth_tuned_batch(HASH_ID id, size_t len)
+{
+    HASH_METH *meth = NULL;
+
+    if ((id >= 0) && (id < HASH_ID_NUM))
+        meth = hash_meth_tuned[id].batch[hash_tune_bucket(len)];
+    return (meth != NULL) && (meth->batch != NULL);
+}
+
+/**
+ * Digest a message with the method's functions called directly.
+ *
+ * @param [in] meth  The hash algorithm method.
+ * @param [in] ctx   The context of at least ctx_len bytes.
+ * @param [in] msg   The message data to digest.
+ * @param [in] len   The length of the message data to digest.
+ * @param [in] data  The buffer to hold the message digest.
+ * @return  HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+static int hash_meth_digest(HASH_METH *meth, void *ctx,
+    const unsigned char *msg, size_t len, unsigned char *data)
+{
+    int ret = 0;
+
+    /* Single shot implementation needs no context. */
+    if (meth->digest != NULL)
     {
-        ret = HASH_ERR_PARAM_NULL;
-        goto end;
+        if (meth->digest(data, msg, len) == 0)
+            ret = HASH_ERR_BAD_DATA;
     }
-
-    /* Allocate memory for the general hash algorithm object. */
-    nh = malloc(sizeof(*nh));
-    if (nh == NULL)
+    else if ((meth->init(ctx) == 0) || (meth->update(ctx, msg, len) == 0) ||
+        (meth->final(data, ctx) == 0))
     {
-        ret = HASH_ERR_ALLOC;
-        goto end;
+        ret = HASH_ERR_BAD_DATA;
     }
 
-    memset(nh, 0, sizeof(*nh));
+    return ret;
+}
 
-    ret = hash_meth_get(id, flags, &nh->meth);
-    if (ret != 0)
-        goto end;
+/**
+ * Get the current time in cycles, or nanoseconds when not available.
+ * Only used to compare implementations.
+ *
+ * @return  The current time.
+ */
+static uint64_t hash_tune_time(void)
+{
+#ifdef CPU_X86_64
+    unsigned int hi, lo;
 
-    /* Allocate memory for the implementation to use. */
-    nh->ctx = malloc(nh->meth->ctx_len);
-    if (nh->ctx == NULL)
+    __asm__ __volatile__ ("rdtsc\n\t" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)lo) | (((uint64_t)hi) << 32);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/**
+ * Measure the time to digest messages of a length with an implementation.
+ * As with the speed test: prime the caches, then time enough operations to
+ * process about the same amount of data for every size.
+ *
+ * @param [in] meth  The hash algorithm method.
+ * @param [in] ctx   The context of at least ctx_len bytes.
+ * @param [in] msg   The message data to digest.
+ * @param [in] len   The length of the message data to digest.
+ * @return  The best time of one operation.
+ */
+static uint64_t hash_tune_measure(HASH_METH *meth, void *ctx,
+    const unsigned char *msg, size_t len)
+{
+    int i, j;
+    int num_ops = (int)(65536 / len);
+    unsigned char dgst[HASH_MAX_LEN];
+    uint64_t start, diff, best = 0;
+
+    for (i=0; i<num_ops; i++)
+        hash_meth_digest(meth, ctx, msg, len, dgst);
+
+    /* Take the best of a few runs to ignore interrupts. */
+    for (j=0; j<3; j++)
     {
-        ret = HASH_ERR_ALLOC;
-        goto end;
+        start = hash_tune_time();
+        for (i=0; i<num_ops; i++)
+            hash_meth_digest(meth, ctx, msg, len, dgst);
+        diff = (hash_tune_time() - start) / num_ops;
+        if ((j == 0) || (diff < best))
+            best = diff;
     }
 
-    *hash = nh;
-    nh = NULL;
-end:
-    HASH_free(nh);
-    return ret;
+    return best;
 }
 
 /**
- * Free the hash algorithm object.
+ * Measure the time to digest a batch of messages of a length with the batch
+ * function of an implementation.
  *
- * @param [in] hash  The hash algorithm object.
+ * @param [in] meth  The hash algorithm method with a batch function.
+ * @param [in] msg   The message data to digest.
+ * @param [in] len   The length of each message.
+ * @return  The best time per message.
  */
-void HASH_free(HASH *hash)
+static uint64_t hash_tune_measure_batch(HASH_METH *meth,
+    const unsigned char *msg, size_t len)
 {
-    if (hash != NULL)
+    int i, j;
+    int num_ops = (int)(65536 / (len * HASH_TUNE_BATCH)) + 1;
+    const unsigned char *msgs[HASH_TUNE_BATCH];
+    size_t lens[HASH_TUNE_BATCH];
+    unsigned char dgst[HASH_TUNE_BATCH][HASH_MAX_LEN];
+    unsigned char *data[HASH_TUNE_BATCH];
+    uint64_t start, diff, best = 0;
+
+    for (i=0; i<HASH_TUNE_BATCH; i++)
     {
-        if (hash->ctx != NULL) free(hash->ctx);
-        free(hash);
+        msgs[i] = msg;
+        lens[i] = len;
+        data[i] = dgst[i];
+    }
+    meth->batch(msgs, lens, HASH_TUNE_BATCH, data);
+
+    /* Take the best of a few runs to ignore interrupts. */
+    for (j=0; j<3; j++)
+    {
+        start = hash_tune_time();
+        for (i=0; i<num_ops; i++)
+            meth->batch(msgs, lens, HASH_TUNE_BATCH, data);
+        diff = (hash_tune_time() - start) / (num_ops * HASH_TUNE_BATCH);
+        if ((j == 0) || (diff < best))
+            best = diff;
     }
+
+    return best;
 }
 
 /**
- * Initialize the hash operation for calculating a digest.
+ * Measure every implementation of every hash algorithm that the CPU supports
+ * and keep the fastest for each size bucket. Batch functions are measured
+ * against the fastest implementation digesting the messages in turn.
  *
- * @param [in] hash  The hash algorithm object.
- * @return  HASH_ERR_PARAM_NULL when hash is NULL.<br>
- *          HASH_ERR_BAD_DATA when the implementation failed to initialize.<br>
+ * @param [out] tuned  The fastest implementations.
+ * @return  HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
  *          0 otherwise.
  */
-int HASH_init(HASH *hash)
+static int hash_tune_measure_all(HASH_TUNE *tuned)
 {
     int ret = 0;
+    int id, b, i;
+    size_t len;
+    uint64_t t, best[HASH_TUNE_BUCKETS];
+    unsigned char *msg = NULL;
+    void *ctx = NULL;
+    HASH_METH **rank;
 
-    if (hash == NULL)
+    len = hash_tune_len[HASH_TUNE_BUCKETS-1];
+    msg = malloc(len);
+    if (msg == NULL)
     {
-        ret = HASH_ERR_PARAM_NULL;
+        ret = HASH_ERR_ALLOC;
         goto end;
     }
+    for (i=0; i<(int)len; i++)
+        msg[i] = (unsigned char)(i * 7);
 
-    if (hash->meth->init(hash->ctx) == 0)
-        ret = HASH_ERR_BAD_DATA;
+    for (id=0; id<HASH_ID_NUM; id++)
+    {
+        rank = hash_meth_ranked(id);
+        for (b=0; b<HASH_TUNE_BUCKETS; b++)
+        {
+            tuned[id].digest[b] = rank[0];
+            tuned[id].batch[b] = rank[0];
+        }
+        /* Nothing to choose between. */
+        if ((rank[0] == NULL) || (rank[1] == NULL))
+            continue;
+
+        for (i=0; rank[i] != NULL; i++)
+        {
+            /* Streaming functions of batch implementations are C code. */
+            if ((i > 0) && (rank[i]->priority == HASH_METH_PRIO_BATCH))
+                continue;
+            ctx = hash_ctx_alloc(rank[i]);
+            if (ctx == NULL)
+            {
+                ret = HASH_ERR_ALLOC;
+                goto end;
+            }
+            for (b=0; b<HASH_TUNE_BUCKETS; b++)
+            {
+                t = hash_tune_measure(rank[i], ctx, msg, hash_tune_len[b]);
+                if ((i == 0) || (t < best[b]))
+                {
+                    tuned[id].digest[b] = rank[i];
+                    tuned[id].batch[b] = rank[i];
+                    best[b] = t;
+                }
+            }
+            hash_ctx_free(rank[i], ctx);
+            ctx = NULL;
+        }
+
+        /* Multi-buffer against a single stream for each size. */
+        for (i=0; rank[i] != NULL; i++)
+        {
+            if (rank[i]->batch == NULL)
+                continue;
+            for (b=0; b<HASH_TUNE_BUCKETS; b++)
+            {
+                t = hash_tune_measure_batch(rank[i], msg, hash_tune_len[b]);
+                if (t < best[b])
+                {
+                    tuned[id].batch[b] = rank[i];
+                    best[b] = t;
+                }
+            }
+        }
+    }
 end:
+    free(ctx);
+    free(msg);
     return ret;
 }
 
 /**
- * Update the hash operation with data.
+ * Load the fastest implementations from a calibration cache file.
+ * The file is only used when written by the same format version on a CPU with
+ * the same features and every implementation named is available.
  *
- * @param [in] hash  The hash algorithm object.
- * @param [in] msg   The message data to digest.
- * @param [in] len   The length of the message data to digest.
- * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
- *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
+ * @param [in]  file   The name of the calibration cache file.
+ * @param [out] tuned  The fastest implementations.
+ * @return  HASH_ERR_IO when the file can't be read.<br>
+ *          HASH_ERR_BAD_DATA when the file is not valid for this library.<br>
  *          0 otherwise.
  */
-int HASH_update(HASH *hash, const unsigned char *msg, int len)
+static int hash_tune_load(const char *file, HASH_TUNE *tuned)
 {
     int ret = 0;
+    FILE *f;
+    char line[128];
+    int version, id, b, n, i, batch;
+    unsigned int cpu;
+    size_t l;
+    HASH_METH **rank;
+    HASH_METH **meths;
 
-    if ((hash == NULL) || (msg == NULL))
+    f = fopen(file, "r");
+    if (f == NULL)
     {
-        ret = HASH_ERR_PARAM_NULL;
+        ret = HASH_ERR_IO;
         goto end;
     }
 
-    if (hash->meth->update(hash->ctx, msg, len) == 0)
+    if ((fgets(line, sizeof(line), f) == NULL) ||
+        (sscanf(line, "hash-calibrate %d %x", &version, &cpu) != 2) ||
+        (version != HASH_TUNE_VERSION) ||
+        (cpu != (unsigned int)hash_cpu_flags()))
+    {
         ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+
+    memset(tuned, 0, sizeof(*tuned) * HASH_ID_NUM);
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        /* Line: [batch] identifier, bucket, name of implementation. */
+        batch = (sscanf(line, "batch %d %d %n", &id, &b, &n) == 2);
+        if ((!batch && (sscanf(line, "%d %d %n", &id, &b, &n) != 2)) ||
+            (id < 0) || (id >= HASH_ID_NUM) || (b < 0) ||
+            (b >= HASH_TUNE_BUCKETS))
+        {
+            ret = HASH_ERR_BAD_DATA;
+            goto end;
+        }
+        meths = batch ? tuned[id].batch : tuned[id].digest;
+        l = strlen(line);
+        if ((l > 0) && (line[l-1] == '\n'))
+            line[l-1] = '\0';
+
+        rank = hash_meth_ranked(id);
+        for (i=0; rank[i] != NULL; i++)
+        {
+            if (strcmp(rank[i]->name, line + n) == 0)
+                break;
+        }
+        if (rank[i] == NULL)
+        {
+            ret = HASH_ERR_BAD_DATA;
+            goto end;
+        }
+        meths[b] = rank[i];
+    }
 end:
+    if (f != NULL)
+        fclose(f);
     return ret;
 }
 
 /**
- * Finalize the hash operation and output the digest.
+ * Save the fastest implementations to a calibration cache file.
  *
- * @param [in] hash  The hash algorithm object.
- * @param [in] data  The message digest.
- * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
- *          HASH_ERR_BAD_DATA when the implementation failed to finalize.<br>
+ * @param [in] file   The name of the calibration cache file.
+ * @param [in] tuned  The fastest implementations.
+ * @return  HASH_ERR_IO when the file can't be written.<br>
  *          0 otherwise.
  */
-int HASH_final(HASH *hash, unsigned char *data)
+static int hash_tune_save(const char *file, HASH_TUNE *tuned)
 {
     int ret = 0;
+    FILE *f;
+    int id, b;
 
-    if ((hash == NULL) || (data == NULL))
+    f = fopen(file, "w");
+    if (f == NULL)
     {
-        ret = HASH_ERR_PARAM_NULL;
+        ret = HASH_ERR_IO;
         goto end;
     }
 
-    if (hash->meth->final(data, hash->ctx) == 0)
-        ret = HASH_ERR_BAD_DATA;
+    fprintf(f, "hash-calibrate %d %x\n", HASH_TUNE_VERSION, hash_cpu_flags());
+    for (id=0; id<HASH_ID_NUM; id++)
+    {
+        for (b=0; b<HASH_TUNE_BUCKETS; b++)
+        {
+            if (tuned[id].digest[b] != NULL)
+                fprintf(f, "%d %d %s\n", id, b, tuned[id].digest[b]->name);
+            if (tuned[id].batch[b] != NULL)
+            {
+                fprintf(f, "batch %d %d %s\n", id, b,
+                    tuned[id].batch[b]->name);
+            }
+        }
+    }
+
+    if (fclose(f) != 0)
+        ret = HASH_ERR_IO;
 end:
     return ret;
 }
 
 /**
- * Get the length of the digest that will be calculated.
+ * Calibrate which implementation of each hash algorithm is fastest for each
+ * message size. HASH_digest then uses the fastest implementation for the
+ * length of the message. HASH_batch without flags uses the fastest for the
+ * average length of the messages - multi-buffer or one message at a time.
+ * The results are cached in the file when one is given: later calls load the
+ * file instead of measuring, unless the file was written for a different CPU
+ * or version of the file format.
+ * Call before other threads are using the library - measuring takes tens of
+ * milliseconds.
  *
- * @param [in] hash  The hash algorithm object.
- * @param [in] len   The length of the message digest.
- * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ * @param [in] file  The name of the calibration cache file. May be NULL.
+ * @return  HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_IO when the cache file can't be written.<br>
  *          0 otherwise.
  */
-int HASH_get_len(HASH *hash, int *len)
+int HASH_calibrate(const char *file)
 {
     int ret = 0;
+    HASH_TUNE tuned[HASH_ID_NUM];
 
-    if ((hash == NULL) || (len == NULL))
+    pthread_mutex_lock(&hash_tune_lock);
+
+    if ((file == NULL) || (hash_tune_load(file, tuned) != 0))
     {
-        ret = HASH_ERR_PARAM_NULL;
-        goto end;
+        ret = hash_tune_measure_all(tuned);
+        if (ret != 0)
+            goto end;
+        if (file != NULL)
+            ret = hash_tune_save(file, tuned);
     }
 
-    *len = hash->meth->len;
+    memcpy(hash_meth_tuned, tuned, sizeof(hash_meth_tuned));
 end:
+    pthread_mutex_unlock(&hash_tune_lock);
     return ret;
 }
 
 /**
- * Get the name of the implementation.
+ * Register an implementation of a hash algorithm.
+ * It is selected by HASH_new and HASH_digest the same way as the built-in
+ * implementations - by priority and flags. The method is copied but the name
+ * must remain valid.
+ * Register before other threads are using the algorithm. Calibrate again to
+ * include the implementation in the size routing of HASH_digest.
  *
- * @param [in] hash  The hash algorithm object.
+ * @param [in] meth  The hash algorithm method.
+ * @return  HASH_ERR_PARAM_NULL when a parameter or required function is
+ *          NULL - dup is required with cleanup.<br>
+ *          HASH_ERR_NOT_FOUND when the hash algorithm identifier is not
+ *          valid.<br>
+ *          HASH_ERR_BAD_LEN when a length or alignment is invalid.<br>
+ *          HASH_ERR_NOT_SUPPORTED when the CPU doesn't have the features the
+ *          implementation requires.<br>
+ *          HASH_ERR_ALLOC when no more implementations can be registered.<br>
+ *          0 otherwise.
+ */
+int HASH_METH_register(const HASH_METH *meth)
+{
+    int ret = 0;
+    int b;
+    HASH_METH *nm;
+
+    if ((meth == NULL) || (meth->name == NULL) || (meth->init == NULL) ||
+        (meth->update == NULL) || (meth->final == NULL) ||
+        ((meth->cleanup != NULL) && (meth->dup == NULL)))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (hash_meth_ranked(meth->id) == NULL)
+    {
+        ret = HASH_ERR_NOT_FOUND;
+        goto end;
+    }
+    if ((meth->len <= 0) || (meth->len > HASH_MAX_LEN) ||
+        (meth->ctx_len <= 0) || (meth->align < 0) ||
+        ((meth->align & (meth->align - 1)) != 0) ||
+        ((meth->export_state != NULL) && ((meth->import_state == NULL) ||
+         (meth->state_len <= 0) ||
+         (meth->state_len > HASH_STATE_MAX_LEN - HASH_STATE_HDR_LEN))))
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    if ((meth->flags & HASH_METH_FLAG_CPU & ~hash_cpu_flags()) != 0)
+    {
+        ret = HASH_ERR_NOT_SUPPORTED;
+        goto end;
+    }
+
+    pthread_mutex_lock(&hash_meth_reg_lock);
+    if (hash_meth_reg_cnt == HASH_METH_REG_MAX)
+        ret = HASH_ERR_ALLOC;
+    else
+    {
+        nm = &hash_meth_reg[hash_meth_reg_cnt++];
+        *nm = *meth;
+        if (nm->export_state == NULL)
+            nm->state_len = 0;
+        hash_meth_rank_add(nm);
+    }
+    pthread_mutex_unlock(&hash_meth_reg_lock);
+    if (ret != 0)
+        goto end;
+
+    /* Calibration didn't measure the new implementation. Written under the
+     * calibration lock so a calibration in progress can't copy over it. */
+    pthread_mutex_lock(&hash_tune_lock);
+    for (b=0; b<HASH_TUNE_BUCKETS; b++)
+    {
+        hash_meth_tuned[meth->id].digest[b] = NULL;
+        hash_meth_tuned[meth->id].batch[b] = NULL;
+    }
+    pthread_mutex_unlock(&hash_tune_lock);
+end:
+    return ret;
+}
+
+/**
+ * Get the length of the digest that will be calculated using the hash
+ * algorithm.
+ *
+ * @param [in]  hash  The hash algorithm identifier.
+ * @param [out] len   The length of a message digest.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the hash
+ *          algorithm.<br>
+ *          0 otherwise.
+ */
+int HASH_METH_get_len(HASH_ID id, int *len)
+{
+    int ret = 0;
+    HASH_METH *meth;
+
+    if (len == NULL)
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    ret = hash_meth_get(id, 0, &meth);
+    if (ret == HASH_ERR_NOT_FOUND)
+        ret = hash_meth_get(id, HASH_METH_FLAG_NONCRYPTO, &meth);
+    if (ret != 0)
+        goto end;
+
+    *len = meth->len;
+end:
+    return ret;
+}
+
+/**
+ * Create an hash algorithm object with the method.
+ *
+ * @param [in]  meth   The hash algorithm method.
+ * @param [out] hash   The hash algorithm object.
+ * @return  HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          0 otherwise.
+ */
+static int hash_new_meth(HASH_METH *meth, HASH **hash)
+{
+    int ret = 0;
+    HASH *nh = NULL;
+
+    /* Allocate memory for the general hash algorithm object. */
+    nh = malloc(sizeof(*nh));
+    if (nh == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+
+    memset(nh, 0, sizeof(*nh));
+    nh->meth = meth;
+
+    /* Allocate memory for the implementation to use. */
+    nh->ctx = hash_ctx_alloc(nh->meth);
+    if (nh->ctx == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+
+    *hash = nh;
+    nh = NULL;
+end:
+    HASH_free(nh);
+    return ret;
+}
+
+/**
+ * Create an hash algorithm object.
+ *
+ * @param [in]  id     The hash algorithm identifier.
+ * @param [in]  flags  The method implementation flags required and, shifted
+ *                     with HASH_METH_FLAG_EXCLUDE, the flags excluded.
+ * @param [out] hash   The hash algorithm object.
+ * @return  HASH_ERR_PARAM_NULL when hash is NULL.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the
+ *          algorithm.<br>
+ *          0 otherwise.
+ */
+int HASH_new(HASH_ID id, int flags, HASH **hash)
+{
+    int ret = 0;
+    HASH_METH *meth;
+
+    if (hash == NULL)
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    ret = hash_meth_get(id, flags, &meth);
+    if (ret != 0)
+        goto end;
+
+    ret = hash_new_meth(meth, hash);
+end:
+    return ret;
+}
+
+/**
+ * Create an hash algorithm object using a specific implementation.
+ * Implementations that the CPU supports are indexed from 0 in order of
+ * priority - use to test and compare every implementation.
+ *
+ * @param [in]  id    The hash algorithm identifier.
+ * @param [in]  idx   The index of the implementation.
+ * @param [out] hash  The hash algorithm object.
+ * @return  HASH_ERR_PARAM_NULL when hash is NULL.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation at the index.<br>
+ *          0 otherwise.
+ */
+int HASH_new_impl(HASH_ID id, int idx, HASH **hash)
+{
+    int ret = 0;
+    int i;
+    HASH_METH **rank;
+
+    if (hash == NULL)
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    rank = hash_meth_ranked(id);
+    if ((rank == NULL) || (idx < 0))
+    {
+        ret = HASH_ERR_NOT_FOUND;
+        goto end;
+    }
+    for (i=0; (i < idx) && (rank[i] != NULL); i++)
+        ;
+    if (rank[i] == NULL)
+    {
+        ret = HASH_ERR_NOT_FOUND;
+        goto end;
+    }
+
+    ret = hash_new_meth(rank[i], hash);
+end:
+    return ret;
+}
+
+/**
+ * Free the hash algorithm object.
+ *
+ * @param [in] hash  The hash algorithm object.
+ */
+void HASH_free(HASH *hash)
+{
+    if (hash != NULL)
+    {
+        hash_ctx_free(hash->meth, hash->ctx);
+        free(hash);
+    }
+}
+
+/**
+ * Duplicate the hash algorithm object including the state of the operation.
+ * Use to calculate digests of messages with a common prefix.
+ *
+ * @param [in]  hash  The hash algorithm object.
+ * @param [out] dup   The new hash algorithm object.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to duplicate.<br>
+ *          0 otherwise.
+ */
+int HASH_dup(HASH *hash, HASH **dup)
+{
+    int ret = 0;
+    HASH *nh = NULL;
+
+    if ((hash == NULL) || (dup == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    ret = hash_new_meth(hash->meth, &nh);
+    if (ret != 0)
+        goto end;
+
+    if (hash->meth->dup == NULL)
+        memcpy(nh->ctx, hash->ctx, hash->meth->ctx_len);
+    else if (hash->meth->dup(nh->ctx, hash->ctx) == 0)
+    {
+        ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+
+    *dup = nh;
+    nh = NULL;
+end:
+    HASH_free(nh);
+    return ret;
+}
+
+/**
+ * Initialize the hash operation for calculating a digest.
+ *
+ * @param [in] hash  The hash algorithm object.
+ * @return  HASH_ERR_PARAM_NULL when hash is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to initialize.<br>
+ *          0 otherwise.
+ */
+int HASH_init(HASH *hash)
+{
+    int ret = 0;
+
+    if (hash == NULL)
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    if (hash->meth->init(hash->ctx) == 0)
+        ret = HASH_ERR_BAD_DATA;
+end:
+    return ret;
+}
+
+/**
+ * Update the hash operation with data.
+ *
+ * @param [in] hash  The hash algorithm object.
+ * @param [in] msg   The message data to digest.
+ * @param [in] len   The length of the message data to digest.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
+ *          0 otherwise.
+ */
+int HASH_update(HASH *hash, const unsigned char *msg, size_t len)
+{
+    int ret = 0;
+
+    if ((hash == NULL) || (msg == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    if (hash->meth->update(hash->ctx, msg, len) == 0)
+        ret = HASH_ERR_BAD_DATA;
+end:
+    return ret;
+}
+
+/**
+ * Update the hash operation with fragments of data.
+ * The fragments are digested in order as if they were one message.
+ *
+ * @param [in] hash  The hash algorithm object.
+ * @param [in] iov   The array of message data fragments to digest.
+ * @param [in] cnt   The number of fragments in the array.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
+ *          0 otherwise.
+ */
+int HASH_updatev(HASH *hash, const HASH_IOVEC *iov, int cnt)
+{
+    int ret = 0;
+    int i;
+
+    if ((hash == NULL) || ((iov == NULL) && (cnt > 0)))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    for (i=0; i<cnt; i++)
+    {
+        if (iov[i].len == 0)
+            continue;
+        if (iov[i].data == NULL)
+        {
+            ret = HASH_ERR_PARAM_NULL;
+            break;
+        }
+        if (hash->meth->update(hash->ctx, iov[i].data, iov[i].len) == 0)
+        {
+            ret = HASH_ERR_BAD_DATA;
+            break;
+        }
+    }
+end:
+    return ret;
+}
+
+/**
+ * Finalize the hash operation and output the digest.
+ *
+ * @param [in] hash  The hash algorithm object.
+ * @param [in] data  The message digest.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to finalize.<br>
+ *          0 otherwise.
+ */
+int HASH_final(HASH *hash, unsigned char *data)
+{
+    int ret = 0;
+
+    if ((hash == NULL) || (data == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    if (hash->meth->final(data, hash->ctx) == 0)
+        ret = HASH_ERR_BAD_DATA;
+end:
+    return ret;
+}
+
+/**
+ * Get the length of the digest that will be calculated.
+ *
+ * @param [in] hash  The hash algorithm object.
+ * @param [in] len   The length of the message digest.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          0 otherwise.
+ */
+int HASH_get_len(HASH *hash, int *len)
+{
+    int ret = 0;
+
+    if ((hash == NULL) || (len == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    *len = hash->meth->len;
+end:
+    return ret;
+}
+
+/**
+ * Get the name of the implementation.
+ *
+ * @param [in] hash  The hash algorithm object.
  * @param [in] name  The name of the hash implementation.
  * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
  *          0 otherwise.
@@ -458,3 +1809,509 @@ end:
     return ret;
 }
 
+/** Calculate a digest with the implementation's functions called directly. */
+#define HASH_DIGEST_DIRECT(ctx, init, update, final, msg, len, data)	\
+do								\
+{								\
+    init(ctx);							\
+    update(ctx, msg, len);					\
+    final(data, ctx);						\
+}								\
+while (0)
+
+/**
+ * Calculate the digest of a message calling the functions of a built-in
+ * implementation directly.
+ * The instruction set the method uses picks the functions so that a
+ * calibrated choice is honoured.
+ *
+ * @param [in] meth  The hash algorithm method - from the built-in table.
+ * @param [in] ctx   The context to use - large enough for the algorithm.
+ * @param [in] msg   The message data to digest.
+ * @param [in] len   The length of the message data to digest.
+ * @param [in] data  The buffer to hold the message digest.
+ * @return  1 when the message was digested.<br>
+ *          0 when the algorithm has no direct path.
+ */
+static int hash_digest_direct(HASH_METH *meth, void *ctx,
+    const unsigned char *msg, size_t len, unsigned char *data)
+{
+    int ret = 1;
+
+    switch (meth->id)
+    {
+        case HASH_ID_SHA1:
+#ifdef CPU_X86_64
+            if ((meth->flags & HASH_METH_FLAG_SHANI) != 0)
+            {
+                HASH_DIGEST_DIRECT(ctx, hash_sha1_init, hash_sha1_ni_update,
+                    hash_sha1_ni_final, msg, len, data);
+                break;
+            }
+#endif
+            HASH_DIGEST_DIRECT(ctx, hash_sha1_init, hash_sha1_update,
+                hash_sha1_final, msg, len, data);
+            break;
+        case HASH_ID_SHA224:
+#ifdef CPU_X86_64
+            if ((meth->flags & HASH_METH_FLAG_SHANI) != 0)
+            {
+                HASH_DIGEST_DIRECT(ctx, hash_sha224_init,
+                    hash_sha256_ni_update, hash_sha224_ni_final, msg, len,
+                    data);
+                break;
+            }
+#endif
+            HASH_DIGEST_DIRECT(ctx, hash_sha224_init, hash_sha256_update,
+                hash_sha224_final, msg, len, data);
+            break;
+        case HASH_ID_SHA256:
+#ifdef CPU_X86_64
+            if ((meth->flags & HASH_METH_FLAG_SHANI) != 0)
+            {
+                HASH_DIGEST_DIRECT(ctx, hash_sha256_init,
+                    hash_sha256_ni_update, hash_sha256_ni_final, msg, len,
+                    data);
+                break;
+            }
+#endif
+            HASH_DIGEST_DIRECT(ctx, hash_sha256_init, hash_sha256_update,
+                hash_sha256_final, msg, len, data);
+            break;
+        case HASH_ID_SHA384:
+            HASH_DIGEST_DIRECT(ctx, hash_sha384_init, hash_sha512_update,
+                hash_sha384_final, msg, len, data);
+            break;
+        case HASH_ID_SHA512:
+            HASH_DIGEST_DIRECT(ctx, hash_sha512_init, hash_sha512_update,
+                hash_sha512_final, msg, len, data);
+            break;
+        case HASH_ID_SHA512_224:
+            HASH_DIGEST_DIRECT(ctx, hash_sha512_224_init, hash_sha512_update,
+                hash_sha512_224_final, msg, len, data);
+            break;
+        case HASH_ID_SHA512_256:
+            HASH_DIGEST_DIRECT(ctx, hash_sha512_256_init, hash_sha512_update,
+                hash_sha512_256_final, msg, len, data);
+            break;
+        case HASH_ID_SHA3_224:
+            hash_sha3_224(data, msg, len);
+            break;
+        case HASH_ID_SHA3_256:
+            hash_sha3_256(data, msg, len);
+            break;
+        case HASH_ID_SHA3_384:
+            hash_sha3_384(data, msg, len);
+            break;
+        case HASH_ID_SHA3_512:
+            hash_sha3_512(data, msg, len);
+            break;
+        case HASH_ID_SHAKE128:
+            hash_shake128_digest(data, msg, len);
+            break;
+        case HASH_ID_SHAKE256:
+            hash_shake256_digest(data, msg, len);
+            break;
+        case HASH_ID_BLAKE2B_224:
+            HASH_DIGEST_DIRECT(ctx, hash_blake2b_224_init,
+                hash_blake2b_update, hash_blake2b_224_final, msg, len, data);
+            break;
+        case HASH_ID_BLAKE2B_256:
+            HASH_DIGEST_DIRECT(ctx, hash_blake2b_256_init,
+                hash_blake2b_update, hash_blake2b_256_final, msg, len, data);
+            break;
+        case HASH_ID_BLAKE2B_384:
+            HASH_DIGEST_DIRECT(ctx, hash_blake2b_384_init,
+                hash_blake2b_update, hash_blake2b_384_final, msg, len, data);
+            break;
+        case HASH_ID_BLAKE2B_512:
+            HASH_DIGEST_DIRECT(ctx, hash_blake2b_512_init,
+                hash_blake2b_update, hash_blake2b_512_final, msg, len, data);
+            break;
+        case HASH_ID_BLAKE2S_224:
+            HASH_DIGEST_DIRECT(ctx, hash_blake2s_224_init,
+                hash_blake2s_update, hash_blake2s_224_final, msg, len, data);
+            break;
+        case HASH_ID_BLAKE2S_256:
+            HASH_DIGEST_DIRECT(ctx, hash_blake2s_256_init,
+                hash_blake2s_update, hash_blake2s_256_final, msg, len, data);
+            break;
+        default:
+            ret = 0;
+            break;
+    }
+
+    return ret;
+}
+
+/**
+ * Calculate the digest of a message in one call.
+ * The best implementation, for the length when calibrated, is called directly
+ * with the context on the stack when built-in. Registered implementations and
+ * other libraries are called through the method table - no dynamic memory is
+ * allocated unless the context is unusually large or aligned.
+ *
+ * @param [in] id    The hash algorithm identifier.
+ * @param [in] msg   The message data to digest.
+ * @param [in] len   The length of the message data to digest.
+ * @param [in] data  The buffer to hold the message digest.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the hash
+ *          algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+int HASH_digest(HASH_ID id, const unsigned char *msg, size_t len,
+    unsigned char *data)
+{
+    int ret = 0;
+    HASH_METH *meth = NULL;
+    void *ctx = NULL;
+    union
+    {
+        HASH_SHA1 sha1;
+        HASH_SHA256 sha256;
+        HASH_SHA512 sha512;
+        HASH_SHA3 sha3;
+        HASH_BLAKE2B blake2b;
+        HASH_BLAKE2S blake2s;
+    } stack_ctx;
+
+    if (((msg == NULL) && (len > 0)) || (data == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    ret = hash_meth_get_size(id, len, &meth);
+    if (ret != 0)
+        goto end;
+
+    /* Built-in implementations are called directly - only registered
+     * implementations and other libraries go through the method table. */
+    if ((meth >= hash_meths) && (meth < hash_meths + HASH_METHS_LEN) &&
+        ((meth->flags & ~HASH_METH_FLAG_CPU) == HASH_METH_FLAG_INTERNAL) &&
+        hash_digest_direct(meth, &stack_ctx, msg, len, data))
+    {
+        goto end;
+    }
+
+    if ((meth->digest != NULL) ||
+        ((meth->ctx_len <= (int)sizeof(stack_ctx)) &&
+         (meth->align <= HASH_STACK_ALIGN)))
+    {
+        ctx = &stack_ctx;
+        /* Context may own memory allocated on first initialization. */
+        if ((meth->digest == NULL) && (meth->cleanup != NULL))
+            memset(ctx, 0, meth->ctx_len);
+    }
+    else
+    {
+        ctx = hash_ctx_alloc(meth);
+        if (ctx == NULL)
+        {
+            ret = HASH_ERR_ALLOC;
+            goto end;
+        }
+    }
+
+    ret = hash_meth_digest(meth, ctx, msg, len, data);
+end:
+    if (ctx != &stack_ctx)
+        hash_ctx_free(meth, ctx);
+    else if ((meth->digest == NULL) && (meth->cleanup != NULL))
+        meth->cleanup(ctx);
+    return ret;
+}
+
+/**
+ * Calculate the digests of many messages.
+ * Without flags and when calibrated, the fastest implementation for the
+ * average length of the messages is used. Otherwise the highest priority
+ * implementation that has all the required flags and none of the excluded
+ * flags is used - require HASH_METH_FLAG_AVX2 for the multi-buffer
+ * implementation. When it digests messages in a batch, its SIMD lanes are kept
+ * full however the lengths differ. Otherwise each message is digested in turn.
+ *
+ * @param [in] id     The hash algorithm identifier.
+ * @param [in] flags  The method implementation flags required and, shifted
+ *                    with HASH_METH_FLAG_EXCLUDE, the flags excluded.
+ * @param [in] msgs   The messages to digest.
+ * @param [in] lens   The lengths of the messages.
+ * @param [in] cnt    The number of messages.
+ * @param [in] data   The buffers to hold the message digests.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the count is negative.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the hash
+ *          algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+int HASH_batch(HASH_ID id, int flags, const unsigned char **msgs,
+    const size_t *lens, int cnt, unsigned char **data)
+{
+    int ret = 0;
+    int i;
+    size_t len = 0;
+    HASH_METH *meth = NULL;
+    void *ctx = NULL;
+
+    if ((cnt > 0) && ((msgs == NULL) || (lens == NULL) || (data == NULL)))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (cnt < 0)
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    for (i=0; i<cnt; i++)
+    {
+        if (((msgs[i] == NULL) && (lens[i] > 0)) || (data[i] == NULL))
+        {
+            ret = HASH_ERR_PARAM_NULL;
+            goto end;
+        }
+    }
+
+    for (i=0; i<cnt; i++)
+        len += lens[i];
+    if (cnt > 0)
+        len /= cnt;
+
+    ret = hash_meth_get_batch(id, flags, len, &meth);
+    if ((ret != 0) || (cnt == 0))
+        goto end;
+
+    if (meth->batch != NULL)
+    {
+        if (meth->batch(msgs, lens, cnt, data) == 0)
+            ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+
+    if (meth->digest == NULL)
+    {
+        ctx = hash_ctx_alloc(meth);
+        if (ctx == NULL)
+        {
+            ret = HASH_ERR_ALLOC;
+            goto end;
+        }
+    }
+    for (i=0; (ret == 0) && (i<cnt); i++)
+        ret = hash_meth_digest(meth, ctx, msgs[i], lens[i], data[i]);
+end:
+    if (meth != NULL)
+        hash_ctx_free(meth, ctx);
+    return ret;
+}
+
+/**
+ * Calculate the digest of all the data read from a file descriptor.
+ * When built with OPT_HASH_AFALG and the kernel has the algorithm, the data is
+ * spliced into the kernel - data in the page cache is not copied into user
+ * space. Otherwise the data is read into a buffer and digested by the best
+ * implementation.
+ * The file descriptor is read until end of file and must be blocking.
+ *
+ * @param [in] id    The hash algorithm identifier.
+ * @param [in] fd    The file descriptor to read.
+ * @param [in] data  The buffer to hold the message digest.
+ * @return  HASH_ERR_PARAM_NULL when data is NULL.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the hash
+ *          algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_IO when reading the file descriptor failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+int HASH_digest_fd(HASH_ID id, int fd, unsigned char *data)
+{
+    int ret = 0;
+    HASH_METH *meth = NULL;
+    void *ctx = NULL;
+    unsigned char *buf = NULL;
+    ssize_t n;
+
+    if (data == NULL)
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    ret = hash_meth_get(id, 0, &meth);
+    if (ret != 0)
+        goto end;
+
+#ifdef OPT_HASH_AFALG
+    ret = hash_afalg_digest_fd(id, fd, data, meth->len);
+    if (ret != HASH_ERR_NOT_SUPPORTED)
+        goto end;
+    ret = 0;
+#endif
+
+    ctx = hash_ctx_alloc(meth);
+    buf = malloc(HASH_FD_BUF_LEN);
+    if ((ctx == NULL) || (buf == NULL))
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+
+    if (meth->init(ctx) == 0)
+    {
+        ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+    while ((n = read(fd, buf, HASH_FD_BUF_LEN)) != 0)
+    {
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ret = HASH_ERR_IO;
+            goto end;
+        }
+        if (meth->update(ctx, buf, n) == 0)
+        {
+            ret = HASH_ERR_BAD_DATA;
+            goto end;
+        }
+    }
+    if (meth->final(data, ctx) == 0)
+        ret = HASH_ERR_BAD_DATA;
+end:
+    free(buf);
+    if (meth != NULL)
+        hash_ctx_free(meth, ctx);
+    return ret;
+}
+
+/**
+ * Get the length of the exported state of the hash operation.
+ *
+ * @param [in]  hash  The hash algorithm object.
+ * @param [out] len   The length of the exported state.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_NOT_SUPPORTED when the implementation can't export.<br>
+ *          0 otherwise.
+ */
+int HASH_get_state_len(HASH *hash, int *len)
+{
+    int ret = 0;
+
+    if ((hash == NULL) || (len == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (hash->meth->export_state == NULL)
+    {
+        ret = HASH_ERR_NOT_SUPPORTED;
+        goto end;
+    }
+
+    *len = HASH_STATE_HDR_LEN + hash->meth->state_len;
+end:
+    return ret;
+}
+
+/**
+ * Export the state of the hash operation.
+ * The format is versioned and independent of the endianness of the CPU and the
+ * implementation. The state can be imported into another hash object of the
+ * same algorithm to continue the operation.
+ *
+ * @param [in]      hash  The hash algorithm object.
+ * @param [in]      data  The buffer to hold the exported state.
+ * @param [in, out] len   On in, the length of the buffer.<br>
+ *                        On out, the length of the exported state.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_NOT_SUPPORTED when the implementation can't export.<br>
+ *          HASH_ERR_BAD_LEN when the buffer is too small.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to export.<br>
+ *          0 otherwise.
+ */
+int HASH_export_state(HASH *hash, unsigned char *data, int *len)
+{
+    int ret = 0;
+    int state_len;
+
+    if ((data == NULL) || (len == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    ret = HASH_get_state_len(hash, &state_len);
+    if (ret != 0)
+        goto end;
+    if (*len < state_len)
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+
+    data[0] = HASH_STATE_VERSION;
+    data[1] = hash->meth->id;
+    if (hash->meth->export_state(data + HASH_STATE_HDR_LEN, hash->ctx) == 0)
+    {
+        ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+
+    *len = state_len;
+end:
+    return ret;
+}
+
+/**
+ * Import the state of a hash operation.
+ * The hash object must be for the same algorithm as the exported state.
+ * HASH_init does not need to be called.
+ *
+ * @param [in] hash  The hash algorithm object.
+ * @param [in] data  The exported state.
+ * @param [in] len   The length of the exported state.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_NOT_SUPPORTED when the implementation can't import.<br>
+ *          HASH_ERR_BAD_LEN when the length of the state is invalid.<br>
+ *          HASH_ERR_BAD_DATA when the version or algorithm is different or
+ *          the state is invalid.<br>
+ *          0 otherwise.
+ */
+int HASH_import_state(HASH *hash, const unsigned char *data, int len)
+{
+    int ret = 0;
+    int state_len;
+
+    if (data == NULL)
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    ret = HASH_get_state_len(hash, &state_len);
+    if (ret != 0)
+        goto end;
+    if (len != state_len)
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    if ((data[0] != HASH_STATE_VERSION) || (data[1] != hash->meth->id))
+    {
+        ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+
+    if (hash->meth->import_state(hash->ctx, data + HASH_STATE_HDR_LEN) == 0)
+        ret = HASH_ERR_BAD_DATA;
+end:
+    return ret;
+}
+
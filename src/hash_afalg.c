@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Hash algorithms calculated by the Linux kernel through AF_ALG sockets.
+ * A socket is bound to each algorithm the kernel has, once. Each context
+ * accepts its own operation socket from it and reuses it until cleaned up.
+ * File descriptors are spliced into the operation socket so that data in the
+ * page cache is not copied into user space.
+ */
+
+#ifdef OPT_HASH_AFALG
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/if_alg.h>
+
+#endif
+
+#include "hash.h"
+#include "hash_afalg.h"
+
+#ifdef OPT_HASH_AFALG
+
+/** The number of hash algorithm identifiers that the kernel may implement. */
+#define HASH_AFALG_ID_NUM	(HASH_ID_SHAKE256 + 1)
+/** The maximum amount of data to splice in one call. */
+#define HASH_AFALG_SPLICE_LEN	(64 * 1024)
+
+/**
+ * The kernel names of the hash algorithms indexed by identifier.
+ * NULL when the kernel doesn't have the algorithm.
+ */
+static const char *hash_afalg_name[HASH_AFALG_ID_NUM] =
+{
+    "sha1", "sha224", "sha256", "sha384", "sha512", NULL, NULL,
+    "sha3-224", "sha3-256", "sha3-384", "sha3-512",
+    NULL, "blake2b-256", "blake2b-384", "blake2b-512",
+    NULL, NULL,
+    NULL, NULL
+};
+
+/** The sockets bound to each algorithm. -1 when not available. */
+static int hash_afalg_tfm[HASH_AFALG_ID_NUM];
+/** Ensures the algorithms are only bound once. */
+static pthread_once_t hash_afalg_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Bind a socket to each algorithm that the kernel has.
+ * The sockets stay open for the life of the process.
+ */
+static void hash_afalg_bind(void)
+{
+    int i;
+    int fd;
+    struct sockaddr_alg sa;
+
+    for (i=0; i<HASH_AFALG_ID_NUM; i++)
+        hash_afalg_tfm[i] = -1;
+
+    for (i=0; i<HASH_AFALG_ID_NUM; i++)
+    {
+        if (hash_afalg_name[i] == NULL)
+            continue;
+
+        fd = socket(AF_ALG, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        /* No AF_ALG in this kernel. */
+        if (fd < 0)
+            break;
+
+        memset(&sa, 0, sizeof(sa));
+        sa.salg_family = AF_ALG;
+        strcpy((char *)sa.salg_type, "hash");
+        strcpy((char *)sa.salg_name, hash_afalg_name[i]);
+        if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0)
+            close(fd);
+        else
+            hash_afalg_tfm[i] = fd;
+    }
+}
+
+/**
+ * Check whether the kernel implements the hash algorithm.
+ *
+ * @param [in] id  The hash algorithm identifier.
+ * @return  1 when the kernel has the algorithm.<br>
+ *          0 otherwise.
+ */
+int hash_afalg_available(HASH_ID id)
+{
+    if ((id < 0) || (id >= HASH_AFALG_ID_NUM))
+        return 0;
+
+    pthread_once(&hash_afalg_once, hash_afalg_bind);
+    return hash_afalg_tfm[id] >= 0;
+}
+
+/**
+ * Initialize the digest context for an algorithm.
+ * An operation that has data sent is abandoned by opening a new socket.
+ *
+ * @param [in] ctx  The context of the hash operation.
+ * @param [in] id   The hash algorithm identifier.
+ * @param [in] len  The length of the message digest.
+ * @return  0 when the kernel doesn't have the algorithm or failed.<br>
+ *          1 otherwise.
+ */
+static int hash_afalg_init(HASH_AFALG *ctx, HASH_ID id, int len)
+{
+    if (!hash_afalg_available(id))
+        return 0;
+
+    if (ctx->open && ctx->more)
+    {
+        close(ctx->op);
+        ctx->open = 0;
+    }
+    if (!ctx->open)
+    {
+        ctx->op = accept4(hash_afalg_tfm[id], NULL, 0, SOCK_CLOEXEC);
+        if (ctx->op < 0)
+            return 0;
+        ctx->open = 1;
+    }
+    ctx->more = 0;
+    ctx->len = len;
+
+    return 1;
+}
+
+/** Define the initialization function of a hash algorithm. */
+#define HASH_AFALG_INIT(name, id, len)					\
+int hash_afalg_##name##_init(HASH_AFALG *ctx)				\
+{									\
+    return hash_afalg_init(ctx, id, len);				\
+}
+
+HASH_AFALG_INIT(sha1, HASH_ID_SHA1, 20)
+HASH_AFALG_INIT(sha224, HASH_ID_SHA224, 28)
+HASH_AFALG_INIT(sha256, HASH_ID_SHA256, 32)
+HASH_AFALG_INIT(sha384, HASH_ID_SHA384, 48)
+HASH_AFALG_INIT(sha512, HASH_ID_SHA512, 64)
+HASH_AFALG_INIT(sha3_224, HASH_ID_SHA3_224, 28)
+HASH_AFALG_INIT(sha3_256, HASH_ID_SHA3_256, 32)
+HASH_AFALG_INIT(sha3_384, HASH_ID_SHA3_384, 48)
+HASH_AFALG_INIT(sha3_512, HASH_ID_SHA3_512, 64)
+HASH_AFALG_INIT(blake2b_256, HASH_ID_BLAKE2B_256, 32)
+HASH_AFALG_INIT(blake2b_384, HASH_ID_BLAKE2B_384, 48)
+HASH_AFALG_INIT(blake2b_512, HASH_ID_BLAKE2B_512, 64)
+
+/**
+ * Update the digest with more data.
+ * The data is sent to the kernel with more to follow.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The data to digest.
+ * @param [in] len   The length of the data to digest.
+ * @return  0 when sending failed.<br>
+ *          1 otherwise.
+ */
+int hash_afalg_update(HASH_AFALG *ctx, const void *data, size_t len)
+{
+    ssize_t n;
+    const unsigned char *d = data;
+
+    while (len > 0)
+    {
+        n = send(ctx->op, d, len, MSG_MORE);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        d += n;
+        len -= n;
+        ctx->more = 1;
+    }
+
+    return 1;
+}
+
+/**
+ * Calculate the message digest based on all the message data seen.
+ * Reading the result finalizes the operation in the kernel.
+ *
+ * @param [in] md   The buffer to hold the message digest.
+ * @param [in] ctx  The context of the hash operation.
+ * @return  0 when reading failed.<br>
+ *          1 otherwise.
+ */
+int hash_afalg_final(unsigned char *md, HASH_AFALG *ctx)
+{
+    ssize_t n;
+
+    do
+        n = read(ctx->op, md, ctx->len);
+    while ((n < 0) && (errno == EINTR));
+    ctx->more = 0;
+
+    return n == ctx->len;
+}
+
+/**
+ * Duplicate the digest context including the state of the operation.
+ * Accepting on an operation socket clones the kernel's state.
+ *
+ * @param [in] dst  The zeroed context to copy into.
+ * @param [in] src  The context of the hash operation.
+ * @return  0 when the kernel failed.<br>
+ *          1 otherwise.
+ */
+int hash_afalg_dup(HASH_AFALG *dst, const HASH_AFALG *src)
+{
+    *dst = *src;
+    if (!src->open)
+        return 1;
+
+    dst->open = 0;
+    dst->op = accept4(src->op, NULL, 0, SOCK_CLOEXEC);
+    if (dst->op < 0)
+        return 0;
+    dst->open = 1;
+
+    return 1;
+}
+
+/**
+ * Close the operation socket.
+ *
+ * @param [in] ctx  The context of the hash operation.
+ */
+void hash_afalg_cleanup(HASH_AFALG *ctx)
+{
+    if (ctx->open)
+        close(ctx->op);
+    ctx->open = 0;
+}
+
+/**
+ * Splice all the data from a file descriptor into the kernel and read the
+ * message digest.
+ * Data goes through a pipe: file to pipe, then pipe to socket with more to
+ * follow. sendfile() isn't used as it doesn't say more follows at the end of
+ * each call.
+ *
+ * @param [in] id   The hash algorithm identifier.
+ * @param [in] fd   The file descriptor to read until end of file.
+ * @param [in] md   The buffer to hold the message digest.
+ * @param [in] len  The length of the message digest.
+ * @return  HASH_ERR_NOT_SUPPORTED when the kernel doesn't have the algorithm
+ *          or the file descriptor can't be spliced - no data was read.<br>
+ *          HASH_ERR_IO when reading or the kernel failed.<br>
+ *          0 otherwise.
+ */
+int hash_afalg_digest_fd(HASH_ID id, int fd, unsigned char *md, int len)
+{
+    int ret = HASH_ERR_NOT_SUPPORTED;
+    int op = -1;
+    int p[2] = { -1, -1 };
+    ssize_t n, m;
+    int first = 1;
+
+    if (!hash_afalg_available(id))
+        goto end;
+    op = accept4(hash_afalg_tfm[id], NULL, 0, SOCK_CLOEXEC);
+    if (op < 0)
+        goto end;
+    if (pipe2(p, O_CLOEXEC) != 0)
+        goto end;
+
+    for (;;)
+    {
+        n = splice(fd, NULL, p[1], NULL, HASH_AFALG_SPLICE_LEN,
+            SPLICE_F_MOVE | SPLICE_F_MORE);
+        if ((n < 0) && (errno == EINTR))
+            continue;
+        if (n < 0)
+        {
+            /* Caller reads the data instead when nothing was consumed. */
+            if (!first || (errno != EINVAL))
+                ret = HASH_ERR_IO;
+            goto end;
+        }
+        if (n == 0)
+            break;
+        first = 0;
+
+        while (n > 0)
+        {
+            m = splice(p[0], NULL, op, NULL, n, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if ((m < 0) && (errno == EINTR))
+                continue;
+            if (m <= 0)
+            {
+                ret = HASH_ERR_IO;
+                goto end;
+            }
+            n -= m;
+        }
+    }
+
+    do
+        n = read(op, md, len);
+    while ((n < 0) && (errno == EINTR));
+    ret = (n == len) ? 0 : HASH_ERR_IO;
+end:
+    if (p[0] >= 0)
+    {
+        close(p[0]);
+        close(p[1]);
+    }
+    if (op >= 0)
+        close(op);
+    return ret;
+}
+
+#endif
+
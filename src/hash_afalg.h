@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HASH_AFALG_H
+#define HASH_AFALG_H
+
+#ifdef OPT_HASH_AFALG
+
+#include <stddef.h>
+#include "hash.h"
+
+/** The context of a digest calculated by the Linux kernel. */
+typedef struct hash_afalg_st
+{
+    /** The operation socket. Only valid when open. */
+    int op;
+    /** Whether the operation socket is open. */
+    int open;
+    /** Whether data has been sent since the operation was initialized. */
+    int more;
+    /** The length of the message digest. */
+    int len;
+} HASH_AFALG;
+
+int hash_afalg_available(HASH_ID id);
+
+int hash_afalg_sha1_init(HASH_AFALG *ctx);
+int hash_afalg_sha224_init(HASH_AFALG *ctx);
+int hash_afalg_sha256_init(HASH_AFALG *ctx);
+int hash_afalg_sha384_init(HASH_AFALG *ctx);
+int hash_afalg_sha512_init(HASH_AFALG *ctx);
+int hash_afalg_sha3_224_init(HASH_AFALG *ctx);
+int hash_afalg_sha3_256_init(HASH_AFALG *ctx);
+int hash_afalg_sha3_384_init(HASH_AFALG *ctx);
+int hash_afalg_sha3_512_init(HASH_AFALG *ctx);
+int hash_afalg_blake2b_256_init(HASH_AFALG *ctx);
+int hash_afalg_blake2b_384_init(HASH_AFALG *ctx);
+int hash_afalg_blake2b_512_init(HASH_AFALG *ctx);
+int hash_afalg_update(HASH_AFALG *ctx, const void *data, size_t len);
+int hash_afalg_final(unsigned char *md, HASH_AFALG *ctx);
+int hash_afalg_dup(HASH_AFALG *dst, const HASH_AFALG *src);
+void hash_afalg_cleanup(HASH_AFALG *ctx);
+
+int hash_afalg_digest_fd(HASH_ID id, int fd, unsigned char *md, int len);
+
+#endif
+
+#endif
+
@@ -386,6 +386,23 @@ int hash_blake2b_512_init(HASH_BLAKE2B *ctx)
     return 1;
 }
 
+/**
+ * Initialize a digest operation for BLAKE2b with any output length.
+ * Used by Argon2's variable-length hash function H'.
+ *
+ * @param [in] ctx  The BLAKE2b hash context.
+ * @param [in] len  The length of the digest output in bytes: 1 to 64.
+ * @return  0 when the length is out of range.<br>
+ *          1 otherwise.
+ */
+int hash_blake2b_len_init(HASH_BLAKE2B *ctx, size_t len)
+{
+    if ((len == 0) || (len > HASH_BLAKE2B_512_LEN))
+        return 0;
+    blake2b_init(ctx, len);
+    return 1;
+}
+
 /**
  * Update the operation with message data.
  *
@@ -410,7 +427,7 @@ int hash_blake2b_update(HASH_BLAKE2B *ctx, const void *in, size_t len)
  */
 int hash_blake2b_224_final(void *out, HASH_BLAKE2B *ctx)
 {
-    blake2b_final(ctx, out, 24);
+    blake2b_final(ctx, out, 28);
     return 1;
 }
 /**
@@ -452,4 +469,82 @@ int hash_blake2b_512_final(void *out, HASH_BLAKE2B *ctx)
     blake2b_final(ctx, out, 64);
     return 1;
 }
+/**
+ * Finalize the digest and generate output of the length initialized with.
+ *
+ * @param [in] out  The digest ouput.
+ * @param [in] ctx  The BLAKE2b hash context.
+ * @param [in] len  The length of the digest output - as passed to
+ *                  hash_blake2b_len_init().
+ * @return  1 to indicate success.
+ */
+int hash_blake2b_len_final(void *out, HASH_BLAKE2B *ctx, size_t len)
+{
+    blake2b_final(ctx, out, len);
+    return 1;
+}
+
+/**
+ * Export the BLAKE2b state in a portable format.
+ * Numbers are stored big-endian. Unused message bytes are zero.
+ *
+ * @param [in] data  The buffer to hold the state of HASH_BLAKE2B_STATE_LEN
+ *                   bytes.
+ * @param [in] ctx   The BLAKE2b hash context.
+ * @return  1 to indicate success.
+ */
+int hash_blake2b_export(unsigned char *data, HASH_BLAKE2B *ctx)
+{
+    int i, j;
+
+    for (i=0; i<8; i++)
+        for (j=0; j<8; j++)
+            data[i*8+j] = ctx->h[i] >> ((7-j)*8);
+    data += 64;
+    for (i=0; i<2; i++)
+        for (j=0; j<8; j++)
+            data[i*8+j] = ctx->n[i] >> ((7-j)*8);
+    data += 16;
+    *(data++) = ctx->i;
+    memcpy(data, ctx->b, ctx->i);
+    memset(data + ctx->i, 0, 128 - ctx->i);
+
+    return 1;
+}
+
+/**
+ * Import the BLAKE2b state from the portable format.
+ *
+ * @param [in] ctx   The BLAKE2b hash context.
+ * @param [in] data  The exported state of HASH_BLAKE2B_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_blake2b_import(HASH_BLAKE2B *ctx, const unsigned char *data)
+{
+    int i, j;
+
+    /* A full block is kept until more data is seen. */
+    if (data[80] > 128)
+        return 0;
+
+    for (i=0; i<8; i++)
+    {
+        ctx->h[i] = 0;
+        for (j=0; j<8; j++)
+            ctx->h[i] |= ((uint64_t)data[i*8+j]) << ((7-j)*8);
+    }
+    data += 64;
+    for (i=0; i<2; i++)
+    {
+        ctx->n[i] = 0;
+        for (j=0; j<8; j++)
+            ctx->n[i] |= ((uint64_t)data[i*8+j]) << ((7-j)*8);
+    }
+    data += 16;
+    ctx->i = *(data++);
+    memcpy(ctx->b, data, 128);
+
+    return 1;
+}
 
@@ -32,6 +32,9 @@
 /** The length of the BLAKE2b-512 digest output. */
 #define HASH_BLAKE2B_512_LEN	64
 
+/** The length of the exported BLAKE2b state. */
+#define HASH_BLAKE2B_STATE_LEN	(64 + 16 + 1 + 128)
+
 /** Data structure for BLAKE2b */
 typedef struct hash_blake2b_st
 {
@@ -49,6 +52,7 @@ int hash_blake2b_224_init(HASH_BLAKE2B *ctx);
 int hash_blake2b_256_init(HASH_BLAKE2B *ctx);
 int hash_blake2b_384_init(HASH_BLAKE2B *ctx);
 int hash_blake2b_512_init(HASH_BLAKE2B *ctx);
+int hash_blake2b_len_init(HASH_BLAKE2B *ctx, size_t len);
 int hash_blake2b_224_mac_init(HASH_BLAKE2B *ctx, const void *key, size_t len);
 int hash_blake2b_256_mac_init(HASH_BLAKE2B *ctx, const void *key, size_t len);
 int hash_blake2b_384_mac_init(HASH_BLAKE2B *ctx, const void *key, size_t len);
@@ -58,4 +62,7 @@ int hash_blake2b_224_final(void *out, HASH_BLAKE2B *ctx);
 int hash_blake2b_256_final(void *out, HASH_BLAKE2B *ctx);
 int hash_blake2b_384_final(void *out, HASH_BLAKE2B *ctx);
 int hash_blake2b_512_final(void *out, HASH_BLAKE2B *ctx);
+int hash_blake2b_len_final(void *out, HASH_BLAKE2B *ctx, size_t len);
+int hash_blake2b_export(unsigned char *data, HASH_BLAKE2B *ctx);
+int hash_blake2b_import(HASH_BLAKE2B *ctx, const unsigned char *data);
 
@@ -123,44 +123,41 @@ static const uint64_t blake2s_iv[4] =
 static void blake2s_compress(HASH_BLAKE2S *ctx, const uint8_t *b, int last)
 {
     int i;
-    uint32_t s[16];
-    uint64_t *s64 = (uint64_t *)s;
-    uint32_t d[16];
-    uint64_t *d64 = (uint64_t *)d;
-    uint64_t *h64 = (uint64_t *)ctx->h;
+    /* Access the 32-bit words 64 bits at a time without breaking aliasing. */
+    union { uint32_t w[16]; uint64_t d[8]; } s, d;
 
     /* Even when little-endian - holds data locally. */
     for (i=0; i<8; i++)
-        BA2N_64_LE(d64[i], &b[i*8]);
+        BA2N_64_LE(d.d[i], &b[i*8]);
 
     /* Init working state. */
-    for (i=0; i<4; i++)
-        s64[i] = h64[i];
+    for (i=0; i<8; i++)
+        s.w[i] = ctx->h[i];
 #ifdef HASH_BLAKE2S_IV_32
     for (i=0; i<8; i++)
-        s[i+8] = blake2s_iv[i];
+        s.w[i+8] = blake2s_iv[i];
 #else
     for (i=0; i<4; i++)
-        s64[i+4] = blake2s_iv[i];
+        s.d[i+4] = blake2s_iv[i];
 #endif
 
-    s[12] ^= ctx->n[0];
-    s[13] ^= ctx->n[1];
-    s[14] ^= last;
-
-    MIX_G_I(s, d, 0);
-    MIX_G_I(s, d, 1);
-    MIX_G_I(s, d, 2);
-    MIX_G_I(s, d, 3);
-    MIX_G_I(s, d, 4);
-    MIX_G_I(s, d, 5);
-    MIX_G_I(s, d, 6);
-    MIX_G_I(s, d, 7);
-    MIX_G_I(s, d, 8);
-    MIX_G_I(s, d, 9);
+    s.w[12] ^= ctx->n[0];
+    s.w[13] ^= ctx->n[1];
+    s.w[14] ^= last;
+
+    MIX_G_I(s.w, d.w, 0);
+    MIX_G_I(s.w, d.w, 1);
+    MIX_G_I(s.w, d.w, 2);
+    MIX_G_I(s.w, d.w, 3);
+    MIX_G_I(s.w, d.w, 4);
+    MIX_G_I(s.w, d.w, 5);
+    MIX_G_I(s.w, d.w, 6);
+    MIX_G_I(s.w, d.w, 7);
+    MIX_G_I(s.w, d.w, 8);
+    MIX_G_I(s.w, d.w, 9);
 
     for (i=0; i<8; i++)
-        ctx->h[i] ^= s[i] ^ s[i+8];
+        ctx->h[i] ^= s.w[i] ^ s.w[i+8];
 }
 
 /**
@@ -400,3 +397,67 @@ int hash_blake2s_256_final(void *out, HASH_BLAKE2S *ctx)
     return 1;
 }
 
+/**
+ * Export the BLAKE2s state in a portable format.
+ * Numbers are stored big-endian. Unused message bytes are zero.
+ *
+ * @param [in] data  The buffer to hold the state of HASH_BLAKE2S_STATE_LEN
+ *                   bytes.
+ * @param [in] ctx   The BLAKE2s hash context.
+ * @return  1 to indicate success.
+ */
+int hash_blake2s_export(unsigned char *data, HASH_BLAKE2S *ctx)
+{
+    int i, j;
+
+    for (i=0; i<8; i++)
+        for (j=0; j<4; j++)
+            data[i*4+j] = ctx->h[i] >> ((3-j)*8);
+    data += 32;
+    for (i=0; i<2; i++)
+        for (j=0; j<4; j++)
+            data[i*4+j] = ctx->n[i] >> ((3-j)*8);
+    data += 8;
+    *(data++) = ctx->i;
+    memcpy(data, ctx->b, ctx->i);
+    memset(data + ctx->i, 0, 64 - ctx->i);
+
+    return 1;
+}
+
+/**
+ * Import the BLAKE2s state from the portable format.
+ *
+ * @param [in] ctx   The BLAKE2s hash context.
+ * @param [in] data  The exported state of HASH_BLAKE2S_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_blake2s_import(HASH_BLAKE2S *ctx, const unsigned char *data)
+{
+    int i, j;
+
+    /* A full block is kept until more data is seen. */
+    if (data[40] > 64)
+        return 0;
+
+    for (i=0; i<8; i++)
+    {
+        ctx->h[i] = 0;
+        for (j=0; j<4; j++)
+            ctx->h[i] |= ((uint32_t)data[i*4+j]) << ((3-j)*8);
+    }
+    data += 32;
+    for (i=0; i<2; i++)
+    {
+        ctx->n[i] = 0;
+        for (j=0; j<4; j++)
+            ctx->n[i] |= ((uint32_t)data[i*4+j]) << ((3-j)*8);
+    }
+    data += 8;
+    ctx->i = *(data++);
+    memcpy(ctx->b, data, 64);
+
+    return 1;
+}
+
@@ -28,6 +28,9 @@
 /** The length of the BLAKE2s-256 digest output. */
 #define HASH_BLAKE2S_256_LEN    32
 
+/** The length of the exported BLAKE2s state. */
+#define HASH_BLAKE2S_STATE_LEN  (32 + 8 + 1 + 64)
+
 /** Data structure for BLAKE2s */
 typedef struct hash_blake2s_st
 {
@@ -48,4 +51,6 @@ int hash_blake2s_256_mac_init(HASH_BLAKE2S *ctx, const void *key, size_t len);
 int hash_blake2s_update(HASH_BLAKE2S *ctx, const void *in, size_t len);
 int hash_blake2s_224_final(void *out, HASH_BLAKE2S *ctx);
 int hash_blake2s_256_final(void *out, HASH_BLAKE2S *ctx);
+int hash_blake2s_export(unsigned char *data, HASH_BLAKE2S *ctx);
+int hash_blake2s_import(HASH_BLAKE2S *ctx, const unsigned char *data);
 
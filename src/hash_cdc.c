@@ -0,0 +1,574 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Content-defined chunking of a stream of data with a digest of each chunk.
+ * Boundaries are found with the Gear rolling hash as in FastCDC: the first
+ * bytes of a chunk are skipped, a harder test is used until the average
+ * length and an easier one after it (normalized chunking) so that lengths
+ * cluster around the average.
+ * Data is copied into one of two buffers. When a buffer fills, its complete
+ * chunks are digested with HASH_batch - on threads when asked for - while the
+ * chunks of the other buffer are found. The incomplete chunk at the end is
+ * carried into the other buffer.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "hash.h"
+
+/** The smallest average chunk length. */
+#define HASH_CDC_AVG_MIN	256
+/** The largest average chunk length. */
+#define HASH_CDC_AVG_MAX	(64 * 1024)
+/** The maximum number of threads digesting the chunks of a buffer. */
+#define HASH_CDC_THREAD_MAX	16
+/** The length of a buffer in maximum length chunks. */
+#define HASH_CDC_BUF_CHUNKS	16
+
+/** The work of a thread: digest some of the chunks of a buffer. */
+typedef struct hash_cdc_job_st
+{
+    /** The hash algorithm identifier. */
+    HASH_ID id;
+    /** The method implementation flags. */
+    int flags;
+    /** The chunks' data. */
+    const unsigned char **msgs;
+    /** The lengths of the chunks. */
+    size_t *lens;
+    /** The number of chunks. */
+    int cnt;
+    /** The buffers to hold the digests. */
+    unsigned char **md;
+    /** The result of the batch digest. */
+    int ret;
+} HASH_CDC_JOB;
+
+/** A buffer of data and the chunks found in it. */
+typedef struct hash_cdc_buf_st
+{
+    /** The data. */
+    unsigned char *data;
+    /** The length of the data in the buffer. */
+    size_t len;
+    /** The offset in the stream of the first byte of data. */
+    uint64_t off;
+    /** The offset in the buffer of the chunk being found. */
+    size_t start;
+    /** The number of complete chunks. */
+    int cnt;
+    /** The data of each chunk. */
+    const unsigned char **msgs;
+    /** The length of each chunk. */
+    size_t *lens;
+    /** The digest buffer of each chunk. */
+    unsigned char **md;
+    /** Whether the chunks are being digested. */
+    int busy;
+    /** The jobs digesting the chunks. */
+    HASH_CDC_JOB job[HASH_CDC_THREAD_MAX];
+    /** The threads of the jobs. */
+    pthread_t thread[HASH_CDC_THREAD_MAX];
+    /** Whether each thread was started. */
+    int started[HASH_CDC_THREAD_MAX];
+} HASH_CDC_BUF;
+
+/** The content-defined chunker structure. */
+struct hash_cdc_st
+{
+    /** The hash algorithm identifier. */
+    HASH_ID id;
+    /** The method implementation flags. */
+    int flags;
+    /** The length of the digest. */
+    int dlen;
+    /** The number of threads digesting the chunks - 0 for none. */
+    int threads;
+    /** The minimum length of a chunk. */
+    size_t min;
+    /** The average length of a chunk. */
+    size_t avg;
+    /** The maximum length of a chunk. */
+    size_t max;
+    /** The mask of the rolling hash tested before the average length. */
+    uint64_t mask_s;
+    /** The mask of the rolling hash tested after the average length. */
+    uint64_t mask_l;
+    /** The length of each buffer. */
+    size_t buf_len;
+    /** The buffers: one being scanned, the other being digested. */
+    HASH_CDC_BUF buf[2];
+    /** The index of the buffer being scanned. */
+    int cur;
+    /** The number of bytes of the current chunk scanned. */
+    size_t pos;
+    /** The rolling hash of the current chunk. */
+    uint64_t fp;
+    /** The function called with each chunk. */
+    HASH_CDC_CB *cb;
+    /** The argument to pass to the function. */
+    void *arg;
+};
+
+/** The random value added to the rolling hash for each byte value. */
+static uint64_t hash_cdc_gear[256];
+/** Ensures the table is only calculated once. */
+static pthread_once_t hash_cdc_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Calculate the Gear table with SplitMix64 from a fixed seed.
+ * Chunk boundaries depend on the table so it must never change.
+ */
+static void hash_cdc_gear_init(void)
+{
+    uint64_t s = 0x4cdc4cdc4cdc4cdcULL;
+    uint64_t z;
+    int i;
+
+    for (i=0; i<256; i++)
+    {
+        z = (s += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        hash_cdc_gear[i] = z ^ (z >> 31);
+    }
+}
+
+/**
+ * Thread function digesting chunks.
+ *
+ * @param [in] arg  The job.
+ * @return  NULL.
+ */
+static void *hash_cdc_thread(void *arg)
+{
+    HASH_CDC_JOB *job = arg;
+
+    job->ret = HASH_batch(job->id, job->flags, job->msgs, job->lens, job->cnt,
+        job->md);
+    return NULL;
+}
+
+/**
+ * Find the end of the chunk starting at the data.
+ * Continues from the bytes already scanned and their rolling hash.
+ *
+ * @param [in] cdc   The chunker object.
+ * @param [in] p     The start of the chunk.
+ * @param [in] len   The length of data available from the start.
+ * @param [in] last  Whether there is no more data.
+ * @return  The length of the chunk.<br>
+ *          0 when more data is needed.
+ */
+static size_t hash_cdc_cut(HASH_CDC *cdc, const unsigned char *p, size_t len,
+    int last)
+{
+    size_t i = cdc->pos;
+    size_t n;
+    uint64_t fp = cdc->fp;
+    uint64_t mask;
+
+    /* Cut-points are never within the minimum length. */
+    if (i < cdc->min)
+        i = cdc->min;
+
+    /* More bits must be zero before the average length. */
+    mask = cdc->mask_s;
+    n = (len < cdc->avg) ? len : cdc->avg;
+    for (; i < n; i++)
+    {
+        fp = (fp << 1) + hash_cdc_gear[p[i]];
+        if ((fp & mask) == 0)
+            return i + 1;
+    }
+    mask = cdc->mask_l;
+    n = (len < cdc->max) ? len : cdc->max;
+    for (; i < n; i++)
+    {
+        fp = (fp << 1) + hash_cdc_gear[p[i]];
+        if ((fp & mask) == 0)
+            return i + 1;
+    }
+    if (i == cdc->max)
+        return i;
+    if (last)
+        return len;
+
+    cdc->pos = i;
+    cdc->fp = fp;
+    return 0;
+}
+
+/**
+ * Find the complete chunks in the data of the buffer being scanned.
+ *
+ * @param [in] cdc   The chunker object.
+ * @param [in] last  Whether there is no more data.
+ */
+static void hash_cdc_scan(HASH_CDC *cdc, int last)
+{
+    HASH_CDC_BUF *b = &cdc->buf[cdc->cur];
+    size_t l;
+
+    while (b->start < b->len)
+    {
+        l = hash_cdc_cut(cdc, b->data + b->start, b->len - b->start, last);
+        if (l == 0)
+            break;
+        b->msgs[b->cnt] = b->data + b->start;
+        b->lens[b->cnt] = l;
+        b->cnt++;
+        b->start += l;
+        cdc->pos = 0;
+        cdc->fp = 0;
+    }
+}
+
+/**
+ * Wait for the chunks of a buffer to be digested and pass each to the
+ * callback in order. The buffer is then empty.
+ *
+ * @param [in] cdc   The chunker object.
+ * @param [in] b     The buffer.
+ * @param [in] emit  Whether to pass the chunks to the callback.
+ * @return  HASH_ERR_BAD_DATA when digesting failed.<br>
+ *          The callback's return when not 0.<br>
+ *          0 otherwise.
+ */
+static int hash_cdc_wait(HASH_CDC *cdc, HASH_CDC_BUF *b, int emit)
+{
+    int ret = 0;
+    int i, n;
+    HASH_CDC_CHUNK chunk;
+
+    if (b->busy)
+    {
+        n = (cdc->threads == 0) ? 1 : cdc->threads;
+        for (i=0; i<n; i++)
+        {
+            if (b->started[i])
+                pthread_join(b->thread[i], NULL);
+            if ((ret == 0) && (b->job[i].ret != 0))
+                ret = b->job[i].ret;
+        }
+        b->busy = 0;
+    }
+
+    chunk.off = b->off;
+    for (i=0; emit && (ret == 0) && (i<b->cnt); i++)
+    {
+        chunk.len = b->lens[i];
+        chunk.data = b->msgs[i];
+        chunk.md = b->md[i];
+        ret = cdc->cb(cdc->arg, &chunk);
+        chunk.off += chunk.len;
+    }
+    b->cnt = 0;
+    b->len = 0;
+    b->start = 0;
+    return ret;
+}
+
+/**
+ * Start digesting the chunks of the buffer being scanned and move the
+ * incomplete chunk into the other buffer to continue scanning.
+ * The other buffer's chunks are waited for and passed to the callback first.
+ *
+ * @param [in] cdc  The chunker object.
+ * @return  HASH_ERR_BAD_DATA when digesting failed.<br>
+ *          The callback's return when not 0.<br>
+ *          0 otherwise.
+ */
+static int hash_cdc_seal(HASH_CDC *cdc)
+{
+    int ret;
+    int i, n, s, e;
+    HASH_CDC_BUF *b = &cdc->buf[cdc->cur];
+    HASH_CDC_BUF *o = &cdc->buf[cdc->cur ^ 1];
+
+    ret = hash_cdc_wait(cdc, o, 1);
+    if (ret != 0)
+        goto end;
+
+    o->off = b->off + b->start;
+    o->len = b->len - b->start;
+    memcpy(o->data, b->data + b->start, o->len);
+    b->len = b->start;
+
+    /* Split the chunks between the threads - or digest them now. */
+    n = (cdc->threads == 0) ? 1 : cdc->threads;
+    for (i=0; i<n; i++)
+    {
+        s = (int)((long)b->cnt * i / n);
+        e = (int)((long)b->cnt * (i + 1) / n);
+        b->job[i].id = cdc->id;
+        b->job[i].flags = cdc->flags;
+        b->job[i].msgs = b->msgs + s;
+        b->job[i].lens = b->lens + s;
+        b->job[i].cnt = e - s;
+        b->job[i].md = b->md + s;
+        b->job[i].ret = 0;
+        b->started[i] = (cdc->threads != 0) && (e > s) &&
+            (pthread_create(&b->thread[i], NULL, hash_cdc_thread,
+             &b->job[i]) == 0);
+        if (!b->started[i])
+            hash_cdc_thread(&b->job[i]);
+    }
+    b->busy = 1;
+    cdc->cur ^= 1;
+end:
+    return ret;
+}
+
+/**
+ * Create a content-defined chunker that digests each chunk.
+ * Chunks are between a quarter of and eight times the average length.
+ *
+ * @param [in]  id       The hash algorithm identifier.
+ * @param [in]  flags    The method implementation flags required and, shifted
+ *                       with HASH_METH_FLAG_EXCLUDE, the flags excluded.
+ *                       e.g. HASH_METH_FLAG_AVX2 for multi-buffer SHA-256.
+ * @param [in]  avg      The average length of a chunk - a power of 2 from
+ *                       256 to 65536.
+ * @param [in]  threads  The number of threads to digest chunks on while the
+ *                       data is scanned - 0 to digest on the calling thread.
+ * @param [in]  cb       The function called with each chunk in order.
+ * @param [in]  arg      The argument to pass to the function.
+ * @param [out] cdc      The new chunker object.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the average length or the number of threads
+ *          is not valid.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the hash
+ *          algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          0 otherwise.
+ */
+int HASH_CDC_new(HASH_ID id, int flags, size_t avg, int threads,
+    HASH_CDC_CB *cb, void *arg, HASH_CDC **cdc)
+{
+    int ret = 0;
+    int i, j, bits, cnt;
+    HASH_CDC *nc = NULL;
+    HASH_CDC_BUF *b;
+
+    if ((cb == NULL) || (cdc == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if ((avg < HASH_CDC_AVG_MIN) || (avg > HASH_CDC_AVG_MAX) ||
+        ((avg & (avg - 1)) != 0) || (threads < 0) ||
+        (threads > HASH_CDC_THREAD_MAX))
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    /* Finds the method without digesting. */
+    ret = HASH_batch(id, flags, NULL, NULL, 0, NULL);
+    if (ret != 0)
+        goto end;
+
+    nc = calloc(1, sizeof(*nc));
+    if (nc == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+    nc->id = id;
+    nc->flags = flags;
+    HASH_METH_get_len(id, &nc->dlen);
+    nc->threads = threads;
+    nc->avg = avg;
+    nc->min = avg / 4;
+    nc->max = avg * 8;
+    for (bits=0; ((size_t)1 << bits) < avg; bits++)
+        ;
+    nc->mask_s = ~(uint64_t)0 << (64 - (bits + 2));
+    nc->mask_l = ~(uint64_t)0 << (64 - (bits - 2));
+    nc->buf_len = nc->max * HASH_CDC_BUF_CHUNKS;
+    nc->cb = cb;
+    nc->arg = arg;
+
+    cnt = (int)(nc->buf_len / nc->min) + 1;
+    for (i=0; i<2; i++)
+    {
+        b = &nc->buf[i];
+        b->data = malloc(nc->buf_len);
+        b->msgs = malloc(cnt * sizeof(*b->msgs));
+        b->lens = malloc(cnt * sizeof(*b->lens));
+        b->md = calloc(cnt, sizeof(*b->md));
+        if ((b->data == NULL) || (b->msgs == NULL) || (b->lens == NULL) ||
+            (b->md == NULL))
+        {
+            ret = HASH_ERR_ALLOC;
+            goto end;
+        }
+        b->md[0] = malloc((size_t)cnt * nc->dlen);
+        if (b->md[0] == NULL)
+        {
+            ret = HASH_ERR_ALLOC;
+            goto end;
+        }
+        for (j=1; j<cnt; j++)
+            b->md[j] = b->md[0] + (size_t)j * nc->dlen;
+    }
+    pthread_once(&hash_cdc_once, hash_cdc_gear_init);
+
+    *cdc = nc;
+    nc = NULL;
+end:
+    HASH_CDC_free(nc);
+    return ret;
+}
+
+/**
+ * Free the chunker object.
+ * Chunks not yet passed to the callback are dropped.
+ *
+ * @param [in] cdc  The chunker object. May be NULL.
+ */
+void HASH_CDC_free(HASH_CDC *cdc)
+{
+    int i;
+
+    if (cdc != NULL)
+    {
+        for (i=0; i<2; i++)
+        {
+            hash_cdc_wait(cdc, &cdc->buf[i], 0);
+            if (cdc->buf[i].md != NULL)
+                free(cdc->buf[i].md[0]);
+            free(cdc->buf[i].md);
+            free(cdc->buf[i].lens);
+            free(cdc->buf[i].msgs);
+            free(cdc->buf[i].data);
+        }
+        free(cdc);
+    }
+}
+
+/**
+ * Initialize the chunker to start a new stream.
+ * Chunks of a previous stream not yet passed to the callback are dropped.
+ *
+ * @param [in] cdc  The chunker object.
+ * @return  HASH_ERR_PARAM_NULL when cdc is NULL.<br>
+ *          0 otherwise.
+ */
+int HASH_CDC_init(HASH_CDC *cdc)
+{
+    int ret = 0;
+    int i;
+
+    if (cdc == NULL)
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    for (i=0; i<2; i++)
+    {
+        hash_cdc_wait(cdc, &cdc->buf[i], 0);
+        cdc->buf[i].off = 0;
+    }
+    cdc->cur = 0;
+    cdc->pos = 0;
+    cdc->fp = 0;
+end:
+    return ret;
+}
+
+/**
+ * Chunk more of the stream.
+ * The data is copied so it need not be kept. Chunks are passed to the
+ * callback, with their digests, once a buffer's worth of data later.
+ *
+ * @param [in] cdc  The chunker object.
+ * @param [in] msg  The data.
+ * @param [in] len  The length of the data.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when digesting failed.<br>
+ *          The callback's return when not 0.<br>
+ *          0 otherwise.
+ */
+int HASH_CDC_update(HASH_CDC *cdc, const unsigned char *msg, size_t len)
+{
+    int ret = 0;
+    size_t l;
+    HASH_CDC_BUF *b;
+
+    if ((cdc == NULL) || ((msg == NULL) && (len > 0)))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    while ((ret == 0) && (len > 0))
+    {
+        b = &cdc->buf[cdc->cur];
+        l = cdc->buf_len - b->len;
+        if (l > len)
+            l = len;
+        memcpy(b->data + b->len, msg, l);
+        b->len += l;
+        msg += l;
+        len -= l;
+
+        hash_cdc_scan(cdc, 0);
+        if (b->len == cdc->buf_len)
+            ret = hash_cdc_seal(cdc);
+    }
+end:
+    return ret;
+}
+
+/**
+ * Finish the stream: the remaining data is the last chunk. All chunks are
+ * passed to the callback before returning.
+ *
+ * @param [in] cdc  The chunker object.
+ * @return  HASH_ERR_PARAM_NULL when cdc is NULL.<br>
+ *          HASH_ERR_BAD_DATA when digesting failed.<br>
+ *          The callback's return when not 0.<br>
+ *          0 otherwise.
+ */
+int HASH_CDC_final(HASH_CDC *cdc)
+{
+    int ret = 0;
+
+    if (cdc == NULL)
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    hash_cdc_scan(cdc, 1);
+    ret = hash_cdc_seal(cdc);
+    if (ret == 0)
+        ret = hash_cdc_wait(cdc, &cdc->buf[cdc->cur ^ 1], 1);
+    if (ret == 0)
+        ret = HASH_CDC_init(cdc);
+end:
+    return ret;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <pthread.h>
+#include "hash.h"
+#include "hash_cpu.h"
+#ifdef CPU_X86_64
+#include <cpuid.h>
+#endif
+
+/** The method flags of the CPU features available. */
+static int hash_cpu_features = 0;
+/** Ensures the CPU features are detected only once. */
+static pthread_once_t hash_cpu_once = PTHREAD_ONCE_INIT;
+
+#ifdef CPU_X86_64
+/** XCR0 bits: SSE and AVX state saved by the operating system. */
+#define XCR0_AVX	0x06
+/** XCR0 bits: AVX-512 opmask and upper ZMM state also saved. */
+#define XCR0_AVX512	0xe6
+
+/**
+ * Get the extended control register 0 - the CPU state the operating system
+ * saves on a context switch.
+ *
+ * @return  Value of XCR0.
+ */
+static uint64_t hash_cpu_xgetbv(void)
+{
+    uint32_t lo, hi;
+
+    __asm__ __volatile__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+    return ((uint64_t)hi << 32) | lo;
+}
+#endif
+
+/**
+ * Detect the features of the CPU that implementations may use.
+ * Vector extensions are only used when the operating system saves the state.
+ */
+static void hash_cpu_detect(void)
+{
+    int features = 0;
+#ifdef CPU_X86_64
+    unsigned int a, b, c, d;
+    unsigned int max;
+    uint64_t xcr0 = 0;
+
+    max = __get_cpuid_max(0, NULL);
+    if (max >= 1)
+    {
+        __cpuid(1, a, b, c, d);
+        if (c & bit_SSE4_1)
+            features |= HASH_METH_FLAG_SSE41;
+        if (c & bit_SSE4_2)
+            features |= HASH_METH_FLAG_SSE42;
+        if ((c & bit_PCLMUL) && (c & bit_SSE4_2))
+            features |= HASH_METH_FLAG_PCLMUL;
+        if (c & bit_RDRND)
+            features |= HASH_CPU_FLAG_RDRAND;
+        if (c & bit_OSXSAVE)
+            xcr0 = hash_cpu_xgetbv();
+    }
+    if (max >= 7)
+    {
+        __cpuid_count(7, 0, a, b, c, d);
+        if ((b & bit_AVX2) && ((xcr0 & XCR0_AVX) == XCR0_AVX))
+            features |= HASH_METH_FLAG_AVX2;
+        if ((b & bit_AVX512F) && (b & bit_AVX512BW) &&
+            ((xcr0 & XCR0_AVX512) == XCR0_AVX512))
+        {
+            features |= HASH_METH_FLAG_AVX512;
+        }
+        if ((b & bit_SHA) && (features & HASH_METH_FLAG_SSE41))
+            features |= HASH_METH_FLAG_SHANI;
+        if (b & bit_BMI2)
+            features |= HASH_METH_FLAG_BMI2;
+    }
+#endif
+
+    hash_cpu_features = features;
+}
+
+/**
+ * Get the CPU features available as method flags.
+ * The CPU is only queried on the first call.
+ *
+ * @return  The method flags of the CPU features available, and
+ *          HASH_CPU_FLAG_RDRAND when the CPU has RDRAND.
+ */
+int hash_cpu_flags(void)
+{
+    pthread_once(&hash_cpu_once, hash_cpu_detect);
+    return hash_cpu_features;
+}
+
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HASH_CPU_H
+#define HASH_CPU_H
+
+/**
+ * Priority of implementations only there for their batch function - the
+ * streaming functions are portable C code.
+ */
+#define HASH_METH_PRIO_BATCH		1
+/** Priority of implementations in the Linux kernel - system call per call. */
+#define HASH_METH_PRIO_AFALG		5
+/** Priority of portable C implementations. */
+#define HASH_METH_PRIO_C		10
+/** Priority of implementations using CPU specific instructions. */
+#define HASH_METH_PRIO_CPU		50
+/** Priority of OpenSSL implementations. */
+#define HASH_METH_PRIO_OPENSSL		100
+
+/**
+ * CPU feature that isn't a method flag: RDRAND available for seeding.
+ * Below the exclude flags and above the method flags.
+ */
+#define HASH_CPU_FLAG_RDRAND		0x8000
+
+int hash_cpu_flags(void);
+
+#endif
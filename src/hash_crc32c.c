@@ -0,0 +1,553 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * CRC32C - the Castagnoli polynomial used by iSCSI, SCTP, ext4 and most
+ * storage formats. The register is kept in reflected form.
+ * The portable code looks up eight bytes at a time in tables (slicing-by-8).
+ * The SSE4.2 code runs the crc32 instruction on three streams at once to hide
+ * its latency and joins the streams by shifting a CRC over the length of the
+ * streams after it with tables.
+ * The PCLMULQDQ code folds four 128-bit accumulators over 64 bytes at a time
+ * with carry-less multiplies and reduces the final 128 bits with crc32.
+ * CRCs of consecutive pieces can be joined with HASH_crc32c_combine so a large
+ * buffer can be checksummed in parts on many threads.
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include "hash.h"
+#include "hash_crc32c.h"
+#include "hash_cpu.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+/** Compile the function for the SSE4.2 crc32 instruction. */
+#define SSE42_TARGET	__attribute__((target("sse4.2")))
+/** Compile the function for carry-less multiply and crc32. */
+#define PCLMUL_TARGET	__attribute__((target("sse4.2,pclmul")))
+#endif
+
+/** The CRC32C polynomial in reflected form. */
+#define CRC32C_POLY	0x82f63b78
+/** The length of each of the three streams for long data. */
+#define CRC32C_LONG	8192
+/** The length of each of the three streams for short data. */
+#define CRC32C_SHORT	256
+/** The least data that is folded - shorter is quicker with three streams. */
+#define CRC32C_FOLD_MIN	2048
+
+/** Load a 64-bit number from little-endian bytes. */
+#define LE64(p)								\
+    (((uint64_t)(p)[0]      ) | ((uint64_t)(p)[1] <<  8) |		\
+     ((uint64_t)(p)[2] << 16) | ((uint64_t)(p)[3] << 24) |		\
+     ((uint64_t)(p)[4] << 32) | ((uint64_t)(p)[5] << 40) |		\
+     ((uint64_t)(p)[6] << 48) | ((uint64_t)(p)[7] << 56))
+
+/** Tables for slicing-by-8: the CRC of a byte followed by 0 to 7 zeros. */
+static uint32_t crc32c_table[8][256];
+/** Tables shifting a CRC over CRC32C_LONG zero bytes, a byte at a time. */
+static uint32_t crc32c_long[4][256];
+/** Tables shifting a CRC over CRC32C_SHORT zero bytes, a byte at a time. */
+static uint32_t crc32c_short[4][256];
+/** Ensures the tables are only calculated once. */
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Multiply two polynomials modulo the CRC32C polynomial.
+ * Both are in reflected form: the top bit is x^0.
+ *
+ * @param [in] a  The first polynomial.
+ * @param [in] b  The second polynomial.
+ * @return  The product modulo the polynomial.
+ */
+static uint32_t crc32c_mul(uint32_t a, uint32_t b)
+{
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t p = 0;
+
+    for (; a != 0; m >>= 1)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            a ^= m;
+        }
+        b = (b >> 1) ^ (CRC32C_POLY & (0 - (b & 1)));
+    }
+    return p;
+}
+
+/**
+ * Calculate x to the power of 8 * n modulo the CRC32C polynomial - the
+ * operator that shifts a CRC over n zero bytes.
+ *
+ * @param [in] n  The number of zero bytes.
+ * @return  The polynomial in reflected form.
+ */
+static uint32_t crc32c_zeros(uint64_t n)
+{
+    /* x^0 and x^8. */
+    uint32_t p = (uint32_t)1 << 31;
+    uint32_t x = (uint32_t)1 << 23;
+
+    for (; n != 0; n >>= 1)
+    {
+        if (n & 1)
+            p = crc32c_mul(x, p);
+        x = crc32c_mul(x, x);
+    }
+    return p;
+}
+
+/**
+ * Make the tables that shift a CRC over a fixed number of zero bytes.
+ * The shift is linear so each byte of the CRC is looked up separately.
+ *
+ * @param [in] t  The four tables.
+ * @param [in] n  The number of zero bytes.
+ */
+static void crc32c_zeros_table(uint32_t t[4][256], size_t n)
+{
+    uint32_t op = crc32c_zeros(n);
+    int i, j;
+
+    for (i=0; i<4; i++)
+    {
+        for (j=0; j<256; j++)
+            t[i][j] = crc32c_mul(op, (uint32_t)j << (i * 8));
+    }
+}
+
+/**
+ * Calculate the tables.
+ */
+static void crc32c_tables(void)
+{
+    int i, j;
+    uint32_t c;
+
+    for (i=0; i<256; i++)
+    {
+        c = i;
+        for (j=0; j<8; j++)
+            c = (c >> 1) ^ (CRC32C_POLY & (0 - (c & 1)));
+        crc32c_table[0][i] = c;
+    }
+    for (i=0; i<256; i++)
+    {
+        for (j=1; j<8; j++)
+        {
+            c = crc32c_table[j-1][i];
+            crc32c_table[j][i] = (c >> 8) ^ crc32c_table[0][c & 0xff];
+        }
+    }
+    crc32c_zeros_table(crc32c_long, CRC32C_LONG);
+    crc32c_zeros_table(crc32c_short, CRC32C_SHORT);
+}
+
+/**
+ * Shift a CRC over a fixed number of zero bytes with tables.
+ *
+ * @param [in] t    The four tables of the shift.
+ * @param [in] crc  The CRC register.
+ * @return  The shifted CRC register.
+ */
+static inline uint32_t crc32c_shift(uint32_t t[4][256], uint32_t crc)
+{
+    return t[0][crc & 0xff] ^ t[1][(crc >> 8) & 0xff] ^
+           t[2][(crc >> 16) & 0xff] ^ t[3][crc >> 24];
+}
+
+/**
+ * Update the CRC register with data using portable code.
+ *
+ * @param [in] crc  The CRC register.
+ * @param [in] p    The data.
+ * @param [in] len  The length of the data.
+ * @return  The updated CRC register.
+ */
+static uint32_t crc32c_c(uint32_t crc, const uint8_t *p, size_t len)
+{
+    uint64_t w;
+
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        w = LE64(p) ^ crc;
+        crc = crc32c_table[7][w & 0xff] ^
+              crc32c_table[6][(w >> 8) & 0xff] ^
+              crc32c_table[5][(w >> 16) & 0xff] ^
+              crc32c_table[4][(w >> 24) & 0xff] ^
+              crc32c_table[3][(w >> 32) & 0xff] ^
+              crc32c_table[2][(w >> 40) & 0xff] ^
+              crc32c_table[1][(w >> 48) & 0xff] ^
+              crc32c_table[0][w >> 56];
+    }
+    for (; len > 0; len--)
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *(p++)) & 0xff];
+    return crc;
+}
+
+#ifdef CPU_X86_64
+/**
+ * Update the CRC register of one stream with the crc32 instruction.
+ *
+ * @param [in] crc  The CRC register.
+ * @param [in] p    The data.
+ * @param [in] len  The length of the data.
+ * @return  The updated CRC register.
+ */
+SSE42_TARGET
+static inline uint32_t crc32c_hw(uint32_t crc, const uint8_t *p, size_t len)
+{
+    uint64_t c = crc;
+    uint64_t w;
+
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        memcpy(&w, p, 8);
+        c = _mm_crc32_u64(c, w);
+    }
+    for (; len > 0; len--)
+        c = _mm_crc32_u8(c, *(p++));
+    return (uint32_t)c;
+}
+
+/**
+ * Update the CRC register with three streams of data at a time.
+ * Streams after the first start from 0 and are joined by shifting the CRC
+ * before them over their length and XORing.
+ *
+ * @param [in] crc  The CRC register.
+ * @param [in] p    The data.
+ * @param [in] len  The length of the data.
+ * @param [in] n    The length of each stream.
+ * @param [in] t    The tables shifting a CRC over n bytes.
+ * @return  The updated CRC register.
+ */
+SSE42_TARGET
+static inline size_t crc32c_hw_3way(uint32_t *crc, const uint8_t *p,
+    size_t len, size_t n, uint32_t t[4][256])
+{
+    uint64_t c0 = *crc, c1, c2;
+    uint64_t w0, w1, w2;
+    size_t i, done = 0;
+
+    for (; len - done >= 3 * n; done += 3 * n, p += 3 * n)
+    {
+        c1 = 0;
+        c2 = 0;
+        for (i=0; i<n; i+=8)
+        {
+            memcpy(&w0, p + i, 8);
+            memcpy(&w1, p + n + i, 8);
+            memcpy(&w2, p + 2 * n + i, 8);
+            c0 = _mm_crc32_u64(c0, w0);
+            c1 = _mm_crc32_u64(c1, w1);
+            c2 = _mm_crc32_u64(c2, w2);
+        }
+        c0 = crc32c_shift(t, (uint32_t)c0) ^ c1;
+        c0 = crc32c_shift(t, (uint32_t)c0) ^ c2;
+    }
+    *crc = (uint32_t)c0;
+    return done;
+}
+
+/**
+ * Update the CRC register with data using the crc32 instruction.
+ *
+ * @param [in] crc  The CRC register.
+ * @param [in] p    The data.
+ * @param [in] len  The length of the data.
+ * @return  The updated CRC register.
+ */
+SSE42_TARGET
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *p, size_t len)
+{
+    size_t l;
+
+    l = crc32c_hw_3way(&crc, p, len, CRC32C_LONG, crc32c_long);
+    p += l;
+    len -= l;
+    l = crc32c_hw_3way(&crc, p, len, CRC32C_SHORT, crc32c_short);
+    return crc32c_hw(crc, p + l, len - l);
+}
+
+/**
+ * Fold a 128-bit accumulator forward over the distance of the constants.
+ * The low 64 bits hold the higher powers of x.
+ *
+ * @param [in] x  The accumulator.
+ * @param [in] k  The constants: x^(d+63) and x^(d-1) modulo the polynomial.
+ * @return  The folded accumulator to XOR into the data at the distance.
+ */
+PCLMUL_TARGET
+static inline __m128i crc32c_fold(__m128i x, __m128i k)
+{
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+        _mm_clmulepi64_si128(x, k, 0x11));
+}
+
+/**
+ * Update the CRC register with data by folding with carry-less multiplies.
+ * The first 16 bytes have the CRC register XORed in. Four accumulators are
+ * folded over 64 bytes at a time, then into one, which has the same CRC as
+ * all the data folded.
+ *
+ * @param [in] crc  The CRC register.
+ * @param [in] p    The data.
+ * @param [in] len  The length of the data.
+ * @return  The updated CRC register.
+ */
+PCLMUL_TARGET
+static uint32_t crc32c_pclmul(uint32_t crc, const uint8_t *p, size_t len)
+{
+    __m128i x[4];
+    __m128i k64 = _mm_set_epi64x(0x75bba45b00000000LL, 0x1c19243b00000000LL);
+    __m128i k16 = _mm_set_epi64x(0x3171d43000000000LL, 0x3743f7bd00000000LL);
+    uint64_t c;
+    int i;
+
+    if (len < CRC32C_FOLD_MIN)
+        return crc32c_sse42(crc, p, len);
+
+    for (i=0; i<4; i++)
+        x[i] = _mm_loadu_si128((const __m128i *)p + i);
+    x[0] = _mm_xor_si128(x[0], _mm_cvtsi32_si128(crc));
+    for (p += 64, len -= 64; len >= 64; p += 64, len -= 64)
+    {
+        for (i=0; i<4; i++)
+        {
+            x[i] = _mm_xor_si128(crc32c_fold(x[i], k64),
+                _mm_loadu_si128((const __m128i *)p + i));
+        }
+    }
+    for (i=1; i<4; i++)
+        x[i] = _mm_xor_si128(x[i], crc32c_fold(x[i-1], k16));
+
+    c = _mm_crc32_u64(0, _mm_cvtsi128_si64(x[3]));
+    c = _mm_crc32_u64(c, _mm_extract_epi64(x[3], 1));
+    return crc32c_sse42((uint32_t)c, p, len);
+}
+#endif
+
+/**
+ * Output the CRC as a digest: inverted and big-endian.
+ *
+ * @param [in] md   The buffer to hold the digest of 4 bytes.
+ * @param [in] crc  The CRC register.
+ */
+static void crc32c_out(unsigned char *md, uint32_t crc)
+{
+    crc = ~crc;
+    md[0] = crc >> 24;
+    md[1] = crc >> 16;
+    md[2] = crc >> 8;
+    md[3] = crc;
+}
+
+/**
+ * Initialize the CRC32C operation.
+ *
+ * @param [in] ctx  The CRC32C context.
+ * @return  1 to indicate success.
+ */
+int hash_crc32c_init(HASH_CRC32C *ctx)
+{
+    pthread_once(&crc32c_once, crc32c_tables);
+    ctx->crc = 0xffffffff;
+    return 1;
+}
+
+/**
+ * Update the CRC32C operation with message data.
+ *
+ * @param [in] ctx  The CRC32C context.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_crc32c_update(HASH_CRC32C *ctx, const void *in, size_t len)
+{
+    ctx->crc = crc32c_c(ctx->crc, in, len);
+    return 1;
+}
+
+/**
+ * Finalize the CRC32C operation and output the digest.
+ *
+ * @param [in] md   The buffer to hold the digest of 4 bytes.
+ * @param [in] ctx  The CRC32C context.
+ * @return  1 to indicate success.
+ */
+int hash_crc32c_final(unsigned char *md, HASH_CRC32C *ctx)
+{
+    crc32c_out(md, ctx->crc);
+    return 1;
+}
+
+/**
+ * Calculate the CRC32C digest of a message in one call.
+ *
+ * @param [in] md   The buffer to hold the digest of 4 bytes.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_crc32c_digest(unsigned char *md, const void *in, size_t len)
+{
+    pthread_once(&crc32c_once, crc32c_tables);
+    crc32c_out(md, crc32c_c(0xffffffff, in, len));
+    return 1;
+}
+
+/**
+ * Export the CRC32C state in a portable format.
+ *
+ * @param [in] data  The buffer to hold HASH_CRC32C_STATE_LEN bytes.
+ * @param [in] ctx   The CRC32C context.
+ * @return  1 to indicate success.
+ */
+int hash_crc32c_export(unsigned char *data, HASH_CRC32C *ctx)
+{
+    data[0] = ctx->crc >> 24;
+    data[1] = ctx->crc >> 16;
+    data[2] = ctx->crc >> 8;
+    data[3] = ctx->crc;
+    return 1;
+}
+
+/**
+ * Import the CRC32C state from the portable format.
+ * The tables are calculated here as update may be called without init.
+ *
+ * @param [in] ctx   The CRC32C context.
+ * @param [in] data  The exported state of HASH_CRC32C_STATE_LEN bytes.
+ * @return  1 to indicate success.
+ */
+int hash_crc32c_import(HASH_CRC32C *ctx, const unsigned char *data)
+{
+    pthread_once(&crc32c_once, crc32c_tables);
+    ctx->crc = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+               ((uint32_t)data[2] << 8) | data[3];
+    return 1;
+}
+
+#ifdef CPU_X86_64
+/**
+ * Update the CRC32C operation with message data using SSE4.2.
+ *
+ * @param [in] ctx  The CRC32C context.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_crc32c_sse42_update(HASH_CRC32C *ctx, const void *in, size_t len)
+{
+    ctx->crc = crc32c_sse42(ctx->crc, in, len);
+    return 1;
+}
+
+/**
+ * Calculate the CRC32C digest of a message in one call using SSE4.2.
+ *
+ * @param [in] md   The buffer to hold the digest of 4 bytes.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_crc32c_sse42_digest(unsigned char *md, const void *in, size_t len)
+{
+    pthread_once(&crc32c_once, crc32c_tables);
+    crc32c_out(md, crc32c_sse42(0xffffffff, in, len));
+    return 1;
+}
+
+/**
+ * Update the CRC32C operation with message data using PCLMULQDQ.
+ *
+ * @param [in] ctx  The CRC32C context.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_crc32c_pclmul_update(HASH_CRC32C *ctx, const void *in, size_t len)
+{
+    ctx->crc = crc32c_pclmul(ctx->crc, in, len);
+    return 1;
+}
+
+/**
+ * Calculate the CRC32C digest of a message in one call using PCLMULQDQ.
+ *
+ * @param [in] md   The buffer to hold the digest of 4 bytes.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_crc32c_pclmul_digest(unsigned char *md, const void *in, size_t len)
+{
+    pthread_once(&crc32c_once, crc32c_tables);
+    crc32c_out(md, crc32c_pclmul(0xffffffff, in, len));
+    return 1;
+}
+#endif
+
+/**
+ * Calculate the CRC32C of data with the best implementation for the CPU.
+ * Pass 0 as the CRC to start and the returned CRC to continue.
+ *
+ * @param [in] crc   The CRC of the data before.
+ * @param [in] data  The data.
+ * @param [in] len   The length of the data.
+ * @return  The CRC32C of all the data.
+ */
+uint32_t HASH_crc32c(uint32_t crc, const unsigned char *data, size_t len)
+{
+    pthread_once(&crc32c_once, crc32c_tables);
+    crc = ~crc;
+#ifdef CPU_X86_64
+    if ((hash_cpu_flags() & HASH_METH_FLAG_PCLMUL) != 0)
+        crc = crc32c_pclmul(crc, data, len);
+    else if ((hash_cpu_flags() & HASH_METH_FLAG_SSE42) != 0)
+        crc = crc32c_sse42(crc, data, len);
+    else
+#endif
+        crc = crc32c_c(crc, data, len);
+    return ~crc;
+}
+
+/**
+ * Combine the CRC32Cs of two consecutive pieces of data into the CRC32C of
+ * both. Costs a number of multiplies that grows with the log of the length.
+ *
+ * @param [in] crc1  The CRC32C of the first piece.
+ * @param [in] crc2  The CRC32C of the second piece.
+ * @param [in] len2  The length of the second piece.
+ * @return  The CRC32C of the first piece followed by the second.
+ */
+uint32_t HASH_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+    return crc32c_mul(crc32c_zeros(len2), crc1) ^ crc2;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef HASH_CRC32C_H
+#define HASH_CRC32C_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** The length of the CRC32C digest output. */
+#define HASH_CRC32C_LEN		4
+
+/** The length of the exported CRC32C state. */
+#define HASH_CRC32C_STATE_LEN	4
+
+/** Data structure for CRC32C. */
+typedef struct hash_crc32c_st
+{
+    /** The CRC register - not yet inverted. */
+    uint32_t crc;
+} HASH_CRC32C;
+
+int hash_crc32c_init(HASH_CRC32C *ctx);
+int hash_crc32c_update(HASH_CRC32C *ctx, const void *in, size_t len);
+int hash_crc32c_final(unsigned char *md, HASH_CRC32C *ctx);
+int hash_crc32c_digest(unsigned char *md, const void *in, size_t len);
+int hash_crc32c_export(unsigned char *data, HASH_CRC32C *ctx);
+int hash_crc32c_import(HASH_CRC32C *ctx, const unsigned char *data);
+
+#ifdef CPU_X86_64
+int hash_crc32c_sse42_update(HASH_CRC32C *ctx, const void *in, size_t len);
+int hash_crc32c_sse42_digest(unsigned char *md, const void *in, size_t len);
+int hash_crc32c_pclmul_update(HASH_CRC32C *ctx, const void *in, size_t len);
+int hash_crc32c_pclmul_digest(unsigned char *md, const void *in, size_t len);
+#endif
+
+#endif
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Digests of one stream of data with several hash algorithms.
+ * Large updates are hashed by the algorithms in parallel on threads. Smaller
+ * updates are split into chunks that fit in the cache and each chunk is
+ * hashed by every algorithm before moving on so the data is read from memory
+ * once.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "hash.h"
+
+/** The maximum number of hash algorithms of a multi-hash object. */
+#define HASH_MULTI_MAX		16
+/** The length of data that an update must have to be hashed on threads. */
+#define HASH_MULTI_THREAD_LEN	(1024 * 1024)
+/** The length of the chunks of data given to each algorithm in turn. */
+#define HASH_MULTI_CHUNK_LEN	(16 * 1024)
+
+/** The multi-hash structure. */
+struct hash_multi_st
+{
+    /** The number of hash algorithms. */
+    int cnt;
+    /** The hash objects - one per algorithm. */
+    HASH *hash[HASH_MULTI_MAX];
+};
+
+/** The work of a thread: update one hash object with all the data. */
+typedef struct hash_multi_job_st
+{
+    /** The hash object to update. */
+    HASH *hash;
+    /** The data to hash. */
+    const unsigned char *msg;
+    /** The length of the data. */
+    size_t len;
+    /** The result of the update. */
+    int ret;
+} HASH_MULTI_JOB;
+
+/**
+ * Thread function updating a hash object.
+ *
+ * @param [in] arg  The job.
+ * @return  NULL.
+ */
+static void *hash_multi_thread(void *arg)
+{
+    HASH_MULTI_JOB *job = arg;
+
+    job->ret = HASH_update(job->hash, job->msg, job->len);
+    return NULL;
+}
+
+/**
+ * Create a multi-hash object that digests the same data with each of the
+ * hash algorithms.
+ *
+ * @param [in]  ids    The hash algorithm identifiers.
+ * @param [in]  cnt    The number of hash algorithms.
+ * @param [in]  flags  The method implementation flags required and, shifted
+ *                     with HASH_METH_FLAG_EXCLUDE, the flags excluded.
+ * @param [out] multi  The new multi-hash object.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the number of algorithms is not valid.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for a hash
+ *          algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          0 otherwise.
+ */
+int HASH_MULTI_new(const HASH_ID *ids, int cnt, int flags,
+    HASH_MULTI **multi)
+{
+    int ret = 0;
+    int i;
+    HASH_MULTI *nm = NULL;
+
+    if ((ids == NULL) || (multi == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if ((cnt <= 0) || (cnt > HASH_MULTI_MAX))
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+
+    nm = calloc(1, sizeof(*nm));
+    if (nm == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+
+    for (i=0; (ret == 0) && (i<cnt); i++)
+    {
+        ret = HASH_new(ids[i], flags, &nm->hash[i]);
+        if (ret == 0)
+            nm->cnt++;
+    }
+    if (ret != 0)
+        goto end;
+
+    *multi = nm;
+    nm = NULL;
+end:
+    HASH_MULTI_free(nm);
+    return ret;
+}
+
+/**
+ * Free the multi-hash object and its hash objects.
+ *
+ * @param [in] multi  The multi-hash object. May be NULL.
+ */
+void HASH_MULTI_free(HASH_MULTI *multi)
+{
+    int i;
+
+    if (multi != NULL)
+    {
+        for (i=0; i<multi->cnt; i++)
+            HASH_free(multi->hash[i]);
+        free(multi);
+    }
+}
+
+/**
+ * Initialize all the hash operations.
+ *
+ * @param [in] multi  The multi-hash object.
+ * @return  HASH_ERR_PARAM_NULL when multi is NULL.<br>
+ *          HASH_ERR_BAD_DATA when an implementation failed to initialize.<br>
+ *          0 otherwise.
+ */
+int HASH_MULTI_init(HASH_MULTI *multi)
+{
+    int ret = 0;
+    int i;
+
+    if (multi == NULL)
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    for (i=0; (ret == 0) && (i<multi->cnt); i++)
+        ret = HASH_init(multi->hash[i]);
+end:
+    return ret;
+}
+
+/**
+ * Update all the hash operations with the data.
+ * Data of HASH_MULTI_THREAD_LEN bytes or more is hashed by the algorithms in
+ * parallel: one on the calling thread and the others on a thread each.
+ * Otherwise the data is hashed by each algorithm in turn a chunk at a time.
+ *
+ * @param [in] multi  The multi-hash object.
+ * @param [in] msg    The message data to digest.
+ * @param [in] len    The length of the message data to digest.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when an implementation failed to update.<br>
+ *          0 otherwise.
+ */
+int HASH_MULTI_update(HASH_MULTI *multi, const unsigned char *msg,
+    size_t len)
+{
+    int ret = 0;
+    int i;
+    size_t o, l;
+    HASH_MULTI_JOB job[HASH_MULTI_MAX];
+    pthread_t thread[HASH_MULTI_MAX];
+    int started[HASH_MULTI_MAX];
+
+    if ((multi == NULL) || ((msg == NULL) && (len > 0)))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (len == 0)
+        goto end;
+
+    if ((len >= HASH_MULTI_THREAD_LEN) && (multi->cnt > 1))
+    {
+        for (i=0; i<multi->cnt; i++)
+        {
+            job[i].hash = multi->hash[i];
+            job[i].msg = msg;
+            job[i].len = len;
+            job[i].ret = 0;
+        }
+        /* Do the work of any thread that can't be started on this one. */
+        for (i=1; i<multi->cnt; i++)
+        {
+            started[i] = pthread_create(&thread[i], NULL, hash_multi_thread,
+                &job[i]) == 0;
+        }
+        hash_multi_thread(&job[0]);
+        for (i=1; i<multi->cnt; i++)
+        {
+            if (started[i])
+                pthread_join(thread[i], NULL);
+            else
+                hash_multi_thread(&job[i]);
+        }
+        for (i=0; (ret == 0) && (i<multi->cnt); i++)
+            ret = job[i].ret;
+        goto end;
+    }
+
+    for (o=0; (ret == 0) && (o<len); o+=l)
+    {
+        l = len - o;
+        if (l > HASH_MULTI_CHUNK_LEN)
+            l = HASH_MULTI_CHUNK_LEN;
+        for (i=0; (ret == 0) && (i<multi->cnt); i++)
+            ret = HASH_update(multi->hash[i], msg + o, l);
+    }
+end:
+    return ret;
+}
+
+/**
+ * Finalize all the hash operations.
+ *
+ * @param [in] multi  The multi-hash object.
+ * @param [in] data   The buffers to hold the message digests - one per
+ *                    algorithm in the order they were given.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when an implementation failed to finalize.<br>
+ *          0 otherwise.
+ */
+int HASH_MULTI_final(HASH_MULTI *multi, unsigned char **data)
+{
+    int ret = 0;
+    int i;
+
+    if ((multi == NULL) || (data == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    for (i=0; (ret == 0) && (i<multi->cnt); i++)
+        ret = HASH_final(multi->hash[i], data[i]);
+end:
+    return ret;
+}
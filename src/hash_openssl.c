@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Hash and HMAC algorithms calculated with OpenSSL 3's EVP API.
+ * The algorithms are fetched from the default provider once so that
+ * initializing a context doesn't look up the implementation again. Contexts
+ * are allocated on first initialization and reused until cleaned up.
+ */
+
+#include <pthread.h>
+#include "hash.h"
+#include "mac.h"
+#include "hash_sha3.h"
+#include "hash_openssl.h"
+
+#ifdef OPT_HASH_OPENSSL
+
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+
+/** The number of hash algorithm identifiers that OpenSSL may implement. */
+#define HASH_OPENSSL_ID_NUM	(HASH_ID_SHAKE256 + 1)
+/** The number of HMAC algorithm identifiers. */
+#define HMAC_OPENSSL_ID_NUM	(MAC_ID_SHA512_256 + 1)
+
+/**
+ * The OpenSSL names of the digests indexed by hash algorithm identifier.
+ * NULL when OpenSSL doesn't have the algorithm with that output length.
+ */
+static const char *hash_openssl_name[HASH_OPENSSL_ID_NUM] =
+{
+    "SHA1", "SHA224", "SHA256", "SHA384", "SHA512", "SHA512-224",
+    "SHA512-256",
+    "SHA3-224", "SHA3-256", "SHA3-384", "SHA3-512",
+    NULL, NULL, NULL, "BLAKE2B-512",
+    NULL, "BLAKE2S-256",
+    "SHAKE128", "SHAKE256"
+};
+
+/** The digests fetched from OpenSSL. */
+static EVP_MD *hash_openssl_md[HASH_OPENSSL_ID_NUM];
+/** HMAC contexts with the digest set - duplicated to make new contexts. */
+static EVP_MAC_CTX *hmac_openssl_tmpl[HMAC_OPENSSL_ID_NUM];
+/** Ensures the algorithms are only fetched once. */
+static pthread_once_t hash_openssl_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Fetch the digests and create the HMAC templates.
+ * Algorithms that fail to fetch are left NULL and fail to initialize.
+ */
+static void hash_openssl_fetch(void)
+{
+    int i;
+    EVP_MAC *mac;
+    OSSL_PARAM params[2];
+
+    for (i=0; i<HASH_OPENSSL_ID_NUM; i++)
+    {
+        if (hash_openssl_name[i] != NULL)
+            hash_openssl_md[i] = EVP_MD_fetch(NULL, hash_openssl_name[i], NULL);
+    }
+
+    mac = EVP_MAC_fetch(NULL, OSSL_MAC_NAME_HMAC, NULL);
+    if (mac == NULL)
+        return;
+    for (i=0; i<HMAC_OPENSSL_ID_NUM; i++)
+    {
+        hmac_openssl_tmpl[i] = EVP_MAC_CTX_new(mac);
+        if (hmac_openssl_tmpl[i] == NULL)
+            continue;
+        params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+            (char *)hash_openssl_name[i], 0);
+        params[1] = OSSL_PARAM_construct_end();
+        if (EVP_MAC_CTX_set_params(hmac_openssl_tmpl[i], params) != 1)
+        {
+            EVP_MAC_CTX_free(hmac_openssl_tmpl[i]);
+            hmac_openssl_tmpl[i] = NULL;
+        }
+    }
+    /* The contexts keep a reference. */
+    EVP_MAC_free(mac);
+}
+
+/**
+ * Initialize the digest context for an algorithm.
+ *
+ * @param [in] ctx      The context of the hash operation.
+ * @param [in] id       The hash algorithm identifier.
+ * @param [in] xof_len  The length of output of an XOF. 0 otherwise.
+ * @return  0 when OpenSSL doesn't have the algorithm or failed.<br>
+ *          1 otherwise.
+ */
+static int hash_openssl_init(HASH_OPENSSL *ctx, HASH_ID id, size_t xof_len)
+{
+    pthread_once(&hash_openssl_once, hash_openssl_fetch);
+    if (hash_openssl_md[id] == NULL)
+        return 0;
+
+    if (ctx->ctx == NULL)
+    {
+        ctx->ctx = EVP_MD_CTX_new();
+        if (ctx->ctx == NULL)
+            return 0;
+    }
+    ctx->xof_len = xof_len;
+
+    return EVP_DigestInit_ex2(ctx->ctx, hash_openssl_md[id], NULL);
+}
+
+/** Define the initialization function of a hash algorithm. */
+#define HASH_OPENSSL_INIT(name, id, xof_len)				\
+int hash_openssl_##name##_init(HASH_OPENSSL *ctx)			\
+{									\
+    return hash_openssl_init(ctx, id, xof_len);				\
+}
+
+HASH_OPENSSL_INIT(sha1, HASH_ID_SHA1, 0)
+HASH_OPENSSL_INIT(sha224, HASH_ID_SHA224, 0)
+HASH_OPENSSL_INIT(sha256, HASH_ID_SHA256, 0)
+HASH_OPENSSL_INIT(sha384, HASH_ID_SHA384, 0)
+HASH_OPENSSL_INIT(sha512, HASH_ID_SHA512, 0)
+HASH_OPENSSL_INIT(sha512_224, HASH_ID_SHA512_224, 0)
+HASH_OPENSSL_INIT(sha512_256, HASH_ID_SHA512_256, 0)
+HASH_OPENSSL_INIT(sha3_224, HASH_ID_SHA3_224, 0)
+HASH_OPENSSL_INIT(sha3_256, HASH_ID_SHA3_256, 0)
+HASH_OPENSSL_INIT(sha3_384, HASH_ID_SHA3_384, 0)
+HASH_OPENSSL_INIT(sha3_512, HASH_ID_SHA3_512, 0)
+HASH_OPENSSL_INIT(blake2b_512, HASH_ID_BLAKE2B_512, 0)
+HASH_OPENSSL_INIT(blake2s_256, HASH_ID_BLAKE2S_256, 0)
+HASH_OPENSSL_INIT(shake128, HASH_ID_SHAKE128, HASH_SHAKE128_LEN)
+HASH_OPENSSL_INIT(shake256, HASH_ID_SHAKE256, HASH_SHAKE256_LEN)
+
+/**
+ * Update the digest with more data.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The data to digest.
+ * @param [in] len   The length of the data to digest.
+ * @return  0 when OpenSSL failed.<br>
+ *          1 otherwise.
+ */
+int hash_openssl_update(HASH_OPENSSL *ctx, const void *data, size_t len)
+{
+    return EVP_DigestUpdate(ctx->ctx, data, len);
+}
+
+/**
+ * Calculate the message digest based on all the message data seen.
+ *
+ * @param [in] md   The buffer to hold the message digest.
+ * @param [in] ctx  The context of the hash operation.
+ * @return  0 when OpenSSL failed.<br>
+ *          1 otherwise.
+ */
+int hash_openssl_final(unsigned char *md, HASH_OPENSSL *ctx)
+{
+    if (ctx->xof_len > 0)
+        return EVP_DigestFinalXOF(ctx->ctx, md, ctx->xof_len);
+    return EVP_DigestFinal_ex(ctx->ctx, md, NULL);
+}
+
+/**
+ * Duplicate the digest context including the state of the operation.
+ *
+ * @param [in] dst  The zeroed context to copy into.
+ * @param [in] src  The context of the hash operation.
+ * @return  0 when allocating or OpenSSL failed.<br>
+ *          1 otherwise.
+ */
+int hash_openssl_dup(HASH_OPENSSL *dst, const HASH_OPENSSL *src)
+{
+    dst->xof_len = src->xof_len;
+    if (src->ctx == NULL)
+        return 1;
+
+    dst->ctx = EVP_MD_CTX_new();
+    if (dst->ctx == NULL)
+        return 0;
+    return EVP_MD_CTX_copy_ex(dst->ctx, src->ctx);
+}
+
+/**
+ * Free the OpenSSL digest context.
+ *
+ * @param [in] ctx  The context of the hash operation.
+ */
+void hash_openssl_cleanup(HASH_OPENSSL *ctx)
+{
+    EVP_MD_CTX_free(ctx->ctx);
+    ctx->ctx = NULL;
+}
+
+/**
+ * Initialize a SHA-3 digest context for MAC - the key is the message prefix.
+ *
+ * @param [in] ctx  The context of the hash operation.
+ * @param [in] id   The hash algorithm identifier.
+ * @param [in] key  The key to initialize with.
+ * @param [in] len  The length of the key.
+ * @return  0 when OpenSSL failed.<br>
+ *          1 otherwise.
+ */
+static int hash_openssl_sha3_mac_init(HASH_OPENSSL *ctx, HASH_ID id,
+    const void *key, size_t len)
+{
+    return hash_openssl_init(ctx, id, 0) &&
+           EVP_DigestUpdate(ctx->ctx, key, len);
+}
+
+/** Define the MAC initialization function of a SHA-3 algorithm. */
+#define HASH_OPENSSL_SHA3_MAC_INIT(name, id)				\
+int hash_openssl_##name##_mac_init(HASH_OPENSSL *ctx, const void *key,	\
+    size_t len)								\
+{									\
+    return hash_openssl_sha3_mac_init(ctx, id, key, len);		\
+}
+
+HASH_OPENSSL_SHA3_MAC_INIT(sha3_224, HASH_ID_SHA3_224)
+HASH_OPENSSL_SHA3_MAC_INIT(sha3_256, HASH_ID_SHA3_256)
+HASH_OPENSSL_SHA3_MAC_INIT(sha3_384, HASH_ID_SHA3_384)
+HASH_OPENSSL_SHA3_MAC_INIT(sha3_512, HASH_ID_SHA3_512)
+
+/**
+ * Initialize the HMAC context with a key.
+ * The context is duplicated from the template with the digest already set.
+ *
+ * @param [in] ctx  The context of the MAC operation.
+ * @param [in] id   The MAC algorithm identifier.
+ * @param [in] key  The key to initialize with.
+ * @param [in] len  The length of the key.
+ * @return  0 when OpenSSL doesn't have the algorithm or failed.<br>
+ *          1 otherwise.
+ */
+static int hmac_openssl_init(HMAC_OPENSSL *ctx, MAC_ID id, const void *key,
+    size_t len)
+{
+    pthread_once(&hash_openssl_once, hash_openssl_fetch);
+    if (hmac_openssl_tmpl[id] == NULL)
+        return 0;
+
+    if (ctx->ctx == NULL)
+    {
+        ctx->ctx = EVP_MAC_CTX_dup(hmac_openssl_tmpl[id]);
+        if (ctx->ctx == NULL)
+            return 0;
+    }
+    /* A NULL key means reuse the previous key to OpenSSL - pass an empty key
+     * so that a NULL key is a zero length key. */
+    if (key == NULL)
+        key = "";
+
+    return EVP_MAC_init(ctx->ctx, key, len, NULL);
+}
+
+/** Define the initialization function of an HMAC algorithm. */
+#define HMAC_OPENSSL_INIT(name, id)					\
+int hmac_openssl_##name##_init(HMAC_OPENSSL *ctx, const void *key,	\
+    size_t len)								\
+{									\
+    return hmac_openssl_init(ctx, id, key, len);			\
+}
+
+HMAC_OPENSSL_INIT(sha1, MAC_ID_SHA1)
+HMAC_OPENSSL_INIT(sha224, MAC_ID_SHA224)
+HMAC_OPENSSL_INIT(sha256, MAC_ID_SHA256)
+HMAC_OPENSSL_INIT(sha384, MAC_ID_SHA384)
+HMAC_OPENSSL_INIT(sha512, MAC_ID_SHA512)
+HMAC_OPENSSL_INIT(sha512_224, MAC_ID_SHA512_224)
+HMAC_OPENSSL_INIT(sha512_256, MAC_ID_SHA512_256)
+
+/**
+ * Update the HMAC with more data.
+ *
+ * @param [in] ctx   The context of the MAC operation.
+ * @param [in] data  The data to MAC.
+ * @param [in] len   The length of the data to MAC.
+ * @return  0 when OpenSSL failed.<br>
+ *          1 otherwise.
+ */
+int hmac_openssl_update(HMAC_OPENSSL *ctx, const void *data, size_t len)
+{
+    return EVP_MAC_update(ctx->ctx, data, len);
+}
+
+/**
+ * Calculate the HMAC based on all the message data seen.
+ *
+ * @param [in] md   The buffer to hold the MAC.
+ * @param [in] ctx  The context of the MAC operation.
+ * @return  0 when OpenSSL failed.<br>
+ *          1 otherwise.
+ */
+int hmac_openssl_final(unsigned char *md, HMAC_OPENSSL *ctx)
+{
+    size_t len;
+
+    return EVP_MAC_final(ctx->ctx, md, &len,
+        EVP_MAC_CTX_get_mac_size(ctx->ctx));
+}
+
+/**
+ * Duplicate the HMAC context including the state of the operation.
+ *
+ * @param [in] dst  The zeroed context to copy into.
+ * @param [in] src  The context of the MAC operation.
+ * @return  0 when allocating or OpenSSL failed.<br>
+ *          1 otherwise.
+ */
+int hmac_openssl_dup(HMAC_OPENSSL *dst, const HMAC_OPENSSL *src)
+{
+    if (src->ctx == NULL)
+        return 1;
+
+    dst->ctx = EVP_MAC_CTX_dup(src->ctx);
+    return dst->ctx != NULL;
+}
+
+/**
+ * Free the OpenSSL MAC context.
+ *
+ * @param [in] ctx  The context of the MAC operation.
+ */
+void hmac_openssl_cleanup(HMAC_OPENSSL *ctx)
+{
+    EVP_MAC_CTX_free(ctx->ctx);
+    ctx->ctx = NULL;
+}
+
+#endif
+
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HASH_OPENSSL_H
+#define HASH_OPENSSL_H
+
+#ifdef OPT_HASH_OPENSSL
+
+#include <stddef.h>
+#include <openssl/evp.h>
+
+/** The context of a digest calculated with OpenSSL. */
+typedef struct hash_openssl_st
+{
+    /** The OpenSSL digest context. NULL until first initialized. */
+    EVP_MD_CTX *ctx;
+    /** The length of output for an XOF. 0 for a fixed length digest. */
+    size_t xof_len;
+} HASH_OPENSSL;
+
+/** The context of an HMAC calculated with OpenSSL. */
+typedef struct hmac_openssl_st
+{
+    /** The OpenSSL MAC context. NULL until first initialized. */
+    EVP_MAC_CTX *ctx;
+} HMAC_OPENSSL;
+
+int hash_openssl_sha1_init(HASH_OPENSSL *ctx);
+int hash_openssl_sha224_init(HASH_OPENSSL *ctx);
+int hash_openssl_sha256_init(HASH_OPENSSL *ctx);
+int hash_openssl_sha384_init(HASH_OPENSSL *ctx);
+int hash_openssl_sha512_init(HASH_OPENSSL *ctx);
+int hash_openssl_sha512_224_init(HASH_OPENSSL *ctx);
+int hash_openssl_sha512_256_init(HASH_OPENSSL *ctx);
+int hash_openssl_sha3_224_init(HASH_OPENSSL *ctx);
+int hash_openssl_sha3_256_init(HASH_OPENSSL *ctx);
+int hash_openssl_sha3_384_init(HASH_OPENSSL *ctx);
+int hash_openssl_sha3_512_init(HASH_OPENSSL *ctx);
+int hash_openssl_blake2b_512_init(HASH_OPENSSL *ctx);
+int hash_openssl_blake2s_256_init(HASH_OPENSSL *ctx);
+int hash_openssl_shake128_init(HASH_OPENSSL *ctx);
+int hash_openssl_shake256_init(HASH_OPENSSL *ctx);
+int hash_openssl_update(HASH_OPENSSL *ctx, const void *data, size_t len);
+int hash_openssl_final(unsigned char *md, HASH_OPENSSL *ctx);
+int hash_openssl_dup(HASH_OPENSSL *dst, const HASH_OPENSSL *src);
+void hash_openssl_cleanup(HASH_OPENSSL *ctx);
+
+int hash_openssl_sha3_224_mac_init(HASH_OPENSSL *ctx, const void *key,
+    size_t len);
+int hash_openssl_sha3_256_mac_init(HASH_OPENSSL *ctx, const void *key,
+    size_t len);
+int hash_openssl_sha3_384_mac_init(HASH_OPENSSL *ctx, const void *key,
+    size_t len);
+int hash_openssl_sha3_512_mac_init(HASH_OPENSSL *ctx, const void *key,
+    size_t len);
+
+int hmac_openssl_sha1_init(HMAC_OPENSSL *ctx, const void *key, size_t len);
+int hmac_openssl_sha224_init(HMAC_OPENSSL *ctx, const void *key, size_t len);
+int hmac_openssl_sha256_init(HMAC_OPENSSL *ctx, const void *key, size_t len);
+int hmac_openssl_sha384_init(HMAC_OPENSSL *ctx, const void *key, size_t len);
+int hmac_openssl_sha512_init(HMAC_OPENSSL *ctx, const void *key, size_t len);
+int hmac_openssl_sha512_224_init(HMAC_OPENSSL *ctx, const void *key,
+    size_t len);
+int hmac_openssl_sha512_256_init(HMAC_OPENSSL *ctx, const void *key,
+    size_t len);
+int hmac_openssl_update(HMAC_OPENSSL *ctx, const void *data, size_t len);
+int hmac_openssl_final(unsigned char *md, HMAC_OPENSSL *ctx);
+int hmac_openssl_dup(HMAC_OPENSSL *dst, const HMAC_OPENSSL *src);
+void hmac_openssl_cleanup(HMAC_OPENSSL *ctx);
+
+#endif
+
+#endif
+
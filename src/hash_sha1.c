@@ -363,3 +363,78 @@ int hmac_sha1_final(unsigned char *md, HASH_SHA1 *ctx)
     return 1;
 }
 
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-1.
+ *
+ * @param [in]      ctx   The SHA1 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys.
+ * @param [in]      iter  The total number of iterations.
+ * @return  1 to indicate success.
+ */
+int hmac_sha1_iterate(HASH_SHA1 **ctx, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    HMAC_ITERATE(HASH_SHA1, ctx, data, cnt, iter, HASH_SHA1_LEN,
+        hash_sha1_block);
+    return 1;
+}
+
+/**
+ * Export the SHA-1 state in a portable format.
+ * Numbers are stored big-endian. Unused message bytes are zero.
+ *
+ * @param [in] data  The buffer to hold the state of HASH_SHA1_STATE_LEN bytes.
+ * @param [in] ctx   The SHA1 context object.
+ * @return  1 to indicate success.
+ */
+int hash_sha1_export(unsigned char *data, HASH_SHA1 *ctx)
+{
+    uint8_t i, j;
+
+    for (i=0; i<5; i++)
+        for (j=0; j<4; j++)
+            data[i*4+j] = ctx->h[i] >> ((3-j)*8);
+    data += 20;
+    for (i=0; i<8; i++)
+        data[i] = ctx->len >> ((7-i)*8);
+    data += 8;
+    *(data++) = ctx->o;
+    memcpy(data, ctx->m, ctx->o);
+    memset(data + ctx->o, 0, BLOCK_SIZE - ctx->o);
+
+    return 1;
+}
+
+/**
+ * Import the SHA-1 state from the portable format.
+ *
+ * @param [in] ctx   The SHA1 context object.
+ * @param [in] data  The exported state of HASH_SHA1_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_sha1_import(HASH_SHA1 *ctx, const unsigned char *data)
+{
+    uint8_t i, j;
+
+    if (data[28] >= BLOCK_SIZE)
+        return 0;
+
+    for (i=0; i<5; i++)
+    {
+        ctx->h[i] = 0;
+        for (j=0; j<4; j++)
+            ctx->h[i] |= ((uint32_t)data[i*4+j]) << ((3-j)*8);
+    }
+    data += 20;
+    ctx->len = 0;
+    for (i=0; i<8; i++)
+        ctx->len |= ((uint64_t)data[i]) << ((7-i)*8);
+    data += 8;
+    ctx->o = *(data++);
+    memcpy(ctx->m, data, BLOCK_SIZE);
+
+    return 1;
+}
+
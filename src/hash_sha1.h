@@ -24,6 +24,8 @@
 
 /** The length of the SHA-1 digest output. */
 #define HASH_SHA1_LEN	20
+/** The length of the exported SHA-1 state. */
+#define HASH_SHA1_STATE_LEN	(20 + 8 + 1 + 64)
 
 /**
  * Rotate left 32-bit integer.
@@ -50,7 +52,21 @@ typedef struct hash_sha1_st
 int hash_sha1_init(HASH_SHA1 *ctx);
 int hash_sha1_update(HASH_SHA1 *ctx, const void *data, size_t len);
 int hash_sha1_final(unsigned char *md, HASH_SHA1 *ctx);
+int hash_sha1_export(unsigned char *data, HASH_SHA1 *ctx);
+int hash_sha1_import(HASH_SHA1 *ctx, const unsigned char *data);
 
 int hmac_sha1_init(HASH_SHA1 *ctx, const void *key, size_t len);
 int hmac_sha1_final(unsigned char *md, HASH_SHA1 *ctx);
+int hmac_sha1_iterate(HASH_SHA1 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
+
+#ifdef CPU_X86_64
+int hash_sha1_ni_update(HASH_SHA1 *ctx, const void *data, size_t len);
+int hash_sha1_ni_final(unsigned char *md, HASH_SHA1 *ctx);
+
+int hmac_sha1_ni_init(HASH_SHA1 *ctx, const void *key, size_t len);
+int hmac_sha1_ni_final(unsigned char *md, HASH_SHA1 *ctx);
+int hmac_sha1_ni_iterate(HASH_SHA1 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
+#endif
 
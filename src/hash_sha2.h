@@ -35,6 +35,11 @@
 /** The length of the SHA-512_256 digest output. */
 #define HASH_SHA512_256_LEN	32
 
+/** The length of the exported SHA-256 state. */
+#define HASH_SHA256_STATE_LEN	(32 + 8 + 1 + 64)
+/** The length of the exported SHA-512 state. */
+#define HASH_SHA512_STATE_LEN	(64 + 16 + 1 + 128)
+
 /**
  * Rotate right 32-bit integer.
  *
@@ -95,6 +100,8 @@ int hash_sha224_final(unsigned char *md, HASH_SHA256 *ctx);
 int hash_sha256_init(HASH_SHA256 *ctx);
 int hash_sha256_update(HASH_SHA256 *ctx, const void *data, size_t len);
 int hash_sha256_final(unsigned char *md, HASH_SHA256 *ctx);
+int hash_sha256_export(unsigned char *data, HASH_SHA256 *ctx);
+int hash_sha256_import(HASH_SHA256 *ctx, const unsigned char *data);
 
 int hash_sha384_init(HASH_SHA512 *ctx);
 #define hash_sha384_update hash_sha512_update
@@ -103,6 +110,8 @@ int hash_sha384_final(unsigned char *md, HASH_SHA512 *ctx);
 int hash_sha512_init(HASH_SHA512 *ctx);
 int hash_sha512_update(HASH_SHA512 *ctx, const void *data, size_t len);
 int hash_sha512_final(unsigned char *md, HASH_SHA512 *ctx);
+int hash_sha512_export(unsigned char *data, HASH_SHA512 *ctx);
+int hash_sha512_import(HASH_SHA512 *ctx, const unsigned char *data);
 
 int hash_sha512_224_init(HASH_SHA512 *ctx);
 #define hash_sha512_224_update hash_sha512_update
@@ -114,19 +123,62 @@ int hash_sha512_256_final(unsigned char *md, HASH_SHA512 *ctx);
 
 int hmac_sha224_init(HASH_SHA256 *ctx, const void *key, size_t len);
 int hmac_sha224_final(unsigned char *md, HASH_SHA256 *ctx);
+int hmac_sha224_iterate(HASH_SHA256 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
 
 int hmac_sha256_init(HASH_SHA256 *ctx, const void *key, size_t len);
 int hmac_sha256_final(unsigned char *md, HASH_SHA256 *ctx);
+int hmac_sha256_iterate(HASH_SHA256 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
+
+#ifdef CPU_X86_64
+int hash_sha256_ni_update(HASH_SHA256 *ctx, const void *data, size_t len);
+int hash_sha224_ni_final(unsigned char *md, HASH_SHA256 *ctx);
+int hash_sha256_ni_final(unsigned char *md, HASH_SHA256 *ctx);
+
+int hmac_sha224_ni_init(HASH_SHA256 *ctx, const void *key, size_t len);
+int hmac_sha224_ni_final(unsigned char *md, HASH_SHA256 *ctx);
+int hmac_sha224_ni_iterate(HASH_SHA256 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
+
+int hmac_sha256_ni_init(HASH_SHA256 *ctx, const void *key, size_t len);
+int hmac_sha256_ni_final(unsigned char *md, HASH_SHA256 *ctx);
+int hmac_sha256_ni_iterate(HASH_SHA256 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
+
+int hash_sha224_avx2_batch(const unsigned char **msgs, const size_t *lens,
+    int cnt, unsigned char **mds);
+int hash_sha256_avx2_batch(const unsigned char **msgs, const size_t *lens,
+    int cnt, unsigned char **mds);
+int hmac_sha224_avx2_batch(const unsigned char **keys, const int *klens,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **macs);
+int hmac_sha256_avx2_batch(const unsigned char **keys, const int *klens,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **macs);
+int hmac_sha224_avx2_iterate(HASH_SHA256 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
+int hmac_sha256_avx2_iterate(HASH_SHA256 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
+#endif
 
 int hmac_sha384_init(HASH_SHA512 *ctx, const void *key, size_t len);
 int hmac_sha384_final(unsigned char *md, HASH_SHA512 *ctx);
+int hmac_sha384_iterate(HASH_SHA512 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
 
 int hmac_sha512_init(HASH_SHA512 *ctx, const void *key, size_t len);
 int hmac_sha512_final(unsigned char *md, HASH_SHA512 *ctx);
+int hmac_sha512_iterate(HASH_SHA512 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
 
 int hmac_sha512_224_init(HASH_SHA512 *ctx, const void *key, size_t len);
 int hmac_sha512_224_final(unsigned char *md, HASH_SHA512 *ctx);
+int hmac_sha512_224_iterate(HASH_SHA512 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
 
 int hmac_sha512_256_init(HASH_SHA512 *ctx, const void *key, size_t len);
 int hmac_sha512_256_final(unsigned char *md, HASH_SHA512 *ctx);
+int hmac_sha512_256_iterate(HASH_SHA512 **ctx, unsigned char **data, int cnt,
+    unsigned int iter);
 
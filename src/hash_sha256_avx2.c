@@ -0,0 +1,765 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * SHA-224 and SHA-256, and HMAC with them, of many messages at once using
+ * AVX2.
+ * Each of the 8 32-bit lanes of a vector digests a different message.
+ * Messages are queued longest first and a lane that finishes is given the
+ * next message so that the lanes are kept full. When few messages are left
+ * they are finished with the single-stream C code.
+ * PBKDF2 iterates HMAC of the previous MAC for each key in a lane.
+ * Only called when the CPU has AVX2 - see hash_cpu_flags().
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash_sha2.h"
+#include "hmac.h"
+
+#ifdef CPU_X86_64
+
+#include <immintrin.h>
+
+/** The size of a block that is processed. */
+#define BLOCK_SIZE      64
+/** The number of messages digested at once. */
+#define LANES		8
+/**
+ * Finish with single-stream code when this many lanes or fewer have work and
+ * there are no more messages to start.
+ */
+#define LANES_MIN	2
+
+/** Compile the function for AVX2. */
+#define AVX2_TARGET	__attribute__((target("avx2")))
+
+/** The constants k to use with SHA-256 block operation (and SHA-224). */
+static const uint32_t hash_sha256_avx2_k[] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/** The initial state of SHA-224. */
+static const uint32_t hash_sha224_avx2_iv[8] =
+{
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+    0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+};
+/** The initial state of SHA-256. */
+static const uint32_t hash_sha256_avx2_iv[8] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/** A block of zeros for lanes without a message. */
+static const uint8_t hash_sha256_avx2_zero[BLOCK_SIZE];
+
+/** Rotate right each 32-bit lane. */
+#define ROTR_V(x, s)							\
+    _mm256_or_si256(_mm256_srli_epi32(x, s), _mm256_slli_epi32(x, 32 - (s)))
+
+/** Message schedule: w[i] is replaced with w[i + 16]. */
+#define MIX_W_V(i)							\
+do									\
+{									\
+    __m256i w15 = w[((i) + 1) & 15];					\
+    __m256i w2 = w[((i) + 14) & 15];					\
+    __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROTR_V(w15, 7),	\
+        ROTR_V(w15, 18)), _mm256_srli_epi32(w15, 3));			\
+    __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROTR_V(w2, 17),	\
+        ROTR_V(w2, 19)), _mm256_srli_epi32(w2, 10));			\
+    w[i] = _mm256_add_epi32(_mm256_add_epi32(w[i], s0),		\
+        _mm256_add_epi32(w[((i) + 9) & 15], s1));			\
+}									\
+while (0)
+
+/** One round of SHA-256 on all lanes. t is the working state, rotated. */
+#define ROUND_V(r)							\
+do									\
+{									\
+    __m256i e = t[(4 - (r)) & 7];					\
+    __m256i a = t[(0 - (r)) & 7];					\
+    __m256i s1, ch, t1, s0, maj;					\
+									\
+    s1 = _mm256_xor_si256(_mm256_xor_si256(ROTR_V(e, 6), ROTR_V(e, 11)), \
+        ROTR_V(e, 25));							\
+    ch = _mm256_xor_si256(t[(6 - (r)) & 7], _mm256_and_si256(e,	\
+        _mm256_xor_si256(t[(5 - (r)) & 7], t[(6 - (r)) & 7])));	\
+    t1 = _mm256_add_epi32(_mm256_add_epi32(t[(7 - (r)) & 7], s1),	\
+        _mm256_add_epi32(ch, _mm256_add_epi32(w[(r) & 15],		\
+        _mm256_set1_epi32(hash_sha256_avx2_k[i + (r)]))));		\
+    s0 = _mm256_xor_si256(_mm256_xor_si256(ROTR_V(a, 2), ROTR_V(a, 13)), \
+        ROTR_V(a, 22));							\
+    maj = _mm256_or_si256(_mm256_and_si256(a, t[(1 - (r)) & 7]),	\
+        _mm256_and_si256(t[(2 - (r)) & 7],				\
+        _mm256_or_si256(a, t[(1 - (r)) & 7])));			\
+    t[(3 - (r)) & 7] = _mm256_add_epi32(t[(3 - (r)) & 7], t1);		\
+    t[(7 - (r)) & 7] = _mm256_add_epi32(t1, _mm256_add_epi32(s0, maj));	\
+}									\
+while (0)
+
+/**
+ * Transpose 8 vectors of 8 32-bit values so that vector i holds word i of
+ * each lane's data.
+ *
+ * @param [in, out] v  The vectors to transpose.
+ */
+#define TRANSPOSE_8X8(v)						\
+do									\
+{									\
+    __m256i t0, t1, t2, t3, t4, t5, t6, t7;				\
+									\
+    t0 = _mm256_unpacklo_epi32(v[0], v[1]);				\
+    t1 = _mm256_unpackhi_epi32(v[0], v[1]);				\
+    t2 = _mm256_unpacklo_epi32(v[2], v[3]);				\
+    t3 = _mm256_unpackhi_epi32(v[2], v[3]);				\
+    t4 = _mm256_unpacklo_epi32(v[4], v[5]);				\
+    t5 = _mm256_unpackhi_epi32(v[4], v[5]);				\
+    t6 = _mm256_unpacklo_epi32(v[6], v[7]);				\
+    t7 = _mm256_unpackhi_epi32(v[6], v[7]);				\
+    v[0] = _mm256_unpacklo_epi64(t0, t2);				\
+    v[1] = _mm256_unpackhi_epi64(t0, t2);				\
+    v[2] = _mm256_unpacklo_epi64(t1, t3);				\
+    v[3] = _mm256_unpackhi_epi64(t1, t3);				\
+    v[4] = _mm256_unpacklo_epi64(t4, t6);				\
+    v[5] = _mm256_unpackhi_epi64(t4, t6);				\
+    v[6] = _mm256_unpacklo_epi64(t5, t7);				\
+    v[7] = _mm256_unpackhi_epi64(t5, t7);				\
+    t0 = _mm256_permute2x128_si256(v[0], v[4], 0x20);			\
+    t1 = _mm256_permute2x128_si256(v[1], v[5], 0x20);			\
+    t2 = _mm256_permute2x128_si256(v[2], v[6], 0x20);			\
+    t3 = _mm256_permute2x128_si256(v[3], v[7], 0x20);			\
+    t4 = _mm256_permute2x128_si256(v[0], v[4], 0x31);			\
+    t5 = _mm256_permute2x128_si256(v[1], v[5], 0x31);			\
+    t6 = _mm256_permute2x128_si256(v[2], v[6], 0x31);			\
+    t7 = _mm256_permute2x128_si256(v[3], v[7], 0x31);			\
+    v[0] = t0; v[1] = t1; v[2] = t2; v[3] = t3;				\
+    v[4] = t4; v[5] = t5; v[6] = t6; v[7] = t7;				\
+}									\
+while (0)
+
+/**
+ * Compress one block of each lane into the lane's state.
+ *
+ * @param [in, out] h  The state of each lane: word i in vector i.
+ * @param [in]      w  The words of each lane's block: word i in vector i.
+ *                     Overwritten with the message schedule.
+ */
+AVX2_TARGET
+static inline void hash_sha256_avx2_compress(__m256i *h, __m256i *w)
+{
+    __m256i t[8];
+    int i, j;
+
+    for (j=0; j<8; j++)
+        t[j] = h[j];
+    for (i=0; i<BLOCK_SIZE; i+=16)
+    {
+        if (i >= 16)
+        {
+            MIX_W_V(0); MIX_W_V(1); MIX_W_V(2); MIX_W_V(3);
+            MIX_W_V(4); MIX_W_V(5); MIX_W_V(6); MIX_W_V(7);
+            MIX_W_V(8); MIX_W_V(9); MIX_W_V(10); MIX_W_V(11);
+            MIX_W_V(12); MIX_W_V(13); MIX_W_V(14); MIX_W_V(15);
+        }
+        ROUND_V(0); ROUND_V(1); ROUND_V(2); ROUND_V(3);
+        ROUND_V(4); ROUND_V(5); ROUND_V(6); ROUND_V(7);
+        ROUND_V(8); ROUND_V(9); ROUND_V(10); ROUND_V(11);
+        ROUND_V(12); ROUND_V(13); ROUND_V(14); ROUND_V(15);
+    }
+    for (j=0; j<8; j++)
+        h[j] = _mm256_add_epi32(h[j], t[j]);
+}
+
+/**
+ * Process blocks of data (512 bits) of 8 messages.
+ * Lanes without a message are given a zero block and a step of 0.
+ *
+ * @param [in, out] h     The state of each lane: word i in vector i.
+ * @param [in, out] p     The next block of each lane's data.
+ * @param [in]      step  The number of bytes to move each lane's data on.
+ * @param [in]      n     The number of blocks to process.
+ */
+AVX2_TARGET
+static void hash_sha256_avx2_blocks(__m256i *h, const uint8_t **p,
+    const size_t *step, size_t n)
+{
+    const __m256i mask = _mm256_set_epi64x(
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m256i w[16];
+    int j;
+
+    for (; n > 0; n--)
+    {
+        /* Load the block of each lane and transpose into words. */
+        for (j=0; j<LANES; j++)
+        {
+            w[j] = _mm256_loadu_si256((const __m256i *)p[j]);
+            w[8 + j] = _mm256_loadu_si256((const __m256i *)(p[j] + 32));
+            p[j] += step[j];
+        }
+        TRANSPOSE_8X8(w);
+        TRANSPOSE_8X8((w + 8));
+        for (j=0; j<16; j++)
+            w[j] = _mm256_shuffle_epi8(w[j], mask);
+
+        hash_sha256_avx2_compress(h, w);
+    }
+}
+
+/** A message being digested in a lane. */
+typedef struct hash_sha256_lane_st
+{
+    /** Index of the message. -1 when the lane is empty. */
+    int job;
+    /** The number of bytes of the message processed. */
+    size_t done;
+    /** The number of blocks left of the message data or padding. */
+    size_t blocks;
+    /** Whether the padding blocks are being processed. */
+    int pad;
+    /** The number of padding blocks. */
+    int pad_blocks;
+    /** The last partial block of the message with padding and length. */
+    uint8_t m[2 * BLOCK_SIZE];
+} HASH_SHA256_LANE;
+
+/** A message and its length in blocks for sorting. */
+typedef struct hash_sha256_job_st
+{
+    /** The number of blocks of the message including padding. */
+    size_t blocks;
+    /** Index of the message. */
+    int idx;
+} HASH_SHA256_JOB;
+
+/**
+ * Compare jobs so that the longest is first.
+ *
+ * @param [in] a  The first job.
+ * @param [in] b  The second job.
+ * @return  Negative when a is longer, positive when b is longer, 0 otherwise.
+ */
+static int hash_sha256_job_cmp(const void *a, const void *b)
+{
+    const HASH_SHA256_JOB *ja = a;
+    const HASH_SHA256_JOB *jb = b;
+
+    if (ja->blocks != jb->blocks)
+        return (ja->blocks > jb->blocks) ? -1 : 1;
+    return ja->idx - jb->idx;
+}
+
+/**
+ * Start a message in a lane: the full blocks are processed from the message
+ * and the rest is copied with the padding.
+ *
+ * @param [in] lane  The lane.
+ * @param [in] job   Index of the message.
+ * @param [in] msg   The message data.
+ * @param [in] len   The length of the message.
+ * @param [in] pre   The number of bytes hashed before the message.
+ */
+static void hash_sha256_lane_start(HASH_SHA256_LANE *lane, int job,
+    const unsigned char *msg, size_t len, size_t pre)
+{
+    size_t o = len & (BLOCK_SIZE - 1);
+    uint64_t bits = (uint64_t)(pre + len) * 8;
+    int i;
+
+    lane->job = job;
+    lane->done = 0;
+    lane->blocks = len / BLOCK_SIZE;
+    lane->pad_blocks = (o < 56) ? 1 : 2;
+    memcpy(lane->m, msg + len - o, o);
+    lane->m[o] = 0x80;
+    memset(lane->m + o + 1, 0, lane->pad_blocks * BLOCK_SIZE - o - 1);
+    for (i=0; i<8; i++)
+        lane->m[lane->pad_blocks * BLOCK_SIZE - 1 - i] = bits >> (i * 8);
+    lane->pad = (lane->blocks == 0);
+    if (lane->pad)
+        lane->blocks = lane->pad_blocks;
+}
+
+/**
+ * Digest many messages with SHA-224 or SHA-256 using 8 lanes.
+ * Each message can continue from its own state: HMAC starts from the state
+ * after the key block.
+ *
+ * @param [in] iv       The state to start each message from.
+ * @param [in] iv_step  The number of words between the states of messages. 0
+ *                      when all messages start from the same state.
+ * @param [in] pre      The number of bytes hashed to reach the state.
+ * @param [in] len      The length of the message digest.
+ * @param [in] msgs     The messages to digest.
+ * @param [in] lens     The lengths of the messages.
+ * @param [in] cnt      The number of messages.
+ * @param [in] mds      The buffers to hold the message digests.
+ * @return  0 when allocating dynamic memory failed.<br>
+ *          1 otherwise.
+ */
+AVX2_TARGET
+static int hash_sha256_avx2_mb(const uint32_t *iv, size_t iv_step,
+    size_t pre, int len, const unsigned char **msgs, const size_t *lens,
+    int cnt, unsigned char **mds)
+{
+    HASH_SHA256_JOB *jobs;
+    HASH_SHA256_LANE lane[LANES];
+    __m256i h[8];
+    uint32_t s[8][LANES];
+    const uint8_t *p[LANES];
+    size_t step[LANES];
+    size_t n;
+    int next = 0;
+    int active = 0;
+    int i, j;
+    HASH_SHA256 ctx;
+
+    if (cnt == 0)
+        return 1;
+    jobs = malloc(cnt * sizeof(*jobs));
+    if (jobs == NULL)
+        return 0;
+    for (i=0; i<cnt; i++)
+    {
+        jobs[i].blocks = (lens[i] + 8) / BLOCK_SIZE + 1;
+        jobs[i].idx = i;
+    }
+    qsort(jobs, cnt, sizeof(*jobs), hash_sha256_job_cmp);
+
+    for (j=0; j<LANES; j++)
+        lane[j].job = -1;
+    for (i=0; i<8; i++)
+        h[i] = _mm256_setzero_si256();
+
+    for (;;)
+    {
+        /* Put the next messages into the empty lanes. */
+        for (i=0; i<8; i++)
+            _mm256_storeu_si256((__m256i *)s[i], h[i]);
+        for (j=0; (j<LANES) && (next<cnt); j++)
+        {
+            if (lane[j].job >= 0)
+                continue;
+            hash_sha256_lane_start(&lane[j], jobs[next].idx,
+                msgs[jobs[next].idx], lens[jobs[next].idx], pre);
+            for (i=0; i<8; i++)
+                s[i][j] = iv[jobs[next].idx * iv_step + i];
+            next++;
+            active++;
+        }
+
+        /* Too few lanes in use - finish the messages one at a time. */
+        if ((next == cnt) && (active <= LANES_MIN))
+        {
+            for (j=0; j<LANES; j++)
+            {
+                int k = lane[j].job;
+
+                /* Padding is started when processed in lanes. */
+                if ((k < 0) || lane[j].pad)
+                    continue;
+                for (i=0; i<8; i++)
+                    ctx.h[i] = s[i][j];
+                ctx.o = 0;
+                ctx.len = pre + lane[j].done;
+                hash_sha256_update(&ctx, msgs[k] + lane[j].done,
+                    lens[k] - lane[j].done);
+                if (len == HASH_SHA224_LEN)
+                    hash_sha224_final(mds[k], &ctx);
+                else
+                    hash_sha256_final(mds[k], &ctx);
+                lane[j].job = -1;
+                active--;
+            }
+        }
+        if (active == 0)
+            break;
+        for (i=0; i<8; i++)
+            h[i] = _mm256_loadu_si256((const __m256i *)s[i]);
+
+        /* Process blocks until a lane reaches the end of its data. */
+        n = (size_t)-1;
+        for (j=0; j<LANES; j++)
+        {
+            if (lane[j].job < 0)
+            {
+                p[j] = hash_sha256_avx2_zero;
+                step[j] = 0;
+                continue;
+            }
+            if (lane[j].pad)
+                p[j] = lane[j].m + (lane[j].pad_blocks - lane[j].blocks) *
+                    BLOCK_SIZE;
+            else
+                p[j] = msgs[lane[j].job] + lane[j].done;
+            step[j] = BLOCK_SIZE;
+            if (lane[j].blocks < n)
+                n = lane[j].blocks;
+        }
+        hash_sha256_avx2_blocks(h, p, step, n);
+
+        /* Move lanes on to padding and output finished messages. */
+        for (i=0; i<8; i++)
+            _mm256_storeu_si256((__m256i *)s[i], h[i]);
+        for (j=0; j<LANES; j++)
+        {
+            if (lane[j].job < 0)
+                continue;
+            lane[j].blocks -= n;
+            if (!lane[j].pad)
+                lane[j].done += n * BLOCK_SIZE;
+            if (lane[j].blocks > 0)
+                continue;
+            if (!lane[j].pad)
+            {
+                lane[j].pad = 1;
+                lane[j].blocks = lane[j].pad_blocks;
+                continue;
+            }
+            for (i=0; i<len/4; i++)
+            {
+                mds[lane[j].job][i*4+0] = s[i][j] >> 24;
+                mds[lane[j].job][i*4+1] = s[i][j] >> 16;
+                mds[lane[j].job][i*4+2] = s[i][j] >> 8;
+                mds[lane[j].job][i*4+3] = s[i][j];
+            }
+            lane[j].job = -1;
+            active--;
+        }
+    }
+
+    free(jobs);
+    return 1;
+}
+
+/**
+ * Digest many messages with SHA-224.
+ *
+ * @param [in] msgs  The messages to digest.
+ * @param [in] lens  The lengths of the messages.
+ * @param [in] cnt   The number of messages.
+ * @param [in] mds   The buffers to hold the message digests.
+ * @return  0 when allocating dynamic memory failed.<br>
+ *          1 otherwise.
+ */
+int hash_sha224_avx2_batch(const unsigned char **msgs, const size_t *lens,
+    int cnt, unsigned char **mds)
+{
+    return hash_sha256_avx2_mb(hash_sha224_avx2_iv, 0, 0, HASH_SHA224_LEN,
+        msgs, lens, cnt, mds);
+}
+
+/**
+ * Digest many messages with SHA-256.
+ *
+ * @param [in] msgs  The messages to digest.
+ * @param [in] lens  The lengths of the messages.
+ * @param [in] cnt   The number of messages.
+ * @param [in] mds   The buffers to hold the message digests.
+ * @return  0 when allocating dynamic memory failed.<br>
+ *          1 otherwise.
+ */
+int hash_sha256_avx2_batch(const unsigned char **msgs, const size_t *lens,
+    int cnt, unsigned char **mds)
+{
+    return hash_sha256_avx2_mb(hash_sha256_avx2_iv, 0, 0, HASH_SHA256_LEN,
+        msgs, lens, cnt, mds);
+}
+
+/**
+ * HMAC many messages with SHA-224 or SHA-256.
+ * The inner hashes of all messages are done in lanes, then the outer hashes.
+ * The key blocks are hashed once for consecutive messages with the same key.
+ *
+ * @param [in] len    The length of the message digest.
+ * @param [in] init   The HMAC initialization function.
+ * @param [in] keys   The keys of the messages.
+ * @param [in] klens  The lengths of the keys.
+ * @param [in] msgs   The messages to MAC.
+ * @param [in] lens   The lengths of the messages.
+ * @param [in] cnt    The number of messages.
+ * @param [in] macs   The buffers to hold the MACs.
+ * @return  0 when allocating dynamic memory failed.<br>
+ *          1 otherwise.
+ */
+static int hmac_sha256_avx2_mb(int len,
+    int (*init)(HASH_SHA256 *, const void *, size_t),
+    const unsigned char **keys, const int *klens, const unsigned char **msgs,
+    const size_t *lens, int cnt, unsigned char **macs)
+{
+    int ret = 0;
+    int i, j;
+    uint32_t *st;
+    unsigned char *md;
+    unsigned char **mds;
+    size_t *mlens;
+    HASH_SHA256 ctx[2];
+
+    if (cnt == 0)
+        return 1;
+    /* States, inner digests, pointers to them and their lengths. */
+    st = malloc(cnt * (16 * sizeof(uint32_t) + HASH_SHA256_LEN +
+        sizeof(*mds) + sizeof(*mlens)));
+    if (st == NULL)
+        return 0;
+    mds = (unsigned char **)(st + cnt * 16);
+    mlens = (size_t *)(mds + cnt);
+    md = (unsigned char *)(mlens + cnt);
+
+    for (i=0; i<cnt; i++)
+    {
+        if ((i == 0) || (keys[i] != keys[i-1]) || (klens[i] != klens[i-1]))
+            init(ctx, keys[i], klens[i]);
+        for (j=0; j<8; j++)
+        {
+            st[i * 16 + j] = ctx[0].h[j];
+            st[i * 16 + 8 + j] = ctx[1].h[j];
+        }
+        mds[i] = md + i * len;
+        mlens[i] = len;
+    }
+
+    ret = hash_sha256_avx2_mb(st, 16, BLOCK_SIZE, len, msgs, lens, cnt,
+        mds);
+    if (ret)
+    {
+        ret = hash_sha256_avx2_mb(st + 8, 16, BLOCK_SIZE, len,
+            (const unsigned char **)mds, mlens, cnt, macs);
+    }
+
+    free(st);
+    return ret;
+}
+
+/**
+ * HMAC many messages with SHA-224.
+ *
+ * @param [in] keys   The keys of the messages.
+ * @param [in] klens  The lengths of the keys.
+ * @param [in] msgs   The messages to MAC.
+ * @param [in] lens   The lengths of the messages.
+ * @param [in] cnt    The number of messages.
+ * @param [in] macs   The buffers to hold the MACs.
+ * @return  0 when allocating dynamic memory failed.<br>
+ *          1 otherwise.
+ */
+int hmac_sha224_avx2_batch(const unsigned char **keys, const int *klens,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **macs)
+{
+    return hmac_sha256_avx2_mb(HASH_SHA224_LEN, &hmac_sha224_init, keys,
+        klens, msgs, lens, cnt, macs);
+}
+
+/**
+ * HMAC many messages with SHA-256.
+ *
+ * @param [in] keys   The keys of the messages.
+ * @param [in] klens  The lengths of the keys.
+ * @param [in] msgs   The messages to MAC.
+ * @param [in] lens   The lengths of the messages.
+ * @param [in] cnt    The number of messages.
+ * @param [in] macs   The buffers to hold the MACs.
+ * @return  0 when allocating dynamic memory failed.<br>
+ *          1 otherwise.
+ */
+int hmac_sha256_avx2_batch(const unsigned char **keys, const int *klens,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **macs)
+{
+    return hmac_sha256_avx2_mb(HASH_SHA256_LEN, &hmac_sha256_init, keys,
+        klens, msgs, lens, cnt, macs);
+}
+
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-224 or
+ * HMAC-SHA-256 for up to 8 keys at once.
+ * The MACs are kept as words in the vectors: the next block is the words of
+ * the digest followed by constant padding, so nothing is loaded, transposed
+ * or byte swapped until the end.
+ *
+ * @param [in]      ctx   The SHA256 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys. At most 8.
+ * @param [in]      iter  The total number of iterations.
+ * @param [in]      len   The length of the MAC.
+ */
+AVX2_TARGET
+static void hmac_sha256_avx2_lanes(HASH_SHA256 **ctx, unsigned char **data,
+    int cnt, unsigned int iter, int len)
+{
+    __m256i ih[8], oh[8], u[8], t[8], h[8], w[16];
+    uint32_t s[8][LANES];
+    int words = len / 4;
+    unsigned int n;
+    int i, j, k;
+
+    /* Lanes without a key repeat the first key. */
+    for (j=0; j<LANES; j++)
+    {
+        k = (j < cnt) ? j : 0;
+        for (i=0; i<8; i++)
+            s[i][j] = ctx[k][0].h[i];
+    }
+    for (i=0; i<8; i++)
+        ih[i] = _mm256_loadu_si256((const __m256i *)s[i]);
+    for (j=0; j<LANES; j++)
+    {
+        k = (j < cnt) ? j : 0;
+        for (i=0; i<8; i++)
+            s[i][j] = ctx[k][1].h[i];
+    }
+    for (i=0; i<8; i++)
+        oh[i] = _mm256_loadu_si256((const __m256i *)s[i]);
+    for (j=0; j<LANES; j++)
+    {
+        k = (j < cnt) ? j : 0;
+        for (i=0; i<words; i++)
+        {
+            s[i][j] = ((uint32_t)data[k][i*4+0] << 24) |
+                      ((uint32_t)data[k][i*4+1] << 16) |
+                      ((uint32_t)data[k][i*4+2] <<  8) |
+                       (uint32_t)data[k][i*4+3];
+        }
+    }
+    for (i=0; i<words; i++)
+    {
+        u[i] = _mm256_loadu_si256((const __m256i *)s[i]);
+        t[i] = u[i];
+    }
+
+    for (n=1; n<iter; n++)
+    {
+        for (i=0; i<words; i++)
+            w[i] = u[i];
+        w[words] = _mm256_set1_epi32((int)0x80000000);
+        for (i=words+1; i<15; i++)
+            w[i] = _mm256_setzero_si256();
+        w[15] = _mm256_set1_epi32((BLOCK_SIZE + len) * 8);
+        for (i=0; i<8; i++)
+            h[i] = ih[i];
+        hash_sha256_avx2_compress(h, w);
+
+        for (i=0; i<words; i++)
+            w[i] = h[i];
+        w[words] = _mm256_set1_epi32((int)0x80000000);
+        for (i=words+1; i<15; i++)
+            w[i] = _mm256_setzero_si256();
+        w[15] = _mm256_set1_epi32((BLOCK_SIZE + len) * 8);
+        for (i=0; i<8; i++)
+            h[i] = oh[i];
+        hash_sha256_avx2_compress(h, w);
+
+        for (i=0; i<words; i++)
+        {
+            u[i] = h[i];
+            t[i] = _mm256_xor_si256(t[i], u[i]);
+        }
+    }
+
+    for (i=0; i<words; i++)
+        _mm256_storeu_si256((__m256i *)s[i], t[i]);
+    for (j=0; j<cnt; j++)
+    {
+        for (i=0; i<words; i++)
+        {
+            data[j][i*4+0] = s[i][j] >> 24;
+            data[j][i*4+1] = s[i][j] >> 16;
+            data[j][i*4+2] = s[i][j] >> 8;
+            data[j][i*4+3] = s[i][j];
+        }
+    }
+}
+
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-224 using 8
+ * lanes. When LANES_MIN or fewer keys are left they are done with
+ * single-stream C code.
+ *
+ * @param [in]      ctx   The SHA256 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys.
+ * @param [in]      iter  The total number of iterations.
+ * @return  1 to indicate success.
+ */
+int hmac_sha224_avx2_iterate(HASH_SHA256 **ctx, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    int i;
+
+    for (i=0; cnt-i>LANES_MIN; i+=LANES)
+    {
+        hmac_sha256_avx2_lanes(ctx + i, data + i,
+            (cnt - i < LANES) ? cnt - i : LANES, iter, HASH_SHA224_LEN);
+    }
+    if (i < cnt)
+        hmac_sha224_iterate(ctx + i, data + i, cnt - i, iter);
+    return 1;
+}
+
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-256 using 8
+ * lanes. When LANES_MIN or fewer keys are left they are done with
+ * single-stream C code.
+ *
+ * @param [in]      ctx   The SHA256 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys.
+ * @param [in]      iter  The total number of iterations.
+ * @return  1 to indicate success.
+ */
+int hmac_sha256_avx2_iterate(HASH_SHA256 **ctx, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    int i;
+
+    for (i=0; cnt-i>LANES_MIN; i+=LANES)
+    {
+        hmac_sha256_avx2_lanes(ctx + i, data + i,
+            (cnt - i < LANES) ? cnt - i : LANES, iter, HASH_SHA256_LEN);
+    }
+    if (i < cnt)
+        hmac_sha256_iterate(ctx + i, data + i, cnt - i, iter);
+    return 1;
+}
+
+#endif
@@ -385,16 +385,17 @@ static int hash_sha3_update(HASH_SHA3 *ctx, const uint8_t *data, size_t len,
  * @param [in] ctx  The context of the hash operation.
  * @param [in] r    The number of 64-bit words from message data used in blocks.
  * @param [in] l    The length of the message digest.
+ * @param [in] d    The padding byte at the end of the message.
  * @return  1 on success.
  */
 static int hash_sha3_final(unsigned char *md, HASH_SHA3 *ctx, uint8_t r,
-    uint8_t l)
+    uint8_t l, uint8_t d)
 {
     uint8_t i;
     uint8_t *s8 = (uint8_t *)ctx->s;
 
     ctx->t[r*8-1] = 0x00;
-    ctx->t[ctx->i] = 0x06;
+    ctx->t[ctx->i] = d;
     ctx->t[r*8-1] |= 0x80;
     for (i=ctx->i+1; i<r*8-1; i++)
         ctx->t[i] = 0;
@@ -467,7 +468,7 @@ int hash_sha3_224_update(HASH_SHA3 *ctx, const uint8_t *data, size_t len)
  */
 int hash_sha3_224_final(unsigned char *md, HASH_SHA3 *ctx)
 {
-    return hash_sha3_final(md, ctx, 18, 28);
+    return hash_sha3_final(md, ctx, 18, 28, 0x06);
 }
 
 /**
@@ -507,7 +508,7 @@ int hash_sha3_256_update(HASH_SHA3 *ctx, const uint8_t *data, size_t len)
  */
 int hash_sha3_256_final(unsigned char *md, HASH_SHA3 *ctx)
 {
-    return hash_sha3_final(md, ctx, 17, 32);
+    return hash_sha3_final(md, ctx, 17, 32, 0x06);
 }
 
 /**
@@ -547,7 +548,7 @@ int hash_sha3_384_update(HASH_SHA3 *ctx, const uint8_t *data, size_t len)
  */
 int hash_sha3_384_final(unsigned char *md, HASH_SHA3 *ctx)
 {
-    return hash_sha3_final(md, ctx, 13, 48);
+    return hash_sha3_final(md, ctx, 13, 48, 0x06);
 }
 
 /**
@@ -587,7 +588,193 @@ int hash_sha3_512_update(HASH_SHA3 *ctx, const uint8_t *data, size_t len)
  */
 int hash_sha3_512_final(unsigned char *md, HASH_SHA3 *ctx)
 {
-    return hash_sha3_final(md, ctx, 9, 64);
+    return hash_sha3_final(md, ctx, 9, 64, 0x06);
+}
+
+/**
+ * Update the SHAKE-128 digest with more data.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The data to digest.
+ * @param [in] len   The length of the data to digest.
+ * @return  1 on success.
+ */
+int hash_shake128_update(HASH_SHA3 *ctx, const uint8_t *data, size_t len)
+{
+    return hash_sha3_update(ctx, data, len, 21);
+}
+
+/**
+ * Calculate the SHAKE-128 output, of HASH_SHAKE128_LEN bytes, based on all the
+ * message data seen.
+ *
+ * @param [in] md   The buffer to hold the message digest.
+ * @param [in] ctx  The context of the hash operation.
+ * @return  1 on success.
+ */
+int hash_shake128_final(unsigned char *md, HASH_SHA3 *ctx)
+{
+    return hash_sha3_final(md, ctx, 21, HASH_SHAKE128_LEN, 0x1f);
+}
+
+/**
+ * Update the SHAKE-256 digest with more data.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The data to digest.
+ * @param [in] len   The length of the data to digest.
+ * @return  1 on success.
+ */
+int hash_shake256_update(HASH_SHA3 *ctx, const uint8_t *data, size_t len)
+{
+    return hash_sha3_update(ctx, data, len, 17);
+}
+
+/**
+ * Calculate the SHAKE-256 output, of HASH_SHAKE256_LEN bytes, based on all the
+ * message data seen.
+ *
+ * @param [in] md   The buffer to hold the message digest.
+ * @param [in] ctx  The context of the hash operation.
+ * @return  1 on success.
+ */
+int hash_shake256_final(unsigned char *md, HASH_SHA3 *ctx)
+{
+    return hash_sha3_final(md, ctx, 17, HASH_SHAKE256_LEN, 0x1f);
+}
+
+/**
+ * Export the SHA-3 state in a portable format.
+ * The state words are stored big-endian. Unused message bytes are zero.
+ *
+ * @param [in] data  The buffer to hold the state of HASH_SHA3_STATE_LEN bytes.
+ * @param [in] ctx   The context of the hash operation.
+ * @return  1 on success.
+ */
+int hash_sha3_export(unsigned char *data, HASH_SHA3 *ctx)
+{
+    int i, j;
+
+    for (i=0; i<25; i++)
+        for (j=0; j<8; j++)
+            data[i*8+j] = ctx->s[i] >> ((7-j)*8);
+    data += 200;
+    *(data++) = ctx->i;
+    for (i=0; i<ctx->i; i++)
+        data[i] = ctx->t[i];
+    for (; i<200; i++)
+        data[i] = 0;
+
+    return 1;
+}
+
+/**
+ * Import the SHA-3 state from the portable format.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The exported state of HASH_SHA3_STATE_LEN bytes.
+ * @param [in] p     The number of 64-bit numbers in a block of data to process.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+static int hash_sha3_import(HASH_SHA3 *ctx, const unsigned char *data,
+    uint8_t p)
+{
+    int i, j;
+
+    if (data[200] >= p*8)
+        return 0;
+
+    for (i=0; i<25; i++)
+    {
+        ctx->s[i] = 0;
+        for (j=0; j<8; j++)
+            ctx->s[i] |= ((uint64_t)data[i*8+j]) << ((7-j)*8);
+    }
+    data += 200;
+    ctx->i = *(data++);
+    for (i=0; i<200; i++)
+        ctx->t[i] = data[i];
+
+    return 1;
+}
+
+/**
+ * Import the SHA-3_224 state from the portable format.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The exported state of HASH_SHA3_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_sha3_224_import(HASH_SHA3 *ctx, const unsigned char *data)
+{
+    return hash_sha3_import(ctx, data, 18);
+}
+
+/**
+ * Import the SHA-3_256 state from the portable format.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The exported state of HASH_SHA3_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_sha3_256_import(HASH_SHA3 *ctx, const unsigned char *data)
+{
+    return hash_sha3_import(ctx, data, 17);
+}
+
+/**
+ * Import the SHA-3_384 state from the portable format.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The exported state of HASH_SHA3_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_sha3_384_import(HASH_SHA3 *ctx, const unsigned char *data)
+{
+    return hash_sha3_import(ctx, data, 13);
+}
+
+/**
+ * Import the SHA-3_512 state from the portable format.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The exported state of HASH_SHA3_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_sha3_512_import(HASH_SHA3 *ctx, const unsigned char *data)
+{
+    return hash_sha3_import(ctx, data, 9);
+}
+
+/**
+ * Import the SHAKE-128 state from the portable format.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The exported state of HASH_SHA3_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_shake128_import(HASH_SHA3 *ctx, const unsigned char *data)
+{
+    return hash_sha3_import(ctx, data, 21);
+}
+
+/**
+ * Import the SHAKE-256 state from the portable format.
+ *
+ * @param [in] ctx   The context of the hash operation.
+ * @param [in] data  The exported state of HASH_SHA3_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_shake256_import(HASH_SHA3 *ctx, const unsigned char *data)
+{
+    return hash_sha3_import(ctx, data, 17);
 }
 
 /**
@@ -675,3 +862,29 @@ int hash_sha3_512(uint8_t *h, const uint8_t *m, uint64_t n)
     return 1;
 }
 
+/**
+ * Single shot hash operation of SHAKE-128 with HASH_SHAKE128_LEN bytes output.
+ *
+ * @param [in] h  The message digest data.
+ * @param [in] m  The message data to hash.
+ * @param [in] n  The length of the message data.
+ * @return  1 on success.
+ */
+int hash_shake128_digest(uint8_t *h, const uint8_t *m, uint64_t n)
+{
+    hash_keccak(21*8, m, n, 0x1f, h, 168, HASH_SHAKE128_LEN);
+    return 1;
+}
+/**
+ * Single shot hash operation of SHAKE-256 with HASH_SHAKE256_LEN bytes output.
+ *
+ * @param [in] h  The message digest data.
+ * @param [in] m  The message data to hash.
+ * @param [in] n  The length of the message data.
+ * @return  1 on success.
+ */
+int hash_shake256_digest(uint8_t *h, const uint8_t *m, uint64_t n)
+{
+    hash_keccak(17*8, m, n, 0x1f, h, 136, HASH_SHAKE256_LEN);
+    return 1;
+}
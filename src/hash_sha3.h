@@ -31,6 +31,13 @@
 #define HASH_SHA3_384_LEN	48
 /** The length of the SHA3-512 digest output. */
 #define HASH_SHA3_512_LEN	64
+/** The length of the SHAKE-128 output - 256 bits for 128-bit security. */
+#define HASH_SHAKE128_LEN	32
+/** The length of the SHAKE-256 output - 512 bits for 256-bit security. */
+#define HASH_SHAKE256_LEN	64
+
+/** The length of the exported SHA-3 state. */
+#define HASH_SHA3_STATE_LEN	(200 + 1 + 200)
 
 /** The SHA-3 hash algorithm data. */
 typedef struct hash_sha3_t
@@ -56,9 +63,23 @@ int hash_sha3_384_final(unsigned char *md, HASH_SHA3 *ctx);
 int hash_sha3_512_mac_init(HASH_SHA3 *ctx, const uint8_t *key, size_t len);
 int hash_sha3_512_update(HASH_SHA3 *ctx, const uint8_t *data, size_t len);
 int hash_sha3_512_final(unsigned char *md, HASH_SHA3 *ctx);
+int hash_shake128_update(HASH_SHA3 *ctx, const uint8_t *data, size_t len);
+int hash_shake128_final(unsigned char *md, HASH_SHA3 *ctx);
+int hash_shake256_update(HASH_SHA3 *ctx, const uint8_t *data, size_t len);
+int hash_shake256_final(unsigned char *md, HASH_SHA3 *ctx);
+
+int hash_sha3_export(unsigned char *data, HASH_SHA3 *ctx);
+int hash_sha3_224_import(HASH_SHA3 *ctx, const unsigned char *data);
+int hash_sha3_256_import(HASH_SHA3 *ctx, const unsigned char *data);
+int hash_sha3_384_import(HASH_SHA3 *ctx, const unsigned char *data);
+int hash_sha3_512_import(HASH_SHA3 *ctx, const unsigned char *data);
+int hash_shake128_import(HASH_SHA3 *ctx, const unsigned char *data);
+int hash_shake256_import(HASH_SHA3 *ctx, const unsigned char *data);
 
 int hash_shake128(uint8_t *h, uint64_t l, const uint8_t *m, uint64_t n);
 int hash_shake256(uint8_t *h, uint64_t l, const uint8_t *m, uint64_t n);
+int hash_shake128_digest(uint8_t *h, const uint8_t *m, uint64_t n);
+int hash_shake256_digest(uint8_t *h, const uint8_t *m, uint64_t n);
 int hash_sha3_224(uint8_t *h, const uint8_t *m, uint64_t n);
 int hash_sha3_256(uint8_t *h, const uint8_t *m, uint64_t n);
 int hash_sha3_384(uint8_t *h, const uint8_t *m, uint64_t n);
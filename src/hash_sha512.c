@@ -541,6 +541,23 @@ int hmac_sha384_final(unsigned char *md, HASH_SHA512 *ctx)
     return 1;
 }
 
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-384.
+ *
+ * @param [in]      ctx   The SHA512 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys.
+ * @param [in]      iter  The total number of iterations.
+ * @return  1 to indicate success.
+ */
+int hmac_sha384_iterate(HASH_SHA512 **ctx, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    HMAC_ITERATE(HASH_SHA512, ctx, data, cnt, iter, HASH_SHA384_LEN,
+        hash_sha512_block);
+    return 1;
+}
+
 /**
  * Initialize the HMAC-SHA-512 operation with a key.
  *
@@ -570,6 +587,23 @@ int hmac_sha512_final(unsigned char *md, HASH_SHA512 *ctx)
     return 1;
 }
 
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-512.
+ *
+ * @param [in]      ctx   The SHA512 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys.
+ * @param [in]      iter  The total number of iterations.
+ * @return  1 to indicate success.
+ */
+int hmac_sha512_iterate(HASH_SHA512 **ctx, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    HMAC_ITERATE(HASH_SHA512, ctx, data, cnt, iter, HASH_SHA512_LEN,
+        hash_sha512_block);
+    return 1;
+}
+
 /**
  * Initialize the HMAC-SHA-512_224 operation with a key.
  *
@@ -600,6 +634,23 @@ int hmac_sha512_224_final(unsigned char *md, HASH_SHA512 *ctx)
     return 1;
 }
 
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-512_224.
+ *
+ * @param [in]      ctx   The SHA512 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys.
+ * @param [in]      iter  The total number of iterations.
+ * @return  1 to indicate success.
+ */
+int hmac_sha512_224_iterate(HASH_SHA512 **ctx, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    HMAC_ITERATE(HASH_SHA512, ctx, data, cnt, iter, HASH_SHA512_224_LEN,
+        hash_sha512_block);
+    return 1;
+}
+
 /**
  * Initialize the HMAC-SHA-512_256 operation with a key.
  *
@@ -630,3 +681,88 @@ int hmac_sha512_256_final(unsigned char *md, HASH_SHA512 *ctx)
     return 1;
 }
 
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-512_256.
+ *
+ * @param [in]      ctx   The SHA512 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys.
+ * @param [in]      iter  The total number of iterations.
+ * @return  1 to indicate success.
+ */
+int hmac_sha512_256_iterate(HASH_SHA512 **ctx, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    HMAC_ITERATE(HASH_SHA512, ctx, data, cnt, iter, HASH_SHA512_256_LEN,
+        hash_sha512_block);
+    return 1;
+}
+
+/**
+ * Export the SHA-512 state in a portable format.
+ * Numbers are stored big-endian. Unused message bytes are zero.
+ * Used for SHA-384, SHA-512_224 and SHA-512_256 as well.
+ *
+ * @param [in] data  The buffer to hold the state of HASH_SHA512_STATE_LEN
+ *                   bytes.
+ * @param [in] ctx   The SHA512 context object.
+ * @return  1 to indicate success.
+ */
+int hash_sha512_export(unsigned char *data, HASH_SHA512 *ctx)
+{
+    uint8_t i, j;
+
+    for (i=0; i<8; i++)
+        for (j=0; j<8; j++)
+            data[i*8+j] = ctx->h[i] >> ((7-j)*8);
+    data += 64;
+    for (i=0; i<8; i++)
+        data[i] = ctx->len_hi >> ((7-i)*8);
+    data += 8;
+    for (i=0; i<8; i++)
+        data[i] = ctx->len_lo >> ((7-i)*8);
+    data += 8;
+    *(data++) = ctx->o;
+    memcpy(data, ctx->m, ctx->o);
+    memset(data + ctx->o, 0, BLOCK_SIZE - ctx->o);
+
+    return 1;
+}
+
+/**
+ * Import the SHA-512 state from the portable format.
+ * Used for SHA-384, SHA-512_224 and SHA-512_256 as well.
+ *
+ * @param [in] ctx   The SHA512 context object.
+ * @param [in] data  The exported state of HASH_SHA512_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_sha512_import(HASH_SHA512 *ctx, const unsigned char *data)
+{
+    uint8_t i, j;
+
+    if (data[80] >= BLOCK_SIZE)
+        return 0;
+
+    for (i=0; i<8; i++)
+    {
+        ctx->h[i] = 0;
+        for (j=0; j<8; j++)
+            ctx->h[i] |= ((uint64_t)data[i*8+j]) << ((7-j)*8);
+    }
+    data += 64;
+    ctx->len_hi = 0;
+    for (i=0; i<8; i++)
+        ctx->len_hi |= ((uint64_t)data[i]) << ((7-i)*8);
+    data += 8;
+    ctx->len_lo = 0;
+    for (i=0; i<8; i++)
+        ctx->len_lo |= ((uint64_t)data[i]) << ((7-i)*8);
+    data += 8;
+    ctx->o = *(data++);
+    memcpy(ctx->m, data, BLOCK_SIZE);
+
+    return 1;
+}
+
@@ -0,0 +1,540 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * SHA-1 and SHA-256 using the Intel SHA extensions.
+ * The contexts are the same as the C implementations so the state can be
+ * exported and imported between them.
+ * Only called when the CPU has the SHA extensions - see hash_cpu_flags().
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash_sha1.h"
+#include "hash_sha2.h"
+#include "hmac.h"
+
+#ifdef CPU_X86_64
+
+#include <immintrin.h>
+
+/** The size of a block that is processed. */
+#define BLOCK_SIZE      64
+
+/** Compile the function for the SHA extensions. */
+#define SHA_NI_TARGET	__attribute__((target("sha,sse4.1")))
+
+/**
+ * Buffer the message and process the full blocks.
+ * Common to SHA-1 and SHA-256 as the contexts have the same fields.
+ *
+ * @param [in] ctx     The context object.
+ * @param [in] data    The data to digest.
+ * @param [in] len     The length of the data to digest.
+ * @param [in] blocks  The function processing blocks of data.
+ */
+#define SHA_NI_UPDATE(ctx, data, len, blocks)				\
+do									\
+{									\
+    size_t l;								\
+    uint8_t *m = ctx->m;						\
+    uint8_t o = ctx->o;							\
+    const uint8_t *d = data;						\
+									\
+    ctx->len += len;							\
+									\
+    if (o > 0)								\
+    {									\
+        l = BLOCK_SIZE - o;						\
+        if (len < l) l = len;						\
+									\
+        memcpy(&m[o], d, l);						\
+        d += l;								\
+        len -= l;							\
+        o += l;								\
+									\
+        if (o == BLOCK_SIZE)						\
+        {								\
+            blocks(ctx->h, m, 1);					\
+            o = 0;							\
+        }								\
+    }									\
+    if (len >= BLOCK_SIZE)						\
+    {									\
+        blocks(ctx->h, d, len / BLOCK_SIZE);				\
+        d += len & ~(size_t)(BLOCK_SIZE - 1);				\
+        len &= BLOCK_SIZE - 1;						\
+    }									\
+    memcpy(m, d, len);							\
+    ctx->o = o + len;							\
+}									\
+while (0)
+
+/**
+ * Pad the message and put the length in bits in the last 8 bytes of a block.
+ *
+ * @param [in] ctx     The context object.
+ * @param [in] blocks  The function processing blocks of data.
+ */
+#define SHA_NI_FIN(ctx, blocks)						\
+do									\
+{									\
+    uint8_t i;								\
+    uint8_t *m = ctx->m;						\
+    uint8_t o = ctx->o;							\
+    uint64_t len = ctx->len * 8;					\
+									\
+    m[o++] = 0x80;							\
+									\
+    if (o > 56)								\
+    {									\
+        memset(&m[o], 0, BLOCK_SIZE - o);				\
+        blocks(ctx->h, m, 1);						\
+        o = 0;								\
+    }									\
+    memset(&m[o], 0, 56-o);						\
+    for (i=0; i<8; i++)							\
+        m[56+i] = len >> ((7-i)*8);					\
+    blocks(ctx->h, m, 1);						\
+}									\
+while (0)
+
+/**
+ * Four rounds of SHA-1: g is the group of rounds (0-19).
+ * The message schedule of later groups is calculated in the same step.
+ * e0 and e1 swap roles each group.
+ */
+#define SHA1_NI_G(g, e0, e1)						\
+do									\
+{									\
+    if (g == 0)								\
+        e0 = _mm_add_epi32(e0, w[0]);					\
+    else								\
+        e0 = _mm_sha1nexte_epu32(e0, w[(g) & 3]);			\
+    e1 = abcd;								\
+    if ((g >= 3) && (g <= 18))						\
+        w[((g)+1) & 3] = _mm_sha1msg2_epu32(w[((g)+1) & 3], w[(g) & 3]); \
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, (g) / 5);			\
+    if ((g >= 1) && (g <= 16))						\
+        w[((g)+3) & 3] = _mm_sha1msg1_epu32(w[((g)+3) & 3], w[(g) & 3]); \
+    if ((g >= 2) && (g <= 17))						\
+        w[((g)+2) & 3] = _mm_xor_si128(w[((g)+2) & 3], w[(g) & 3]);	\
+}									\
+while (0)
+
+/**
+ * Process blocks of data (512 bits) for SHA-1.
+ *
+ * @param [in] h  The SHA-1 state.
+ * @param [in] m  The message data to digest.
+ * @param [in] n  The number of blocks to process.
+ */
+SHA_NI_TARGET
+static void hash_sha1_ni_blocks(uint32_t *h, const uint8_t *m, size_t n)
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+                                        0x08090a0b0c0d0e0fULL);
+    __m128i abcd, abcd_save, e0, e0_save, e1;
+    __m128i w[4];
+    int i;
+
+    abcd = _mm_loadu_si128((const __m128i *)h);
+    abcd = _mm_shuffle_epi32(abcd, 0x1b);
+    e0 = _mm_set_epi32(h[4], 0, 0, 0);
+
+    for (; n > 0; n--, m += BLOCK_SIZE)
+    {
+        abcd_save = abcd;
+        e0_save = e0;
+
+        for (i=0; i<4; i++)
+        {
+            w[i] = _mm_loadu_si128((const __m128i *)(m + i * 16));
+            w[i] = _mm_shuffle_epi8(w[i], mask);
+        }
+
+        SHA1_NI_G( 0, e0, e1); SHA1_NI_G( 1, e1, e0);
+        SHA1_NI_G( 2, e0, e1); SHA1_NI_G( 3, e1, e0);
+        SHA1_NI_G( 4, e0, e1); SHA1_NI_G( 5, e1, e0);
+        SHA1_NI_G( 6, e0, e1); SHA1_NI_G( 7, e1, e0);
+        SHA1_NI_G( 8, e0, e1); SHA1_NI_G( 9, e1, e0);
+        SHA1_NI_G(10, e0, e1); SHA1_NI_G(11, e1, e0);
+        SHA1_NI_G(12, e0, e1); SHA1_NI_G(13, e1, e0);
+        SHA1_NI_G(14, e0, e1); SHA1_NI_G(15, e1, e0);
+        SHA1_NI_G(16, e0, e1); SHA1_NI_G(17, e1, e0);
+        SHA1_NI_G(18, e0, e1); SHA1_NI_G(19, e1, e0);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    abcd = _mm_shuffle_epi32(abcd, 0x1b);
+    _mm_storeu_si128((__m128i *)h, abcd);
+    h[4] = _mm_extract_epi32(e0, 3);
+}
+
+/** Process one block of data into the state of a SHA-1 context. */
+#define SHA1_NI_BLOCK(ctx, m)	hash_sha1_ni_blocks((ctx)->h, m, 1)
+
+/**
+ * Update the message digest with more data.
+ *
+ * @param [in] ctx   The SHA1 context object.
+ * @param [in] data  The data to digest.
+ * @param [in] len   The length of the data to digest.
+ * @return  1 to indicate success.
+ */
+int hash_sha1_ni_update(HASH_SHA1 *ctx, const void *data, size_t len)
+{
+    SHA_NI_UPDATE(ctx, data, len, hash_sha1_ni_blocks);
+    return 1;
+}
+
+/**
+ * Finalize the message digest for SHA-1.
+ * Output 160 bits or 20 bytes.
+ *
+ * @param [in] md   The message digest buffer.
+ * @param [in] ctx  The SHA1 context object.
+ * @return  1 to indicate success.
+ */
+int hash_sha1_ni_final(unsigned char *md, HASH_SHA1 *ctx)
+{
+    uint8_t i, j;
+    uint32_t *h = ctx->h;
+
+    SHA_NI_FIN(ctx, hash_sha1_ni_blocks);
+
+    for (i=0; i<5; i++)
+        for (j=0; j<4; j++)
+            md[i*4+j] = h[i] >> ((3-j)*8);
+
+    return 1;
+}
+
+/**
+ * Initialize the HMAC-SHA-1 operation with a key.
+ *
+ * @param [in] ctx  The SHA1 context objects.
+ * @param [in] key  The key data.
+ * @param [in] len  The length of the key data.
+ * @return  1 to indicate success.
+ */
+int hmac_sha1_ni_init(HASH_SHA1 *ctx, const void *key, size_t len)
+{
+    HMAC_INIT(ctx, key, len, HASH_SHA1_LEN, hash_sha1_init,
+        hash_sha1_ni_update, hash_sha1_ni_final);
+    return 1;
+}
+
+/**
+ * Finalize the HMAC-SHA-1 operation.
+ * Output 160 bits or 20 bytes.
+ *
+ * @param [in] md   The MAC data buffer.
+ * @param [in] ctx  The SHA1 context objects.
+ * @return  1 to indicate success.
+ */
+int hmac_sha1_ni_final(unsigned char *md, HASH_SHA1 *ctx)
+{
+    HMAC_FINAL(md, ctx, HASH_SHA1_LEN, hash_sha1_ni_update,
+        hash_sha1_ni_final);
+    return 1;
+}
+
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-1.
+ *
+ * @param [in]      ctx   The SHA1 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys.
+ * @param [in]      iter  The total number of iterations.
+ * @return  1 to indicate success.
+ */
+SHA_NI_TARGET
+int hmac_sha1_ni_iterate(HASH_SHA1 **ctx, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    HMAC_ITERATE(HASH_SHA1, ctx, data, cnt, iter, HASH_SHA1_LEN,
+        SHA1_NI_BLOCK);
+    return 1;
+}
+
+/** The constants k to use with SHA-256 block operation (and SHA-224). */
+static const uint32_t hash_sha256_ni_k[] __attribute__((aligned(16))) =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * Four rounds of SHA-256: g is the group of rounds (0-15).
+ * The message schedule of later groups is calculated in the same step.
+ */
+#define SHA256_NI_G(g)							\
+do									\
+{									\
+    __m128i t;								\
+									\
+    t = _mm_add_epi32(w[(g) & 3],					\
+        _mm_load_si128((const __m128i *)&hash_sha256_ni_k[(g) * 4]));	\
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, t);			\
+    if ((g >= 3) && (g <= 14))						\
+    {									\
+        __m128i x = _mm_alignr_epi8(w[(g) & 3], w[((g)+3) & 3], 4);	\
+        w[((g)+1) & 3] = _mm_add_epi32(w[((g)+1) & 3], x);		\
+        w[((g)+1) & 3] = _mm_sha256msg2_epu32(w[((g)+1) & 3], w[(g) & 3]); \
+    }									\
+    t = _mm_shuffle_epi32(t, 0x0e);					\
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, t);			\
+    if ((g >= 1) && (g <= 12))						\
+        w[((g)+3) & 3] = _mm_sha256msg1_epu32(w[((g)+3) & 3], w[(g) & 3]); \
+}									\
+while (0)
+
+/**
+ * Process blocks of data (512 bits) for SHA-256.
+ *
+ * @param [in] h  The SHA-256 state.
+ * @param [in] m  The message data to digest.
+ * @param [in] n  The number of blocks to process.
+ */
+SHA_NI_TARGET
+static void hash_sha256_ni_blocks(uint32_t *h, const uint8_t *m, size_t n)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                        0x0405060700010203ULL);
+    __m128i abef, abef_save, cdgh, cdgh_save, t;
+    __m128i w[4];
+    int i;
+
+    /* Reorder state: DCBA, HGFE -> ABEF, CDGH */
+    t = _mm_loadu_si128((const __m128i *)&h[0]);
+    cdgh = _mm_loadu_si128((const __m128i *)&h[4]);
+    t = _mm_shuffle_epi32(t, 0xb1);
+    cdgh = _mm_shuffle_epi32(cdgh, 0x1b);
+    abef = _mm_alignr_epi8(t, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, t, 0xf0);
+
+    for (; n > 0; n--, m += BLOCK_SIZE)
+    {
+        abef_save = abef;
+        cdgh_save = cdgh;
+
+        for (i=0; i<4; i++)
+        {
+            w[i] = _mm_loadu_si128((const __m128i *)(m + i * 16));
+            w[i] = _mm_shuffle_epi8(w[i], mask);
+        }
+
+        SHA256_NI_G( 0); SHA256_NI_G( 1); SHA256_NI_G( 2); SHA256_NI_G( 3);
+        SHA256_NI_G( 4); SHA256_NI_G( 5); SHA256_NI_G( 6); SHA256_NI_G( 7);
+        SHA256_NI_G( 8); SHA256_NI_G( 9); SHA256_NI_G(10); SHA256_NI_G(11);
+        SHA256_NI_G(12); SHA256_NI_G(13); SHA256_NI_G(14); SHA256_NI_G(15);
+
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+    }
+
+    /* Reorder state: ABEF, CDGH -> DCBA, HGFE */
+    t = _mm_shuffle_epi32(abef, 0x1b);
+    cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+    abef = _mm_blend_epi16(t, cdgh, 0xf0);
+    cdgh = _mm_alignr_epi8(cdgh, t, 8);
+    _mm_storeu_si128((__m128i *)&h[0], abef);
+    _mm_storeu_si128((__m128i *)&h[4], cdgh);
+}
+
+/** Process one block of data into the state of a SHA-256 context. */
+#define SHA256_NI_BLOCK(ctx, m)	hash_sha256_ni_blocks((ctx)->h, m, 1)
+
+/**
+ * Update the message digest with more data.
+ *
+ * @param [in] ctx   The SHA256 context object.
+ * @param [in] data  The data to digest.
+ * @param [in] len   The length of the data to digest.
+ * @return  1 to indicate success.
+ */
+int hash_sha256_ni_update(HASH_SHA256 *ctx, const void *data, size_t len)
+{
+    SHA_NI_UPDATE(ctx, data, len, hash_sha256_ni_blocks);
+    return 1;
+}
+
+/**
+ * Finalize the message digest for SHA-224.
+ * Output 224 bits or 28 bytes.
+ *
+ * @param [in] md   The message digest buffer.
+ * @param [in] ctx  The SHA256 context object.
+ * @return  1 to indicate success.
+ */
+int hash_sha224_ni_final(unsigned char *md, HASH_SHA256 *ctx)
+{
+    uint8_t i, j;
+    uint32_t *h = ctx->h;
+
+    SHA_NI_FIN(ctx, hash_sha256_ni_blocks);
+
+    for (i=0; i<7; i++)
+        for (j=0; j<4; j++)
+            md[i*4+j] = h[i] >> ((3-j)*8);
+
+    return 1;
+}
+
+/**
+ * Finalize the message digest for SHA-256.
+ * Output 256 bits or 32 bytes.
+ *
+ * @param [in] md   The message digest buffer.
+ * @param [in] ctx  The SHA256 context object.
+ * @return  1 to indicate success.
+ */
+int hash_sha256_ni_final(unsigned char *md, HASH_SHA256 *ctx)
+{
+    uint8_t i, j;
+    uint32_t *h = ctx->h;
+
+    SHA_NI_FIN(ctx, hash_sha256_ni_blocks);
+
+    for (i=0; i<8; i++)
+        for (j=0; j<4; j++)
+            md[i*4+j] = h[i] >> ((3-j)*8);
+
+    return 1;
+}
+
+/**
+ * Initialize the HMAC-SHA-224 operation with a key.
+ *
+ * @param [in] ctx  The SHA256 context objects.
+ * @param [in] key  The key data.
+ * @param [in] len  The length of the key data.
+ * @return  1 to indicate success.
+ */
+int hmac_sha224_ni_init(HASH_SHA256 *ctx, const void *key, size_t len)
+{
+    HMAC_INIT(ctx, key, len, HASH_SHA224_LEN, hash_sha224_init,
+        hash_sha256_ni_update, hash_sha224_ni_final);
+    return 1;
+}
+
+/**
+ * Finalize the HMAC-SHA-224 operation.
+ * Output 224 bits or 28 bytes.
+ *
+ * @param [in] md   The MAC data buffer.
+ * @param [in] ctx  The SHA256 context objects.
+ * @return  1 to indicate success.
+ */
+int hmac_sha224_ni_final(unsigned char *md, HASH_SHA256 *ctx)
+{
+    HMAC_FINAL(md, ctx, HASH_SHA224_LEN, hash_sha256_ni_update,
+        hash_sha224_ni_final);
+    return 1;
+}
+
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-224.
+ *
+ * @param [in]      ctx   The SHA256 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys.
+ * @param [in]      iter  The total number of iterations.
+ * @return  1 to indicate success.
+ */
+SHA_NI_TARGET
+int hmac_sha224_ni_iterate(HASH_SHA256 **ctx, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    HMAC_ITERATE(HASH_SHA256, ctx, data, cnt, iter, HASH_SHA224_LEN,
+        SHA256_NI_BLOCK);
+    return 1;
+}
+
+/**
+ * Initialize the HMAC-SHA-256 operation with a key.
+ *
+ * @param [in] ctx  The SHA256 context objects.
+ * @param [in] key  The key data.
+ * @param [in] len  The length of the key data.
+ * @return  1 to indicate success.
+ */
+int hmac_sha256_ni_init(HASH_SHA256 *ctx, const void *key, size_t len)
+{
+    HMAC_INIT(ctx, key, len, HASH_SHA256_LEN, hash_sha256_init,
+        hash_sha256_ni_update, hash_sha256_ni_final);
+    return 1;
+}
+
+/**
+ * Finalize the HMAC-SHA-256 operation.
+ * Output 256 bits or 32 bytes.
+ *
+ * @param [in] md   The MAC data buffer.
+ * @param [in] ctx  The SHA256 context objects.
+ * @return  1 to indicate success.
+ */
+int hmac_sha256_ni_final(unsigned char *md, HASH_SHA256 *ctx)
+{
+    HMAC_FINAL(md, ctx, HASH_SHA256_LEN, hash_sha256_ni_update,
+        hash_sha256_ni_final);
+    return 1;
+}
+
+/**
+ * Perform the PBKDF2 iterations after the first with HMAC-SHA-256.
+ *
+ * @param [in]      ctx   The SHA256 context objects of each key. Only read.
+ * @param [in, out] data  The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt   The number of keys.
+ * @param [in]      iter  The total number of iterations.
+ * @return  1 to indicate success.
+ */
+SHA_NI_TARGET
+int hmac_sha256_ni_iterate(HASH_SHA256 **ctx, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    HMAC_ITERATE(HASH_SHA256, ctx, data, cnt, iter, HASH_SHA256_LEN,
+        SHA256_NI_BLOCK);
+    return 1;
+}
+
+#endif /* CPU_X86_64 */
+
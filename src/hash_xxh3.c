@@ -0,0 +1,1104 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * XXH3 non-cryptographic hash with the default secret and a seed of 0.
+ * Messages of up to 240 bytes are mixed directly with the secret. Longer
+ * messages are split into stripes of 64 bytes that are accumulated into eight
+ * 64-bit lanes, and the lanes are scrambled after each block of 16 stripes.
+ * Only accumulating stripes differs between implementations: SSE2 works on
+ * two lanes at a time and AVX2 on four.
+ * Collisions are easy to construct - never use where the data is chosen by an
+ * attacker.
+ */
+
+#include <string.h>
+#include "hash_xxh3.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+/** Compile the function for AVX2. */
+#define AVX2_TARGET	__attribute__((target("avx2")))
+#endif
+
+/** 128-bit unsigned integer for the products. */
+__extension__ typedef unsigned __int128 xxh3_u128;
+
+/** The length of a stripe of message accumulated at once. */
+#define XXH3_STRIPE_LEN		64
+/** The length of the secret. */
+#define XXH3_SECRET_LEN		192
+/** The number of stripes in a block - the secret moves 8 bytes a stripe. */
+#define XXH3_STRIPES		((XXH3_SECRET_LEN - XXH3_STRIPE_LEN) / 8)
+/** The longest message that is not accumulated in stripes. */
+#define XXH3_MID_MAX		240
+/** Offset into the secret for scrambling the lanes. */
+#define XXH3_SCRAMBLE_OFF	(XXH3_SECRET_LEN - XXH3_STRIPE_LEN)
+/** Offset into the secret for accumulating the last stripe. */
+#define XXH3_LAST_OFF		(XXH3_SECRET_LEN - XXH3_STRIPE_LEN - 7)
+/** Offset into the secret for merging the lanes into the low 64 bits. */
+#define XXH3_MERGE_OFF		11
+
+#define PRIME32_1	0x9e3779b1U
+#define PRIME32_2	0x85ebca77U
+#define PRIME32_3	0xc2b2ae3dU
+#define PRIME64_1	0x9e3779b185ebca87ULL
+#define PRIME64_2	0xc2b2ae3d27d4eb4fULL
+#define PRIME64_3	0x165667b19e3779f9ULL
+#define PRIME64_4	0x85ebca77c2b2ae63ULL
+#define PRIME64_5	0x27d4eb2f165667c5ULL
+#define PRIME_MX1	0x165667919e3779f9ULL
+#define PRIME_MX2	0x9fb21c651e98df25ULL
+
+/** Load a 32-bit number from little-endian bytes. */
+#define LE32(p)								\
+    (((uint32_t)(p)[0]      ) | ((uint32_t)(p)[1] <<  8) |		\
+     ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+/** Load a 64-bit number from little-endian bytes. */
+#define LE64(p)								\
+    (((uint64_t)(p)[0]      ) | ((uint64_t)(p)[1] <<  8) |		\
+     ((uint64_t)(p)[2] << 16) | ((uint64_t)(p)[3] << 24) |		\
+     ((uint64_t)(p)[4] << 32) | ((uint64_t)(p)[5] << 40) |		\
+     ((uint64_t)(p)[6] << 48) | ((uint64_t)(p)[7] << 56))
+
+/** The default secret. */
+static const uint8_t xxh3_secret[XXH3_SECRET_LEN] =
+{
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe,
+    0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78,
+    0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e,
+    0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e,
+    0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f,
+    0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3,
+    0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49,
+    0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28,
+    0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+/**
+ * Accumulate stripes of message into the lanes.
+ *
+ * @param [in] acc     The eight lanes.
+ * @param [in] in      The stripes of message.
+ * @param [in] secret  The secret for the first stripe - 8 bytes on a stripe.
+ * @param [in] cnt     The number of stripes.
+ */
+typedef void XXH3_ACCUM(uint64_t *acc, const uint8_t *in,
+    const uint8_t *secret, size_t cnt);
+
+/**
+ * Multiply two 64-bit numbers and fold the 128-bit product into 64 bits.
+ *
+ * @param [in] a  The first number.
+ * @param [in] b  The second number.
+ * @return  The low and high halves of the product XORed.
+ */
+static inline uint64_t xxh3_mul_fold(uint64_t a, uint64_t b)
+{
+    xxh3_u128 p = (xxh3_u128)a * b;
+
+    return (uint64_t)p ^ (uint64_t)(p >> 64);
+}
+
+/**
+ * The final mix of XXH64.
+ *
+ * @param [in] h  The hash value.
+ * @return  The mixed hash value.
+ */
+static inline uint64_t xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/**
+ * The final mix of XXH3.
+ *
+ * @param [in] h  The hash value.
+ * @return  The mixed hash value.
+ */
+static inline uint64_t xxh3_avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+/**
+ * The stronger final mix for 4 to 8 bytes of message.
+ *
+ * @param [in] h    The hash value.
+ * @param [in] len  The length of the message.
+ * @return  The mixed hash value.
+ */
+static inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len)
+{
+    h ^= ((h << 49) | (h >> 15)) ^ ((h << 24) | (h >> 40));
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= PRIME_MX2;
+    h ^= h >> 28;
+    return h;
+}
+
+/**
+ * Mix 16 bytes of message with 16 bytes of secret.
+ *
+ * @param [in] in  The message data.
+ * @param [in] s   The secret.
+ * @return  The mixed value.
+ */
+static inline uint64_t xxh3_mix16(const uint8_t *in, const uint8_t *s)
+{
+    return xxh3_mul_fold(LE64(in) ^ LE64(s), LE64(in + 8) ^ LE64(s + 8));
+}
+
+/**
+ * Calculate the 64-bit hash of up to 16 bytes.
+ *
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  The hash value.
+ */
+static uint64_t xxh3_64_0to16(const uint8_t *in, size_t len)
+{
+    const uint8_t *s = xxh3_secret;
+    uint64_t lo, hi;
+
+    if (len > 8)
+    {
+        lo = LE64(in) ^ (LE64(s + 24) ^ LE64(s + 32));
+        hi = LE64(in + len - 8) ^ (LE64(s + 40) ^ LE64(s + 48));
+        return xxh3_avalanche(len + __builtin_bswap64(lo) + hi +
+            xxh3_mul_fold(lo, hi));
+    }
+    if (len >= 4)
+    {
+        lo = LE32(in + len - 4) + ((uint64_t)LE32(in) << 32);
+        return xxh3_rrmxmx(lo ^ (LE64(s + 8) ^ LE64(s + 16)), len);
+    }
+    if (len > 0)
+    {
+        lo = ((uint32_t)in[0] << 16) | ((uint32_t)in[len >> 1] << 24) |
+             in[len - 1] | ((uint32_t)len << 8);
+        return xxh64_avalanche(lo ^ (LE32(s) ^ LE32(s + 4)));
+    }
+    return xxh64_avalanche(LE64(s + 56) ^ LE64(s + 64));
+}
+
+/**
+ * Calculate the 64-bit hash of 17 to 240 bytes.
+ * Up to 128 bytes, pairs of 16 bytes from each end are mixed in.
+ *
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  The hash value.
+ */
+static uint64_t xxh3_64_17to240(const uint8_t *in, size_t len)
+{
+    const uint8_t *s = xxh3_secret;
+    uint64_t acc = len * PRIME64_1;
+    uint64_t acc_end;
+    size_t i;
+
+    if (len <= 128)
+    {
+        if (len > 32)
+        {
+            if (len > 64)
+            {
+                if (len > 96)
+                {
+                    acc += xxh3_mix16(in + 48, s + 96);
+                    acc += xxh3_mix16(in + len - 64, s + 112);
+                }
+                acc += xxh3_mix16(in + 32, s + 64);
+                acc += xxh3_mix16(in + len - 48, s + 80);
+            }
+            acc += xxh3_mix16(in + 16, s + 32);
+            acc += xxh3_mix16(in + len - 32, s + 48);
+        }
+        acc += xxh3_mix16(in, s);
+        acc += xxh3_mix16(in + len - 16, s + 16);
+        return xxh3_avalanche(acc);
+    }
+
+    for (i=0; i<8; i++)
+        acc += xxh3_mix16(in + 16 * i, s + 16 * i);
+    acc_end = xxh3_mix16(in + len - 16, s + 136 - 17);
+    acc = xxh3_avalanche(acc);
+    for (i=8; i<len/16; i++)
+        acc_end += xxh3_mix16(in + 16 * i, s + 16 * (i - 8) + 3);
+    return xxh3_avalanche(acc + acc_end);
+}
+
+/**
+ * Calculate the 128-bit hash of up to 16 bytes.
+ *
+ * @param [in]  in   The message data.
+ * @param [in]  len  The length of the message data.
+ * @param [out] h    The low and high 64 bits of the hash value.
+ */
+static void xxh3_128_0to16(const uint8_t *in, size_t len, uint64_t *h)
+{
+    const uint8_t *s = xxh3_secret;
+    uint32_t c, r;
+    uint64_t lo, hi;
+    xxh3_u128 m, p;
+
+    if (len > 8)
+    {
+        lo = LE64(in);
+        hi = LE64(in + len - 8);
+        m = (xxh3_u128)(lo ^ hi ^ LE64(s + 32) ^ LE64(s + 40)) * PRIME64_1;
+        lo = (uint64_t)m + ((uint64_t)(len - 1) << 54);
+        hi ^= LE64(s + 48) ^ LE64(s + 56);
+        hi += (uint64_t)(m >> 64) + (uint64_t)(uint32_t)hi * (PRIME32_2 - 1);
+        lo ^= __builtin_bswap64(hi);
+        p = (xxh3_u128)lo * PRIME64_2;
+        h[0] = xxh3_avalanche((uint64_t)p);
+        h[1] = xxh3_avalanche((uint64_t)(p >> 64) + hi * PRIME64_2);
+    }
+    else if (len >= 4)
+    {
+        lo = LE32(in) + ((uint64_t)LE32(in + len - 4) << 32);
+        lo ^= LE64(s + 16) ^ LE64(s + 24);
+        m = (xxh3_u128)lo * (PRIME64_1 + (len << 2));
+        hi = (uint64_t)(m >> 64);
+        lo = (uint64_t)m;
+        hi += lo << 1;
+        lo ^= hi >> 3;
+        lo ^= lo >> 35;
+        lo *= PRIME_MX2;
+        lo ^= lo >> 28;
+        h[0] = lo;
+        h[1] = xxh3_avalanche(hi);
+    }
+    else if (len > 0)
+    {
+        c = ((uint32_t)in[0] << 16) | ((uint32_t)in[len >> 1] << 24) |
+            in[len - 1] | ((uint32_t)len << 8);
+        r = __builtin_bswap32(c);
+        r = (r << 13) | (r >> 19);
+        h[0] = xxh64_avalanche(c ^ (uint64_t)(LE32(s) ^ LE32(s + 4)));
+        h[1] = xxh64_avalanche(r ^ (uint64_t)(LE32(s + 8) ^ LE32(s + 12)));
+    }
+    else
+    {
+        h[0] = xxh64_avalanche(LE64(s + 64) ^ LE64(s + 72));
+        h[1] = xxh64_avalanche(LE64(s + 80) ^ LE64(s + 88));
+    }
+}
+
+/**
+ * Mix two 16 byte pieces of message into the 128-bit accumulator.
+ *
+ * @param [in] acc  The low and high 64 bits of the accumulator.
+ * @param [in] a    The first 16 bytes of message data.
+ * @param [in] b    The second 16 bytes of message data.
+ * @param [in] s    The 32 bytes of secret.
+ */
+static inline void xxh3_mix32(uint64_t *acc, const uint8_t *a,
+    const uint8_t *b, const uint8_t *s)
+{
+    acc[0] += xxh3_mix16(a, s);
+    acc[0] ^= LE64(b) + LE64(b + 8);
+    acc[1] += xxh3_mix16(b, s + 16);
+    acc[1] ^= LE64(a) + LE64(a + 8);
+}
+
+/**
+ * Calculate the 128-bit hash of 17 to 240 bytes.
+ *
+ * @param [in]  in   The message data.
+ * @param [in]  len  The length of the message data.
+ * @param [out] h    The low and high 64 bits of the hash value.
+ */
+static void xxh3_128_17to240(const uint8_t *in, size_t len, uint64_t *h)
+{
+    const uint8_t *s = xxh3_secret;
+    uint64_t acc[2] = { len * PRIME64_1, 0 };
+    size_t i;
+
+    if (len <= 128)
+    {
+        if (len > 32)
+        {
+            if (len > 64)
+            {
+                if (len > 96)
+                    xxh3_mix32(acc, in + 48, in + len - 64, s + 96);
+                xxh3_mix32(acc, in + 32, in + len - 48, s + 64);
+            }
+            xxh3_mix32(acc, in + 16, in + len - 32, s + 32);
+        }
+        xxh3_mix32(acc, in, in + len - 16, s);
+    }
+    else
+    {
+        for (i=32; i<160; i+=32)
+            xxh3_mix32(acc, in + i - 32, in + i - 16, s + i - 32);
+        acc[0] = xxh3_avalanche(acc[0]);
+        acc[1] = xxh3_avalanche(acc[1]);
+        for (i=160; i<=len; i+=32)
+            xxh3_mix32(acc, in + i - 32, in + i - 16, s + 3 + i - 160);
+        xxh3_mix32(acc, in + len - 16, in + len - 32, s + 136 - 17 - 16);
+    }
+
+    h[0] = xxh3_avalanche(acc[0] + acc[1]);
+    h[1] = 0 - xxh3_avalanche(acc[0] * PRIME64_1 + acc[1] * PRIME64_4 +
+        len * PRIME64_2);
+}
+
+/**
+ * Accumulate stripes of message into the lanes with portable code.
+ *
+ * @param [in] acc     The eight lanes.
+ * @param [in] in      The stripes of message.
+ * @param [in] secret  The secret for the first stripe.
+ * @param [in] cnt     The number of stripes.
+ */
+static void xxh3_c_accum(uint64_t *acc, const uint8_t *in,
+    const uint8_t *secret, size_t cnt)
+{
+    size_t n;
+    int i;
+    uint64_t d, k;
+
+    for (n=0; n<cnt; n++)
+    {
+        for (i=0; i<8; i++)
+        {
+            d = LE64(in + 8 * i);
+            k = d ^ LE64(secret + 8 * i);
+            acc[i ^ 1] += d;
+            acc[i] += (k & 0xffffffff) * (k >> 32);
+        }
+        in += XXH3_STRIPE_LEN;
+        secret += 8;
+    }
+}
+
+/**
+ * Scramble the lanes at the end of a block.
+ *
+ * @param [in] acc  The eight lanes.
+ */
+static void xxh3_scramble(uint64_t *acc)
+{
+    const uint8_t *s = xxh3_secret + XXH3_SCRAMBLE_OFF;
+    int i;
+
+    for (i=0; i<8; i++)
+    {
+        acc[i] ^= acc[i] >> 47;
+        acc[i] ^= LE64(s + 8 * i);
+        acc[i] *= PRIME32_1;
+    }
+}
+
+/**
+ * Accumulate stripes, scrambling the lanes each time a block is complete.
+ *
+ * @param [in] acc    The eight lanes.
+ * @param [in] s      The number of stripes into the current block.
+ * @param [in] in     The stripes of message.
+ * @param [in] cnt    The number of stripes.
+ * @param [in] accum  The function accumulating stripes.
+ */
+static void xxh3_stripes(uint64_t *acc, size_t *s, const uint8_t *in,
+    size_t cnt, XXH3_ACCUM *accum)
+{
+    size_t l = XXH3_STRIPES - *s;
+
+    while (cnt >= l)
+    {
+        accum(acc, in, xxh3_secret + *s * 8, l);
+        xxh3_scramble(acc);
+        in += l * XXH3_STRIPE_LEN;
+        cnt -= l;
+        *s = 0;
+        l = XXH3_STRIPES;
+    }
+    if (cnt > 0)
+    {
+        accum(acc, in, xxh3_secret + *s * 8, cnt);
+        *s += cnt;
+    }
+}
+
+/**
+ * Set the lanes to their initial values.
+ *
+ * @param [in] acc  The eight lanes.
+ */
+static void xxh3_acc_init(uint64_t *acc)
+{
+    acc[0] = PRIME32_3;
+    acc[1] = PRIME64_1;
+    acc[2] = PRIME64_2;
+    acc[3] = PRIME64_3;
+    acc[4] = PRIME64_4;
+    acc[5] = PRIME32_2;
+    acc[6] = PRIME64_5;
+    acc[7] = PRIME32_1;
+}
+
+/**
+ * Accumulate a message of more than 240 bytes in one call.
+ * The last stripe always ends at the end of the message and may overlap the
+ * stripe before.
+ *
+ * @param [in] acc    The eight lanes.
+ * @param [in] in     The message data.
+ * @param [in] len    The length of the message data.
+ * @param [in] accum  The function accumulating stripes.
+ */
+static void xxh3_long(uint64_t *acc, const uint8_t *in, size_t len,
+    XXH3_ACCUM *accum)
+{
+    size_t s = 0;
+
+    xxh3_acc_init(acc);
+    xxh3_stripes(acc, &s, in, (len - 1) / XXH3_STRIPE_LEN, accum);
+    accum(acc, in + len - XXH3_STRIPE_LEN, xxh3_secret + XXH3_LAST_OFF, 1);
+}
+
+/**
+ * Merge the lanes into a 64-bit hash value.
+ *
+ * @param [in] acc    The eight lanes.
+ * @param [in] s      The secret to mix with.
+ * @param [in] start  The starting value.
+ * @return  The hash value.
+ */
+static uint64_t xxh3_merge(const uint64_t *acc, const uint8_t *s,
+    uint64_t start)
+{
+    int i;
+
+    for (i=0; i<4; i++)
+    {
+        start += xxh3_mul_fold(acc[2 * i] ^ LE64(s + 16 * i),
+            acc[2 * i + 1] ^ LE64(s + 16 * i + 8));
+    }
+    return xxh3_avalanche(start);
+}
+
+/**
+ * Put a 64-bit hash value into big-endian bytes - the canonical form.
+ *
+ * @param [in] md  The buffer to hold the bytes.
+ * @param [in] h   The hash value.
+ */
+static void xxh3_out(unsigned char *md, uint64_t h)
+{
+    int i;
+
+    for (i=0; i<8; i++)
+        md[i] = h >> ((7 - i) * 8);
+}
+
+/**
+ * Get a 64-bit number from big-endian bytes.
+ *
+ * @param [in] p  The bytes.
+ * @return  The number.
+ */
+static uint64_t xxh3_in(const unsigned char *p)
+{
+    uint64_t h = 0;
+    int i;
+
+    for (i=0; i<8; i++)
+        h = (h << 8) | p[i];
+    return h;
+}
+
+/**
+ * Calculate the 64-bit digest of a message in one call.
+ *
+ * @param [in] md     The buffer to hold the digest.
+ * @param [in] in     The message data.
+ * @param [in] len    The length of the message data.
+ * @param [in] accum  The function accumulating stripes.
+ */
+static void xxh3_64_digest(unsigned char *md, const uint8_t *in, size_t len,
+    XXH3_ACCUM *accum)
+{
+    uint64_t acc[8];
+
+    if (len <= 16)
+        xxh3_out(md, xxh3_64_0to16(in, len));
+    else if (len <= XXH3_MID_MAX)
+        xxh3_out(md, xxh3_64_17to240(in, len));
+    else
+    {
+        xxh3_long(acc, in, len, accum);
+        xxh3_out(md, xxh3_merge(acc, xxh3_secret + XXH3_MERGE_OFF,
+            len * PRIME64_1));
+    }
+}
+
+/**
+ * Merge the lanes into a 128-bit digest.
+ *
+ * @param [in] md   The buffer to hold the digest.
+ * @param [in] acc  The eight lanes.
+ * @param [in] len  The length of the message data.
+ */
+static void xxh3_128_merge(unsigned char *md, const uint64_t *acc,
+    uint64_t len)
+{
+    xxh3_out(md, xxh3_merge(acc, xxh3_secret + XXH3_SECRET_LEN - 64 -
+        XXH3_MERGE_OFF, ~(len * PRIME64_2)));
+    xxh3_out(md + 8, xxh3_merge(acc, xxh3_secret + XXH3_MERGE_OFF,
+        len * PRIME64_1));
+}
+
+/**
+ * Calculate the 128-bit digest of a message in one call.
+ * The high 64 bits are output first.
+ *
+ * @param [in] md     The buffer to hold the digest.
+ * @param [in] in     The message data.
+ * @param [in] len    The length of the message data.
+ * @param [in] accum  The function accumulating stripes.
+ */
+static void xxh3_128_digest(unsigned char *md, const uint8_t *in, size_t len,
+    XXH3_ACCUM *accum)
+{
+    uint64_t acc[8];
+    uint64_t h[2];
+
+    if (len > XXH3_MID_MAX)
+    {
+        xxh3_long(acc, in, len, accum);
+        xxh3_128_merge(md, acc, len);
+        return;
+    }
+
+    if (len <= 16)
+        xxh3_128_0to16(in, len, h);
+    else
+        xxh3_128_17to240(in, len, h);
+    xxh3_out(md, h[1]);
+    xxh3_out(md + 8, h[0]);
+}
+
+/**
+ * Update the XXH3 operation with message data.
+ * The cache is only emptied when more data arrives so that the last stripe
+ * and short messages are always available to finalization.
+ *
+ * @param [in] ctx    The XXH3 context.
+ * @param [in] in     The message data.
+ * @param [in] len    The length of the message data.
+ * @param [in] accum  The function accumulating stripes.
+ */
+static void xxh3_update(HASH_XXH3 *ctx, const uint8_t *in, size_t len,
+    XXH3_ACCUM *accum)
+{
+    size_t l, cnt;
+    size_t s = ctx->s;
+
+    ctx->n += len;
+    if (len <= (size_t)(HASH_XXH3_BUF_LEN - ctx->i))
+    {
+        memcpy(ctx->b + ctx->i, in, len);
+        ctx->i += len;
+        return;
+    }
+
+    if (ctx->i > 0)
+    {
+        l = HASH_XXH3_BUF_LEN - ctx->i;
+        memcpy(ctx->b + ctx->i, in, l);
+        in += l;
+        len -= l;
+        xxh3_stripes(ctx->acc, &s, ctx->b,
+            HASH_XXH3_BUF_LEN / XXH3_STRIPE_LEN, accum);
+    }
+    if (len > HASH_XXH3_BUF_LEN)
+    {
+        cnt = (len - 1) / XXH3_STRIPE_LEN;
+        xxh3_stripes(ctx->acc, &s, in, cnt, accum);
+        in += cnt * XXH3_STRIPE_LEN;
+        len -= cnt * XXH3_STRIPE_LEN;
+        /* Keep the last stripe in case less than a stripe is left. */
+        memcpy(ctx->b + HASH_XXH3_BUF_LEN - XXH3_STRIPE_LEN,
+            in - XXH3_STRIPE_LEN, XXH3_STRIPE_LEN);
+    }
+    memcpy(ctx->b, in, len);
+    ctx->i = len;
+    ctx->s = s;
+}
+
+/**
+ * Accumulate the cached data of a long message into a copy of the lanes.
+ * The context is not changed so that more data can still be added.
+ *
+ * @param [in]  ctx    The XXH3 context.
+ * @param [out] acc    The eight lanes.
+ * @param [in]  accum  The function accumulating stripes.
+ */
+static void xxh3_final_acc(HASH_XXH3 *ctx, uint64_t *acc, XXH3_ACCUM *accum)
+{
+    uint8_t last[XXH3_STRIPE_LEN];
+    const uint8_t *p;
+    size_t s = ctx->s;
+    size_t l;
+
+    memcpy(acc, ctx->acc, sizeof(ctx->acc));
+    if (ctx->i >= XXH3_STRIPE_LEN)
+    {
+        xxh3_stripes(acc, &s, ctx->b, (ctx->i - 1) / XXH3_STRIPE_LEN,
+            accum);
+        p = ctx->b + ctx->i - XXH3_STRIPE_LEN;
+    }
+    else
+    {
+        /* Last stripe starts in the data accumulated before. */
+        l = XXH3_STRIPE_LEN - ctx->i;
+        memcpy(last, ctx->b + HASH_XXH3_BUF_LEN - l, l);
+        memcpy(last + l, ctx->b, ctx->i);
+        p = last;
+    }
+    accum(acc, p, xxh3_secret + XXH3_LAST_OFF, 1);
+}
+
+/**
+ * Output the 64-bit digest of the data seen by the XXH3 operation.
+ *
+ * @param [in] md     The buffer to hold the digest.
+ * @param [in] ctx    The XXH3 context.
+ * @param [in] accum  The function accumulating stripes.
+ */
+static void xxh3_64_final(unsigned char *md, HASH_XXH3 *ctx,
+    XXH3_ACCUM *accum)
+{
+    uint64_t acc[8];
+
+    if (ctx->n <= XXH3_MID_MAX)
+        xxh3_64_digest(md, ctx->b, ctx->n, accum);
+    else
+    {
+        xxh3_final_acc(ctx, acc, accum);
+        xxh3_out(md, xxh3_merge(acc, xxh3_secret + XXH3_MERGE_OFF,
+            ctx->n * PRIME64_1));
+    }
+}
+
+/**
+ * Output the 128-bit digest of the data seen by the XXH3 operation.
+ *
+ * @param [in] md     The buffer to hold the digest.
+ * @param [in] ctx    The XXH3 context.
+ * @param [in] accum  The function accumulating stripes.
+ */
+static void xxh3_128_final(unsigned char *md, HASH_XXH3 *ctx,
+    XXH3_ACCUM *accum)
+{
+    uint64_t acc[8];
+
+    if (ctx->n <= XXH3_MID_MAX)
+        xxh3_128_digest(md, ctx->b, ctx->n, accum);
+    else
+    {
+        xxh3_final_acc(ctx, acc, accum);
+        xxh3_128_merge(md, acc, ctx->n);
+    }
+}
+
+/**
+ * Initialize the XXH3 operation.
+ *
+ * @param [in] ctx  The XXH3 context.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_init(HASH_XXH3 *ctx)
+{
+    xxh3_acc_init(ctx->acc);
+    ctx->n = 0;
+    ctx->i = 0;
+    ctx->s = 0;
+    return 1;
+}
+
+/**
+ * Update the XXH3 operation with message data.
+ *
+ * @param [in] ctx  The XXH3 context.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_update(HASH_XXH3 *ctx, const void *in, size_t len)
+{
+    xxh3_update(ctx, in, len, &xxh3_c_accum);
+    return 1;
+}
+
+/**
+ * Finalize the XXH3 operation and output the 64-bit digest.
+ *
+ * @param [in] md   The buffer to hold the digest of 8 bytes.
+ * @param [in] ctx  The XXH3 context.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_64_final(unsigned char *md, HASH_XXH3 *ctx)
+{
+    xxh3_64_final(md, ctx, &xxh3_c_accum);
+    return 1;
+}
+
+/**
+ * Finalize the XXH3 operation and output the 128-bit digest.
+ *
+ * @param [in] md   The buffer to hold the digest of 16 bytes.
+ * @param [in] ctx  The XXH3 context.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_128_final(unsigned char *md, HASH_XXH3 *ctx)
+{
+    xxh3_128_final(md, ctx, &xxh3_c_accum);
+    return 1;
+}
+
+/**
+ * Calculate the XXH3 64-bit digest of a message in one call.
+ *
+ * @param [in] md   The buffer to hold the digest of 8 bytes.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_64_digest(unsigned char *md, const void *in, size_t len)
+{
+    xxh3_64_digest(md, in, len, &xxh3_c_accum);
+    return 1;
+}
+
+/**
+ * Calculate the XXH3 128-bit digest of a message in one call.
+ *
+ * @param [in] md   The buffer to hold the digest of 16 bytes.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_128_digest(unsigned char *md, const void *in, size_t len)
+{
+    xxh3_128_digest(md, in, len, &xxh3_c_accum);
+    return 1;
+}
+
+/**
+ * Export the XXH3 state in a portable format.
+ * The whole cache is exported as the last stripe may be needed from it.
+ *
+ * @param [in] data  The buffer to hold HASH_XXH3_STATE_LEN bytes.
+ * @param [in] ctx   The XXH3 context.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_export(unsigned char *data, HASH_XXH3 *ctx)
+{
+    int i;
+
+    for (i=0; i<8; i++)
+        xxh3_out(data + i * 8, ctx->acc[i]);
+    data += 64;
+    xxh3_out(data, ctx->n);
+    data += 8;
+    *(data++) = ctx->s;
+    *(data++) = ctx->i >> 8;
+    *(data++) = ctx->i;
+    memcpy(data, ctx->b, HASH_XXH3_BUF_LEN);
+
+    return 1;
+}
+
+/**
+ * Import the XXH3 state from the portable format.
+ *
+ * @param [in] ctx   The XXH3 context.
+ * @param [in] data  The exported state of HASH_XXH3_STATE_LEN bytes.
+ * @return  0 when the state is invalid.<br>
+ *          1 otherwise.
+ */
+int hash_xxh3_import(HASH_XXH3 *ctx, const unsigned char *data)
+{
+    int i;
+    uint16_t l = ((uint16_t)data[73] << 8) | data[74];
+
+    /* A full cache is kept until more data is seen. */
+    if ((data[72] >= XXH3_STRIPES) || (l > HASH_XXH3_BUF_LEN))
+        return 0;
+
+    for (i=0; i<8; i++)
+        ctx->acc[i] = xxh3_in(data + i * 8);
+    data += 64;
+    ctx->n = xxh3_in(data);
+    data += 8;
+    ctx->s = *(data++);
+    ctx->i = l;
+    data += 2;
+    memcpy(ctx->b, data, HASH_XXH3_BUF_LEN);
+
+    return 1;
+}
+
+#ifdef CPU_X86_64
+/**
+ * Accumulate stripes of message into the lanes with SSE2 - two lanes at a
+ * time.
+ *
+ * @param [in] acc     The eight lanes.
+ * @param [in] in      The stripes of message.
+ * @param [in] secret  The secret for the first stripe.
+ * @param [in] cnt     The number of stripes.
+ */
+static void xxh3_sse2_accum(uint64_t *acc, const uint8_t *in,
+    const uint8_t *secret, size_t cnt)
+{
+    __m128i a[4], d, k;
+    size_t n;
+    int i;
+
+    for (i=0; i<4; i++)
+        a[i] = _mm_loadu_si128((const __m128i *)acc + i);
+    for (n=0; n<cnt; n++)
+    {
+        for (i=0; i<4; i++)
+        {
+            d = _mm_loadu_si128((const __m128i *)in + i);
+            k = _mm_xor_si128(d,
+                _mm_loadu_si128((const __m128i *)secret + i));
+            /* Product of the low and high 32 bits of each key. */
+            k = _mm_mul_epu32(k, _mm_shuffle_epi32(k, 0x31));
+            /* Message words are added to the other lane of the pair. */
+            a[i] = _mm_add_epi64(a[i], _mm_shuffle_epi32(d, 0x4e));
+            a[i] = _mm_add_epi64(a[i], k);
+        }
+        in += XXH3_STRIPE_LEN;
+        secret += 8;
+    }
+    for (i=0; i<4; i++)
+        _mm_storeu_si128((__m128i *)acc + i, a[i]);
+}
+
+/**
+ * Update the XXH3 operation with message data using SSE2.
+ *
+ * @param [in] ctx  The XXH3 context.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_sse2_update(HASH_XXH3 *ctx, const void *in, size_t len)
+{
+    xxh3_update(ctx, in, len, &xxh3_sse2_accum);
+    return 1;
+}
+
+/**
+ * Finalize the XXH3 operation and output the 64-bit digest using SSE2.
+ *
+ * @param [in] md   The buffer to hold the digest of 8 bytes.
+ * @param [in] ctx  The XXH3 context.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_64_sse2_final(unsigned char *md, HASH_XXH3 *ctx)
+{
+    xxh3_64_final(md, ctx, &xxh3_sse2_accum);
+    return 1;
+}
+
+/**
+ * Finalize the XXH3 operation and output the 128-bit digest using SSE2.
+ *
+ * @param [in] md   The buffer to hold the digest of 16 bytes.
+ * @param [in] ctx  The XXH3 context.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_128_sse2_final(unsigned char *md, HASH_XXH3 *ctx)
+{
+    xxh3_128_final(md, ctx, &xxh3_sse2_accum);
+    return 1;
+}
+
+/**
+ * Calculate the XXH3 64-bit digest of a message in one call using SSE2.
+ *
+ * @param [in] md   The buffer to hold the digest of 8 bytes.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_64_sse2_digest(unsigned char *md, const void *in, size_t len)
+{
+    xxh3_64_digest(md, in, len, &xxh3_sse2_accum);
+    return 1;
+}
+
+/**
+ * Calculate the XXH3 128-bit digest of a message in one call using SSE2.
+ *
+ * @param [in] md   The buffer to hold the digest of 16 bytes.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_128_sse2_digest(unsigned char *md, const void *in, size_t len)
+{
+    xxh3_128_digest(md, in, len, &xxh3_sse2_accum);
+    return 1;
+}
+
+/**
+ * Accumulate stripes of message into the lanes with AVX2 - four lanes at a
+ * time.
+ *
+ * @param [in] acc     The eight lanes.
+ * @param [in] in      The stripes of message.
+ * @param [in] secret  The secret for the first stripe.
+ * @param [in] cnt     The number of stripes.
+ */
+AVX2_TARGET
+static void xxh3_avx2_accum(uint64_t *acc, const uint8_t *in,
+    const uint8_t *secret, size_t cnt)
+{
+    __m256i a[2], d, k;
+    size_t n;
+    int i;
+
+    for (i=0; i<2; i++)
+        a[i] = _mm256_loadu_si256((const __m256i *)acc + i);
+    for (n=0; n<cnt; n++)
+    {
+        for (i=0; i<2; i++)
+        {
+            d = _mm256_loadu_si256((const __m256i *)in + i);
+            k = _mm256_xor_si256(d,
+                _mm256_loadu_si256((const __m256i *)secret + i));
+            k = _mm256_mul_epu32(k, _mm256_shuffle_epi32(k, 0x31));
+            a[i] = _mm256_add_epi64(a[i], _mm256_shuffle_epi32(d, 0x4e));
+            a[i] = _mm256_add_epi64(a[i], k);
+        }
+        in += XXH3_STRIPE_LEN;
+        secret += 8;
+    }
+    for (i=0; i<2; i++)
+        _mm256_storeu_si256((__m256i *)acc + i, a[i]);
+}
+
+/**
+ * Update the XXH3 operation with message data using AVX2.
+ *
+ * @param [in] ctx  The XXH3 context.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_avx2_update(HASH_XXH3 *ctx, const void *in, size_t len)
+{
+    xxh3_update(ctx, in, len, &xxh3_avx2_accum);
+    return 1;
+}
+
+/**
+ * Finalize the XXH3 operation and output the 64-bit digest using AVX2.
+ *
+ * @param [in] md   The buffer to hold the digest of 8 bytes.
+ * @param [in] ctx  The XXH3 context.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_64_avx2_final(unsigned char *md, HASH_XXH3 *ctx)
+{
+    xxh3_64_final(md, ctx, &xxh3_avx2_accum);
+    return 1;
+}
+
+/**
+ * Finalize the XXH3 operation and output the 128-bit digest using AVX2.
+ *
+ * @param [in] md   The buffer to hold the digest of 16 bytes.
+ * @param [in] ctx  The XXH3 context.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_128_avx2_final(unsigned char *md, HASH_XXH3 *ctx)
+{
+    xxh3_128_final(md, ctx, &xxh3_avx2_accum);
+    return 1;
+}
+
+/**
+ * Calculate the XXH3 64-bit digest of a message in one call using AVX2.
+ *
+ * @param [in] md   The buffer to hold the digest of 8 bytes.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_64_avx2_digest(unsigned char *md, const void *in, size_t len)
+{
+    xxh3_64_digest(md, in, len, &xxh3_avx2_accum);
+    return 1;
+}
+
+/**
+ * Calculate the XXH3 128-bit digest of a message in one call using AVX2.
+ *
+ * @param [in] md   The buffer to hold the digest of 16 bytes.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int hash_xxh3_128_avx2_digest(unsigned char *md, const void *in, size_t len)
+{
+    xxh3_128_digest(md, in, len, &xxh3_avx2_accum);
+    return 1;
+}
+#endif
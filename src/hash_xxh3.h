@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef HASH_XXH3_H
+#define HASH_XXH3_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** The length of the XXH3-64 digest output. */
+#define HASH_XXH3_64_LEN	8
+/** The length of the XXH3-128 digest output. */
+#define HASH_XXH3_128_LEN	16
+
+/** The length of the data cached before stripes are accumulated. */
+#define HASH_XXH3_BUF_LEN	256
+
+/** The length of the exported XXH3 state. */
+#define HASH_XXH3_STATE_LEN	(64 + 8 + 1 + 2 + HASH_XXH3_BUF_LEN)
+
+/** Data structure for XXH3 - the state is the same for both output sizes. */
+typedef struct hash_xxh3_st
+{
+    /** The accumulators. */
+    uint64_t acc[8];
+    /** Cached message data. */
+    uint8_t b[HASH_XXH3_BUF_LEN];
+    /** Number of bytes seen. */
+    uint64_t n;
+    /** Number of bytes in cache. */
+    uint16_t i;
+    /** Number of stripes accumulated into the current block. */
+    uint8_t s;
+} HASH_XXH3;
+
+int hash_xxh3_init(HASH_XXH3 *ctx);
+int hash_xxh3_update(HASH_XXH3 *ctx, const void *in, size_t len);
+int hash_xxh3_64_final(unsigned char *md, HASH_XXH3 *ctx);
+int hash_xxh3_128_final(unsigned char *md, HASH_XXH3 *ctx);
+int hash_xxh3_64_digest(unsigned char *md, const void *in, size_t len);
+int hash_xxh3_128_digest(unsigned char *md, const void *in, size_t len);
+int hash_xxh3_export(unsigned char *data, HASH_XXH3 *ctx);
+int hash_xxh3_import(HASH_XXH3 *ctx, const unsigned char *data);
+
+#ifdef CPU_X86_64
+int hash_xxh3_sse2_update(HASH_XXH3 *ctx, const void *in, size_t len);
+int hash_xxh3_64_sse2_final(unsigned char *md, HASH_XXH3 *ctx);
+int hash_xxh3_128_sse2_final(unsigned char *md, HASH_XXH3 *ctx);
+int hash_xxh3_64_sse2_digest(unsigned char *md, const void *in, size_t len);
+int hash_xxh3_128_sse2_digest(unsigned char *md, const void *in, size_t len);
+
+int hash_xxh3_avx2_update(HASH_XXH3 *ctx, const void *in, size_t len);
+int hash_xxh3_64_avx2_final(unsigned char *md, HASH_XXH3 *ctx);
+int hash_xxh3_128_avx2_final(unsigned char *md, HASH_XXH3 *ctx);
+int hash_xxh3_64_avx2_digest(unsigned char *md, const void *in, size_t len);
+int hash_xxh3_128_avx2_digest(unsigned char *md, const void *in, size_t len);
+#endif
+
+#endif
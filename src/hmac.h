@@ -67,4 +67,58 @@ do								\
 }								\
 while (0)
 
+/**
+ * Store the first bytes of a digest's state big-endian.
+ *
+ * @param [in] m     The buffer to hold the bytes.
+ * @param [in] h     The state words.
+ * @param [in] dlen  The number of bytes to store.
+ */
+#define HMAC_STORE_H(m, h, dlen)				\
+do								\
+{								\
+    int j;							\
+    for (j=0; j<(dlen); j++)					\
+        m[j] = h[j / sizeof(*h)] >>				\
+            ((sizeof(*h) - 1 - j % sizeof(*h)) * 8);		\
+}								\
+while (0)
+
+/**
+ * Performs the iterations of PBKDF2 after the first with a digest:
+ * data = MAC(data) repeatedly, XORing each MAC into the output.
+ * A MAC fits in one block with padding, so the padded block is built once and
+ * each hash is one compression from the state after the key block. The
+ * contexts are only read so that a key's contexts can be shared.
+ */
+#define HMAC_ITERATE(type, ctx, data, cnt, iter, dlen, block)	\
+do								\
+{								\
+    int c, i;							\
+    unsigned int n;						\
+    type t;							\
+    unsigned char m[BLOCK_SIZE];				\
+								\
+    memset(m, 0, BLOCK_SIZE);					\
+    m[dlen] = 0x80;						\
+    m[BLOCK_SIZE - 2] = ((BLOCK_SIZE + dlen) * 8) >> 8;	\
+    m[BLOCK_SIZE - 1] = ((BLOCK_SIZE + dlen) * 8) & 0xff;	\
+    for (c=0; c<cnt; c++)					\
+    {								\
+        memcpy(m, data[c], dlen);				\
+        for (n=1; n<iter; n++)					\
+        {							\
+            memcpy(t.h, ctx[c][0].h, sizeof(t.h));		\
+            block(&t, m);					\
+            HMAC_STORE_H(m, t.h, dlen);				\
+            memcpy(t.h, ctx[c][1].h, sizeof(t.h));		\
+            block(&t, m);					\
+            HMAC_STORE_H(m, t.h, dlen);				\
+            for (i=0; i<dlen; i++)				\
+                data[c][i] ^= m[i];				\
+        }							\
+    }								\
+}								\
+while (0)
+
 
@@ -0,0 +1,617 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Key derivation functions built on the MAC algorithms.
+ * PBKDF2 (RFC 8018) with HMAC: the password's key blocks are hashed once into
+ * a MAC_KEY and the iterations are done by the implementation - one block
+ * compression for each of the inner and outer hashes, with many output
+ * blocks and passwords in parallel lanes when the implementation has them.
+ * HKDF (RFC 5869): the PRK's key blocks are hashed once for all the rounds of
+ * expanding and for all the labels of a batch.
+ * The memory arenas of scrypt and Argon2 are mapped here too.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "kdf.h"
+#include "kdf_arena.h"
+#include "mac_meth.h"
+
+/**
+ * Check the parameters of a batch of PBKDF2 derivations.
+ *
+ * @param [in] pwds   The passwords.
+ * @param [in] plens  The lengths of the passwords.
+ * @param [in] salts  The salts.
+ * @param [in] slens  The lengths of the salts.
+ * @param [in] iter   The number of iterations.
+ * @param [in] cnt    The number of passwords.
+ * @param [in] keys   The buffers of the keys.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the count or a password length is
+ *          negative.<br>
+ *          HASH_ERR_BAD_DATA when the number of iterations is 0.<br>
+ *          0 otherwise.
+ */
+static int kdf_pbkdf2_check(const unsigned char **pwds, const int *plens,
+    const unsigned char **salts, const size_t *slens, unsigned int iter,
+    int cnt, unsigned char **keys)
+{
+    int ret = 0;
+    int i;
+
+    if (cnt < 0)
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    if (iter == 0)
+    {
+        ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+    if ((cnt > 0) && ((pwds == NULL) || (plens == NULL) || (salts == NULL) ||
+        (slens == NULL) || (keys == NULL)))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    for (i=0; i<cnt; i++)
+    {
+        if (plens[i] < 0)
+        {
+            ret = HASH_ERR_BAD_LEN;
+            break;
+        }
+        if (((pwds[i] == NULL) && (plens[i] > 0)) ||
+            ((salts[i] == NULL) && (slens[i] > 0)) || (keys[i] == NULL))
+        {
+            ret = HASH_ERR_PARAM_NULL;
+            break;
+        }
+    }
+end:
+    return ret;
+}
+
+/**
+ * Derive keys from passwords with PBKDF2.
+ * Every output block of every password is a job for MAC_KEY_iterate so that
+ * they can be processed in parallel.
+ *
+ * @param [in] mac    The MAC algorithm object - the PRF.
+ * @param [in] pwds   The passwords.
+ * @param [in] plens  The lengths of the passwords.
+ * @param [in] salts  The salts.
+ * @param [in] slens  The lengths of the salts.
+ * @param [in] iter   The number of iterations.
+ * @param [in] cnt    The number of passwords.
+ * @param [in] keys   The buffers to hold the keys.
+ * @param [in] klen   The length of each key.
+ * @return  HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+static int kdf_pbkdf2(MAC *mac, const unsigned char **pwds, const int *plens,
+    const unsigned char **salts, const size_t *slens, unsigned int iter,
+    int cnt, unsigned char **keys, size_t klen)
+{
+    int ret = 0;
+    int i, mlen;
+    size_t b, o, blocks, jobs, j;
+    unsigned char cb[4];
+    MAC_KEY **mkeys = NULL;
+    MAC_KEY **jkeys;
+    unsigned char **ju;
+    unsigned char *u;
+
+    MAC_get_len(mac, &mlen);
+    blocks = (klen + mlen - 1) / mlen;
+    jobs = cnt * blocks;
+    if (jobs == 0)
+        goto end;
+
+    /* Keys of passwords, key and output of each job, then the outputs. */
+    mkeys = calloc(1, cnt * sizeof(*mkeys) + jobs * (sizeof(*jkeys) +
+        sizeof(*ju) + mlen));
+    if (mkeys == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+    jkeys = mkeys + cnt;
+    ju = (unsigned char **)(jkeys + jobs);
+    u = (unsigned char *)(ju + jobs);
+
+    /* First iteration: MAC of the salt and the block number. */
+    for (i=0, j=0; (ret == 0) && (i<cnt); i++)
+    {
+        ret = MAC_KEY_new(mac, pwds[i], plens[i], &mkeys[i]);
+        for (b=1; (ret == 0) && (b<=blocks); b++, j++)
+        {
+            cb[0] = b >> 24;
+            cb[1] = b >> 16;
+            cb[2] = b >> 8;
+            cb[3] = b;
+            jkeys[j] = mkeys[i];
+            ju[j] = u + j * mlen;
+            ret = MAC_sign_init_key(mac, mkeys[i]);
+            if ((ret == 0) && (slens[i] > 0))
+                ret = MAC_sign_update(mac, salts[i], slens[i]);
+            if (ret == 0)
+                ret = MAC_sign_update(mac, cb, sizeof(cb));
+            if (ret == 0)
+                ret = MAC_sign_final(mac, ju[j]);
+        }
+    }
+    if (ret == 0)
+        ret = MAC_KEY_iterate(jkeys, ju, jobs, iter);
+    if (ret != 0)
+        goto end;
+
+    for (i=0, j=0; i<cnt; i++)
+    {
+        for (o=0; o<klen; o+=mlen, j++)
+            memcpy(keys[i] + o, ju[j], (klen - o < (size_t)mlen) ? klen - o :
+                (size_t)mlen);
+    }
+end:
+    if (mkeys != NULL)
+    {
+        for (i=0; i<cnt; i++)
+            MAC_KEY_free(mkeys[i]);
+        memset(u, 0, jobs * mlen);
+    }
+    free(mkeys);
+    return ret;
+}
+
+/**
+ * Derive a key from a password with PBKDF2.
+ * The MAC is the pseudo-random function, normally HMAC.
+ *
+ * @param [in] id    The MAC algorithm identifier.
+ * @param [in] pwd   The password.
+ * @param [in] plen  The length of the password.
+ * @param [in] salt  The salt.
+ * @param [in] slen  The length of the salt.
+ * @param [in] iter  The number of iterations.
+ * @param [in] key   The buffer to hold the key.
+ * @param [in] klen  The length of the key to derive.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the password length is negative.<br>
+ *          HASH_ERR_NOT_FOUND when no implementation of the MAC algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the number of iterations is 0 or the
+ *          implementation failed.<br>
+ *          0 otherwise.
+ */
+int KDF_pbkdf2(MAC_ID id, const unsigned char *pwd, int plen,
+    const unsigned char *salt, size_t slen, unsigned int iter,
+    unsigned char *key, size_t klen)
+{
+    return KDF_pbkdf2_batch(id, 0, &pwd, &plen, &salt, &slen, iter, 1, &key,
+        klen);
+}
+
+/**
+ * Derive keys from many passwords with PBKDF2.
+ * The output blocks of all passwords are iterated together: implementations
+ * with lanes, like HMAC-SHA-256 with MAC_METH_FLAG_AVX2, process them in
+ * parallel. Without flags, lanes are used unless the highest ranked
+ * implementation iterates with CPU instructions, e.g. the SHA extensions.
+ *
+ * @param [in] id     The MAC algorithm identifier.
+ * @param [in] flags  The flags of the MAC implementation to use.
+ * @param [in] pwds   The passwords.
+ * @param [in] plens  The lengths of the passwords.
+ * @param [in] salts  The salts.
+ * @param [in] slens  The lengths of the salts.
+ * @param [in] iter   The number of iterations.
+ * @param [in] cnt    The number of passwords.
+ * @param [in] keys   The buffers to hold the keys.
+ * @param [in] klen   The length of each key to derive.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the count or a password length is
+ *          negative.<br>
+ *          HASH_ERR_NOT_FOUND when no implementation of the MAC algorithm
+ *          matches the flags.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the number of iterations is 0 or the
+ *          implementation failed.<br>
+ *          0 otherwise.
+ */
+int KDF_pbkdf2_batch(MAC_ID id, int flags, const unsigned char **pwds,
+    const int *plens, const unsigned char **salts, const size_t *slens,
+    unsigned int iter, int cnt, unsigned char **keys, size_t klen)
+{
+    int ret = 0;
+    MAC *mac = NULL;
+
+    ret = kdf_pbkdf2_check(pwds, plens, salts, slens, iter, cnt, keys);
+    if (ret == 0)
+        ret = mac_new_iterate(id, flags, &mac);
+    if (ret == 0)
+        ret = kdf_pbkdf2(mac, pwds, plens, salts, slens, iter, cnt, keys,
+            klen);
+
+    MAC_free(mac);
+    return ret;
+}
+
+/**
+ * Derive keys from many passwords with PBKDF2 and compare with the expected
+ * keys, e.g. candidate passwords against stored hashes.
+ * Bit i of verified is set when the key of password i matches.
+ * The comparisons take the same time whether they match or not.
+ *
+ * @param [in]  id        The MAC algorithm identifier.
+ * @param [in]  flags     The flags of the MAC implementation to use.
+ * @param [in]  pwds      The passwords.
+ * @param [in]  plens     The lengths of the passwords.
+ * @param [in]  salts     The salts.
+ * @param [in]  slens     The lengths of the salts.
+ * @param [in]  iter      The number of iterations.
+ * @param [in]  cnt       The number of passwords.
+ * @param [in]  keys      The expected keys.
+ * @param [in]  klen      The length of each key.
+ * @param [out] verified  The bitmap of verified passwords of (cnt + 7) / 8
+ *                        bytes.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the count or a password length is
+ *          negative.<br>
+ *          HASH_ERR_NOT_FOUND when no implementation of the MAC algorithm
+ *          matches the flags.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the number of iterations is 0 or the
+ *          implementation failed.<br>
+ *          0 otherwise.
+ */
+int KDF_pbkdf2_batch_verify(MAC_ID id, int flags, const unsigned char **pwds,
+    const int *plens, const unsigned char **salts, const size_t *slens,
+    unsigned int iter, int cnt, unsigned char **keys, size_t klen,
+    unsigned char *verified)
+{
+    int ret = 0;
+    int i;
+    size_t j;
+    unsigned char diff;
+    unsigned char *cdata = NULL;
+    unsigned char **cptr;
+
+    ret = kdf_pbkdf2_check(pwds, plens, salts, slens, iter, cnt, keys);
+    if ((ret == 0) && (verified == NULL))
+        ret = HASH_ERR_PARAM_NULL;
+    if ((ret != 0) || (cnt == 0))
+        goto end;
+
+    /* Pointers to the calculated keys and then the keys. */
+    cdata = malloc(cnt * (sizeof(*cptr) + klen));
+    if (cdata == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+    cptr = (unsigned char **)cdata;
+    for (i=0; i<cnt; i++)
+        cptr[i] = cdata + cnt * sizeof(*cptr) + i * klen;
+
+    ret = KDF_pbkdf2_batch(id, flags, pwds, plens, salts, slens, iter, cnt,
+        cptr, klen);
+    if (ret != 0)
+        goto end;
+
+    memset(verified, 0, ((size_t)cnt + 7) / 8);
+    for (i=0; i<cnt; i++)
+    {
+        diff = 0;
+        for (j=0; j<klen; j++)
+            diff |= cptr[i][j] ^ keys[i][j];
+        verified[i / 8] |= (unsigned char)((diff == 0) << (i % 8));
+    }
+end:
+    if (cdata != NULL)
+        memset(cdata, 0, cnt * (sizeof(*cptr) + klen));
+    free(cdata);
+    return ret;
+}
+
+/**
+ * HKDF-Extract: a pseudo-random key from input keying material.
+ *
+ * @param [in] id    The MAC algorithm identifier.
+ * @param [in] salt  The salt. May be NULL to use a MAC length of zeros.
+ * @param [in] slen  The length of the salt.
+ * @param [in] ikm   The input keying material.
+ * @param [in] ilen  The length of the input keying material.
+ * @param [in] prk   The buffer to hold the pseudo-random key of the MAC's
+ *                   length.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the salt length is negative.<br>
+ *          HASH_ERR_NOT_FOUND when no implementation of the MAC algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+int KDF_hkdf_extract(MAC_ID id, const unsigned char *salt, int slen,
+    const unsigned char *ikm, size_t ilen, unsigned char *prk)
+{
+    int ret = 0;
+    int len;
+    unsigned char zero[HASH_MAX_LEN];
+
+    if (((ikm == NULL) && (ilen > 0)) || (prk == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (slen < 0)
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+
+    if (salt == NULL)
+    {
+        ret = MAC_METH_get_len(id, &len);
+        if (ret != 0)
+            goto end;
+        memset(zero, 0, len);
+        salt = zero;
+        slen = len;
+    }
+    ret = MAC_compute(id, salt, slen, ikm, ilen, prk);
+end:
+    return ret;
+}
+
+/**
+ * HKDF-Expand with a MAC object and the PRK's key object.
+ * T(i) = MAC(PRK, T(i-1) | info | i) - each round starts from the key's
+ * state.
+ *
+ * @param [in] mac   The MAC algorithm object.
+ * @param [in] mkey  The MAC key object of the pseudo-random key.
+ * @param [in] info  The context and application specific information.
+ * @param [in] ilen  The length of the information.
+ * @param [in] okm   The buffer to hold the output keying material.
+ * @param [in] olen  The length of the output keying material.
+ * @return  HASH_ERR_BAD_LEN when the output is more than 255 MACs long.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+static int kdf_hkdf_expand(MAC *mac, MAC_KEY *mkey,
+    const unsigned char *info, size_t ilen, unsigned char *okm, size_t olen)
+{
+    int ret = 0;
+    int len;
+    size_t o, n;
+    unsigned char i;
+    unsigned char t[HASH_MAX_LEN];
+
+    MAC_get_len(mac, &len);
+    if (olen > 255 * (size_t)len)
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+
+    for (i=1, o=0; (ret == 0) && (o<olen); i++, o+=n)
+    {
+        ret = MAC_sign_init_key(mac, mkey);
+        if ((ret == 0) && (i > 1))
+            ret = MAC_sign_update(mac, t, len);
+        if ((ret == 0) && (ilen > 0))
+            ret = MAC_sign_update(mac, info, ilen);
+        if (ret == 0)
+            ret = MAC_sign_update(mac, &i, 1);
+        if (ret == 0)
+            ret = MAC_sign_final(mac, t);
+        n = (olen - o < (size_t)len) ? olen - o : (size_t)len;
+        if (ret == 0)
+            memcpy(okm + o, t, n);
+    }
+    memset(t, 0, sizeof(t));
+end:
+    return ret;
+}
+
+/**
+ * HKDF-Expand: output keying material from a pseudo-random key.
+ *
+ * @param [in] id    The MAC algorithm identifier.
+ * @param [in] prk   The pseudo-random key.
+ * @param [in] plen  The length of the pseudo-random key.
+ * @param [in] info  The context and application specific information.
+ * @param [in] ilen  The length of the information.
+ * @param [in] okm   The buffer to hold the output keying material.
+ * @param [in] olen  The length of the output keying material.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the PRK length is negative or the output is
+ *          more than 255 MACs long.<br>
+ *          HASH_ERR_NOT_FOUND when no implementation of the MAC algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+int KDF_hkdf_expand(MAC_ID id, const unsigned char *prk, int plen,
+    const unsigned char *info, size_t ilen, unsigned char *okm, size_t olen)
+{
+    return KDF_hkdf_expand_batch(id, prk, plen, &info, &ilen, 1, &okm, &olen);
+}
+
+/**
+ * HKDF-Expand many labels from one pseudo-random key, e.g. the keys and IVs
+ * of a TLS 1.3 or QUIC connection.
+ * The PRK's key blocks are hashed once for all labels and rounds.
+ *
+ * @param [in] id     The MAC algorithm identifier.
+ * @param [in] prk    The pseudo-random key.
+ * @param [in] plen   The length of the pseudo-random key.
+ * @param [in] infos  The information of each label.
+ * @param [in] ilens  The lengths of the information.
+ * @param [in] cnt    The number of labels.
+ * @param [in] okms   The buffers to hold the output keying material.
+ * @param [in] olens  The lengths of the output keying material.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the PRK length or count is negative or an
+ *          output is more than 255 MACs long.<br>
+ *          HASH_ERR_NOT_FOUND when no implementation of the MAC algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+int KDF_hkdf_expand_batch(MAC_ID id, const unsigned char *prk, int plen,
+    const unsigned char **infos, const size_t *ilens, int cnt,
+    unsigned char **okms, const size_t *olens)
+{
+    int ret = 0;
+    int i;
+    MAC *mac = NULL;
+    MAC_KEY *mkey = NULL;
+
+    if ((plen < 0) || (cnt < 0))
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    if (((prk == NULL) && (plen > 0)) || ((cnt > 0) && ((infos == NULL) ||
+        (ilens == NULL) || (okms == NULL) || (olens == NULL))))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    for (i=0; i<cnt; i++)
+    {
+        if (((infos[i] == NULL) && (ilens[i] > 0)) ||
+            ((okms[i] == NULL) && (olens[i] > 0)))
+        {
+            ret = HASH_ERR_PARAM_NULL;
+            goto end;
+        }
+    }
+
+    ret = MAC_new(id, 0, &mac);
+    if (ret == 0)
+        ret = MAC_KEY_new(mac, prk, plen, &mkey);
+    for (i=0; (ret == 0) && (i<cnt); i++)
+        ret = kdf_hkdf_expand(mac, mkey, infos[i], ilens[i], okms[i], olens[i]);
+end:
+    MAC_KEY_free(mkey);
+    MAC_free(mac);
+    return ret;
+}
+
+/**
+ * HKDF: extract a pseudo-random key and expand it.
+ *
+ * @param [in] id    The MAC algorithm identifier.
+ * @param [in] salt  The salt. May be NULL to use a MAC length of zeros.
+ * @param [in] slen  The length of the salt.
+ * @param [in] ikm   The input keying material.
+ * @param [in] klen  The length of the input keying material.
+ * @param [in] info  The context and application specific information.
+ * @param [in] ilen  The length of the information.
+ * @param [in] okm   The buffer to hold the output keying material.
+ * @param [in] olen  The length of the output keying material.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the salt length is negative or the output
+ *          is more than 255 MACs long.<br>
+ *          HASH_ERR_NOT_FOUND when no implementation of the MAC algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+int KDF_hkdf(MAC_ID id, const unsigned char *salt, int slen,
+    const unsigned char *ikm, size_t klen, const unsigned char *info,
+    size_t ilen, unsigned char *okm, size_t olen)
+{
+    int ret = 0;
+    int len = 0;
+    unsigned char prk[HASH_MAX_LEN];
+
+    ret = KDF_hkdf_extract(id, salt, slen, ikm, klen, prk);
+    if (ret == 0)
+        ret = MAC_METH_get_len(id, &len);
+    if (ret == 0)
+        ret = KDF_hkdf_expand(id, prk, len, info, ilen, okm, olen);
+
+    memset(prk, 0, sizeof(prk));
+    return ret;
+}
+
+/**
+ * Map memory for an arena, with huge pages when it is big enough.
+ * Memory-hard functions make random accesses all over the arena and huge
+ * pages keep them from missing the TLB.
+ * Falls back to normal pages that are advised to be backed by transparent
+ * huge pages.
+ *
+ * @param [in, out] len  The number of bytes needed. On out, the number of
+ *                       bytes mapped.
+ * @return  The memory or NULL when mapping failed.
+ */
+void *kdf_arena_new(size_t *len)
+{
+    void *m = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    size_t hlen;
+
+    if (*len >= KDF_ARENA_HUGE_PAGE)
+    {
+        /* Huge page mappings are whole pages. */
+        hlen = (*len + KDF_ARENA_HUGE_PAGE - 1) &
+            ~(size_t)(KDF_ARENA_HUGE_PAGE - 1);
+        m = mmap(NULL, hlen, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (m != MAP_FAILED)
+            *len = hlen;
+    }
+#endif
+    if (m == MAP_FAILED)
+    {
+        m = mmap(NULL, *len, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED)
+            return NULL;
+#ifdef MADV_HUGEPAGE
+        if (*len >= KDF_ARENA_HUGE_PAGE)
+            madvise(m, *len, MADV_HUGEPAGE);
+#endif
+    }
+    return m;
+}
+
+/**
+ * Unmap the memory of an arena.
+ *
+ * @param [in] m    The memory.
+ * @param [in] len  The number of bytes mapped - as returned by
+ *                  kdf_arena_new().
+ */
+void kdf_arena_free(void *m, size_t len)
+{
+    munmap(m, len);
+}
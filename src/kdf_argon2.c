@@ -0,0 +1,813 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Argon2d, Argon2i and Argon2id (RFC 9106) on BLAKE2b from hash_blake2b.c.
+ * The memory matrix is one arena of blocks - lane after lane - that asks for
+ * huge pages. Each lane is filled by a worker thread and the threads meet
+ * at the end of each slice, as blocks of other lanes may only be referenced
+ * from finished segments.
+ * The compression function G is done with AVX2 when the CPU has it: a row of
+ * the block is four vectors and a column is four pairs of 128-bit halves.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "kdf.h"
+#include "kdf_arena.h"
+#include "hash_cpu.h"
+#include "hash_blake2b.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+/** Compile the function for AVX2. */
+#define AVX2_TARGET	__attribute__((target("avx2")))
+#endif
+
+/** The version of Argon2 implemented. */
+#define ARGON2_VERSION		0x13
+/** The number of 64-bit words in a block. */
+#define ARGON2_BLOCK_WORDS	128
+/** The size of a block in bytes. */
+#define ARGON2_BLOCK_SIZE	1024
+/** The number of slices in a pass. */
+#define ARGON2_SLICES		4
+/** The length of H0 and the two 32-bit words appended to it. */
+#define ARGON2_H0_LEN		(HASH_BLAKE2B_512_LEN + 8)
+/** The maximum number of lanes. */
+#define ARGON2_MAX_LANES	0xffffff
+
+/** A block of the memory matrix. Aligned for vector loads and stores. */
+typedef struct argon2_block_st
+{
+    /** The words of the block. */
+    uint64_t v[ARGON2_BLOCK_WORDS];
+} __attribute__((aligned(64))) ARGON2_BLOCK;
+
+/** The compression function G: out = G(x, y), or out ^= G(x, y). */
+typedef void ARGON2_G(const ARGON2_BLOCK *x, const ARGON2_BLOCK *y,
+    ARGON2_BLOCK *out, int with_xor);
+
+/** Barrier that the threads meet at after each slice. */
+typedef struct argon2_sync_st
+{
+    /** Lock protecting the counts. */
+    pthread_mutex_t lock;
+    /** Signalled when the last thread arrives. */
+    pthread_cond_t cond;
+    /** The number of threads that meet. */
+    int n;
+    /** The number of threads waiting. */
+    int wait;
+    /** Incremented each time the threads are released. */
+    unsigned int gen;
+} ARGON2_SYNC;
+
+/** The parameters and memory of an Argon2 operation. */
+typedef struct argon2_st
+{
+    /** The memory matrix: block c of lane l is at l * q + c. */
+    ARGON2_BLOCK *b;
+    /** The compression function to use. */
+    ARGON2_G *g;
+    /** The Argon2 type. */
+    uint32_t type;
+    /** The number of passes. */
+    uint32_t t;
+    /** The number of blocks - a multiple of 4 * p. */
+    uint32_t m;
+    /** The number of lanes. */
+    uint32_t p;
+    /** The number of blocks in a lane. */
+    uint32_t q;
+    /** The number of blocks in a segment. */
+    uint32_t sl;
+    /** The number of lane groups - lane l is in group l modulo this. */
+    int groups;
+    /** The barrier the threads meet at after each slice. */
+    ARGON2_SYNC sync;
+} ARGON2;
+
+/** The work of one thread: the lanes in a range of groups. */
+typedef struct argon2_worker_st
+{
+    /** The Argon2 operation. */
+    ARGON2 *ctx;
+    /** The first group of lanes. */
+    int lo;
+    /** The group of lanes after the last. */
+    int hi;
+} ARGON2_WORKER;
+
+/** Rotate a 64-bit word right. */
+#define ROTR64(a, n)	(((a) >> (n)) | ((a) << (64 - (n))))
+
+/** BlaMka: addition with the product of the low 32 bits. */
+#define BLAMKA(a, b)							\
+    ((a) + (b) + 2 * (uint64_t)(uint32_t)(a) * (uint32_t)(b))
+
+/** The G function of BLAKE2b with multiplication (GB of RFC 9106). */
+#define GB(a, b, c, d)							\
+    a = BLAMKA(a, b); d = ROTR64(d ^ a, 32);				\
+    c = BLAMKA(c, d); b = ROTR64(b ^ c, 24);				\
+    a = BLAMKA(a, b); d = ROTR64(d ^ a, 16);				\
+    c = BLAMKA(c, d); b = ROTR64(b ^ c, 63)
+
+/** The permutation P on sixteen words. */
+#define P(v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14,\
+    v15)								\
+do									\
+{									\
+    GB(v0, v4, v8, v12); GB(v1, v5, v9, v13);				\
+    GB(v2, v6, v10, v14); GB(v3, v7, v11, v15);				\
+    GB(v0, v5, v10, v15); GB(v1, v6, v11, v12);				\
+    GB(v2, v7, v8, v13); GB(v3, v4, v9, v14);				\
+}									\
+while (0)
+
+/**
+ * The compression function G in portable C.
+ * P is applied to the rows of R = X ^ Y and then to the columns; a column
+ * is made of pairs of words.
+ *
+ * @param [in] x         The first input block.
+ * @param [in] y         The second input block.
+ * @param [in] out       The output block.
+ * @param [in] with_xor  Whether to XOR into the output block.
+ */
+static void argon2_g_c(const ARGON2_BLOCK *x, const ARGON2_BLOCK *y,
+    ARGON2_BLOCK *out, int with_xor)
+{
+    uint64_t r[ARGON2_BLOCK_WORDS];
+    uint64_t q[ARGON2_BLOCK_WORDS];
+    uint64_t *v;
+    int i;
+
+    for (i=0; i<ARGON2_BLOCK_WORDS; i++)
+        q[i] = r[i] = x->v[i] ^ y->v[i];
+
+    for (i=0; i<8; i++)
+    {
+        v = q + 16 * i;
+        P(v[ 0], v[ 1], v[ 2], v[ 3], v[ 4], v[ 5], v[ 6], v[ 7],
+          v[ 8], v[ 9], v[10], v[11], v[12], v[13], v[14], v[15]);
+    }
+    for (i=0; i<8; i++)
+    {
+        v = q + 2 * i;
+        P(v[  0], v[  1], v[ 16], v[ 17], v[ 32], v[ 33], v[ 48], v[ 49],
+          v[ 64], v[ 65], v[ 80], v[ 81], v[ 96], v[ 97], v[112], v[113]);
+    }
+
+    if (with_xor)
+    {
+        for (i=0; i<ARGON2_BLOCK_WORDS; i++)
+            out->v[i] ^= q[i] ^ r[i];
+    }
+    else
+    {
+        for (i=0; i<ARGON2_BLOCK_WORDS; i++)
+            out->v[i] = q[i] ^ r[i];
+    }
+}
+
+#ifdef CPU_X86_64
+/** BlaMka on vectors of four words. */
+#define BLAMKA_AVX2(a, b)						\
+    _mm256_add_epi64(_mm256_add_epi64(a, b),				\
+        _mm256_slli_epi64(_mm256_mul_epu32(a, b), 1))
+
+/** Rotate the four words right by 32 bits. */
+#define ROTR32_AVX2(x)	_mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+/** Rotate the four words right by 24 bits. */
+#define ROTR24_AVX2(x)	_mm256_shuffle_epi8(x, rot24)
+/** Rotate the four words right by 16 bits. */
+#define ROTR16_AVX2(x)	_mm256_shuffle_epi8(x, rot16)
+/** Rotate the four words right by 63 bits. */
+#define ROTR63_AVX2(x)							\
+    _mm256_xor_si256(_mm256_srli_epi64(x, 63), _mm256_add_epi64(x, x))
+
+/** GB on the four columns - or diagonals - of a row. */
+#define GB_AVX2(a, b, c, d)						\
+    a = BLAMKA_AVX2(a, b); d = ROTR32_AVX2(_mm256_xor_si256(d, a));	\
+    c = BLAMKA_AVX2(c, d); b = ROTR24_AVX2(_mm256_xor_si256(b, c));	\
+    a = BLAMKA_AVX2(a, b); d = ROTR16_AVX2(_mm256_xor_si256(d, a));	\
+    c = BLAMKA_AVX2(c, d); b = ROTR63_AVX2(_mm256_xor_si256(b, c))
+
+/** The permutation P on sixteen words in four vectors. */
+#define P_AVX2(a, b, c, d)						\
+do									\
+{									\
+    GB_AVX2(a, b, c, d);						\
+    b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));		\
+    c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));		\
+    d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3));		\
+    GB_AVX2(a, b, c, d);						\
+    b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));		\
+    c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));		\
+    d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1));		\
+}									\
+while (0)
+
+/** Load a vector from two pairs of words 16 words apart. */
+#define LOAD_COL_AVX2(p)						\
+    _mm256_inserti128_si256(_mm256_castsi128_si256(			\
+        _mm_load_si128((const __m128i *)(p))),				\
+        _mm_load_si128((const __m128i *)((p) + 16)), 1)
+
+/** Store a vector into two pairs of words 16 words apart. */
+#define STORE_COL_AVX2(p, x)						\
+    _mm_store_si128((__m128i *)(p), _mm256_castsi256_si128(x));		\
+    _mm_store_si128((__m128i *)((p) + 16), _mm256_extracti128_si256(x, 1))
+
+/**
+ * The compression function G with AVX2.
+ *
+ * @param [in] x         The first input block.
+ * @param [in] y         The second input block.
+ * @param [in] out       The output block.
+ * @param [in] with_xor  Whether to XOR into the output block.
+ */
+AVX2_TARGET
+static void argon2_g_avx2(const ARGON2_BLOCK *x, const ARGON2_BLOCK *y,
+    ARGON2_BLOCK *out, int with_xor)
+{
+    const __m256i rot24 = _mm256_setr_epi8(
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    const __m256i rot16 = _mm256_setr_epi8(
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    __m256i r[ARGON2_BLOCK_WORDS / 4];
+    uint64_t q[ARGON2_BLOCK_WORDS] __attribute__((aligned(32)));
+    const __m256i *xv = (const __m256i *)x->v;
+    const __m256i *yv = (const __m256i *)y->v;
+    __m256i *qv = (__m256i *)q;
+    __m256i *ov = (__m256i *)out->v;
+    __m256i a, b, c, d;
+    int i;
+
+    /* Rows: 16 contiguous words. */
+    for (i=0; i<8; i++)
+    {
+        a = r[4*i+0] = _mm256_xor_si256(xv[4*i+0], yv[4*i+0]);
+        b = r[4*i+1] = _mm256_xor_si256(xv[4*i+1], yv[4*i+1]);
+        c = r[4*i+2] = _mm256_xor_si256(xv[4*i+2], yv[4*i+2]);
+        d = r[4*i+3] = _mm256_xor_si256(xv[4*i+3], yv[4*i+3]);
+        P_AVX2(a, b, c, d);
+        qv[4*i+0] = a;
+        qv[4*i+1] = b;
+        qv[4*i+2] = c;
+        qv[4*i+3] = d;
+    }
+    /* Columns: pairs of words from each row. */
+    for (i=0; i<8; i++)
+    {
+        a = LOAD_COL_AVX2(q + 2 * i);
+        b = LOAD_COL_AVX2(q + 2 * i + 32);
+        c = LOAD_COL_AVX2(q + 2 * i + 64);
+        d = LOAD_COL_AVX2(q + 2 * i + 96);
+        P_AVX2(a, b, c, d);
+        STORE_COL_AVX2(q + 2 * i, a);
+        STORE_COL_AVX2(q + 2 * i + 32, b);
+        STORE_COL_AVX2(q + 2 * i + 64, c);
+        STORE_COL_AVX2(q + 2 * i + 96, d);
+    }
+
+    if (with_xor)
+    {
+        for (i=0; i<ARGON2_BLOCK_WORDS/4; i++)
+        {
+            ov[i] = _mm256_xor_si256(ov[i],
+                _mm256_xor_si256(qv[i], r[i]));
+        }
+    }
+    else
+    {
+        for (i=0; i<ARGON2_BLOCK_WORDS/4; i++)
+            ov[i] = _mm256_xor_si256(qv[i], r[i]);
+    }
+}
+#endif
+
+/**
+ * Get the compression function G that best matches the flags.
+ * The AVX2 implementation is preferred when the CPU has AVX2.
+ *
+ * @param [in] flags  The implementation flags required and excluded.
+ * @return  The compression function.<br>
+ *          NULL when no implementation matches the flags.
+ */
+static ARGON2_G *argon2_g_get(int flags)
+{
+    int req = flags & 0xffff;
+    int excl = (flags >> 16) & 0xffff;
+    int f;
+
+#ifdef CPU_X86_64
+    f = HASH_METH_FLAG_INTERNAL | HASH_METH_FLAG_AVX2;
+    if (((hash_cpu_flags() & HASH_METH_FLAG_AVX2) != 0) &&
+        ((f & req) == req) && ((f & excl) == 0))
+    {
+        return &argon2_g_avx2;
+    }
+#endif
+    f = HASH_METH_FLAG_INTERNAL;
+    if (((f & req) == req) && ((f & excl) == 0))
+        return &argon2_g_c;
+    return NULL;
+}
+
+/**
+ * Encode a 32-bit number little-endian.
+ *
+ * @param [in] b  The buffer of 4 bytes.
+ * @param [in] n  The number.
+ */
+static void argon2_le32(unsigned char *b, uint32_t n)
+{
+    b[0] = n;
+    b[1] = n >> 8;
+    b[2] = n >> 16;
+    b[3] = n >> 24;
+}
+
+/**
+ * The variable-length hash function H'.
+ *
+ * @param [in] out   The buffer to hold the output.
+ * @param [in] len   The length of the output.
+ * @param [in] in    The input.
+ * @param [in] ilen  The length of the input.
+ */
+static void argon2_hprime(unsigned char *out, size_t len,
+    const unsigned char *in, size_t ilen)
+{
+    HASH_BLAKE2B ctx;
+    unsigned char le[4];
+    unsigned char v[HASH_BLAKE2B_512_LEN];
+
+    argon2_le32(le, len);
+    hash_blake2b_len_init(&ctx, (len <= HASH_BLAKE2B_512_LEN) ? len :
+        HASH_BLAKE2B_512_LEN);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    hash_blake2b_update(&ctx, in, ilen);
+    if (len <= HASH_BLAKE2B_512_LEN)
+    {
+        hash_blake2b_len_final(out, &ctx, len);
+        return;
+    }
+
+    /* First half of each 64-byte hash then all of the last. */
+    hash_blake2b_512_final(v, &ctx);
+    memcpy(out, v, HASH_BLAKE2B_512_LEN / 2);
+    out += HASH_BLAKE2B_512_LEN / 2;
+    len -= HASH_BLAKE2B_512_LEN / 2;
+    while (len > HASH_BLAKE2B_512_LEN)
+    {
+        hash_blake2b_512_init(&ctx);
+        hash_blake2b_update(&ctx, v, sizeof(v));
+        hash_blake2b_512_final(v, &ctx);
+        memcpy(out, v, HASH_BLAKE2B_512_LEN / 2);
+        out += HASH_BLAKE2B_512_LEN / 2;
+        len -= HASH_BLAKE2B_512_LEN / 2;
+    }
+    hash_blake2b_len_init(&ctx, len);
+    hash_blake2b_update(&ctx, v, sizeof(v));
+    hash_blake2b_len_final(out, &ctx, len);
+    memset(v, 0, sizeof(v));
+}
+
+/**
+ * Hash a 1024-byte block with H' into a block of the matrix.
+ *
+ * @param [in] b     The block of the matrix.
+ * @param [in] in    The input.
+ * @param [in] ilen  The length of the input.
+ */
+static void argon2_hprime_block(ARGON2_BLOCK *b, const unsigned char *in,
+    size_t ilen)
+{
+    unsigned char d[ARGON2_BLOCK_SIZE];
+    int i, j;
+
+    argon2_hprime(d, sizeof(d), in, ilen);
+    for (i=0; i<ARGON2_BLOCK_WORDS; i++)
+    {
+        b->v[i] = 0;
+        for (j=7; j>=0; j--)
+            b->v[i] = (b->v[i] << 8) | d[i * 8 + j];
+    }
+    memset(d, 0, sizeof(d));
+}
+
+/**
+ * Calculate the index of the reference block in its lane.
+ * The reference set is the blocks of the lane that are finished and not
+ * being overwritten, excluding the previous block when in the same lane.
+ *
+ * @param [in] ctx    The Argon2 operation.
+ * @param [in] pass   The pass.
+ * @param [in] slice  The slice.
+ * @param [in] i      The index of the block in the segment.
+ * @param [in] j1     The low 32 bits of the pseudo-random number.
+ * @param [in] same   Whether the reference block is in the same lane.
+ * @return  The column of the reference block.
+ */
+static uint32_t argon2_ref_index(ARGON2 *ctx, uint32_t pass, uint32_t slice,
+    uint32_t i, uint32_t j1, int same)
+{
+    uint32_t area, start = 0;
+    uint64_t rel;
+
+    if (pass == 0)
+        area = slice * ctx->sl;
+    else
+        area = ctx->q - ctx->sl;
+    if (same)
+        area += i - 1;
+    else if (i == 0)
+        area--;
+
+    /* Non-uniform mapping favouring recent blocks. */
+    rel = ((uint64_t)j1 * j1) >> 32;
+    rel = area - 1 - (((uint64_t)area * rel) >> 32);
+
+    if ((pass != 0) && (slice != ARGON2_SLICES - 1))
+        start = (slice + 1) * ctx->sl;
+    return (start + rel) % ctx->q;
+}
+
+/**
+ * Fill a segment of a lane.
+ * Argon2i, and Argon2id in the first half of the first pass, takes the
+ * pseudo-random numbers from address blocks that don't depend on the
+ * password. Otherwise they come from the previous block.
+ *
+ * @param [in] ctx    The Argon2 operation.
+ * @param [in] pass   The pass.
+ * @param [in] lane   The lane.
+ * @param [in] slice  The slice.
+ */
+static void argon2_fill_segment(ARGON2 *ctx, uint32_t pass, uint32_t lane,
+    uint32_t slice)
+{
+    static const ARGON2_BLOCK zero;
+    ARGON2_BLOCK in, tmp, addr;
+    int indep;
+    uint32_t i, start = 0, cur, prev, rlane;
+    uint64_t rnd;
+
+    indep = (ctx->type == KDF_ARGON2_I) || ((ctx->type == KDF_ARGON2_ID) &&
+        (pass == 0) && (slice < ARGON2_SLICES / 2));
+    if (indep)
+    {
+        memset(&in, 0, sizeof(in));
+        in.v[0] = pass;
+        in.v[1] = lane;
+        in.v[2] = slice;
+        in.v[3] = ctx->m;
+        in.v[4] = ctx->t;
+        in.v[5] = ctx->type;
+    }
+    /* The first two blocks of a lane are made from H0. */
+    if ((pass == 0) && (slice == 0))
+    {
+        start = 2;
+        if (indep)
+        {
+            in.v[6]++;
+            ctx->g(&zero, &in, &tmp, 0);
+            ctx->g(&zero, &tmp, &addr, 0);
+        }
+    }
+
+    cur = lane * ctx->q + slice * ctx->sl + start;
+    for (i=start; i<ctx->sl; i++, cur++)
+    {
+        prev = (cur % ctx->q == 0) ? cur + ctx->q - 1 : cur - 1;
+        if (indep)
+        {
+            if (i % ARGON2_BLOCK_WORDS == 0)
+            {
+                in.v[6]++;
+                ctx->g(&zero, &in, &tmp, 0);
+                ctx->g(&zero, &tmp, &addr, 0);
+            }
+            rnd = addr.v[i % ARGON2_BLOCK_WORDS];
+        }
+        else
+            rnd = ctx->b[prev].v[0];
+
+        rlane = (uint32_t)(rnd >> 32) % ctx->p;
+        if ((pass == 0) && (slice == 0))
+            rlane = lane;
+        ctx->g(&ctx->b[prev], &ctx->b[rlane * ctx->q + argon2_ref_index(ctx,
+            pass, slice, i, (uint32_t)rnd, rlane == lane)], &ctx->b[cur],
+            pass != 0);
+    }
+}
+
+/**
+ * Wait for all the threads to finish the slice.
+ *
+ * @param [in] sync  The barrier.
+ */
+static void argon2_sync(ARGON2_SYNC *sync)
+{
+    unsigned int gen;
+
+    pthread_mutex_lock(&sync->lock);
+    if (++sync->wait >= sync->n)
+    {
+        sync->wait = 0;
+        sync->gen++;
+        pthread_cond_broadcast(&sync->cond);
+    }
+    else
+    {
+        gen = sync->gen;
+        while (gen == sync->gen)
+            pthread_cond_wait(&sync->cond, &sync->lock);
+    }
+    pthread_mutex_unlock(&sync->lock);
+}
+
+/**
+ * Fill the segments of the worker's lanes, slice by slice, for all passes.
+ *
+ * @param [in] arg  The worker.
+ * @return  NULL.
+ */
+static void *argon2_thread(void *arg)
+{
+    ARGON2_WORKER *w = arg;
+    ARGON2 *ctx = w->ctx;
+    uint32_t pass, slice, lane;
+    int g;
+
+    for (pass=0; pass<ctx->t; pass++)
+    {
+        for (slice=0; slice<ARGON2_SLICES; slice++)
+        {
+            for (g=w->lo; g<w->hi; g++)
+            {
+                for (lane=g; lane<ctx->p; lane+=ctx->groups)
+                    argon2_fill_segment(ctx, pass, lane, slice);
+            }
+            if (ctx->groups > 1)
+                argon2_sync(&ctx->sync);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Calculate H0: the hash of the parameters and inputs.
+ *
+ * @param [in] h0  The buffer to hold H0 with room for two more words.
+ * @param [in] ...  The inputs as passed to KDF_argon2().
+ */
+static void argon2_h0(unsigned char *h0, int type, const unsigned char *pwd,
+    int plen, const unsigned char *salt, size_t slen,
+    const unsigned char *secret, size_t klen, const unsigned char *ad,
+    size_t alen, uint32_t t, uint32_t m, uint32_t p, size_t tlen)
+{
+    HASH_BLAKE2B ctx;
+    unsigned char le[4];
+
+    hash_blake2b_512_init(&ctx);
+    argon2_le32(le, p);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    argon2_le32(le, tlen);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    argon2_le32(le, m);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    argon2_le32(le, t);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    argon2_le32(le, ARGON2_VERSION);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    argon2_le32(le, type);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    argon2_le32(le, plen);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    hash_blake2b_update(&ctx, pwd, plen);
+    argon2_le32(le, slen);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    hash_blake2b_update(&ctx, salt, slen);
+    argon2_le32(le, klen);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    hash_blake2b_update(&ctx, secret, klen);
+    argon2_le32(le, alen);
+    hash_blake2b_update(&ctx, le, sizeof(le));
+    hash_blake2b_update(&ctx, ad, alen);
+    hash_blake2b_512_final(h0, &ctx);
+}
+
+/**
+ * Hash a password with Argon2.
+ * The memory of m KiB is split into p lanes that are filled by up to threads
+ * threads. The threads meet 4 times a pass.
+ *
+ * @param [in] type     The Argon2 type: KDF_ARGON2_D, KDF_ARGON2_I or
+ *                      KDF_ARGON2_ID.
+ * @param [in] flags    The flags of the compression function implementation
+ *                      to use, e.g. exclude HASH_METH_FLAG_AVX2 for
+ *                      portable C.
+ * @param [in] pwd      The password.
+ * @param [in] plen     The length of the password.
+ * @param [in] salt     The salt.
+ * @param [in] slen     The length of the salt. At least 8.
+ * @param [in] secret   The secret value. May be NULL.
+ * @param [in] klen     The length of the secret value.
+ * @param [in] ad       The associated data. May be NULL.
+ * @param [in] alen     The length of the associated data.
+ * @param [in] t        The number of passes.
+ * @param [in] m        The memory size in KiB. At least 8 * p.
+ * @param [in] p        The number of lanes - the degree of parallelism.
+ * @param [in] threads  The maximum number of threads to use. 0 means one for
+ *                      each online CPU.
+ * @param [in] tag      The buffer to hold the tag.
+ * @param [in] tlen     The length of the tag. At least 4.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the password length or number of threads
+ *          is negative, the salt is shorter than 8 bytes or the tag is
+ *          shorter than 4 bytes.<br>
+ *          HASH_ERR_BAD_DATA when the type is unknown, t is 0, p is 0 or
+ *          too big or m is less than 8 * p.<br>
+ *          HASH_ERR_NOT_FOUND when no implementation matches the flags.<br>
+ *          HASH_ERR_ALLOC when allocating memory failed.<br>
+ *          0 otherwise.
+ */
+int KDF_argon2(int type, int flags, const unsigned char *pwd, int plen,
+    const unsigned char *salt, size_t slen, const unsigned char *secret,
+    size_t klen, const unsigned char *ad, size_t alen, uint32_t t,
+    uint32_t m, uint32_t p, int threads, unsigned char *tag, size_t tlen)
+{
+    int ret = 0;
+    ARGON2 ctx;
+    ARGON2_WORKER *w = NULL;
+    pthread_t *tid = NULL;
+    size_t len = 0;
+    unsigned char h0[ARGON2_H0_LEN];
+    unsigned char c[ARGON2_BLOCK_SIZE];
+    ARGON2_BLOCK *last;
+    uint32_t l;
+    int i, j, created = 0;
+    long cpus;
+
+    memset(&ctx, 0, sizeof(ctx));
+    if ((pwd == NULL && plen > 0) || (salt == NULL) ||
+        (secret == NULL && klen > 0) || (ad == NULL && alen > 0) ||
+        (tag == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if ((plen < 0) || (threads < 0) || (slen < 8) || (tlen < 4) ||
+        (slen > UINT32_MAX) || (klen > UINT32_MAX) || (alen > UINT32_MAX) ||
+        (tlen > UINT32_MAX))
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    if ((type < KDF_ARGON2_D) || (type > KDF_ARGON2_ID) || (t == 0) ||
+        (p == 0) || (p > ARGON2_MAX_LANES) || (m / 8 < p))
+    {
+        ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+    ctx.g = argon2_g_get(flags);
+    if (ctx.g == NULL)
+    {
+        ret = HASH_ERR_NOT_FOUND;
+        goto end;
+    }
+
+    ctx.type = type;
+    ctx.t = t;
+    ctx.p = p;
+    ctx.m = (m / (ARGON2_SLICES * p)) * (ARGON2_SLICES * p);
+    ctx.q = ctx.m / p;
+    ctx.sl = ctx.q / ARGON2_SLICES;
+
+    len = (size_t)ctx.m * sizeof(ARGON2_BLOCK);
+    ctx.b = kdf_arena_new(&len);
+    if (ctx.b == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+
+    /* First two blocks of each lane. */
+    argon2_h0(h0, type, pwd, plen, salt, slen, secret, klen, ad, alen, t, m,
+        p, tlen);
+    for (l=0; l<p; l++)
+    {
+        for (i=0; i<2; i++)
+        {
+            argon2_le32(h0 + HASH_BLAKE2B_512_LEN, i);
+            argon2_le32(h0 + HASH_BLAKE2B_512_LEN + 4, l);
+            argon2_hprime_block(&ctx.b[l * ctx.q + i], h0, sizeof(h0));
+        }
+    }
+    memset(h0, 0, sizeof(h0));
+
+    if (threads == 0)
+    {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int)cpus : 1;
+    }
+    if ((uint32_t)threads > p)
+        threads = p;
+    ctx.groups = threads;
+
+    w = calloc(threads, sizeof(*w) + sizeof(*tid));
+    if (w == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+    tid = (pthread_t *)(w + threads);
+    pthread_mutex_init(&ctx.sync.lock, NULL);
+    pthread_cond_init(&ctx.sync.cond, NULL);
+    ctx.sync.n = threads;
+    for (i=0; i<threads; i++)
+    {
+        w[i].ctx = &ctx;
+        w[i].lo = i;
+        w[i].hi = i + 1;
+    }
+    /* This thread takes the last group and those of threads not started. */
+    for (; created<threads-1; created++)
+    {
+        if (pthread_create(&tid[created], NULL, &argon2_thread,
+            &w[created]) != 0)
+        {
+            break;
+        }
+    }
+    w[created].hi = threads;
+    if (created < threads - 1)
+    {
+        pthread_mutex_lock(&ctx.sync.lock);
+        ctx.sync.n = created + 1;
+        if (ctx.sync.wait >= ctx.sync.n)
+        {
+            ctx.sync.wait = 0;
+            ctx.sync.gen++;
+            pthread_cond_broadcast(&ctx.sync.cond);
+        }
+        pthread_mutex_unlock(&ctx.sync.lock);
+    }
+    argon2_thread(&w[created]);
+    for (i=0; i<created; i++)
+        pthread_join(tid[i], NULL);
+    pthread_cond_destroy(&ctx.sync.cond);
+    pthread_mutex_destroy(&ctx.sync.lock);
+
+    /* XOR of the last block of each lane. */
+    for (l=1; l<p; l++)
+    {
+        last = &ctx.b[l * ctx.q + ctx.q - 1];
+        for (i=0; i<ARGON2_BLOCK_WORDS; i++)
+            ctx.b[ctx.q - 1].v[i] ^= last->v[i];
+    }
+    last = &ctx.b[ctx.q - 1];
+    for (i=0; i<ARGON2_BLOCK_WORDS; i++)
+    {
+        for (j=0; j<8; j++)
+            c[i * 8 + j] = last->v[i] >> (8 * j);
+    }
+    argon2_hprime(tag, tlen, c, sizeof(c));
+    memset(c, 0, sizeof(c));
+end:
+    free(w);
+    if (ctx.b != NULL)
+        kdf_arena_free(ctx.b, len);
+    return ret;
+}
@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * scrypt (RFC 7914) with PBKDF2-HMAC-SHA-256 from kdf.c.
+ * The words of each 64-byte block are kept in the order that the SSE2 code
+ * of Salsa20/8 wants - the diagonals in vector rows - for the whole of ROMix,
+ * so there is no shuffling of the words in the memory-hard loop.
+ * The V arrays of all threads are in one arena that asks for huge pages so
+ * that the random accesses into V don't miss the TLB on each one.
+ * The p independent ROMix operations are shared between threads.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "kdf.h"
+#include "kdf_arena.h"
+
+#ifdef CPU_X86_64
+#include <emmintrin.h>
+#endif
+
+/** The number of 32-bit words in a Salsa20 block. */
+#define SCRYPT_BLOCK_WORDS	16
+/** The alignment of each thread's memory in the arena. */
+#define SCRYPT_ALIGN		64
+
+/** The parameters and memory shared by the threads doing ROMix. */
+typedef struct scrypt_job_st
+{
+    /** The blocks B of PBKDF2 output - p of them each 128 * r bytes. */
+    unsigned char *b;
+    /** The cost parameter. */
+    uint64_t n;
+    /** The block size parameter. */
+    uint32_t r;
+    /** The parallelization parameter. */
+    uint32_t p;
+    /** The memory arena - V, X and Y for each thread. */
+    uint32_t *arena;
+    /** The number of 32-bit words of arena for each thread. */
+    size_t words;
+    /** The next block of B to mix. Taken atomically. */
+    uint32_t next;
+    /** The next slot in the arena. Taken atomically. */
+    uint32_t slot;
+} SCRYPT_JOB;
+
+#ifdef CPU_X86_64
+/** Rotate the 32-bit words of a vector left. */
+#define ROTL_EPI32(t, n)						\
+    _mm_xor_si128(_mm_slli_epi32(t, n), _mm_srli_epi32(t, 32 - n))
+
+/**
+ * Salsa20/8 core on a block in diagonal order: B = B + Salsa20/8(B).
+ * Row 0 has words 0, 5, 10 and 15, so a column of the state is a vector and
+ * rotating the rows turns the rows of the state into vectors.
+ *
+ * @param [in] b  The block to update in place.
+ */
+static void scrypt_salsa20_8(uint32_t *b)
+{
+    __m128i *v = (__m128i *)b;
+    __m128i x0 = v[0], x1 = v[1], x2 = v[2], x3 = v[3];
+    __m128i t;
+    int i;
+
+    for (i=0; i<8; i+=2)
+    {
+        /* Columns. */
+        t = _mm_add_epi32(x0, x3);
+        x1 = _mm_xor_si128(x1, ROTL_EPI32(t, 7));
+        t = _mm_add_epi32(x1, x0);
+        x2 = _mm_xor_si128(x2, ROTL_EPI32(t, 9));
+        t = _mm_add_epi32(x2, x1);
+        x3 = _mm_xor_si128(x3, ROTL_EPI32(t, 13));
+        t = _mm_add_epi32(x3, x2);
+        x0 = _mm_xor_si128(x0, ROTL_EPI32(t, 18));
+
+        x1 = _mm_shuffle_epi32(x1, 0x93);
+        x2 = _mm_shuffle_epi32(x2, 0x4e);
+        x3 = _mm_shuffle_epi32(x3, 0x39);
+
+        /* Rows. */
+        t = _mm_add_epi32(x0, x1);
+        x3 = _mm_xor_si128(x3, ROTL_EPI32(t, 7));
+        t = _mm_add_epi32(x3, x0);
+        x2 = _mm_xor_si128(x2, ROTL_EPI32(t, 9));
+        t = _mm_add_epi32(x2, x3);
+        x1 = _mm_xor_si128(x1, ROTL_EPI32(t, 13));
+        t = _mm_add_epi32(x1, x2);
+        x0 = _mm_xor_si128(x0, ROTL_EPI32(t, 18));
+
+        x1 = _mm_shuffle_epi32(x1, 0x39);
+        x2 = _mm_shuffle_epi32(x2, 0x4e);
+        x3 = _mm_shuffle_epi32(x3, 0x93);
+    }
+
+    v[0] = _mm_add_epi32(v[0], x0);
+    v[1] = _mm_add_epi32(v[1], x1);
+    v[2] = _mm_add_epi32(v[2], x2);
+    v[3] = _mm_add_epi32(v[3], x3);
+}
+
+/**
+ * BlockMix with Salsa20/8: Y = BlockMix(X).
+ * The XOR of the previous block is done in vectors as each block is mixed.
+ *
+ * @param [in] x  The 2 * r blocks to mix.
+ * @param [in] y  The 2 * r blocks to hold the output.
+ * @param [in] r  The block size parameter.
+ */
+static void scrypt_block_mix(const uint32_t *x, uint32_t *y, uint32_t r)
+{
+    const __m128i *xv = (const __m128i *)x;
+    __m128i t[4];
+    __m128i *d;
+    uint32_t i;
+
+    memcpy(t, x + (2 * r - 1) * SCRYPT_BLOCK_WORDS, sizeof(t));
+    for (i=0; i<2*r; i++, xv+=4)
+    {
+        t[0] = _mm_xor_si128(t[0], xv[0]);
+        t[1] = _mm_xor_si128(t[1], xv[1]);
+        t[2] = _mm_xor_si128(t[2], xv[2]);
+        t[3] = _mm_xor_si128(t[3], xv[3]);
+        scrypt_salsa20_8((uint32_t *)t);
+        /* Even blocks to the first half, odd blocks to the second. */
+        d = (__m128i *)(y + ((i & 1) * r + (i >> 1)) * SCRYPT_BLOCK_WORDS);
+        d[0] = t[0];
+        d[1] = t[1];
+        d[2] = t[2];
+        d[3] = t[3];
+    }
+}
+
+/**
+ * XOR the blocks of one array into another: x ^= v.
+ *
+ * @param [in] x    The blocks to update.
+ * @param [in] v    The blocks to XOR in.
+ * @param [in] len  The number of 32-bit words.
+ */
+static void scrypt_xor(uint32_t *x, const uint32_t *v, size_t len)
+{
+    __m128i *xv = (__m128i *)x;
+    const __m128i *vv = (const __m128i *)v;
+    size_t i;
+
+    for (i=0; i<len/4; i++)
+        xv[i] = _mm_xor_si128(xv[i], vv[i]);
+}
+#else
+/** Rotate a 32-bit word left. */
+#define ROTL32(a, n)	(((a) << (n)) | ((a) >> (32 - (n))))
+
+/** The index of word i of a block in diagonal order. */
+#define D(i)		(((i) * 13) & 15)
+/** A quarter-round on words a, b, c and d of a block in diagonal order. */
+#define QR(x, a, b, c, d)						\
+    x[D(b)] ^= ROTL32(x[D(a)] + x[D(d)], 7);				\
+    x[D(c)] ^= ROTL32(x[D(b)] + x[D(a)], 9);				\
+    x[D(d)] ^= ROTL32(x[D(c)] + x[D(b)], 13);				\
+    x[D(a)] ^= ROTL32(x[D(d)] + x[D(c)], 18)
+
+/**
+ * Salsa20/8 core on a block in diagonal order: B = B + Salsa20/8(B).
+ * Word i of the block is at index 13 * i modulo 16.
+ *
+ * @param [in] b  The block to update in place.
+ */
+static void scrypt_salsa20_8(uint32_t *b)
+{
+    uint32_t x[SCRYPT_BLOCK_WORDS];
+    int i;
+
+    memcpy(x, b, sizeof(x));
+    for (i=0; i<8; i+=2)
+    {
+        /* Columns. */
+        QR(x,  0,  4,  8, 12);
+        QR(x,  5,  9, 13,  1);
+        QR(x, 10, 14,  2,  6);
+        QR(x, 15,  3,  7, 11);
+        /* Rows. */
+        QR(x,  0,  1,  2,  3);
+        QR(x,  5,  6,  7,  4);
+        QR(x, 10, 11,  8,  9);
+        QR(x, 15, 12, 13, 14);
+    }
+    for (i=0; i<SCRYPT_BLOCK_WORDS; i++)
+        b[i] += x[i];
+}
+
+/**
+ * BlockMix with Salsa20/8: Y = BlockMix(X).
+ *
+ * @param [in] x  The 2 * r blocks to mix.
+ * @param [in] y  The 2 * r blocks to hold the output.
+ * @param [in] r  The block size parameter.
+ */
+static void scrypt_block_mix(const uint32_t *x, uint32_t *y, uint32_t r)
+{
+    uint32_t t[SCRYPT_BLOCK_WORDS];
+    uint32_t i, j;
+
+    memcpy(t, x + (2 * r - 1) * SCRYPT_BLOCK_WORDS, sizeof(t));
+    for (i=0; i<2*r; i++, x+=SCRYPT_BLOCK_WORDS)
+    {
+        for (j=0; j<SCRYPT_BLOCK_WORDS; j++)
+            t[j] ^= x[j];
+        scrypt_salsa20_8(t);
+        /* Even blocks to the first half, odd blocks to the second. */
+        memcpy(y + ((i & 1) * r + (i >> 1)) * SCRYPT_BLOCK_WORDS, t,
+            sizeof(t));
+    }
+}
+
+/**
+ * XOR the blocks of one array into another: x ^= v.
+ *
+ * @param [in] x    The blocks to update.
+ * @param [in] v    The blocks to XOR in.
+ * @param [in] len  The number of 32-bit words.
+ */
+static void scrypt_xor(uint32_t *x, const uint32_t *v, size_t len)
+{
+    size_t i;
+
+    for (i=0; i<len; i++)
+        x[i] ^= v[i];
+}
+#endif
+
+/**
+ * ROMix: mix a block of B with N blocks of memory.
+ * The bytes are loaded into words in diagonal order and stored back in
+ * little-endian order.
+ *
+ * @param [in] b  The 128 * r bytes to mix in place.
+ * @param [in] n  The cost parameter.
+ * @param [in] r  The block size parameter.
+ * @param [in] v  The memory - N * 32 * r words followed by X and Y.
+ */
+static void scrypt_romix(unsigned char *b, uint64_t n, uint32_t r,
+    uint32_t *v)
+{
+    size_t len = 32 * (size_t)r;
+    uint32_t *x = v + n * len;
+    uint32_t *y = x + len;
+    uint32_t *last;
+    uint64_t i, j;
+    size_t k, w;
+    unsigned char *p;
+
+    for (k=0; k<len; k++)
+    {
+        p = b + k * 4;
+        w = (k & ~(size_t)15) + ((k * 13) & 15);
+        x[w] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+               ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    /* Two BlockMix per loop so X and Y swap back. */
+    for (i=0; i<n; i+=2)
+    {
+        memcpy(v + i * len, x, len * 4);
+        scrypt_block_mix(x, v + (i + 1) * len, r);
+        scrypt_block_mix(v + (i + 1) * len, x, r);
+    }
+    for (i=0; i<n; i+=2)
+    {
+        /* Integerify: words 0 and 1 - at 0 and 13 - of the last block. */
+        last = x + len - SCRYPT_BLOCK_WORDS;
+        j = (last[0] | ((uint64_t)last[13] << 32)) & (n - 1);
+        scrypt_xor(x, v + j * len, len);
+        scrypt_block_mix(x, y, r);
+        last = y + len - SCRYPT_BLOCK_WORDS;
+        j = (last[0] | ((uint64_t)last[13] << 32)) & (n - 1);
+        scrypt_xor(y, v + j * len, len);
+        scrypt_block_mix(y, x, r);
+    }
+
+    for (k=0; k<len; k++)
+    {
+        p = b + k * 4;
+        w = x[(k & ~(size_t)15) + ((k * 13) & 15)];
+        p[0] = w;
+        p[1] = w >> 8;
+        p[2] = w >> 16;
+        p[3] = w >> 24;
+    }
+    memset(x, 0, len * 2 * 4);
+}
+
+/**
+ * Thread that takes blocks of B and mixes them until none are left.
+ *
+ * @param [in] arg  The scrypt job.
+ * @return  NULL.
+ */
+static void *scrypt_thread(void *arg)
+{
+    SCRYPT_JOB *job = arg;
+    uint32_t slot = __atomic_fetch_add(&job->slot, 1, __ATOMIC_RELAXED);
+    uint32_t *v = job->arena + slot * job->words;
+    uint32_t i;
+
+    while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+        job->p)
+    {
+        scrypt_romix(job->b + (size_t)i * 128 * job->r, job->n, job->r, v);
+    }
+    return NULL;
+}
+
+/**
+ * Derive a key from a password with scrypt.
+ * PBKDF2-HMAC-SHA-256 with one iteration produces p blocks of 128 * r bytes
+ * that are each mixed by ROMix with N * 128 * r bytes of memory. The blocks
+ * are mixed by up to threads threads - each with its own memory - so the
+ * memory used is the number of threads times N * 128 * r bytes.
+ *
+ * @param [in] pwd      The password.
+ * @param [in] plen     The length of the password.
+ * @param [in] salt     The salt.
+ * @param [in] slen     The length of the salt.
+ * @param [in] n        The cost parameter. A power of 2 greater than 1.
+ * @param [in] r        The block size parameter.
+ * @param [in] p        The parallelization parameter.
+ * @param [in] threads  The maximum number of threads to use. 0 means one for
+ *                      each online CPU.
+ * @param [in] key      The buffer to hold the key.
+ * @param [in] klen     The length of the key to derive.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the password length or number of threads
+ *          is negative.<br>
+ *          HASH_ERR_BAD_DATA when N is not a power of 2 greater than 1, r or
+ *          p is 0 or r * p is 2^30 or more.<br>
+ *          HASH_ERR_ALLOC when allocating memory failed.<br>
+ *          0 otherwise.
+ */
+int KDF_scrypt(const unsigned char *pwd, int plen, const unsigned char *salt,
+    size_t slen, uint64_t n, uint32_t r, uint32_t p, int threads,
+    unsigned char *key, size_t klen)
+{
+    int ret = 0;
+    SCRYPT_JOB job;
+    size_t blen = 0, alen = 0;
+    pthread_t *tid = NULL;
+    int i, created = 0;
+    long cpus;
+
+    memset(&job, 0, sizeof(job));
+    if ((pwd == NULL && plen > 0) || (salt == NULL && slen > 0) ||
+        (key == NULL && klen > 0))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if ((plen < 0) || (threads < 0))
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    if ((n < 2) || ((n & (n - 1)) != 0) || (r == 0) || (p == 0) ||
+        ((uint64_t)r * p >= ((uint64_t)1 << 30)) ||
+        (n > SIZE_MAX / 256 / r / 2))
+    {
+        ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+
+    if (threads == 0)
+    {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int)cpus : 1;
+    }
+    if ((uint32_t)threads > p)
+        threads = p;
+
+    job.n = n;
+    job.r = r;
+    job.p = p;
+    /* V of N blocks then X and Y, rounded up for alignment. */
+    job.words = ((n + 2) * 32 * r + SCRYPT_ALIGN / 4 - 1) &
+        ~(size_t)(SCRYPT_ALIGN / 4 - 1);
+
+    blen = (size_t)p * 128 * r;
+    job.b = malloc(blen);
+    if (job.b == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+    ret = KDF_pbkdf2(MAC_ID_SHA256, pwd, plen, salt, slen, 1, job.b, blen);
+    if (ret != 0)
+        goto end;
+
+    /* Fewer threads when there isn't the memory for all of them. */
+    for (; threads > 0; threads /= 2)
+    {
+        if (job.words > SIZE_MAX / 4 / threads)
+            continue;
+        alen = threads * job.words * 4;
+        job.arena = kdf_arena_new(&alen);
+        if (job.arena != NULL)
+            break;
+    }
+    if (job.arena == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+
+    if (threads > 1)
+    {
+        tid = malloc((threads - 1) * sizeof(*tid));
+        for (i=0; (tid != NULL) && (i<threads-1); i++)
+        {
+            if (pthread_create(&tid[i], NULL, &scrypt_thread, &job) != 0)
+                break;
+            created++;
+        }
+    }
+    /* This thread mixes too - and does all the work when none started. */
+    scrypt_thread(&job);
+    for (i=0; i<created; i++)
+        pthread_join(tid[i], NULL);
+
+    ret = KDF_pbkdf2(MAC_ID_SHA256, pwd, plen, job.b, blen, 1, key, klen);
+end:
+    free(tid);
+    if (job.arena != NULL)
+        kdf_arena_free(job.arena, alen);
+    if (job.b != NULL)
+    {
+        memset(job.b, 0, blen);
+        free(job.b);
+    }
+    return ret;
+}
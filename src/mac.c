@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "mac.h"
 #include "hash.h"
 #include "hash_sha1.h"
@@ -29,34 +30,12 @@
 #include "hash_sha3.h"
 #include "hash_blake2b.h"
 #include "hash_blake2s.h"
-
-/** The MAC initialization function prototype. */
-typedef int MAC_INIT(void *, const void *, size_t);
-/** The MAC update function prototype. */
-typedef int MAC_UPDATE(void *, const void *, size_t);
-/** The MAC final function prototype. */
-typedef int MAC_FINAL(unsigned char *, void *);
-
-/** The method table entry for MAC functions. */
-typedef struct mac_meth_st
-{
-    /** Name of implementation. */
-    char *name;
-    /** Flags of the implementaiton. */
-    uint8_t flags;
-    /** The MAC algorithm identifier. */
-    MAC_ID id;
-    /** The length of the MAC algorithm output. */
-    int len;
-    /** The length of the context required for the MAC algorithm. */
-    int ctx_len;
-    /** The initialization function of the MAC algorithm. */
-    MAC_INIT *init;
-    /** The update function of the MAC algorithm. */
-    MAC_UPDATE *update;
-    /** The finalization function of the MAC algorithm. */
-    MAC_FINAL *final;
-} MAC_METH;
+#include "mac_poly1305.h"
+#include "mac_siphash.h"
+#include "hash_openssl.h"
+#include "hash_cpu.h"
+#include "hash_meth.h"
+#include "mac_meth.h"
 
 /** The MAC structure. */
 struct mac_st
@@ -67,124 +46,450 @@ struct mac_st
     void *ctx;
 };
 
+/** The MAC key structure: the context after initializing with the key. */
+struct mac_key_st
+{
+    /** The MAC algorithm method. */
+    MAC_METH *meth;
+    /** The context initialized with the key. Only read after creation. */
+    void *ctx;
+};
+
 /**
  * The MAC algorithm implementations.
- * The first entry with the matching identifier is used.
+ * Implementations are ranked by priority and those needing CPU features that
+ * are not available are never used.
  */
 static MAC_METH mac_meths[] =
 {
+#ifdef OPT_HASH_OPENSSL
+    /* OpenSSL implementation of HMAC SHA-1. */
+    { "HMAC-SHA-1 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA1, HASH_SHA1_LEN, sizeof(HMAC_OPENSSL), 0,
+      (MAC_INIT *)&hmac_openssl_sha1_init,
+      (MAC_UPDATE *)&hmac_openssl_update,
+      (MAC_FINAL *)&hmac_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hmac_openssl_dup,
+      (MAC_CLEANUP *)&hmac_openssl_cleanup },
+    /* OpenSSL implementation of HMAC SHA-224. */
+    { "HMAC-SHA-224 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA224, HASH_SHA224_LEN, sizeof(HMAC_OPENSSL), 0,
+      (MAC_INIT *)&hmac_openssl_sha224_init,
+      (MAC_UPDATE *)&hmac_openssl_update,
+      (MAC_FINAL *)&hmac_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hmac_openssl_dup,
+      (MAC_CLEANUP *)&hmac_openssl_cleanup },
+    /* OpenSSL implementation of HMAC SHA-256. */
+    { "HMAC-SHA-256 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA256, HASH_SHA256_LEN, sizeof(HMAC_OPENSSL), 0,
+      (MAC_INIT *)&hmac_openssl_sha256_init,
+      (MAC_UPDATE *)&hmac_openssl_update,
+      (MAC_FINAL *)&hmac_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hmac_openssl_dup,
+      (MAC_CLEANUP *)&hmac_openssl_cleanup },
+    /* OpenSSL implementation of HMAC SHA-384. */
+    { "HMAC-SHA-384 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA384, HASH_SHA384_LEN, sizeof(HMAC_OPENSSL), 0,
+      (MAC_INIT *)&hmac_openssl_sha384_init,
+      (MAC_UPDATE *)&hmac_openssl_update,
+      (MAC_FINAL *)&hmac_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hmac_openssl_dup,
+      (MAC_CLEANUP *)&hmac_openssl_cleanup },
+    /* OpenSSL implementation of HMAC SHA-512. */
+    { "HMAC-SHA-512 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA512, HASH_SHA512_LEN, sizeof(HMAC_OPENSSL), 0,
+      (MAC_INIT *)&hmac_openssl_sha512_init,
+      (MAC_UPDATE *)&hmac_openssl_update,
+      (MAC_FINAL *)&hmac_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hmac_openssl_dup,
+      (MAC_CLEANUP *)&hmac_openssl_cleanup },
+    /* OpenSSL implementation of HMAC SHA-512_224. */
+    { "HMAC-SHA-512_224 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA512_224, HASH_SHA512_224_LEN, sizeof(HMAC_OPENSSL), 0,
+      (MAC_INIT *)&hmac_openssl_sha512_224_init,
+      (MAC_UPDATE *)&hmac_openssl_update,
+      (MAC_FINAL *)&hmac_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hmac_openssl_dup,
+      (MAC_CLEANUP *)&hmac_openssl_cleanup },
+    /* OpenSSL implementation of HMAC SHA-512_256. */
+    { "HMAC-SHA-512_256 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA512_256, HASH_SHA512_256_LEN, sizeof(HMAC_OPENSSL), 0,
+      (MAC_INIT *)&hmac_openssl_sha512_256_init,
+      (MAC_UPDATE *)&hmac_openssl_update,
+      (MAC_FINAL *)&hmac_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hmac_openssl_dup,
+      (MAC_CLEANUP *)&hmac_openssl_cleanup },
+    /* OpenSSL implementation of SHA3-224. */
+    { "SHA-3_224 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA3_224, HASH_SHA3_224_LEN, sizeof(HASH_OPENSSL), 0,
+      (MAC_INIT *)&hash_openssl_sha3_224_mac_init,
+      (MAC_UPDATE *)&hash_openssl_update,
+      (MAC_FINAL *)&hash_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hash_openssl_dup,
+      (MAC_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHA3-256. */
+    { "SHA-3_256 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA3_256, HASH_SHA3_256_LEN, sizeof(HASH_OPENSSL), 0,
+      (MAC_INIT *)&hash_openssl_sha3_256_mac_init,
+      (MAC_UPDATE *)&hash_openssl_update,
+      (MAC_FINAL *)&hash_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hash_openssl_dup,
+      (MAC_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHA3-384. */
+    { "SHA-3_384 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA3_384, HASH_SHA3_384_LEN, sizeof(HASH_OPENSSL), 0,
+      (MAC_INIT *)&hash_openssl_sha3_384_mac_init,
+      (MAC_UPDATE *)&hash_openssl_update,
+      (MAC_FINAL *)&hash_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hash_openssl_dup,
+      (MAC_CLEANUP *)&hash_openssl_cleanup },
+    /* OpenSSL implementation of SHA3-512. */
+    { "SHA-3_512 OpenSSL", MAC_METH_FLAG_OPENSSL, HASH_METH_PRIO_OPENSSL,
+      MAC_ID_SHA3_512, HASH_SHA3_512_LEN, sizeof(HASH_OPENSSL), 0,
+      (MAC_INIT *)&hash_openssl_sha3_512_mac_init,
+      (MAC_UPDATE *)&hash_openssl_update,
+      (MAC_FINAL *)&hash_openssl_final,
+      NULL, NULL,
+      (MAC_DUP *)&hash_openssl_dup,
+      (MAC_CLEANUP *)&hash_openssl_cleanup },
+#endif
+#ifdef CPU_X86_64
+    /* Implementation of HMAC SHA-1 using the SHA extensions. */
+    { "HMAC-SHA-1 SHA-NI", MAC_METH_FLAG_INTERNAL | MAC_METH_FLAG_SHANI,
+      HASH_METH_PRIO_CPU,
+      MAC_ID_SHA1, HASH_SHA1_LEN, 2*sizeof(HASH_SHA1), 0,
+      (MAC_INIT *)&hmac_sha1_ni_init,
+      (MAC_UPDATE *)&hash_sha1_ni_update,
+      (MAC_FINAL *)&hmac_sha1_ni_final,
+      NULL,
+      (MAC_ITERATE *)&hmac_sha1_ni_iterate,
+      NULL, NULL },
+    /* Implementation of HMAC SHA-224 using the SHA extensions. */
+    { "HMAC-SHA-224 SHA-NI", MAC_METH_FLAG_INTERNAL | MAC_METH_FLAG_SHANI,
+      HASH_METH_PRIO_CPU,
+      MAC_ID_SHA224, HASH_SHA224_LEN, 2*sizeof(HASH_SHA256), 0,
+      (MAC_INIT *)&hmac_sha224_ni_init,
+      (MAC_UPDATE *)&hash_sha256_ni_update,
+      (MAC_FINAL *)&hmac_sha224_ni_final,
+      NULL,
+      (MAC_ITERATE *)&hmac_sha224_ni_iterate,
+      NULL, NULL },
+    /* Implementation of HMAC SHA-256 using the SHA extensions. */
+    { "HMAC-SHA-256 SHA-NI", MAC_METH_FLAG_INTERNAL | MAC_METH_FLAG_SHANI,
+      HASH_METH_PRIO_CPU,
+      MAC_ID_SHA256, HASH_SHA256_LEN, 2*sizeof(HASH_SHA256), 0,
+      (MAC_INIT *)&hmac_sha256_ni_init,
+      (MAC_UPDATE *)&hash_sha256_ni_update,
+      (MAC_FINAL *)&hmac_sha256_ni_final,
+      NULL,
+      (MAC_ITERATE *)&hmac_sha256_ni_iterate,
+      NULL, NULL },
+    /* HMAC SHA-224 with many messages processed at once using AVX2 - batch and
+     * iterate only. */
+    { "HMAC-SHA-224 AVX2 batch", MAC_METH_FLAG_INTERNAL | MAC_METH_FLAG_AVX2,
+      HASH_METH_PRIO_BATCH,
+      MAC_ID_SHA224, HASH_SHA224_LEN, 2*sizeof(HASH_SHA256), 0,
+      (MAC_INIT *)&hmac_sha224_init,
+      (MAC_UPDATE *)&hash_sha256_update,
+      (MAC_FINAL *)&hmac_sha224_final,
+      (MAC_BATCH *)&hmac_sha224_avx2_batch,
+      (MAC_ITERATE *)&hmac_sha224_avx2_iterate,
+      NULL, NULL },
+    /* HMAC SHA-256 with many messages processed at once using AVX2 - batch and
+     * iterate only. */
+    { "HMAC-SHA-256 AVX2 batch", MAC_METH_FLAG_INTERNAL | MAC_METH_FLAG_AVX2,
+      HASH_METH_PRIO_BATCH,
+      MAC_ID_SHA256, HASH_SHA256_LEN, 2*sizeof(HASH_SHA256), 0,
+      (MAC_INIT *)&hmac_sha256_init,
+      (MAC_UPDATE *)&hash_sha256_update,
+      (MAC_FINAL *)&hmac_sha256_final,
+      (MAC_BATCH *)&hmac_sha256_avx2_batch,
+      (MAC_ITERATE *)&hmac_sha256_avx2_iterate,
+      NULL, NULL },
+    /* Poly1305 with four blocks at once using AVX2. */
+    { "Poly1305 AVX2", MAC_METH_FLAG_INTERNAL | MAC_METH_FLAG_AVX2,
+      HASH_METH_PRIO_CPU,
+      MAC_ID_POLY1305, MAC_POLY1305_LEN, sizeof(MAC_POLY1305), 0,
+      (MAC_INIT *)&mac_poly1305_avx2_init,
+      (MAC_UPDATE *)&mac_poly1305_avx2_update,
+      (MAC_FINAL *)&mac_poly1305_final,
+      NULL, NULL, NULL, NULL },
+    /* SipHash-2-4 with four messages at once using AVX2. */
+    { "SipHash-2-4 AVX2", MAC_METH_FLAG_INTERNAL | MAC_METH_FLAG_AVX2,
+      HASH_METH_PRIO_CPU,
+      MAC_ID_SIPHASH_2_4, MAC_SIPHASH_LEN, sizeof(MAC_SIPHASH), 0,
+      (MAC_INIT *)&mac_siphash_2_4_init,
+      (MAC_UPDATE *)&mac_siphash_update,
+      (MAC_FINAL *)&mac_siphash_final,
+      (MAC_BATCH *)&mac_siphash_2_4_avx2_batch,
+      NULL, NULL, NULL },
+    /* SipHash-1-3 with four messages at once using AVX2. */
+    { "SipHash-1-3 AVX2", MAC_METH_FLAG_INTERNAL | MAC_METH_FLAG_AVX2,
+      HASH_METH_PRIO_CPU,
+      MAC_ID_SIPHASH_1_3, MAC_SIPHASH_LEN, sizeof(MAC_SIPHASH), 0,
+      (MAC_INIT *)&mac_siphash_1_3_init,
+      (MAC_UPDATE *)&mac_siphash_update,
+      (MAC_FINAL *)&mac_siphash_final,
+      (MAC_BATCH *)&mac_siphash_1_3_avx2_batch,
+      NULL, NULL, NULL },
+#endif
     /* Implementation of HMAC SHA-1. */
-    { "HMAC-SHA-1 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA1, HASH_SHA1_LEN, 2*sizeof(HASH_SHA1),
+    { "HMAC-SHA-1 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA1, HASH_SHA1_LEN, 2*sizeof(HASH_SHA1), 0,
       (MAC_INIT *)&hmac_sha1_init,
       (MAC_UPDATE *)&hash_sha1_update,
-      (MAC_FINAL *)&hmac_sha1_final },
+      (MAC_FINAL *)&hmac_sha1_final,
+      NULL,
+      (MAC_ITERATE *)&hmac_sha1_iterate,
+      NULL, NULL },
     /* Implementation of HMAC SHA-224. */
-    { "HMAC-SHA-224 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA224, HASH_SHA224_LEN, 2*sizeof(HASH_SHA256),
+    { "HMAC-SHA-224 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA224, HASH_SHA224_LEN, 2*sizeof(HASH_SHA256), 0,
       (MAC_INIT *)&hmac_sha224_init,
       (MAC_UPDATE *)&hash_sha256_update,
-      (MAC_FINAL *)&hmac_sha224_final },
+      (MAC_FINAL *)&hmac_sha224_final,
+      NULL,
+      (MAC_ITERATE *)&hmac_sha224_iterate,
+      NULL, NULL },
     /* Implementation of HMAC SHA-256. */
-    { "HMAC-SHA-256 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA256, HASH_SHA256_LEN, 2*sizeof(HASH_SHA256),
+    { "HMAC-SHA-256 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA256, HASH_SHA256_LEN, 2*sizeof(HASH_SHA256), 0,
       (MAC_INIT *)&hmac_sha256_init,
       (MAC_UPDATE *)&hash_sha256_update,
-      (MAC_FINAL *)&hmac_sha256_final },
+      (MAC_FINAL *)&hmac_sha256_final,
+      NULL,
+      (MAC_ITERATE *)&hmac_sha256_iterate,
+      NULL, NULL },
     /* Implementation of HMAC SHA-384. */
-    { "HMAC-SHA-384 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA384, HASH_SHA384_LEN, 2*sizeof(HASH_SHA512),
+    { "HMAC-SHA-384 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA384, HASH_SHA384_LEN, 2*sizeof(HASH_SHA512), 0,
       (MAC_INIT *)&hmac_sha384_init,
       (MAC_UPDATE *)&hash_sha512_update,
-      (MAC_FINAL *)&hmac_sha384_final },
+      (MAC_FINAL *)&hmac_sha384_final,
+      NULL,
+      (MAC_ITERATE *)&hmac_sha384_iterate,
+      NULL, NULL },
     /* Implementation of HMAC SHA-512. */
-    { "HMAC-SHA-512 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA512, HASH_SHA512_LEN, 2*sizeof(HASH_SHA512),
+    { "HMAC-SHA-512 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA512, HASH_SHA512_LEN, 2*sizeof(HASH_SHA512), 0,
       (MAC_INIT *)&hmac_sha512_init,
       (MAC_UPDATE *)&hash_sha512_update,
-      (MAC_FINAL *)&hmac_sha512_final },
+      (MAC_FINAL *)&hmac_sha512_final,
+      NULL,
+      (MAC_ITERATE *)&hmac_sha512_iterate,
+      NULL, NULL },
     /* Implementation of HMAC SHA-512_224. */
-    { "HMAC-SHA-512_224 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA512_224, HASH_SHA512_224_LEN, 2*sizeof(HASH_SHA512),
+    { "HMAC-SHA-512_224 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA512_224, HASH_SHA512_224_LEN, 2*sizeof(HASH_SHA512), 0,
       (MAC_INIT *)&hmac_sha512_224_init,
       (MAC_UPDATE *)&hash_sha512_update,
-      (MAC_FINAL *)&hmac_sha512_224_final },
+      (MAC_FINAL *)&hmac_sha512_224_final,
+      NULL,
+      (MAC_ITERATE *)&hmac_sha512_224_iterate,
+      NULL, NULL },
     /* Implementation of HMAC SHA-512_256. */
-    { "HMAC-SHA-512_256 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA512_256, HASH_SHA512_256_LEN, 2*sizeof(HASH_SHA512),
+    { "HMAC-SHA-512_256 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA512_256, HASH_SHA512_256_LEN, 2*sizeof(HASH_SHA512), 0,
       (MAC_INIT *)&hmac_sha512_256_init,
       (MAC_UPDATE *)&hash_sha512_update,
-      (MAC_FINAL *)&hmac_sha512_256_final },
+      (MAC_FINAL *)&hmac_sha512_256_final,
+      NULL,
+      (MAC_ITERATE *)&hmac_sha512_256_iterate,
+      NULL, NULL },
     /* Implementation of SHA3-224. */
-    { "SHA-3_224 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA3_224, HASH_SHA3_224_LEN, sizeof(HASH_SHA3),
+    { "SHA-3_224 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA3_224, HASH_SHA3_224_LEN, sizeof(HASH_SHA3), 0,
       (MAC_INIT *)&hash_sha3_224_mac_init,
       (MAC_UPDATE *)&hash_sha3_224_update,
-      (MAC_FINAL *)&hash_sha3_224_final },
+      (MAC_FINAL *)&hash_sha3_224_final,
+      NULL, NULL, NULL, NULL },
     /* Implementation of SHA3-256. */
-    { "SHA-3_256 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA3_256, HASH_SHA3_256_LEN, sizeof(HASH_SHA3),
+    { "SHA-3_256 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA3_256, HASH_SHA3_256_LEN, sizeof(HASH_SHA3), 0,
       (MAC_INIT *)&hash_sha3_256_mac_init,
       (MAC_UPDATE *)&hash_sha3_256_update,
-      (MAC_FINAL *)&hash_sha3_256_final },
+      (MAC_FINAL *)&hash_sha3_256_final,
+      NULL, NULL, NULL, NULL },
     /* Implementation of SHA3-384. */
-    { "SHA-3_384 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA3_384, HASH_SHA3_384_LEN, sizeof(HASH_SHA3),
+    { "SHA-3_384 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA3_384, HASH_SHA3_384_LEN, sizeof(HASH_SHA3), 0,
       (MAC_INIT *)&hash_sha3_384_mac_init,
       (MAC_UPDATE *)&hash_sha3_384_update,
-      (MAC_FINAL *)&hash_sha3_384_final },
+      (MAC_FINAL *)&hash_sha3_384_final,
+      NULL, NULL, NULL, NULL },
     /* Implementation of SHA3-512. */
-    { "SHA-3_512 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_SHA3_512, HASH_SHA3_512_LEN, sizeof(HASH_SHA3),
+    { "SHA-3_512 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SHA3_512, HASH_SHA3_512_LEN, sizeof(HASH_SHA3), 0,
       (MAC_INIT *)&hash_sha3_512_mac_init,
       (MAC_UPDATE *)&hash_sha3_512_update,
-      (MAC_FINAL *)&hash_sha3_512_final },
+      (MAC_FINAL *)&hash_sha3_512_final,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2B with 224-bit output. */
-    { "BLAKE2b_224 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_BLAKE2B_224, HASH_BLAKE2B_224_LEN, sizeof(HASH_BLAKE2B),
+    { "BLAKE2b_224 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_BLAKE2B_224, HASH_BLAKE2B_224_LEN, sizeof(HASH_BLAKE2B), 0,
       (MAC_INIT *)&hash_blake2b_224_mac_init,
       (MAC_UPDATE *)&hash_blake2b_update,
-      (MAC_FINAL *)&hash_blake2b_224_final },
+      (MAC_FINAL *)&hash_blake2b_224_final,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2B with 256-bit output. */
-    { "BLAKE2b_256 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_BLAKE2B_256, HASH_BLAKE2B_256_LEN, sizeof(HASH_BLAKE2B),
+    { "BLAKE2b_256 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_BLAKE2B_256, HASH_BLAKE2B_256_LEN, sizeof(HASH_BLAKE2B), 0,
       (MAC_INIT *)&hash_blake2b_256_mac_init,
       (MAC_UPDATE *)&hash_blake2b_update,
-      (MAC_FINAL *)&hash_blake2b_256_final },
+      (MAC_FINAL *)&hash_blake2b_256_final,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2B with 384-bit output. */
-    { "BLAKE2b_384 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_BLAKE2B_384, HASH_BLAKE2B_384_LEN, sizeof(HASH_BLAKE2B),
+    { "BLAKE2b_384 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_BLAKE2B_384, HASH_BLAKE2B_384_LEN, sizeof(HASH_BLAKE2B), 0,
       (MAC_INIT *)&hash_blake2b_384_mac_init,
       (MAC_UPDATE *)&hash_blake2b_update,
-      (MAC_FINAL *)&hash_blake2b_384_final },
+      (MAC_FINAL *)&hash_blake2b_384_final,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2B with 512-bit output. */
-    { "BLAKE2b_512 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_BLAKE2B_512, HASH_BLAKE2B_512_LEN, sizeof(HASH_BLAKE2B),
+    { "BLAKE2b_512 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_BLAKE2B_512, HASH_BLAKE2B_512_LEN, sizeof(HASH_BLAKE2B), 0,
       (MAC_INIT *)&hash_blake2b_512_mac_init,
       (MAC_UPDATE *)&hash_blake2b_update,
-      (MAC_FINAL *)&hash_blake2b_512_final },
+      (MAC_FINAL *)&hash_blake2b_512_final,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2S with 224-bit output. */
-    { "BLAKE2s_224 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_BLAKE2S_224, HASH_BLAKE2S_224_LEN, sizeof(HASH_BLAKE2S),
+    { "BLAKE2s_224 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_BLAKE2S_224, HASH_BLAKE2S_224_LEN, sizeof(HASH_BLAKE2S), 0,
       (MAC_INIT *)&hash_blake2s_224_mac_init,
       (MAC_UPDATE *)&hash_blake2s_update,
-      (MAC_FINAL *)&hash_blake2s_224_final },
+      (MAC_FINAL *)&hash_blake2s_224_final,
+      NULL, NULL, NULL, NULL },
     /* Implementation of BLAKE2S with 256-bit output. */
-    { "BLAKE2s_256 C", MAC_METH_FLAG_INTERNAL,
-      MAC_ID_BLAKE2S_256, HASH_BLAKE2S_256_LEN, sizeof(HASH_BLAKE2S),
+    { "BLAKE2s_256 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_BLAKE2S_256, HASH_BLAKE2S_256_LEN, sizeof(HASH_BLAKE2S), 0,
       (MAC_INIT *)&hash_blake2s_256_mac_init,
       (MAC_UPDATE *)&hash_blake2s_update,
-      (MAC_FINAL *)&hash_blake2s_256_final },
+      (MAC_FINAL *)&hash_blake2s_256_final,
+      NULL, NULL, NULL, NULL },
+    /* Implementation of Poly1305. */
+    { "Poly1305 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_POLY1305, MAC_POLY1305_LEN, sizeof(MAC_POLY1305), 0,
+      (MAC_INIT *)&mac_poly1305_init,
+      (MAC_UPDATE *)&mac_poly1305_update,
+      (MAC_FINAL *)&mac_poly1305_final,
+      NULL, NULL, NULL, NULL },
+    /* Implementation of SipHash-2-4. */
+    { "SipHash-2-4 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SIPHASH_2_4, MAC_SIPHASH_LEN, sizeof(MAC_SIPHASH), 0,
+      (MAC_INIT *)&mac_siphash_2_4_init,
+      (MAC_UPDATE *)&mac_siphash_update,
+      (MAC_FINAL *)&mac_siphash_final,
+      NULL, NULL, NULL, NULL },
+    /* Implementation of SipHash-1-3. */
+    { "SipHash-1-3 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_SIPHASH_1_3, MAC_SIPHASH_LEN, sizeof(MAC_SIPHASH), 0,
+      (MAC_INIT *)&mac_siphash_1_3_init,
+      (MAC_UPDATE *)&mac_siphash_update,
+      (MAC_FINAL *)&mac_siphash_final,
+      NULL, NULL, NULL, NULL },
+    /* Implementation of HalfSipHash-2-4. */
+    { "HalfSipHash-2-4 C", MAC_METH_FLAG_INTERNAL, HASH_METH_PRIO_C,
+      MAC_ID_HALFSIPHASH_2_4, MAC_HALFSIPHASH_LEN, sizeof(MAC_HALFSIPHASH),
+      0,
+      (MAC_INIT *)&mac_halfsiphash_init,
+      (MAC_UPDATE *)&mac_halfsiphash_update,
+      (MAC_FINAL *)&mac_halfsiphash_final,
+      NULL, NULL, NULL, NULL },
 };
 /** The number of MAC algorithm implementations. */
 #define MAC_METHS_LEN   ((int)(sizeof(mac_meths)/sizeof(*mac_meths)))
 
+/** The number of MAC algorithm identifiers. */
+#define MAC_ID_NUM	(MAC_ID_HALFSIPHASH_2_4 + 1)
+/** The alignment that a context on the stack is guaranteed to have. */
+#define MAC_STACK_ALIGN	8
+
+/**
+ * The implementations of each MAC algorithm that the CPU supports, ordered by
+ * priority. NULL terminated.
+ */
+static MAC_METH *mac_meth_rank[MAC_ID_NUM][MAC_METHS_LEN +
+    HASH_METH_REG_MAX + 1];
+/** Ensures the implementations are only ranked once. */
+static pthread_once_t mac_meth_rank_once = PTHREAD_ONCE_INIT;
+
+/** The implementations registered by the application. */
+static MAC_METH mac_meth_reg[HASH_METH_REG_MAX];
+/** The number of implementations registered by the application. */
+static int mac_meth_reg_cnt = 0;
+/** Serializes registering implementations. */
+static pthread_mutex_t mac_meth_reg_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Add an implementation into the ranking of its MAC algorithm.
+ * Placed after the implementations of the same or higher priority.
+ *
+ * @param [in] meth  The MAC algorithm method.
+ */
+static void mac_meth_rank_add(MAC_METH *meth)
+{
+    int j;
+    MAC_METH **rank = mac_meth_rank[meth->id];
+
+    for (j=0; rank[j] != NULL; j++)
+        ;
+    for (; (j > 0) && (rank[j-1]->priority < meth->priority); j--)
+        rank[j] = rank[j-1];
+    rank[j] = meth;
+}
+
+/**
+ * Rank the implementations of each MAC algorithm.
+ * Implementations of the same priority stay in table order.
+ */
+static void mac_meth_rank_init(void)
+{
+    int cpu = hash_cpu_flags();
+    int i;
+
+    for (i=0; i<MAC_METHS_LEN; i++)
+    {
+        /* Skip implementations that need features the CPU doesn't have. */
+        if ((mac_meths[i].flags & MAC_METH_FLAG_CPU & ~cpu) == 0)
+            mac_meth_rank_add(&mac_meths[i]);
+    }
+}
+
+/**
+ * Get the ranked implementations of the MAC algorithm.
+ *
+ * @param [in] id  The MAC algorithm identifier.
+ * @return  NULL when the identifier is not valid.<br>
+ *          NULL terminated array of methods, best first, otherwise.
+ */
+static MAC_METH **mac_meth_ranked(MAC_ID id)
+{
+    if ((id < 0) || (id >= MAC_ID_NUM))
+        return NULL;
+
+    pthread_once(&mac_meth_rank_once, mac_meth_rank_init);
+    return mac_meth_rank[id];
+}
+
 /**
  * Get the MAC algorithm method by id.
+ * The highest priority implementation that has all the required flags and
+ * none of the excluded flags is used.
  *
  * @param [in]  id     The MAC algorithm identifier.
- * @param [in]  flags  The method implementation flags required.
- * @parma [out] meth   The MAC algorithm method.
+ * @param [in]  flags  The method implementation flags required and, shifted
+ *                     with MAC_METH_FLAG_EXCLUDE, the flags excluded.
+ * @param [out] meth   The MAC algorithm method.
  * @return  HASH_ERR_NOT_FOUND when there is no implementation for the MAC
  *          algorithm.<br>
  *          0 otherwise.
@@ -192,79 +497,265 @@ static MAC_METH mac_meths[] =
 int mac_meth_get(MAC_ID id, int flags, MAC_METH **meth)
 {
     int ret = 0;
-    int i;
+    int req = flags & 0xffff;
+    int excl = (flags >> 16) & 0xffff;
+    MAC_METH **rank;
 
     *meth = NULL;
-    /* Find the first matching method. */
-    for (i=0; i<MAC_METHS_LEN; i++)
+    rank = mac_meth_ranked(id);
+    if (rank == NULL)
+    {
+        ret = HASH_ERR_NOT_FOUND;
+        goto end;
+    }
+
+    /* Find the best matching method. */
+    for (; *rank != NULL; rank++)
     {
-        if ((mac_meths[i].id == id) &&
-            ((mac_meths[i].flags & flags) == flags))
+        if ((((*rank)->flags & req) == req) && (((*rank)->flags & excl) == 0))
         {
-            *meth = &mac_meths[i];
+            *meth = *rank;
             break;
         }
     }
 
     if (*meth == NULL)
         ret = HASH_ERR_NOT_FOUND;
-
+end:
     return ret;
 }
 
 /**
- * Get the length of the digest that will be calculated using the MAC
- * algorithm.
+ * The hash algorithm of each HMAC - calibrating the hash's batch function
+ * tunes the HMAC's.
+ */
+static const HASH_ID mac_hmac_hash_id[] =
+{
+    HASH_ID_SHA1, HASH_ID_SHA224, HASH_ID_SHA256, HASH_ID_SHA384,
+    HASH_ID_SHA512, HASH_ID_SHA512_224, HASH_ID_SHA512_256
+};
+
+/**
+ * Get the MAC algorithm method to process a batch of messages.
+ * The method is as for mac_meth_get: the batch function of an implementation
+ * is used when it is the highest ranked or required by the flags, e.g.
+ * MAC_METH_FLAG_AVX2. Without flags, an HMAC uses a batch function when
+ * calibration found the hash's batch function fastest for the average length
+ * of the messages.
  *
- * @param [in]  mac  The MAC algorithm identifier.
- * @param [out] len  The length of a message digest.
- * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
- *          HASH_ERR_NOT_FOUND when there is no implementation for the MAC
+ * @param [in]  id     The MAC algorithm identifier.
+ * @param [in]  flags  The method implementation flags required and, shifted
+ *                     with MAC_METH_FLAG_EXCLUDE, the flags excluded.
+ * @param [in]  lens   The lengths of the messages.
+ * @param [in]  cnt    The number of messages.
+ * @param [out] meth   The MAC algorithm method.
+ * @return  HASH_ERR_NOT_FOUND when there is no implementation for the MAC
  *          algorithm.<br>
  *          0 otherwise.
  */
-int MAC_METH_get_len(MAC_ID id, int *len)
+static int mac_meth_get_batch(MAC_ID id, int flags, const size_t *lens,
+    int cnt, MAC_METH **meth)
 {
-    int ret = HASH_ERR_NOT_FOUND;
+    int ret;
     int i;
+    size_t len = 0;
+    MAC_METH **rank;
 
-    /* Find the first matching method. */
-    for (i=0; i<MAC_METHS_LEN; i++)
+    ret = mac_meth_get(id, flags, meth);
+    if ((ret != 0) || (flags != 0) || ((*meth)->batch != NULL) ||
+        (id < 0) || (id >= (int)(sizeof(mac_hmac_hash_id) /
+                                 sizeof(*mac_hmac_hash_id))))
     {
-        if (mac_meths[i].id == id)
+        goto end;
+    }
+
+    for (i=0; i<cnt; i++)
+        len += lens[i];
+    if (cnt > 0)
+        len /= cnt;
+    if (hash_meth_tuned_batch(mac_hmac_hash_id[id], len))
+    {
+        for (rank = mac_meth_ranked(id); *rank != NULL; rank++)
         {
-            *len = mac_meths[i].len;
-            ret = 0;
-            break;
+            if ((*rank)->batch != NULL)
+            {
+                *meth = *rank;
+                break;
+            }
         }
     }
+end:
+    return ret;
+}
+
+/**
+ * Register an implementation of a MAC algorithm.
+ * It is selected by MAC_new and MAC_compute the same way as the built-in
+ * implementations - by priority and flags. The method is copied but the name
+ * must remain valid.
+ * Register before other threads are using the algorithm.
+ *
+ * @param [in] meth  The MAC algorithm method.
+ * @return  HASH_ERR_PARAM_NULL when a parameter or required function is
+ *          NULL - dup is required with cleanup.<br>
+ *          HASH_ERR_NOT_FOUND when the MAC algorithm identifier is not
+ *          valid.<br>
+ *          HASH_ERR_BAD_LEN when a length or alignment is invalid.<br>
+ *          HASH_ERR_NOT_SUPPORTED when the CPU doesn't have the features the
+ *          implementation requires.<br>
+ *          HASH_ERR_ALLOC when no more implementations can be registered.<br>
+ *          0 otherwise.
+ */
+int MAC_METH_register(const MAC_METH *meth)
+{
+    int ret = 0;
+
+    if ((meth == NULL) || (meth->name == NULL) || (meth->init == NULL) ||
+        (meth->update == NULL) || (meth->final == NULL) ||
+        ((meth->cleanup != NULL) && (meth->dup == NULL)))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (mac_meth_ranked(meth->id) == NULL)
+    {
+        ret = HASH_ERR_NOT_FOUND;
+        goto end;
+    }
+    if ((meth->len <= 0) || (meth->len > HASH_MAX_LEN) ||
+        (meth->ctx_len <= 0) || (meth->align < 0) ||
+        ((meth->align & (meth->align - 1)) != 0))
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    if ((meth->flags & MAC_METH_FLAG_CPU & ~hash_cpu_flags()) != 0)
+    {
+        ret = HASH_ERR_NOT_SUPPORTED;
+        goto end;
+    }
 
+    pthread_mutex_lock(&mac_meth_reg_lock);
+    if (mac_meth_reg_cnt == HASH_METH_REG_MAX)
+        ret = HASH_ERR_ALLOC;
+    else
+    {
+        mac_meth_reg[mac_meth_reg_cnt] = *meth;
+        mac_meth_rank_add(&mac_meth_reg[mac_meth_reg_cnt++]);
+    }
+    pthread_mutex_unlock(&mac_meth_reg_lock);
+end:
     return ret;
 }
 
 /**
- * Create a MAC algorithm object.
+ * Get the length of the digest that will be calculated using the MAC
+ * algorithm.
  *
- * @param [in]  id     The MAC algorithm identifier.
- * @param [in]  flags  The method implementation flags required.
- * @param [out] mac    The MAC algorithm object.
- * @return  HASH_ERR_PARAM_NULL when MAC is NULL.<br>
- *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
- *          HASH_ERR_NOT_FOUND when there is no implementation for the
+ * @param [in]  mac  The MAC algorithm identifier.
+ * @param [out] len  The length of a message digest.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the MAC
  *          algorithm.<br>
  *          0 otherwise.
  */
-int MAC_new(MAC_ID id, int flags, MAC **mac)
+int MAC_METH_get_len(MAC_ID id, int *len)
 {
     int ret = 0;
-    MAC *nh = NULL;
+    MAC_METH *meth;
 
-    if (mac == NULL)
+    if (len == NULL)
     {
         ret = HASH_ERR_PARAM_NULL;
         goto end;
     }
 
+    ret = mac_meth_get(id, 0, &meth);
+    if (ret != 0)
+        goto end;
+
+    *len = meth->len;
+end:
+    return ret;
+}
+
+/**
+ * Allocate a zeroed context for the method with the alignment it requires.
+ *
+ * @param [in] meth  The MAC algorithm method.
+ * @return  NULL when allocating dynamic memory failed.<br>
+ *          The context otherwise. Free with mac_ctx_free().
+ */
+static void *mac_ctx_alloc(MAC_METH *meth)
+{
+    void *ctx = NULL;
+
+    if (meth->align <= (int)sizeof(void *))
+        ctx = malloc(meth->ctx_len);
+    else if (posix_memalign(&ctx, meth->align, meth->ctx_len) != 0)
+        ctx = NULL;
+    if (ctx != NULL)
+        memset(ctx, 0, meth->ctx_len);
+
+    return ctx;
+}
+
+/**
+ * Free a context allocated for the method and what the context owns.
+ *
+ * @param [in] meth  The MAC algorithm method.
+ * @param [in] ctx   The context. May be NULL.
+ */
+static void mac_ctx_free(MAC_METH *meth, void *ctx)
+{
+    if (ctx != NULL)
+    {
+        if (meth->cleanup != NULL)
+            meth->cleanup(ctx);
+        free(ctx);
+    }
+}
+
+/**
+ * Copy the state of a context into a context that has been used.
+ *
+ * @param [in] meth  The MAC algorithm method.
+ * @param [in] dst   The context to copy into.
+ * @param [in] src   The context to copy from. Only read.
+ * @return  0 when the implementation failed to copy.<br>
+ *          1 otherwise.
+ */
+static int mac_ctx_copy(MAC_METH *meth, void *dst, const void *src)
+{
+    int ret = 1;
+
+    if (meth->dup == NULL)
+        memcpy(dst, src, meth->ctx_len);
+    else
+    {
+        /* Release what the context owns before it is replaced. */
+        if (meth->cleanup != NULL)
+            meth->cleanup(dst);
+        memset(dst, 0, meth->ctx_len);
+        ret = meth->dup(dst, src);
+    }
+
+    return ret;
+}
+
+/**
+ * Create a MAC algorithm object with the method.
+ *
+ * @param [in]  meth  The MAC algorithm method.
+ * @param [out] mac   The MAC algorithm object.
+ * @return  HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          0 otherwise.
+ */
+static int mac_new_meth(MAC_METH *meth, MAC **mac)
+{
+    int ret = 0;
+    MAC *nh = NULL;
+
     /* Allocate memory for the general MAC algorithm object. */
     nh = malloc(sizeof(*nh));
     if (nh == NULL)
@@ -274,13 +765,10 @@ int MAC_new(MAC_ID id, int flags, MAC **mac)
     }
 
     memset(nh, 0, sizeof(*nh));
-
-    ret = mac_meth_get(id, flags, &nh->meth);
-    if (ret != 0)
-        goto end;
+    nh->meth = meth;
 
     /* Allocate memory for the implementation to use. */
-    nh->ctx = malloc(nh->meth->ctx_len);
+    nh->ctx = mac_ctx_alloc(nh->meth);
     if (nh->ctx == NULL)
     {
         ret = HASH_ERR_ALLOC;
@@ -295,32 +783,59 @@ end:
 }
 
 /**
- * Free the MAC algorithm object.
+ * Create a MAC algorithm object.
  *
- * @param [in] mac  The MAC algorithm object.
+ * @param [in]  id     The MAC algorithm identifier.
+ * @param [in]  flags  The method implementation flags required and, shifted
+ *                     with MAC_METH_FLAG_EXCLUDE, the flags excluded.
+ * @param [out] mac    The MAC algorithm object.
+ * @return  HASH_ERR_PARAM_NULL when MAC is NULL.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the
+ *          algorithm.<br>
+ *          0 otherwise.
  */
-void MAC_free(MAC *mac)
+int MAC_new(MAC_ID id, int flags, MAC **mac)
 {
-    if (mac != NULL)
+    int ret = 0;
+    MAC_METH *meth;
+
+    if (mac == NULL)
     {
-        if (mac->ctx != NULL) free(mac->ctx);
-        free(mac);
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
     }
+
+    ret = mac_meth_get(id, flags, &meth);
+    if (ret != 0)
+        goto end;
+
+    ret = mac_new_meth(meth, mac);
+end:
+    return ret;
 }
 
 /**
- * Initialize the MAC operation with a key.
+ * Create a MAC algorithm object to iterate keys, e.g. for PBKDF2.
+ * Without flags, an implementation with a CPU specific iterate function is
+ * preferred: the highest ranked when it has one, otherwise one with many
+ * lanes, e.g. HMAC-SHA-256 AVX2 batch, over portable C.
  *
- * @param [in] mac  The MAC algorithm object.
- * @param [in] key  The key to use in the MAC.
- * @param [in] len  The length of the key.
- * @return  HASH_ERR_PARAM_NULL when mac is NULL.<br>
- *          HASH_ERR_BAD_DATA when the implementation failed to initialize.<br>
+ * @param [in]  id     The MAC algorithm identifier.
+ * @param [in]  flags  The method implementation flags required and, shifted
+ *                     with MAC_METH_FLAG_EXCLUDE, the flags excluded.
+ * @param [out] mac    The MAC algorithm object.
+ * @return  HASH_ERR_PARAM_NULL when MAC is NULL.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the
+ *          MAC algorithm.<br>
  *          0 otherwise.
  */
-static int mac_init(MAC *mac, const unsigned char *key, int len)
+int mac_new_iterate(MAC_ID id, int flags, MAC **mac)
 {
     int ret = 0;
+    MAC_METH *meth;
+    MAC_METH **rank;
 
     if (mac == NULL)
     {
@@ -328,69 +843,513 @@ static int mac_init(MAC *mac, const unsigned char *key, int len)
         goto end;
     }
 
-    if (mac->meth->init(mac->ctx, key, len) == 0)
-        ret = HASH_ERR_BAD_DATA;
+    ret = mac_meth_get(id, flags, &meth);
+    if (ret != 0)
+        goto end;
+
+    if ((flags == 0) && ((meth->iterate == NULL) ||
+                         (meth->priority < HASH_METH_PRIO_CPU)))
+    {
+        for (rank = mac_meth_ranked(id); *rank != NULL; rank++)
+        {
+            if (((*rank)->iterate != NULL) && ((*rank)->batch != NULL))
+            {
+                meth = *rank;
+                break;
+            }
+        }
+    }
+
+    ret = mac_new_meth(meth, mac);
 end:
     return ret;
 }
 
 /**
- * Update the MAC operation with data.
+ * Create a MAC algorithm object using a specific implementation.
+ * Implementations that the CPU supports are indexed from 0 in order of
+ * priority - use to test and compare every implementation.
  *
- * @param [in] mac  The MAC algorithm object.
- * @param [in] msg  The message data to digest.
- * @param [in] len  The length of the message data to digest.
- * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
- *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
+ * @param [in]  id   The MAC algorithm identifier.
+ * @param [in]  idx  The index of the implementation.
+ * @param [out] mac  The MAC algorithm object.
+ * @return  HASH_ERR_PARAM_NULL when mac is NULL.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation at the index.<br>
  *          0 otherwise.
  */
-static int mac_update(MAC *mac, const unsigned char *msg, int len)
+int MAC_new_impl(MAC_ID id, int idx, MAC **mac)
 {
     int ret = 0;
+    int i;
+    MAC_METH **rank;
 
-    if ((mac == NULL) || (msg == NULL))
+    if (mac == NULL)
     {
         ret = HASH_ERR_PARAM_NULL;
         goto end;
     }
 
-    if (mac->meth->update(mac->ctx, msg, len) == 0)
-        ret = HASH_ERR_BAD_DATA;
+    rank = mac_meth_ranked(id);
+    if ((rank == NULL) || (idx < 0))
+    {
+        ret = HASH_ERR_NOT_FOUND;
+        goto end;
+    }
+    for (i=0; (i < idx) && (rank[i] != NULL); i++)
+        ;
+    if (rank[i] == NULL)
+    {
+        ret = HASH_ERR_NOT_FOUND;
+        goto end;
+    }
+
+    ret = mac_new_meth(rank[i], mac);
 end:
     return ret;
 }
 
 /**
- * Initialize the sign operation for calculating the MAC.
+ * Free the MAC algorithm object.
  *
  * @param [in] mac  The MAC algorithm object.
- * @param [in] key  The key to use in the MAC.
- * @param [in] len  The length of the key.
- * @return  HASH_ERR_PARAM_NULL when mac is NULL.<br>
- *          HASH_ERR_BAD_DATA when the implementation failed to initialize.<br>
- *          0 otherwise.
  */
-int MAC_sign_init(MAC *mac, const unsigned char *key, int len)
+void MAC_free(MAC *mac)
 {
-    return mac_init(mac, key, len);
+    if (mac != NULL)
+    {
+        mac_ctx_free(mac->meth, mac->ctx);
+        free(mac);
+    }
 }
 
 /**
- * Update the MAC signing operation with data.
+ * Duplicate the MAC algorithm object including the state of the operation.
+ * Use to calculate MACs, with the same key, of messages with a common prefix.
  *
- * @param [in] mac  The MAC algorithm object.
- * @param [in] msg  The message data to digest.
- * @param [in] len  The length of the message data to digest.
+ * @param [in]  mac  The MAC algorithm object.
+ * @param [out] dup  The new MAC algorithm object.
  * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
- *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to duplicate.<br>
  *          0 otherwise.
  */
-int MAC_sign_update(MAC *mac, const unsigned char *msg, int len)
+int MAC_dup(MAC *mac, MAC **dup)
 {
-    return mac_update(mac, msg, len);
-}
+    int ret = 0;
+    MAC *nh = NULL;
 
-/**
+    if ((mac == NULL) || (dup == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    ret = mac_new_meth(mac->meth, &nh);
+    if (ret != 0)
+        goto end;
+
+    if (mac->meth->dup == NULL)
+        memcpy(nh->ctx, mac->ctx, mac->meth->ctx_len);
+    else if (mac->meth->dup(nh->ctx, mac->ctx) == 0)
+    {
+        ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+
+    *dup = nh;
+    nh = NULL;
+end:
+    MAC_free(nh);
+    return ret;
+}
+
+/**
+ * Initialize the MAC operation with a key.
+ *
+ * @param [in] mac  The MAC algorithm object.
+ * @param [in] key  The key to use in the MAC.
+ * @param [in] len  The length of the key.
+ * @return  HASH_ERR_PARAM_NULL when mac is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to initialize.<br>
+ *          0 otherwise.
+ */
+static int mac_init(MAC *mac, const unsigned char *key, int len)
+{
+    int ret = 0;
+
+    if (mac == NULL)
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    if (mac->meth->init(mac->ctx, key, len) == 0)
+        ret = HASH_ERR_BAD_DATA;
+end:
+    return ret;
+}
+
+/**
+ * Create a key object for the MAC object's implementation.
+ * The key is processed once - for HMAC the inner and outer key blocks are
+ * hashed - and the state is copied to start each MAC operation.
+ * The key object is only read after creation and can be shared by threads.
+ *
+ * @param [in]  mac   The MAC algorithm object.
+ * @param [in]  key   The key to use in the MAC.
+ * @param [in]  len   The length of the key.
+ * @param [out] mkey  The new MAC key object.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to initialize.<br>
+ *          0 otherwise.
+ */
+int MAC_KEY_new(MAC *mac, const unsigned char *key, int len, MAC_KEY **mkey)
+{
+    int ret = 0;
+    MAC_KEY *nk = NULL;
+
+    if ((mac == NULL) || ((key == NULL) && (len > 0)) || (mkey == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    nk = malloc(sizeof(*nk));
+    if (nk == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+    nk->meth = mac->meth;
+    nk->ctx = mac_ctx_alloc(nk->meth);
+    if (nk->ctx == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+
+    if (nk->meth->init(nk->ctx, key, len) == 0)
+    {
+        ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+
+    *mkey = nk;
+    nk = NULL;
+end:
+    MAC_KEY_free(nk);
+    return ret;
+}
+
+/**
+ * Free the MAC key object.
+ * The state derived from the key is zeroized.
+ *
+ * @param [in] mkey  The MAC key object. May be NULL.
+ */
+void MAC_KEY_free(MAC_KEY *mkey)
+{
+    if (mkey != NULL)
+    {
+        if ((mkey->ctx != NULL) && (mkey->meth->cleanup == NULL))
+            memset(mkey->ctx, 0, mkey->meth->ctx_len);
+        mac_ctx_free(mkey->meth, mkey->ctx);
+        free(mkey);
+    }
+}
+
+/**
+ * Perform the iterations with the keys of an implementation that has no
+ * iterate function: the MAC operation is started by copying the key's
+ * context.
+ *
+ * @param [in]      meth   The MAC algorithm method.
+ * @param [in]      mkeys  The MAC key objects.
+ * @param [in, out] data   The first MAC of each key in, XOR of all MACs out.
+ * @param [in]      cnt    The number of keys.
+ * @param [in]      iter   The total number of iterations.
+ * @return  HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+static int mac_meth_iterate(MAC_METH *meth, MAC_KEY **mkeys,
+    unsigned char **data, int cnt, unsigned int iter)
+{
+    int ret = 0;
+    int i, j;
+    unsigned int n;
+    unsigned char u[HASH_MAX_LEN];
+    void *ctx;
+
+    ctx = mac_ctx_alloc(meth);
+    if (ctx == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+
+    for (i=0; (ret == 0) && (i<cnt); i++)
+    {
+        memcpy(u, data[i], meth->len);
+        for (n=1; n<iter; n++)
+        {
+            if ((mac_ctx_copy(meth, ctx, mkeys[i]->ctx) == 0) ||
+                (meth->update(ctx, u, meth->len) == 0) ||
+                (meth->final(u, ctx) == 0))
+            {
+                ret = HASH_ERR_BAD_DATA;
+                break;
+            }
+            for (j=0; j<meth->len; j++)
+                data[i][j] ^= u[j];
+        }
+    }
+end:
+    mac_ctx_free(meth, ctx);
+    return ret;
+}
+
+/**
+ * Perform the iterations of PBKDF2 after the first for each key.
+ * The data is replaced by the MAC of it iter - 1 times and each MAC is XORed
+ * into the data. The implementation's iterate function hashes one block from
+ * the key's states for the inner and outer hashes, and may process many keys
+ * in parallel. Keys created with the same MAC object should be next to each
+ * other. The key objects are only read.
+ *
+ * @param [in]      mkeys  The MAC key objects.
+ * @param [in, out] data   The first MAC of each key in, XOR of all MACs out.
+ *                         Each buffer is the length of the key's MAC.
+ * @param [in]      cnt    The number of keys.
+ * @param [in]      iter   The total number of iterations.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the count is negative.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+int MAC_KEY_iterate(MAC_KEY **mkeys, unsigned char **data, int cnt,
+    unsigned int iter)
+{
+    int ret = 0;
+    int i, j, n;
+    MAC_METH *meth;
+    void **ctx = NULL;
+
+    if (cnt < 0)
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    if ((cnt > 0) && ((mkeys == NULL) || (data == NULL)))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    for (i=0; i<cnt; i++)
+    {
+        if ((mkeys[i] == NULL) || (data[i] == NULL))
+        {
+            ret = HASH_ERR_PARAM_NULL;
+            goto end;
+        }
+    }
+    if ((cnt == 0) || (iter <= 1))
+        goto end;
+
+    ctx = malloc(cnt * sizeof(*ctx));
+    if (ctx == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+
+    /* Each run of keys with the same implementation in one call. */
+    for (i=0; (ret == 0) && (i<cnt); i+=n)
+    {
+        meth = mkeys[i]->meth;
+        for (n=1; (i+n<cnt) && (mkeys[i+n]->meth == meth); n++)
+            ;
+        if (meth->iterate == NULL)
+            ret = mac_meth_iterate(meth, mkeys + i, data + i, n, iter);
+        else
+        {
+            for (j=0; j<n; j++)
+                ctx[j] = mkeys[i+j]->ctx;
+            if (meth->iterate(ctx, data + i, n, iter) == 0)
+                ret = HASH_ERR_BAD_DATA;
+        }
+    }
+end:
+    free(ctx);
+    return ret;
+}
+
+/**
+ * Initialize the MAC operation by copying the state of a key object.
+ *
+ * @param [in] mac   The MAC algorithm object.
+ * @param [in] mkey  The MAC key object.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_NOT_SUPPORTED when the key object was created for a
+ *          different implementation.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to copy.<br>
+ *          0 otherwise.
+ */
+static int mac_init_key(MAC *mac, const MAC_KEY *mkey)
+{
+    int ret = 0;
+
+    if ((mac == NULL) || (mkey == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (mac->meth != mkey->meth)
+    {
+        ret = HASH_ERR_NOT_SUPPORTED;
+        goto end;
+    }
+
+    if (mac_ctx_copy(mac->meth, mac->ctx, mkey->ctx) == 0)
+        ret = HASH_ERR_BAD_DATA;
+end:
+    return ret;
+}
+
+/**
+ * Update the MAC operation with data.
+ *
+ * @param [in] mac  The MAC algorithm object.
+ * @param [in] msg  The message data to digest.
+ * @param [in] len  The length of the message data to digest.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
+ *          0 otherwise.
+ */
+static int mac_update(MAC *mac, const unsigned char *msg, size_t len)
+{
+    int ret = 0;
+
+    if ((mac == NULL) || (msg == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    if (mac->meth->update(mac->ctx, msg, len) == 0)
+        ret = HASH_ERR_BAD_DATA;
+end:
+    return ret;
+}
+
+/**
+ * Update the MAC operation with fragments of data.
+ * The fragments are processed in order as if they were one message.
+ *
+ * @param [in] mac  The MAC algorithm object.
+ * @param [in] iov  The array of message data fragments.
+ * @param [in] cnt  The number of fragments in the array.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
+ *          0 otherwise.
+ */
+static int mac_updatev(MAC *mac, const HASH_IOVEC *iov, int cnt)
+{
+    int ret = 0;
+    int i;
+
+    if ((mac == NULL) || ((iov == NULL) && (cnt > 0)))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    for (i=0; i<cnt; i++)
+    {
+        if (iov[i].len == 0)
+            continue;
+        if (iov[i].data == NULL)
+        {
+            ret = HASH_ERR_PARAM_NULL;
+            break;
+        }
+        if (mac->meth->update(mac->ctx, iov[i].data, iov[i].len) == 0)
+        {
+            ret = HASH_ERR_BAD_DATA;
+            break;
+        }
+    }
+end:
+    return ret;
+}
+
+/**
+ * Initialize the sign operation for calculating the MAC.
+ *
+ * @param [in] mac  The MAC algorithm object.
+ * @param [in] key  The key to use in the MAC.
+ * @param [in] len  The length of the key.
+ * @return  HASH_ERR_PARAM_NULL when mac is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to initialize.<br>
+ *          0 otherwise.
+ */
+int MAC_sign_init(MAC *mac, const unsigned char *key, int len)
+{
+    return mac_init(mac, key, len);
+}
+
+/**
+ * Initialize the sign operation with a key object.
+ * The MAC of a short message takes two fewer compressions with HMAC than
+ * MAC_sign_init as the key blocks have already been hashed.
+ *
+ * @param [in] mac   The MAC algorithm object.
+ * @param [in] mkey  The MAC key object.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_NOT_SUPPORTED when the key object was created for a
+ *          different implementation.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to copy.<br>
+ *          0 otherwise.
+ */
+int MAC_sign_init_key(MAC *mac, const MAC_KEY *mkey)
+{
+    return mac_init_key(mac, mkey);
+}
+
+/**
+ * Update the MAC signing operation with data.
+ *
+ * @param [in] mac  The MAC algorithm object.
+ * @param [in] msg  The message data to digest.
+ * @param [in] len  The length of the message data to digest.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
+ *          0 otherwise.
+ */
+int MAC_sign_update(MAC *mac, const unsigned char *msg, size_t len)
+{
+    return mac_update(mac, msg, len);
+}
+
+/**
+ * Update the MAC signing operation with fragments of data.
+ *
+ * @param [in] mac  The MAC algorithm object.
+ * @param [in] iov  The array of message data fragments.
+ * @param [in] cnt  The number of fragments in the array.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
+ *          0 otherwise.
+ */
+int MAC_sign_updatev(MAC *mac, const HASH_IOVEC *iov, int cnt)
+{
+    return mac_updatev(mac, iov, cnt);
+}
+
+/**
  * Finalize the signing operation and output the MAC.
  *
  * @param [in] mac   The MAC algorithm object.
@@ -430,6 +1389,22 @@ int MAC_verify_init(MAC *mac, const unsigned char *key, int len)
     return mac_init(mac, key, len);
 }
 
+/**
+ * Initialize the verification operation with a key object.
+ *
+ * @param [in] mac   The MAC algorithm object.
+ * @param [in] mkey  The MAC key object.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_NOT_SUPPORTED when the key object was created for a
+ *          different implementation.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to copy.<br>
+ *          0 otherwise.
+ */
+int MAC_verify_init_key(MAC *mac, const MAC_KEY *mkey)
+{
+    return mac_init_key(mac, mkey);
+}
+
 /**
  * Update the MAC verification operation with data.
  *
@@ -440,11 +1415,26 @@ int MAC_verify_init(MAC *mac, const unsigned char *key, int len)
  *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
  *          0 otherwise.
  */
-int MAC_verify_update(MAC *mac, const unsigned char *msg, int len)
+int MAC_verify_update(MAC *mac, const unsigned char *msg, size_t len)
 {
     return mac_update(mac, msg, len);
 }
 
+/**
+ * Update the MAC verification operation with fragments of data.
+ *
+ * @param [in] mac  The MAC algorithm object.
+ * @param [in] iov  The array of message data fragments.
+ * @param [in] cnt  The number of fragments in the array.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to update.<br>
+ *          0 otherwise.
+ */
+int MAC_verify_updatev(MAC *mac, const HASH_IOVEC *iov, int cnt)
+{
+    return mac_updatev(mac, iov, cnt);
+}
+
 /**
  * Finalize the verification operation and compare with the passed in data.
  *
@@ -475,6 +1465,492 @@ end:
     return ret;
 }
 
+/** Calculate a MAC with the implementation's functions called directly. */
+#define MAC_COMPUTE(ctx, init, update, final, key, klen, msg, len, data) \
+do								\
+{								\
+    if (init(ctx, key, klen) == 0)				\
+        ret = HASH_ERR_BAD_DATA;				\
+    else							\
+    {								\
+        update(ctx, msg, len);					\
+        final(data, ctx);					\
+    }								\
+}								\
+while (0)
+
+/**
+ * Calculate the MAC of a message calling the functions of a built-in
+ * implementation directly.
+ * The instruction set the method uses picks the functions.
+ *
+ * @param [in] meth  The MAC algorithm method - from the built-in table.
+ * @param [in] ctx   The context to use - large enough for the algorithm.
+ * @param [in] key   The key to use in the MAC.
+ * @param [in] klen  The length of the key.
+ * @param [in] msg   The message data to MAC.
+ * @param [in] len   The length of the message data to MAC.
+ * @param [in] data  The buffer to hold the MAC.
+ * @return  HASH_ERR_NOT_FOUND when the algorithm has no direct path.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed to initialize.<br>
+ *          0 otherwise.
+ */
+static int mac_compute_direct(MAC_METH *meth, void *ctx,
+    const unsigned char *key, int klen, const unsigned char *msg, size_t len,
+    unsigned char *data)
+{
+    int ret = 0;
+
+    switch (meth->id)
+    {
+        case MAC_ID_SHA1:
+#ifdef CPU_X86_64
+            if ((meth->flags & MAC_METH_FLAG_SHANI) != 0)
+            {
+                MAC_COMPUTE(ctx, hmac_sha1_ni_init, hash_sha1_ni_update,
+                    hmac_sha1_ni_final, key, klen, msg, len, data);
+                break;
+            }
+#endif
+            MAC_COMPUTE(ctx, hmac_sha1_init, hash_sha1_update,
+                hmac_sha1_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SHA224:
+#ifdef CPU_X86_64
+            if ((meth->flags & MAC_METH_FLAG_SHANI) != 0)
+            {
+                MAC_COMPUTE(ctx, hmac_sha224_ni_init, hash_sha256_ni_update,
+                    hmac_sha224_ni_final, key, klen, msg, len, data);
+                break;
+            }
+#endif
+            MAC_COMPUTE(ctx, hmac_sha224_init, hash_sha256_update,
+                hmac_sha224_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SHA256:
+#ifdef CPU_X86_64
+            if ((meth->flags & MAC_METH_FLAG_SHANI) != 0)
+            {
+                MAC_COMPUTE(ctx, hmac_sha256_ni_init, hash_sha256_ni_update,
+                    hmac_sha256_ni_final, key, klen, msg, len, data);
+                break;
+            }
+#endif
+            MAC_COMPUTE(ctx, hmac_sha256_init, hash_sha256_update,
+                hmac_sha256_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SHA384:
+            MAC_COMPUTE(ctx, hmac_sha384_init, hash_sha512_update,
+                hmac_sha384_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SHA512:
+            MAC_COMPUTE(ctx, hmac_sha512_init, hash_sha512_update,
+                hmac_sha512_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SHA512_224:
+            MAC_COMPUTE(ctx, hmac_sha512_224_init, hash_sha512_update,
+                hmac_sha512_224_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SHA512_256:
+            MAC_COMPUTE(ctx, hmac_sha512_256_init, hash_sha512_update,
+                hmac_sha512_256_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SHA3_224:
+            MAC_COMPUTE(ctx, hash_sha3_224_mac_init, hash_sha3_224_update,
+                hash_sha3_224_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SHA3_256:
+            MAC_COMPUTE(ctx, hash_sha3_256_mac_init, hash_sha3_256_update,
+                hash_sha3_256_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SHA3_384:
+            MAC_COMPUTE(ctx, hash_sha3_384_mac_init, hash_sha3_384_update,
+                hash_sha3_384_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SHA3_512:
+            MAC_COMPUTE(ctx, hash_sha3_512_mac_init, hash_sha3_512_update,
+                hash_sha3_512_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_BLAKE2B_224:
+            MAC_COMPUTE(ctx, hash_blake2b_224_mac_init, hash_blake2b_update,
+                hash_blake2b_224_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_BLAKE2B_256:
+            MAC_COMPUTE(ctx, hash_blake2b_256_mac_init, hash_blake2b_update,
+                hash_blake2b_256_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_BLAKE2B_384:
+            MAC_COMPUTE(ctx, hash_blake2b_384_mac_init, hash_blake2b_update,
+                hash_blake2b_384_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_BLAKE2B_512:
+            MAC_COMPUTE(ctx, hash_blake2b_512_mac_init, hash_blake2b_update,
+                hash_blake2b_512_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_BLAKE2S_224:
+            MAC_COMPUTE(ctx, hash_blake2s_224_mac_init, hash_blake2s_update,
+                hash_blake2s_224_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_BLAKE2S_256:
+            MAC_COMPUTE(ctx, hash_blake2s_256_mac_init, hash_blake2s_update,
+                hash_blake2s_256_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_POLY1305:
+#ifdef CPU_X86_64
+            if ((meth->flags & MAC_METH_FLAG_AVX2) != 0)
+            {
+                MAC_COMPUTE(ctx, mac_poly1305_avx2_init,
+                    mac_poly1305_avx2_update, mac_poly1305_final, key, klen,
+                    msg, len, data);
+                break;
+            }
+#endif
+            MAC_COMPUTE(ctx, mac_poly1305_init, mac_poly1305_update,
+                mac_poly1305_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SIPHASH_2_4:
+            MAC_COMPUTE(ctx, mac_siphash_2_4_init, mac_siphash_update,
+                mac_siphash_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_SIPHASH_1_3:
+            MAC_COMPUTE(ctx, mac_siphash_1_3_init, mac_siphash_update,
+                mac_siphash_final, key, klen, msg, len, data);
+            break;
+        case MAC_ID_HALFSIPHASH_2_4:
+            MAC_COMPUTE(ctx, mac_halfsiphash_init, mac_halfsiphash_update,
+                mac_halfsiphash_final, key, klen, msg, len, data);
+            break;
+        default:
+            ret = HASH_ERR_NOT_FOUND;
+            break;
+    }
+
+    return ret;
+}
+
+/**
+ * Calculate the MAC of a message with a key in one call.
+ * The best implementation is called directly with the context on the stack
+ * when built-in. Registered implementations and other libraries are called
+ * through the method table - no dynamic memory is allocated unless the context
+ * is unusually large or aligned.
+ *
+ * @param [in] id    The MAC algorithm identifier.
+ * @param [in] key   The key to use in the MAC.
+ * @param [in] klen  The length of the key.
+ * @param [in] msg   The message data to MAC.
+ * @param [in] len   The length of the message data to MAC.
+ * @param [in] data  The buffer to hold the MAC.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the MAC
+ *          algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+int MAC_compute(MAC_ID id, const unsigned char *key, int klen,
+    const unsigned char *msg, size_t len, unsigned char *data)
+{
+    int ret = 0;
+    MAC_METH *meth = NULL;
+    void *ctx = NULL;
+    union
+    {
+        HASH_SHA1 sha1[2];
+        HASH_SHA256 sha256[2];
+        HASH_SHA512 sha512[2];
+        HASH_SHA3 sha3;
+        HASH_BLAKE2B blake2b;
+        HASH_BLAKE2S blake2s;
+        MAC_POLY1305 poly1305;
+        MAC_SIPHASH siphash;
+    } stack_ctx;
+
+    if (((key == NULL) && (klen > 0)) || ((msg == NULL) && (len > 0)) ||
+        (data == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    ret = mac_meth_get(id, 0, &meth);
+    if (ret != 0)
+        goto end;
+
+    /* Built-in implementations are called directly - only registered
+     * implementations and other libraries go through the method table. */
+    if ((meth >= mac_meths) && (meth < mac_meths + MAC_METHS_LEN) &&
+        ((meth->flags & ~MAC_METH_FLAG_CPU) == MAC_METH_FLAG_INTERNAL) &&
+        (meth->ctx_len <= (int)sizeof(stack_ctx)))
+    {
+        ret = mac_compute_direct(meth, &stack_ctx, key, klen, msg, len, data);
+        if (ret != HASH_ERR_NOT_FOUND)
+            goto end;
+        ret = 0;
+    }
+
+    if ((meth->ctx_len <= (int)sizeof(stack_ctx)) &&
+        (meth->align <= MAC_STACK_ALIGN))
+    {
+        ctx = &stack_ctx;
+        /* Context may own memory allocated on first initialization. */
+        if (meth->cleanup != NULL)
+            memset(ctx, 0, meth->ctx_len);
+    }
+    else
+    {
+        ctx = mac_ctx_alloc(meth);
+        if (ctx == NULL)
+        {
+            ret = HASH_ERR_ALLOC;
+            goto end;
+        }
+    }
+
+    if ((meth->init(ctx, key, klen) == 0) ||
+        (meth->update(ctx, msg, len) == 0) || (meth->final(data, ctx) == 0))
+    {
+        ret = HASH_ERR_BAD_DATA;
+    }
+end:
+    if (ctx != &stack_ctx)
+        mac_ctx_free(meth, ctx);
+    else if (meth->cleanup != NULL)
+        meth->cleanup(ctx);
+    return ret;
+}
+
+/**
+ * MAC many messages with the method's functions called directly.
+ * The context after initializing with a key is kept and copied for each
+ * message with the same key as the previous one.
+ *
+ * @param [in] meth   The MAC algorithm method.
+ * @param [in] keys   The keys of the messages.
+ * @param [in] klens  The lengths of the keys.
+ * @param [in] msgs   The messages to MAC.
+ * @param [in] lens   The lengths of the messages.
+ * @param [in] cnt    The number of messages.
+ * @param [in] data   The buffers to hold the MACs.
+ * @return  HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+static int mac_meth_batch(MAC_METH *meth, const unsigned char **keys,
+    const int *klens, const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **data)
+{
+    int ret = 0;
+    int i;
+    void *key_ctx = NULL;
+    void *ctx = NULL;
+
+    if (meth->batch != NULL)
+    {
+        if (meth->batch(keys, klens, msgs, lens, cnt, data) == 0)
+            ret = HASH_ERR_BAD_DATA;
+        goto end;
+    }
+
+    key_ctx = mac_ctx_alloc(meth);
+    ctx = mac_ctx_alloc(meth);
+    if ((key_ctx == NULL) || (ctx == NULL))
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+
+    for (i=0; (ret == 0) && (i<cnt); i++)
+    {
+        if ((i == 0) || (keys[i] != keys[i-1]) || (klens[i] != klens[i-1]))
+        {
+            if (meth->init(key_ctx, keys[i], klens[i]) == 0)
+            {
+                ret = HASH_ERR_BAD_DATA;
+                break;
+            }
+        }
+
+        if ((mac_ctx_copy(meth, ctx, key_ctx) == 0) ||
+            (meth->update(ctx, msgs[i], lens[i]) == 0) ||
+            (meth->final(data[i], ctx) == 0))
+        {
+            ret = HASH_ERR_BAD_DATA;
+        }
+    }
+end:
+    mac_ctx_free(meth, key_ctx);
+    mac_ctx_free(meth, ctx);
+    return ret;
+}
+
+/**
+ * Check the parameters of a batch of messages.
+ *
+ * @param [in] keys   The keys of the messages.
+ * @param [in] klens  The lengths of the keys.
+ * @param [in] msgs   The messages to MAC.
+ * @param [in] lens   The lengths of the messages.
+ * @param [in] cnt    The number of messages.
+ * @param [in] data   The buffers of the MACs.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the count or a key length is negative.<br>
+ *          0 otherwise.
+ */
+static int mac_batch_check(const unsigned char **keys, const int *klens,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **data)
+{
+    int ret = 0;
+    int i;
+
+    if (cnt < 0)
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    if ((cnt > 0) && ((keys == NULL) || (klens == NULL) || (msgs == NULL) ||
+        (lens == NULL) || (data == NULL)))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    for (i=0; i<cnt; i++)
+    {
+        if (klens[i] < 0)
+        {
+            ret = HASH_ERR_BAD_LEN;
+            goto end;
+        }
+        if (((keys[i] == NULL) && (klens[i] > 0)) ||
+            ((msgs[i] == NULL) && (lens[i] > 0)) || (data[i] == NULL))
+        {
+            ret = HASH_ERR_PARAM_NULL;
+            goto end;
+        }
+    }
+end:
+    return ret;
+}
+
+/**
+ * Calculate the MACs of many messages.
+ * Each message has its own key. To share a key, pass the same pointer and
+ * length for each message: the key is only processed once for consecutive
+ * messages with the same key.
+ * The highest priority implementation that has all the required flags and
+ * none of the excluded flags is used - without flags, HMAC uses the batch
+ * function when HASH_calibrate found the hash's fastest for the length. When
+ * it processes messages in a batch, e.g. HMAC-SHA-256 with MAC_METH_FLAG_AVX2
+ * required, the inner and then the outer hashes of the messages are calculated
+ * many at once.
+ *
+ * @param [in] id     The MAC algorithm identifier.
+ * @param [in] flags  The method implementation flags required and, shifted
+ *                    with MAC_METH_FLAG_EXCLUDE, the flags excluded.
+ * @param [in] keys   The keys of the messages.
+ * @param [in] klens  The lengths of the keys.
+ * @param [in] msgs   The messages to MAC.
+ * @param [in] lens   The lengths of the messages.
+ * @param [in] cnt    The number of messages.
+ * @param [in] data   The buffers to hold the MACs.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the count or a key length is negative.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the MAC
+ *          algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise.
+ */
+int MAC_batch_sign(MAC_ID id, int flags, const unsigned char **keys,
+    const int *klens, const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **data)
+{
+    int ret = 0;
+    MAC_METH *meth;
+
+    ret = mac_batch_check(keys, klens, msgs, lens, cnt, data);
+    if (ret == 0)
+        ret = mac_meth_get_batch(id, flags, lens, cnt, &meth);
+    if ((ret == 0) && (cnt > 0))
+        ret = mac_meth_batch(meth, keys, klens, msgs, lens, cnt, data);
+
+    return ret;
+}
+
+/**
+ * Verify the MACs of many messages.
+ * Bit i of the verified bitmap (bit i % 8 of byte i / 8) is set when the MAC
+ * of message i matches. The MACs are compared in constant time.
+ * Keys and implementations are as for MAC_batch_sign.
+ *
+ * @param [in]  id        The MAC algorithm identifier.
+ * @param [in]  flags     The method implementation flags required and,
+ *                        shifted with MAC_METH_FLAG_EXCLUDE, the flags
+ *                        excluded.
+ * @param [in]  keys      The keys of the messages.
+ * @param [in]  klens     The lengths of the keys.
+ * @param [in]  msgs      The messages to MAC.
+ * @param [in]  lens      The lengths of the messages.
+ * @param [in]  cnt       The number of messages.
+ * @param [in]  data      The MACs to verify.
+ * @param [out] verified  The bitmap of messages verified: (cnt + 7) / 8
+ *                        bytes.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the count or a key length is negative.<br>
+ *          HASH_ERR_NOT_FOUND when there is no implementation for the MAC
+ *          algorithm.<br>
+ *          HASH_ERR_ALLOC when allocating dynamic memory failed.<br>
+ *          HASH_ERR_BAD_DATA when the implementation failed.<br>
+ *          0 otherwise - whether or not the MACs match.
+ */
+int MAC_batch_verify(MAC_ID id, int flags, const unsigned char **keys,
+    const int *klens, const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **data, unsigned char *verified)
+{
+    int ret = 0;
+    int i, j;
+    unsigned char diff;
+    MAC_METH *meth;
+    unsigned char *cdata = NULL;
+    unsigned char **cptr;
+
+    ret = mac_batch_check(keys, klens, msgs, lens, cnt, data);
+    if ((ret == 0) && (verified == NULL))
+        ret = HASH_ERR_PARAM_NULL;
+    if (ret == 0)
+        ret = mac_meth_get_batch(id, flags, lens, cnt, &meth);
+    if ((ret != 0) || (cnt == 0))
+        goto end;
+
+    /* Pointers to the calculated MACs and then the MACs. */
+    cdata = malloc(cnt * (sizeof(*cptr) + meth->len));
+    if (cdata == NULL)
+    {
+        ret = HASH_ERR_ALLOC;
+        goto end;
+    }
+    cptr = (unsigned char **)cdata;
+    for (i=0; i<cnt; i++)
+        cptr[i] = cdata + cnt * sizeof(*cptr) + i * meth->len;
+
+    ret = mac_meth_batch(meth, keys, klens, msgs, lens, cnt, cptr);
+    if (ret != 0)
+        goto end;
+
+    memset(verified, 0, ((size_t)cnt + 7) / 8);
+    for (i=0; i<cnt; i++)
+    {
+        diff = 0;
+        for (j=0; j<meth->len; j++)
+            diff |= cptr[i][j] ^ data[i][j];
+        verified[i / 8] |= (unsigned char)((diff == 0) << (i % 8));
+    }
+end:
+    free(cdata);
+    return ret;
+}
+
 /**
  * Get the length of the digest that will be calculated.
  *
@@ -0,0 +1,501 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Poly1305 one-time authenticator (RFC 8439).
+ * The portable code keeps the accumulator in three 64-bit limbs of 44, 44
+ * and 42 bits and multiplies with 128-bit products.
+ * The AVX2 code has four accumulators - one in each 64-bit lane - in five
+ * limbs of 26 bits. Each iteration multiplies all four by r^4 and adds the
+ * next four blocks. At the end lane i is multiplied by r^(4-i) and the lanes
+ * are added into the 44-bit accumulator.
+ */
+
+#include <string.h>
+#include "mac_poly1305.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+/** Compile the function for AVX2. */
+#define AVX2_TARGET	__attribute__((target("avx2")))
+/** Only use the lanes for this much data - the final multiply costs. */
+#define POLY1305_AVX2_MIN	256
+#endif
+
+/** 128-bit unsigned integer for the products. */
+__extension__ typedef unsigned __int128 poly1305_u128;
+
+/** Mask of 44 bits. */
+#define M44	0xfffffffffffULL
+/** Mask of 42 bits. */
+#define M42	0x3ffffffffffULL
+/** Mask of 26 bits. */
+#define M26	0x3ffffffULL
+
+/** Load a 64-bit number from little-endian bytes. */
+#define LE64(p)								\
+    (((uint64_t)(p)[0]      ) | ((uint64_t)(p)[1] <<  8) |		\
+     ((uint64_t)(p)[2] << 16) | ((uint64_t)(p)[3] << 24) |		\
+     ((uint64_t)(p)[4] << 32) | ((uint64_t)(p)[5] << 40) |		\
+     ((uint64_t)(p)[6] << 48) | ((uint64_t)(p)[7] << 56))
+
+/**
+ * Multiply a number in radix 2^44 by r and partially reduce.
+ *
+ * @param [in] h  The number to multiply in place.
+ * @param [in] r  The multiplier.
+ * @param [in] s  r[1] and r[2] times 20.
+ */
+static void poly1305_mul(uint64_t *h, const uint64_t *r, const uint64_t *s)
+{
+    poly1305_u128 d0, d1, d2;
+    uint64_t c;
+
+    d0 = (poly1305_u128)h[0] * r[0] + (poly1305_u128)h[1] * s[1] +
+         (poly1305_u128)h[2] * s[0];
+    d1 = (poly1305_u128)h[0] * r[1] + (poly1305_u128)h[1] * r[0] +
+         (poly1305_u128)h[2] * s[1];
+    d2 = (poly1305_u128)h[0] * r[2] + (poly1305_u128)h[1] * r[1] +
+         (poly1305_u128)h[2] * r[0];
+
+    c = (uint64_t)(d0 >> 44); h[0] = (uint64_t)d0 & M44;
+    d1 += c;
+    c = (uint64_t)(d1 >> 44); h[1] = (uint64_t)d1 & M44;
+    d2 += c;
+    c = (uint64_t)(d2 >> 42); h[2] = (uint64_t)d2 & M42;
+    h[0] += c * 5;
+    c = h[0] >> 44; h[0] &= M44;
+    h[1] += c;
+}
+
+/**
+ * Process blocks of message: h = (h + m) * r for each block.
+ *
+ * @param [in] ctx    The Poly1305 context.
+ * @param [in] m      The message blocks.
+ * @param [in] cnt    The number of blocks.
+ * @param [in] hibit  The bit above the block - 2^128 in radix 2^44. Zero for
+ *                    the final padded block.
+ */
+static void poly1305_blocks(MAC_POLY1305 *ctx, const uint8_t *m, size_t cnt,
+    uint64_t hibit)
+{
+    uint64_t t0, t1;
+
+    for (; cnt > 0; cnt--, m += MAC_POLY1305_BLOCK_LEN)
+    {
+        t0 = LE64(m);
+        t1 = LE64(m + 8);
+        ctx->h[0] += t0 & M44;
+        ctx->h[1] += ((t0 >> 44) | (t1 << 20)) & M44;
+        ctx->h[2] += ((t1 >> 24) & M42) | hibit;
+        poly1305_mul(ctx->h, ctx->r, ctx->s);
+    }
+}
+
+/**
+ * Initialize a Poly1305 operation with a key.
+ * r is clamped and s is stored to add at the end.
+ *
+ * @param [in] ctx  The Poly1305 context.
+ * @param [in] key  The one-time key: r then s.
+ * @param [in] len  The length of the key. Must be 32.
+ * @return  0 when the key length is not 32.<br>
+ *          1 otherwise.
+ */
+int mac_poly1305_init(MAC_POLY1305 *ctx, const void *key, size_t len)
+{
+    const uint8_t *k = key;
+    uint64_t t0, t1;
+
+    if ((key == NULL) || (len != MAC_POLY1305_KEY_LEN))
+        return 0;
+
+    t0 = LE64(k);
+    t1 = LE64(k + 8);
+    ctx->r[0] = t0 & 0xffc0fffffffULL;
+    ctx->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+    ctx->r[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+    ctx->s[0] = ctx->r[1] * 20;
+    ctx->s[1] = ctx->r[2] * 20;
+    ctx->pad[0] = LE64(k + 16);
+    ctx->pad[1] = LE64(k + 24);
+    ctx->h[0] = 0;
+    ctx->h[1] = 0;
+    ctx->h[2] = 0;
+    ctx->i = 0;
+
+    return 1;
+}
+
+/**
+ * Update the Poly1305 operation with message data, with a function to
+ * process the bulk of the data.
+ *
+ * @param [in] ctx     The Poly1305 context.
+ * @param [in] in      The message data.
+ * @param [in] len     The length of the message data.
+ * @param [in] blocks  The function processing whole blocks.
+ */
+static void poly1305_update(MAC_POLY1305 *ctx, const uint8_t *in, size_t len,
+    void (*blocks)(MAC_POLY1305 *, const uint8_t *, size_t))
+{
+    size_t l;
+
+    /* Fill up the cache first. */
+    if (ctx->i > 0)
+    {
+        l = MAC_POLY1305_BLOCK_LEN - ctx->i;
+        if (l > len)
+            l = len;
+        memcpy(ctx->b + ctx->i, in, l);
+        ctx->i += l;
+        in += l;
+        len -= l;
+        if (ctx->i < MAC_POLY1305_BLOCK_LEN)
+            return;
+        poly1305_blocks(ctx, ctx->b, 1, (uint64_t)1 << 40);
+        ctx->i = 0;
+    }
+    l = len / MAC_POLY1305_BLOCK_LEN;
+    if (l > 0)
+    {
+        blocks(ctx, in, l);
+        in += l * MAC_POLY1305_BLOCK_LEN;
+        len -= l * MAC_POLY1305_BLOCK_LEN;
+    }
+    /* Cache the rest of the data. */
+    memcpy(ctx->b, in, len);
+    ctx->i = len;
+}
+
+/**
+ * Process whole blocks of message with the portable code.
+ *
+ * @param [in] ctx  The Poly1305 context.
+ * @param [in] m    The message blocks.
+ * @param [in] cnt  The number of blocks.
+ */
+static void poly1305_c_blocks(MAC_POLY1305 *ctx, const uint8_t *m,
+    size_t cnt)
+{
+    poly1305_blocks(ctx, m, cnt, (uint64_t)1 << 40);
+}
+
+/**
+ * Update the Poly1305 operation with message data.
+ *
+ * @param [in] ctx  The Poly1305 context.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int mac_poly1305_update(MAC_POLY1305 *ctx, const void *in, size_t len)
+{
+    poly1305_update(ctx, in, len, &poly1305_c_blocks);
+    return 1;
+}
+
+/**
+ * Finalize the Poly1305 operation and output the tag.
+ * The last partial block is padded with a 1 byte and the accumulator is
+ * fully reduced before s is added.
+ *
+ * @param [in] tag  The buffer to hold the tag of 16 bytes.
+ * @param [in] ctx  The Poly1305 context.
+ * @return  1 to indicate success.
+ */
+int mac_poly1305_final(unsigned char *tag, MAC_POLY1305 *ctx)
+{
+    uint64_t h0, h1, h2, g0, g1, g2, c;
+    int i;
+
+    if (ctx->i > 0)
+    {
+        ctx->b[ctx->i] = 1;
+        memset(ctx->b + ctx->i + 1, 0, MAC_POLY1305_BLOCK_LEN - ctx->i - 1);
+        poly1305_blocks(ctx, ctx->b, 1, 0);
+    }
+
+    /* Fully carry h. */
+    h0 = ctx->h[0];
+    h1 = ctx->h[1];
+    h2 = ctx->h[2];
+    c = h1 >> 44; h1 &= M44;
+    h2 += c; c = h2 >> 42; h2 &= M42;
+    h0 += c * 5; c = h0 >> 44; h0 &= M44;
+    h1 += c; c = h1 >> 44; h1 &= M44;
+    h2 += c; c = h2 >> 42; h2 &= M42;
+    h0 += c * 5; c = h0 >> 44; h0 &= M44;
+    h1 += c;
+
+    /* g = h - p: use g when h is at least p. Constant time. */
+    g0 = h0 + 5; c = g0 >> 44; g0 &= M44;
+    g1 = h1 + c; c = g1 >> 44; g1 &= M44;
+    g2 = h2 + c - ((uint64_t)1 << 42);
+    c = (g2 >> 63) - 1;
+    h0 = (h0 & ~c) | (g0 & c);
+    h1 = (h1 & ~c) | (g1 & c);
+    h2 = (h2 & ~c) | (g2 & c);
+
+    /* tag = (h + s) mod 2^128 */
+    h0 += ctx->pad[0] & M44; c = h0 >> 44; h0 &= M44;
+    h1 += (((ctx->pad[0] >> 44) | (ctx->pad[1] << 20)) & M44) + c;
+    c = h1 >> 44; h1 &= M44;
+    h2 += ((ctx->pad[1] >> 24) & M42) + c;
+    h0 = h0 | (h1 << 44);
+    h1 = (h1 >> 20) | (h2 << 24);
+    for (i=0; i<8; i++)
+    {
+        tag[i] = (uint8_t)(h0 >> (8 * i));
+        tag[i + 8] = (uint8_t)(h1 >> (8 * i));
+    }
+
+    return 1;
+}
+
+#ifdef CPU_X86_64
+/**
+ * Convert a number in radix 2^44 to radix 2^26.
+ * The limbs of the input may be a little over size - so may the output's.
+ *
+ * @param [in] d  The number in radix 2^26.
+ * @param [in] h  The number in radix 2^44.
+ */
+static void poly1305_to_26(uint64_t *d, const uint64_t *h)
+{
+    d[0] = h[0] & M26;
+    d[1] = (h[0] >> 26) + ((h[1] << 18) & M26);
+    d[2] = (h[1] >> 8) & M26;
+    d[3] = (h[1] >> 34) + ((h[2] << 10) & M26);
+    d[4] = h[2] >> 16;
+}
+
+/**
+ * Initialize a Poly1305 operation with a key and calculate r^2, r^3 and r^4
+ * for the AVX2 lanes.
+ *
+ * @param [in] ctx  The Poly1305 context.
+ * @param [in] key  The one-time key: r then s.
+ * @param [in] len  The length of the key. Must be 32.
+ * @return  0 when the key length is not 32.<br>
+ *          1 otherwise.
+ */
+int mac_poly1305_avx2_init(MAC_POLY1305 *ctx, const void *key, size_t len)
+{
+    uint64_t p[3];
+    uint64_t d[5];
+    int i, j;
+
+    if (!mac_poly1305_init(ctx, key, len))
+        return 0;
+
+    memcpy(p, ctx->r, sizeof(p));
+    for (i=0; i<4; i++)
+    {
+        if (i > 0)
+            poly1305_mul(p, ctx->r, ctx->s);
+        poly1305_to_26(d, p);
+        for (j=0; j<5; j++)
+            ctx->rp[i][j] = (uint32_t)d[j];
+    }
+
+    return 1;
+}
+
+/** Multiply the five limbs of the four lanes by r and partially reduce. */
+#define POLY1305_MUL_AVX2(h, r, s)					\
+do									\
+{									\
+    __m256i d0, d1, d2, d3, d4, c;					\
+    d0 = _mm256_add_epi64(_mm256_add_epi64(				\
+        _mm256_mul_epu32(h[0], r[0]), _mm256_mul_epu32(h[1], s[4])),	\
+        _mm256_add_epi64(_mm256_add_epi64(				\
+        _mm256_mul_epu32(h[2], s[3]), _mm256_mul_epu32(h[3], s[2])),	\
+        _mm256_mul_epu32(h[4], s[1])));					\
+    d1 = _mm256_add_epi64(_mm256_add_epi64(				\
+        _mm256_mul_epu32(h[0], r[1]), _mm256_mul_epu32(h[1], r[0])),	\
+        _mm256_add_epi64(_mm256_add_epi64(				\
+        _mm256_mul_epu32(h[2], s[4]), _mm256_mul_epu32(h[3], s[3])),	\
+        _mm256_mul_epu32(h[4], s[2])));					\
+    d2 = _mm256_add_epi64(_mm256_add_epi64(				\
+        _mm256_mul_epu32(h[0], r[2]), _mm256_mul_epu32(h[1], r[1])),	\
+        _mm256_add_epi64(_mm256_add_epi64(				\
+        _mm256_mul_epu32(h[2], r[0]), _mm256_mul_epu32(h[3], s[4])),	\
+        _mm256_mul_epu32(h[4], s[3])));					\
+    d3 = _mm256_add_epi64(_mm256_add_epi64(				\
+        _mm256_mul_epu32(h[0], r[3]), _mm256_mul_epu32(h[1], r[2])),	\
+        _mm256_add_epi64(_mm256_add_epi64(				\
+        _mm256_mul_epu32(h[2], r[1]), _mm256_mul_epu32(h[3], r[0])),	\
+        _mm256_mul_epu32(h[4], s[4])));					\
+    d4 = _mm256_add_epi64(_mm256_add_epi64(				\
+        _mm256_mul_epu32(h[0], r[4]), _mm256_mul_epu32(h[1], r[3])),	\
+        _mm256_add_epi64(_mm256_add_epi64(				\
+        _mm256_mul_epu32(h[2], r[2]), _mm256_mul_epu32(h[3], r[1])),	\
+        _mm256_mul_epu32(h[4], r[0])));					\
+    c = _mm256_srli_epi64(d0, 26); h[0] = _mm256_and_si256(d0, mask);	\
+    d1 = _mm256_add_epi64(d1, c);					\
+    c = _mm256_srli_epi64(d1, 26); h[1] = _mm256_and_si256(d1, mask);	\
+    d2 = _mm256_add_epi64(d2, c);					\
+    c = _mm256_srli_epi64(d2, 26); h[2] = _mm256_and_si256(d2, mask);	\
+    d3 = _mm256_add_epi64(d3, c);					\
+    c = _mm256_srli_epi64(d3, 26); h[3] = _mm256_and_si256(d3, mask);	\
+    d4 = _mm256_add_epi64(d4, c);					\
+    c = _mm256_srli_epi64(d4, 26); h[4] = _mm256_and_si256(d4, mask);	\
+    h[0] = _mm256_add_epi64(h[0],					\
+        _mm256_add_epi64(c, _mm256_slli_epi64(c, 2)));			\
+    c = _mm256_srli_epi64(h[0], 26); h[0] = _mm256_and_si256(h[0], mask); \
+    h[1] = _mm256_add_epi64(h[1], c);					\
+}									\
+while (0)
+
+/**
+ * Load four blocks of message into the lanes and add to the accumulators.
+ * Lane i gets block i.
+ *
+ * @param [in] h      The accumulators.
+ * @param [in] m      The four message blocks.
+ * @param [in] mask   Mask of 26 bits in each lane.
+ * @param [in] hibit  The bit above the block in the top limb.
+ */
+AVX2_TARGET
+static inline void poly1305_avx2_add(__m256i *h, const uint8_t *m,
+    __m256i mask, __m256i hibit)
+{
+    __m256i a = _mm256_loadu_si256((const __m256i *)m);
+    __m256i b = _mm256_loadu_si256((const __m256i *)(m + 32));
+    /* Low and high halves of the blocks in order 0, 2, 1, 3 - reorder. */
+    __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b),
+        _MM_SHUFFLE(3, 1, 2, 0));
+    __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b),
+        _MM_SHUFFLE(3, 1, 2, 0));
+
+    h[0] = _mm256_add_epi64(h[0], _mm256_and_si256(lo, mask));
+    h[1] = _mm256_add_epi64(h[1],
+        _mm256_and_si256(_mm256_srli_epi64(lo, 26), mask));
+    h[2] = _mm256_add_epi64(h[2], _mm256_and_si256(_mm256_or_si256(
+        _mm256_srli_epi64(lo, 52), _mm256_slli_epi64(hi, 12)), mask));
+    h[3] = _mm256_add_epi64(h[3],
+        _mm256_and_si256(_mm256_srli_epi64(hi, 14), mask));
+    h[4] = _mm256_add_epi64(h[4],
+        _mm256_or_si256(_mm256_srli_epi64(hi, 40), hibit));
+}
+
+/**
+ * Process a multiple of four blocks in the AVX2 lanes.
+ * The accumulator is added to the first block and the result is put back
+ * into the accumulator.
+ *
+ * @param [in] ctx  The Poly1305 context.
+ * @param [in] m    The message blocks.
+ * @param [in] cnt  The number of blocks. A multiple of 4.
+ */
+AVX2_TARGET
+static void poly1305_avx2_lanes(MAC_POLY1305 *ctx, const uint8_t *m,
+    size_t cnt)
+{
+    const __m256i mask = _mm256_set1_epi64x(M26);
+    const __m256i hibit = _mm256_set1_epi64x(1 << 24);
+    __m256i h[5], r[5], s[5], p[5], ps[5];
+    uint64_t d[5];
+    uint64_t t[4];
+    int i;
+
+    poly1305_to_26(d, ctx->h);
+    for (i=0; i<5; i++)
+    {
+        h[i] = _mm256_set_epi64x(0, 0, 0, d[i]);
+        r[i] = _mm256_set1_epi64x(ctx->rp[3][i]);
+        s[i] = _mm256_add_epi64(r[i], _mm256_slli_epi64(r[i], 2));
+        /* Lane i is multiplied by r^(4-i) at the end. */
+        p[i] = _mm256_set_epi64x(ctx->rp[0][i], ctx->rp[1][i], ctx->rp[2][i],
+            ctx->rp[3][i]);
+        ps[i] = _mm256_add_epi64(p[i], _mm256_slli_epi64(p[i], 2));
+    }
+
+    poly1305_avx2_add(h, m, mask, hibit);
+    for (cnt -= 4, m += 64; cnt > 0; cnt -= 4, m += 64)
+    {
+        POLY1305_MUL_AVX2(h, r, s);
+        poly1305_avx2_add(h, m, mask, hibit);
+    }
+    POLY1305_MUL_AVX2(h, p, ps);
+
+    /* Add the lanes and carry. */
+    for (i=0; i<5; i++)
+    {
+        _mm256_storeu_si256((__m256i *)t, h[i]);
+        d[i] = t[0] + t[1] + t[2] + t[3];
+    }
+    d[1] += d[0] >> 26; d[0] &= M26;
+    d[2] += d[1] >> 26; d[1] &= M26;
+    d[3] += d[2] >> 26; d[2] &= M26;
+    d[4] += d[3] >> 26; d[3] &= M26;
+    d[0] += (d[4] >> 26) * 5; d[4] &= M26;
+    d[1] += d[0] >> 26; d[0] &= M26;
+
+    /* Back to radix 2^44. */
+    ctx->h[0] = d[0] + ((d[1] & 0x3ffff) << 26);
+    ctx->h[1] = (d[1] >> 18) + (d[2] << 8) + ((d[3] & 0x3ff) << 34);
+    ctx->h[2] = (d[3] >> 10) + (d[4] << 16);
+}
+
+/**
+ * Process whole blocks of message: groups of four in the AVX2 lanes when
+ * there is enough data and the rest with the portable code.
+ *
+ * @param [in] ctx  The Poly1305 context.
+ * @param [in] m    The message blocks.
+ * @param [in] cnt  The number of blocks.
+ */
+static void poly1305_avx2_blocks(MAC_POLY1305 *ctx, const uint8_t *m,
+    size_t cnt)
+{
+    size_t l;
+
+    if (cnt * MAC_POLY1305_BLOCK_LEN >= POLY1305_AVX2_MIN)
+    {
+        l = cnt & ~(size_t)3;
+        poly1305_avx2_lanes(ctx, m, l);
+        m += l * MAC_POLY1305_BLOCK_LEN;
+        cnt -= l;
+    }
+    poly1305_blocks(ctx, m, cnt, (uint64_t)1 << 40);
+}
+
+/**
+ * Update the Poly1305 operation with message data using AVX2 for large
+ * amounts of data.
+ *
+ * @param [in] ctx  The Poly1305 context.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int mac_poly1305_avx2_update(MAC_POLY1305 *ctx, const void *in, size_t len)
+{
+    poly1305_update(ctx, in, len, &poly1305_avx2_blocks);
+    return 1;
+}
+#endif
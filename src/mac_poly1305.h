@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef MAC_POLY1305_H
+#define MAC_POLY1305_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** The length of the Poly1305 key. */
+#define MAC_POLY1305_KEY_LEN	32
+/** The length of the Poly1305 tag. */
+#define MAC_POLY1305_LEN	16
+/** The size of a Poly1305 block. */
+#define MAC_POLY1305_BLOCK_LEN	16
+
+/** Data structure for Poly1305. */
+typedef struct mac_poly1305_st
+{
+    /** The clamped key r in radix 2^44. */
+    uint64_t r[3];
+    /** r[1] and r[2] times 20 - for the reduction modulo 2^130 - 5. */
+    uint64_t s[2];
+    /** The accumulator in radix 2^44. */
+    uint64_t h[3];
+    /** The key s that is added at the end. */
+    uint64_t pad[2];
+    /** r^1 to r^4 in radix 2^26 for the AVX2 lanes. */
+    uint32_t rp[4][5];
+    /** Cached message data. */
+    uint8_t b[MAC_POLY1305_BLOCK_LEN];
+    /** Number of bytes in cache. */
+    uint8_t i;
+} MAC_POLY1305;
+
+int mac_poly1305_init(MAC_POLY1305 *ctx, const void *key, size_t len);
+int mac_poly1305_update(MAC_POLY1305 *ctx, const void *in, size_t len);
+int mac_poly1305_final(unsigned char *tag, MAC_POLY1305 *ctx);
+#ifdef CPU_X86_64
+int mac_poly1305_avx2_init(MAC_POLY1305 *ctx, const void *key, size_t len);
+int mac_poly1305_avx2_update(MAC_POLY1305 *ctx, const void *in, size_t len);
+#endif
+
+#endif
+
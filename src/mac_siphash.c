@@ -0,0 +1,799 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * SipHash-2-4, SipHash-1-3 and HalfSipHash-2-4 keyed hashes.
+ * Short keyed hashes for hash tables: a 16 byte message of SipHash-2-4 is
+ * ten rounds of adds, rotates and XORs on 64-bit words.
+ * The AVX2 code hashes four messages at once, one in each 64-bit lane. A lane
+ * that has no more message words keeps its state until all lanes are done.
+ */
+
+#include <string.h>
+#include "mac.h"
+#include "mac_siphash.h"
+#include "hash_cpu.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+/** Compile the function for AVX2. */
+#define AVX2_TARGET	__attribute__((target("avx2")))
+/** The number of messages hashed at once with AVX2. */
+#define LANES		4
+#endif
+
+/** Load a 64-bit number from little-endian bytes. */
+#define LE64(p)								\
+    (((uint64_t)(p)[0]      ) | ((uint64_t)(p)[1] <<  8) |		\
+     ((uint64_t)(p)[2] << 16) | ((uint64_t)(p)[3] << 24) |		\
+     ((uint64_t)(p)[4] << 32) | ((uint64_t)(p)[5] << 40) |		\
+     ((uint64_t)(p)[6] << 48) | ((uint64_t)(p)[7] << 56))
+/** Load a 32-bit number from little-endian bytes. */
+#define LE32(p)								\
+    (((uint32_t)(p)[0]      ) | ((uint32_t)(p)[1] <<  8) |		\
+     ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+
+/** Rotate a 64-bit number left. */
+#define ROTL64(x, n)	(((x) << (n)) | ((x) >> (64 - (n))))
+/** Rotate a 32-bit number left. */
+#define ROTL32(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+
+/** One round of SipHash on the state v0..v3. */
+#define SIPROUND(v0, v1, v2, v3)					\
+    do									\
+    {									\
+        v0 += v1; v1 = ROTL64(v1, 13); v1 ^= v0; v0 = ROTL64(v0, 32);	\
+        v2 += v3; v3 = ROTL64(v3, 16); v3 ^= v2;			\
+        v0 += v3; v3 = ROTL64(v3, 21); v3 ^= v0;			\
+        v2 += v1; v1 = ROTL64(v1, 17); v1 ^= v2; v2 = ROTL64(v2, 32);	\
+    }									\
+    while (0)
+
+/** One round of HalfSipHash on the state v0..v3. */
+#define HALFSIPROUND(v0, v1, v2, v3)					\
+    do									\
+    {									\
+        v0 += v1; v1 = ROTL32(v1,  5); v1 ^= v0; v0 = ROTL32(v0, 16);	\
+        v2 += v3; v3 = ROTL32(v3,  8); v3 ^= v2;			\
+        v0 += v3; v3 = ROTL32(v3,  7); v3 ^= v0;			\
+        v2 += v1; v1 = ROTL32(v1, 13); v1 ^= v2; v2 = ROTL32(v2, 16);	\
+    }									\
+    while (0)
+
+/**
+ * Load the last bytes of a message, fewer than 8, as a little-endian number.
+ *
+ * @param [in] m    The bytes.
+ * @param [in] len  The number of bytes.
+ * @return  The bytes as a number.
+ */
+static inline uint64_t siphash_tail(const uint8_t *m, size_t len)
+{
+    uint64_t t = 0;
+
+    switch (len)
+    {
+        case 7: t |= (uint64_t)m[6] << 48;
+        /* fall through */
+        case 6: t |= (uint64_t)m[5] << 40;
+        /* fall through */
+        case 5: t |= (uint64_t)m[4] << 32;
+        /* fall through */
+        case 4: t |= (uint64_t)m[3] << 24;
+        /* fall through */
+        case 3: t |= (uint64_t)m[2] << 16;
+        /* fall through */
+        case 2: t |= (uint64_t)m[1] <<  8;
+        /* fall through */
+        case 1: t |= (uint64_t)m[0];
+    }
+    return t;
+}
+
+/**
+ * SipHash-c-d of a whole message.
+ * Inlined into each caller so that the rounds are unrolled.
+ *
+ * @param [in] k0   The first half of the key.
+ * @param [in] k1   The second half of the key.
+ * @param [in] m    The message.
+ * @param [in] len  The length of the message.
+ * @param [in] c    The number of rounds per message word.
+ * @param [in] d    The number of rounds in finalization.
+ * @return  The hash.
+ */
+static inline uint64_t siphash(uint64_t k0, uint64_t k1, const uint8_t *m,
+    size_t len, int c, int d)
+{
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+    uint64_t w;
+    const uint8_t *end = m + (len & ~(size_t)7);
+    int i;
+
+    for (; m != end; m += 8)
+    {
+        w = LE64(m);
+        v3 ^= w;
+        for (i=0; i<c; i++)
+            SIPROUND(v0, v1, v2, v3);
+        v0 ^= w;
+    }
+    w = siphash_tail(m, len & 7) | ((uint64_t)len << 56);
+    v3 ^= w;
+    for (i=0; i<c; i++)
+        SIPROUND(v0, v1, v2, v3);
+    v0 ^= w;
+
+    v2 ^= 0xff;
+    for (i=0; i<d; i++)
+        SIPROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/**
+ * HalfSipHash-2-4 of a whole message.
+ *
+ * @param [in] k0   The first half of the key.
+ * @param [in] k1   The second half of the key.
+ * @param [in] m    The message.
+ * @param [in] len  The length of the message.
+ * @return  The hash.
+ */
+static uint32_t halfsiphash(uint32_t k0, uint32_t k1, const uint8_t *m,
+    size_t len)
+{
+    uint32_t v0 = k0;
+    uint32_t v1 = k1;
+    uint32_t v2 = k0 ^ 0x6c796765;
+    uint32_t v3 = k1 ^ 0x74656462;
+    uint32_t w;
+    const uint8_t *end = m + (len & ~(size_t)3);
+
+    for (; m != end; m += 4)
+    {
+        w = LE32(m);
+        v3 ^= w;
+        HALFSIPROUND(v0, v1, v2, v3);
+        HALFSIPROUND(v0, v1, v2, v3);
+        v0 ^= w;
+    }
+    w = (uint32_t)siphash_tail(m, len & 3) | ((uint32_t)len << 24);
+    v3 ^= w;
+    HALFSIPROUND(v0, v1, v2, v3);
+    HALFSIPROUND(v0, v1, v2, v3);
+    v0 ^= w;
+
+    v2 ^= 0xff;
+    HALFSIPROUND(v0, v1, v2, v3);
+    HALFSIPROUND(v0, v1, v2, v3);
+    HALFSIPROUND(v0, v1, v2, v3);
+    HALFSIPROUND(v0, v1, v2, v3);
+    return v1 ^ v3;
+}
+
+/**
+ * Initialize a SipHash-c-d operation with a key.
+ *
+ * @param [in] ctx  The SipHash context.
+ * @param [in] key  The key.
+ * @param [in] len  The length of the key. Must be 16.
+ * @param [in] c    The number of rounds per message word.
+ * @param [in] d    The number of rounds in finalization.
+ * @return  0 when the key length is not 16.<br>
+ *          1 otherwise.
+ */
+static int mac_siphash_init(MAC_SIPHASH *ctx, const void *key, size_t len,
+    int c, int d)
+{
+    const uint8_t *k = key;
+    uint64_t k0, k1;
+
+    if (len != MAC_SIPHASH_KEY_LEN)
+        return 0;
+
+    k0 = LE64(k);
+    k1 = LE64(k + 8);
+    ctx->v[0] = k0 ^ 0x736f6d6570736575ULL;
+    ctx->v[1] = k1 ^ 0x646f72616e646f6dULL;
+    ctx->v[2] = k0 ^ 0x6c7967656e657261ULL;
+    ctx->v[3] = k1 ^ 0x7465646279746573ULL;
+    ctx->m = 0;
+    ctx->len = 0;
+    ctx->c = c;
+    ctx->d = d;
+
+    return 1;
+}
+
+/**
+ * Initialize a SipHash-2-4 operation with a key.
+ *
+ * @param [in] ctx  The SipHash context.
+ * @param [in] key  The key.
+ * @param [in] len  The length of the key. Must be 16.
+ * @return  0 when the key length is not 16.<br>
+ *          1 otherwise.
+ */
+int mac_siphash_2_4_init(MAC_SIPHASH *ctx, const void *key, size_t len)
+{
+    return mac_siphash_init(ctx, key, len, 2, 4);
+}
+
+/**
+ * Initialize a SipHash-1-3 operation with a key.
+ *
+ * @param [in] ctx  The SipHash context.
+ * @param [in] key  The key.
+ * @param [in] len  The length of the key. Must be 16.
+ * @return  0 when the key length is not 16.<br>
+ *          1 otherwise.
+ */
+int mac_siphash_1_3_init(MAC_SIPHASH *ctx, const void *key, size_t len)
+{
+    return mac_siphash_init(ctx, key, len, 1, 3);
+}
+
+/**
+ * Compress a message word into the SipHash state.
+ *
+ * @param [in] ctx  The SipHash context.
+ * @param [in] w    The message word.
+ */
+static void siphash_word(MAC_SIPHASH *ctx, uint64_t w)
+{
+    uint64_t v0 = ctx->v[0], v1 = ctx->v[1], v2 = ctx->v[2], v3 = ctx->v[3];
+    int i;
+
+    v3 ^= w;
+    for (i=0; i<ctx->c; i++)
+        SIPROUND(v0, v1, v2, v3);
+    v0 ^= w;
+
+    ctx->v[0] = v0; ctx->v[1] = v1; ctx->v[2] = v2; ctx->v[3] = v3;
+}
+
+/**
+ * Update the SipHash operation with message data.
+ *
+ * @param [in] ctx  The SipHash context.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int mac_siphash_update(MAC_SIPHASH *ctx, const void *in, size_t len)
+{
+    const uint8_t *m = in;
+
+    /* Fill the cached word. */
+    for (; (len > 0) && ((ctx->len & 7) != 0); len--, m++)
+    {
+        ctx->m |= (uint64_t)*m << (8 * (ctx->len & 7));
+        if ((++ctx->len & 7) == 0)
+        {
+            siphash_word(ctx, ctx->m);
+            ctx->m = 0;
+        }
+    }
+    for (; len >= 8; len -= 8, m += 8)
+    {
+        siphash_word(ctx, LE64(m));
+        ctx->len += 8;
+    }
+    /* Cache is empty unless no data was left after filling it. */
+    ctx->m |= siphash_tail(m, len);
+    ctx->len += len;
+
+    return 1;
+}
+
+/**
+ * Finalize the SipHash operation and output the tag.
+ *
+ * @param [in] tag  The tag: 8 bytes.
+ * @param [in] ctx  The SipHash context.
+ * @return  1 to indicate success.
+ */
+int mac_siphash_final(unsigned char *tag, MAC_SIPHASH *ctx)
+{
+    uint64_t v0, v1, v2, v3;
+    int i;
+
+    siphash_word(ctx, ctx->m | (ctx->len << 56));
+    v0 = ctx->v[0]; v1 = ctx->v[1]; v2 = ctx->v[2]; v3 = ctx->v[3];
+    v2 ^= 0xff;
+    for (i=0; i<ctx->d; i++)
+        SIPROUND(v0, v1, v2, v3);
+    v0 ^= v1 ^ v2 ^ v3;
+    for (i=0; i<MAC_SIPHASH_LEN; i++)
+        tag[i] = (unsigned char)(v0 >> (8 * i));
+
+    return 1;
+}
+
+/**
+ * Initialize a HalfSipHash-2-4 operation with a key.
+ *
+ * @param [in] ctx  The HalfSipHash context.
+ * @param [in] key  The key.
+ * @param [in] len  The length of the key. Must be 8.
+ * @return  0 when the key length is not 8.<br>
+ *          1 otherwise.
+ */
+int mac_halfsiphash_init(MAC_HALFSIPHASH *ctx, const void *key, size_t len)
+{
+    const uint8_t *k = key;
+    uint32_t k0, k1;
+
+    if (len != MAC_HALFSIPHASH_KEY_LEN)
+        return 0;
+
+    k0 = LE32(k);
+    k1 = LE32(k + 4);
+    ctx->v[0] = k0;
+    ctx->v[1] = k1;
+    ctx->v[2] = k0 ^ 0x6c796765;
+    ctx->v[3] = k1 ^ 0x74656462;
+    ctx->m = 0;
+    ctx->len = 0;
+
+    return 1;
+}
+
+/**
+ * Compress a message word into the HalfSipHash state.
+ *
+ * @param [in] ctx  The HalfSipHash context.
+ * @param [in] w    The message word.
+ */
+static void halfsiphash_word(MAC_HALFSIPHASH *ctx, uint32_t w)
+{
+    uint32_t v0 = ctx->v[0], v1 = ctx->v[1], v2 = ctx->v[2], v3 = ctx->v[3];
+
+    v3 ^= w;
+    HALFSIPROUND(v0, v1, v2, v3);
+    HALFSIPROUND(v0, v1, v2, v3);
+    v0 ^= w;
+
+    ctx->v[0] = v0; ctx->v[1] = v1; ctx->v[2] = v2; ctx->v[3] = v3;
+}
+
+/**
+ * Update the HalfSipHash operation with message data.
+ *
+ * @param [in] ctx  The HalfSipHash context.
+ * @param [in] in   The message data.
+ * @param [in] len  The length of the message data.
+ * @return  1 to indicate success.
+ */
+int mac_halfsiphash_update(MAC_HALFSIPHASH *ctx, const void *in, size_t len)
+{
+    const uint8_t *m = in;
+
+    /* Fill the cached word. */
+    for (; (len > 0) && ((ctx->len & 3) != 0); len--, m++)
+    {
+        ctx->m |= (uint32_t)*m << (8 * (ctx->len & 3));
+        if ((++ctx->len & 3) == 0)
+        {
+            halfsiphash_word(ctx, ctx->m);
+            ctx->m = 0;
+        }
+    }
+    for (; len >= 4; len -= 4, m += 4)
+    {
+        halfsiphash_word(ctx, LE32(m));
+        ctx->len += 4;
+    }
+    /* Cache is empty unless no data was left after filling it. */
+    ctx->m |= (uint32_t)siphash_tail(m, len);
+    ctx->len += len;
+
+    return 1;
+}
+
+/**
+ * Finalize the HalfSipHash operation and output the tag.
+ *
+ * @param [in] tag  The tag: 4 bytes.
+ * @param [in] ctx  The HalfSipHash context.
+ * @return  1 to indicate success.
+ */
+int mac_halfsiphash_final(unsigned char *tag, MAC_HALFSIPHASH *ctx)
+{
+    uint32_t v0, v1, v2, v3;
+    int i;
+
+    halfsiphash_word(ctx, ctx->m | (ctx->len << 24));
+    v0 = ctx->v[0]; v1 = ctx->v[1]; v2 = ctx->v[2]; v3 = ctx->v[3];
+    v2 ^= 0xff;
+    for (i=0; i<4; i++)
+        HALFSIPROUND(v0, v1, v2, v3);
+    v1 ^= v3;
+    for (i=0; i<MAC_HALFSIPHASH_LEN; i++)
+        tag[i] = (unsigned char)(v1 >> (8 * i));
+
+    return 1;
+}
+
+#ifdef CPU_X86_64
+/** Rotate each 64-bit lane left by n bits. */
+#define ROTL_V(x, n)							\
+    _mm256_or_si256(_mm256_slli_epi64(x, n), _mm256_srli_epi64(x, 64 - (n)))
+
+/**
+ * One round of SipHash on four states - one in each lane.
+ * Rotates by 16 and 32 are byte shuffles. Requires rot16 in scope.
+ */
+#define SIPROUND_V(v0, v1, v2, v3)					\
+    do									\
+    {									\
+        v0 = _mm256_add_epi64(v0, v1);					\
+        v1 = _mm256_xor_si256(ROTL_V(v1, 13), v0);			\
+        v0 = _mm256_shuffle_epi32(v0, 0xb1);				\
+        v2 = _mm256_add_epi64(v2, v3);					\
+        v3 = _mm256_xor_si256(_mm256_shuffle_epi8(v3, rot16), v2);	\
+        v0 = _mm256_add_epi64(v0, v3);					\
+        v3 = _mm256_xor_si256(ROTL_V(v3, 21), v0);			\
+        v2 = _mm256_add_epi64(v2, v1);					\
+        v1 = _mm256_xor_si256(ROTL_V(v1, 17), v2);			\
+        v2 = _mm256_shuffle_epi32(v2, 0xb1);				\
+    }									\
+    while (0)
+
+/**
+ * SipHash-c-d of four messages at once - one in each lane.
+ * Messages of different lengths are hashed with the longest: a lane that
+ * has no more words keeps its state.
+ *
+ * @param [in]  k0    The first half of the key of each message.
+ * @param [in]  k1    The second half of the key of each message.
+ * @param [in]  msgs  The messages.
+ * @param [in]  lens  The lengths of the messages.
+ * @param [in]  c     The number of rounds per message word.
+ * @param [in]  d     The number of rounds in finalization.
+ * @param [out] out   The hash of each message.
+ */
+AVX2_TARGET
+static void siphash_avx2_lanes(const uint64_t *k0, const uint64_t *k1,
+    const uint8_t **msgs, const size_t *lens, int c, int d, uint64_t *out)
+{
+    __m256i v0, v1, v2, v3, w, act, t0, t1, t2, t3, nw;
+    const __m256i rot16 = _mm256_setr_epi8(
+        6, 7, 0, 1, 2, 3, 4, 5, 14, 15, 8, 9, 10, 11, 12, 13,
+        6, 7, 0, 1, 2, 3, 4, 5, 14, 15, 8, 9, 10, 11, 12, 13);
+    uint64_t last[LANES];
+    uint64_t m[LANES];
+    size_t n, words = 0, least = (size_t)-1;
+    int i, j;
+
+    for (j=0; j<LANES; j++)
+    {
+        if ((lens[j] >> 3) > words)
+            words = lens[j] >> 3;
+        if ((lens[j] >> 3) < least)
+            least = lens[j] >> 3;
+        last[j] = siphash_tail(msgs[j] + (lens[j] & ~(size_t)7),
+            lens[j] & 7) | ((uint64_t)lens[j] << 56);
+    }
+    /* Number of words of each lane including the last. */
+    nw = _mm256_set_epi64x((lens[3] >> 3) + 1, (lens[2] >> 3) + 1,
+        (lens[1] >> 3) + 1, (lens[0] >> 3) + 1);
+
+    t0 = _mm256_set_epi64x(k0[3], k0[2], k0[1], k0[0]);
+    t1 = _mm256_set_epi64x(k1[3], k1[2], k1[1], k1[0]);
+    v0 = _mm256_xor_si256(t0, _mm256_set1_epi64x(0x736f6d6570736575ULL));
+    v1 = _mm256_xor_si256(t1, _mm256_set1_epi64x(0x646f72616e646f6dULL));
+    v2 = _mm256_xor_si256(t0, _mm256_set1_epi64x(0x6c7967656e657261ULL));
+    v3 = _mm256_xor_si256(t1, _mm256_set1_epi64x(0x7465646279746573ULL));
+
+    /* One more word than the longest for the last bytes and length. */
+    for (n=0; n<=words; n++)
+    {
+        /* x86 is little-endian: load words directly. */
+        for (j=0; j<LANES; j++)
+        {
+            if (n < (lens[j] >> 3))
+                memcpy(&m[j], msgs[j] + 8 * n, sizeof(m[j]));
+            else
+                m[j] = last[j];
+        }
+        w = _mm256_set_epi64x(m[3], m[2], m[1], m[0]);
+
+        t0 = v0; t1 = v1; t2 = v2;
+        t3 = _mm256_xor_si256(v3, w);
+        for (i=0; i<c; i++)
+            SIPROUND_V(t0, t1, t2, t3);
+        t0 = _mm256_xor_si256(t0, w);
+
+        if (n <= least)
+        {
+            v0 = t0; v1 = t1; v2 = t2; v3 = t3;
+        }
+        else
+        {
+            /* Lanes past their last word keep their state. */
+            act = _mm256_cmpgt_epi64(nw, _mm256_set1_epi64x(n));
+            v0 = _mm256_blendv_epi8(v0, t0, act);
+            v1 = _mm256_blendv_epi8(v1, t1, act);
+            v2 = _mm256_blendv_epi8(v2, t2, act);
+            v3 = _mm256_blendv_epi8(v3, t3, act);
+        }
+    }
+
+    v2 = _mm256_xor_si256(v2, _mm256_set1_epi64x(0xff));
+    for (i=0; i<d; i++)
+        SIPROUND_V(v0, v1, v2, v3);
+    v0 = _mm256_xor_si256(_mm256_xor_si256(v0, v1), _mm256_xor_si256(v2, v3));
+    _mm256_storeu_si256((__m256i *)out, v0);
+}
+
+/**
+ * SipHash-c-d of many messages, four at a time with AVX2.
+ * All messages use the same key when keys is NULL.
+ *
+ * @param [in]  keys  The key of each message. May be NULL.
+ * @param [in]  key   The key of all messages when keys is NULL.
+ * @param [in]  msgs  The messages.
+ * @param [in]  lens  The lengths of the messages.
+ * @param [in]  cnt   The number of messages.
+ * @param [in]  c     The number of rounds per message word.
+ * @param [in]  d     The number of rounds in finalization.
+ * @param [out] out   The hash of each message.
+ */
+static void siphash_avx2(const unsigned char **keys, const unsigned char *key,
+    const unsigned char **msgs, const size_t *lens, int cnt, int c, int d,
+    uint64_t *out)
+{
+    uint64_t k0[LANES], k1[LANES], h[LANES];
+    const uint8_t *lm[LANES];
+    size_t ll[LANES];
+    int i, j, n;
+
+    for (i=0; i<cnt; i+=LANES)
+    {
+        n = (cnt - i < LANES) ? cnt - i : LANES;
+        for (j=0; j<LANES; j++)
+        {
+            /* Spare lanes hash an empty message. */
+            const uint8_t *k = (keys != NULL) ? keys[i + j % n] : key;
+
+            k0[j] = LE64(k);
+            k1[j] = LE64(k + 8);
+            lm[j] = (j < n) ? msgs[i + j] : (const uint8_t *)"";
+            ll[j] = (j < n) ? lens[i + j] : 0;
+        }
+        siphash_avx2_lanes(k0, k1, lm, ll, c, d, h);
+        for (j=0; j<n; j++)
+            out[i + j] = h[j];
+    }
+}
+
+/**
+ * SipHash-c-d of many messages, each with its own key, using AVX2.
+ *
+ * @param [in] keys   The keys of the messages.
+ * @param [in] klens  The lengths of the keys. Must be 16.
+ * @param [in] msgs   The messages.
+ * @param [in] lens   The lengths of the messages.
+ * @param [in] cnt    The number of messages.
+ * @param [in] tags   The buffers to hold the tags.
+ * @param [in] c      The number of rounds per message word.
+ * @param [in] d      The number of rounds in finalization.
+ * @return  0 when a key length is not 16.<br>
+ *          1 otherwise.
+ */
+static int mac_siphash_avx2_batch(const unsigned char **keys,
+    const int *klens, const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **tags, int c, int d)
+{
+    uint64_t h[LANES];
+    int i, j, n;
+
+    for (i=0; i<cnt; i++)
+    {
+        if (klens[i] != MAC_SIPHASH_KEY_LEN)
+            return 0;
+    }
+    for (i=0; i<cnt; i+=LANES)
+    {
+        n = (cnt - i < LANES) ? cnt - i : LANES;
+        siphash_avx2(keys + i, NULL, msgs + i, lens + i, n, c, d, h);
+        for (j=0; j<n; j++)
+            memcpy(tags[i + j], &h[j], MAC_SIPHASH_LEN);
+    }
+
+    return 1;
+}
+
+/**
+ * SipHash-2-4 of many messages, each with its own key, using AVX2.
+ *
+ * @param [in] keys   The keys of the messages.
+ * @param [in] klens  The lengths of the keys. Must be 16.
+ * @param [in] msgs   The messages.
+ * @param [in] lens   The lengths of the messages.
+ * @param [in] cnt    The number of messages.
+ * @param [in] tags   The buffers to hold the tags.
+ * @return  0 when a key length is not 16.<br>
+ *          1 otherwise.
+ */
+int mac_siphash_2_4_avx2_batch(const unsigned char **keys, const int *klens,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **tags)
+{
+    return mac_siphash_avx2_batch(keys, klens, msgs, lens, cnt, tags, 2, 4);
+}
+
+/**
+ * SipHash-1-3 of many messages, each with its own key, using AVX2.
+ *
+ * @param [in] keys   The keys of the messages.
+ * @param [in] klens  The lengths of the keys. Must be 16.
+ * @param [in] msgs   The messages.
+ * @param [in] lens   The lengths of the messages.
+ * @param [in] cnt    The number of messages.
+ * @param [in] tags   The buffers to hold the tags.
+ * @return  0 when a key length is not 16.<br>
+ *          1 otherwise.
+ */
+int mac_siphash_1_3_avx2_batch(const unsigned char **keys, const int *klens,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **tags)
+{
+    return mac_siphash_avx2_batch(keys, klens, msgs, lens, cnt, tags, 1, 3);
+}
+#endif
+
+/**
+ * SipHash-2-4 of a message - for the keys of hash tables.
+ * No context or checks: the key is read as two 64-bit numbers and the
+ * message compressed in one pass.
+ *
+ * @param [in] key  The key: MAC_SIPHASH_KEY_LEN bytes.
+ * @param [in] msg  The message.
+ * @param [in] len  The length of the message.
+ * @return  The hash - the tag as a little-endian number.
+ */
+uint64_t MAC_siphash_2_4(const unsigned char *key, const void *msg,
+    size_t len)
+{
+    return siphash(LE64(key), LE64(key + 8), msg, len, 2, 4);
+}
+
+/**
+ * SipHash-1-3 of a message - for the keys of hash tables.
+ * Fewer rounds than SipHash-2-4: faster with a smaller security margin.
+ *
+ * @param [in] key  The key: MAC_SIPHASH_KEY_LEN bytes.
+ * @param [in] msg  The message.
+ * @param [in] len  The length of the message.
+ * @return  The hash - the tag as a little-endian number.
+ */
+uint64_t MAC_siphash_1_3(const unsigned char *key, const void *msg,
+    size_t len)
+{
+    return siphash(LE64(key), LE64(key + 8), msg, len, 1, 3);
+}
+
+/**
+ * HalfSipHash-2-4 of a message - for the keys of hash tables on 32-bit
+ * CPUs.
+ *
+ * @param [in] key  The key: MAC_HALFSIPHASH_KEY_LEN bytes.
+ * @param [in] msg  The message.
+ * @param [in] len  The length of the message.
+ * @return  The hash - the tag as a little-endian number.
+ */
+uint32_t MAC_halfsiphash_2_4(const unsigned char *key, const void *msg,
+    size_t len)
+{
+    return halfsiphash(LE32(key), LE32(key + 4), msg, len);
+}
+
+/**
+ * Hash many messages with one key - e.g. the keys being inserted into or
+ * rehashed in a hash table.
+ * With AVX2, SipHash-2-4 and SipHash-1-3 hash four messages at once. Lengths
+ * that are close keep the lanes busy.
+ *
+ * @param [in]  id      The MAC algorithm identifier: MAC_ID_SIPHASH_2_4,
+ *                      MAC_ID_SIPHASH_1_3 or MAC_ID_HALFSIPHASH_2_4.
+ * @param [in]  key     The key: MAC_SIPHASH_KEY_LEN bytes or
+ *                      MAC_HALFSIPHASH_KEY_LEN bytes for HalfSipHash.
+ * @param [in]  msgs    The messages.
+ * @param [in]  lens    The lengths of the messages.
+ * @param [in]  cnt     The number of messages.
+ * @param [out] hashes  The hash of each message.
+ * @return  HASH_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          HASH_ERR_BAD_LEN when the count is negative.<br>
+ *          HASH_ERR_NOT_FOUND when the algorithm is not a SipHash.<br>
+ *          0 otherwise.
+ */
+int MAC_siphash_batch(MAC_ID id, const unsigned char *key,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    uint64_t *hashes)
+{
+    int ret = 0;
+    int i;
+    uint64_t k0, k1;
+    int c = 2, d = 4;
+
+    if ((key == NULL) || (msgs == NULL) || (lens == NULL) || (hashes == NULL))
+    {
+        ret = HASH_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (cnt < 0)
+    {
+        ret = HASH_ERR_BAD_LEN;
+        goto end;
+    }
+    for (i=0; i<cnt; i++)
+    {
+        if ((msgs[i] == NULL) && (lens[i] != 0))
+        {
+            ret = HASH_ERR_PARAM_NULL;
+            goto end;
+        }
+    }
+
+    switch (id)
+    {
+        case MAC_ID_SIPHASH_1_3:
+            c = 1; d = 3;
+            /* fall through */
+        case MAC_ID_SIPHASH_2_4:
+#ifdef CPU_X86_64
+            if ((cnt >= LANES) &&
+                ((hash_cpu_flags() & HASH_METH_FLAG_AVX2) != 0))
+            {
+                siphash_avx2(NULL, key, msgs, lens, cnt, c, d, hashes);
+                break;
+            }
+#endif
+            k0 = LE64(key);
+            k1 = LE64(key + 8);
+            for (i=0; i<cnt; i++)
+            {
+                if (c == 2)
+                    hashes[i] = siphash(k0, k1, msgs[i], lens[i], 2, 4);
+                else
+                    hashes[i] = siphash(k0, k1, msgs[i], lens[i], 1, 3);
+            }
+            break;
+        case MAC_ID_HALFSIPHASH_2_4:
+            for (i=0; i<cnt; i++)
+                hashes[i] = halfsiphash(LE32(key), LE32(key + 4), msgs[i],
+                    lens[i]);
+            break;
+        default:
+            ret = HASH_ERR_NOT_FOUND;
+            break;
+    }
+end:
+    return ret;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef MAC_SIPHASH_H
+#define MAC_SIPHASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** The length of the SipHash tag. */
+#define MAC_SIPHASH_LEN		8
+/** The length of the HalfSipHash tag. */
+#define MAC_HALFSIPHASH_LEN	4
+
+/** Data structure for SipHash-c-d. */
+typedef struct mac_siphash_st
+{
+    /** The state. */
+    uint64_t v[4];
+    /** Cached message bytes, little-endian. */
+    uint64_t m;
+    /** The number of bytes of message. */
+    uint64_t len;
+    /** The number of rounds per message word. */
+    uint8_t c;
+    /** The number of rounds in finalization. */
+    uint8_t d;
+} MAC_SIPHASH;
+
+/** Data structure for HalfSipHash-2-4. */
+typedef struct mac_halfsiphash_st
+{
+    /** The state. */
+    uint32_t v[4];
+    /** Cached message bytes, little-endian. */
+    uint32_t m;
+    /** The number of bytes of message. */
+    uint32_t len;
+} MAC_HALFSIPHASH;
+
+int mac_siphash_2_4_init(MAC_SIPHASH *ctx, const void *key, size_t len);
+int mac_siphash_1_3_init(MAC_SIPHASH *ctx, const void *key, size_t len);
+int mac_siphash_update(MAC_SIPHASH *ctx, const void *in, size_t len);
+int mac_siphash_final(unsigned char *tag, MAC_SIPHASH *ctx);
+
+int mac_halfsiphash_init(MAC_HALFSIPHASH *ctx, const void *key, size_t len);
+int mac_halfsiphash_update(MAC_HALFSIPHASH *ctx, const void *in, size_t len);
+int mac_halfsiphash_final(unsigned char *tag, MAC_HALFSIPHASH *ctx);
+
+#ifdef CPU_X86_64
+int mac_siphash_2_4_avx2_batch(const unsigned char **keys, const int *klens,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **tags);
+int mac_siphash_1_3_avx2_batch(const unsigned char **keys, const int *klens,
+    const unsigned char **msgs, const size_t *lens, int cnt,
+    unsigned char **tags);
+#endif
+
+#endif
@@ -21,6 +21,20 @@
  *
  */
 
+/*
+ * Random bytes from HMAC_DRBG with HMAC-SHA-256 (NIST SP 800-90A).
+ * Each thread has its own generator so no locking is needed. Small requests
+ * are served from a buffer of output so that they don't each cost a
+ * generate. The generator is seeded on first use, reseeded after
+ * RANDOM_RESEED_INTERVAL generates and after fork() so that the child
+ * doesn't repeat the parent's output.
+ * Seed material comes from getrandom(), or /dev/urandom when the system call
+ * isn't available - the system must supply it. Define OPT_HASH_RDRAND to mix
+ * in the CPU's RDRAND too when the CPU has it.
+ * Define OPT_HASH_OPENSSL_RAND to use OpenSSL's RAND_bytes instead.
+ */
+
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include "random.h"
@@ -28,11 +42,260 @@
 #ifdef OPT_HASH_OPENSSL_RAND
 #include "openssl/rand.h"
 #else
-#include "hash_sha3.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/random.h>
+#include "hash.h"
+#include "hash_cpu.h"
+#include "hash_sha2.h"
+
+/** The HMAC functions of the fastest implementation on the CPU. */
+typedef struct random_hmac_st
+{
+    /** Initialize HMAC-SHA-256 with a key. */
+    int (*init)(HASH_SHA256 *ctx, const void *key, size_t len);
+    /** Update HMAC-SHA-256 with data. */
+    int (*update)(HASH_SHA256 *ctx, const void *data, size_t len);
+    /** Finalize HMAC-SHA-256. */
+    int (*final)(unsigned char *md, HASH_SHA256 *ctx);
+} RANDOM_HMAC;
+
+/** The generator of this thread. */
+static _Thread_local RANDOM_DRBG random_drbg;
+/** The HMAC implementation to use. */
+static RANDOM_HMAC random_hmac;
+/** Incremented in the child process after fork(). */
+static volatile unsigned int random_fork_gen = 0;
+/** Ensures the HMAC implementation is chosen and fork handler registered. */
+static pthread_once_t random_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Count the forks so that generators reseed in the child.
+ */
+static void random_atfork_child(void)
+{
+    random_fork_gen++;
+}
+
+/**
+ * Choose the HMAC implementation and register the fork handler.
+ */
+static void random_init(void)
+{
+    random_hmac.init = &hmac_sha256_init;
+    random_hmac.update = &hash_sha256_update;
+    random_hmac.final = &hmac_sha256_final;
+#ifdef CPU_X86_64
+    if (hash_cpu_flags() & HASH_METH_FLAG_SHANI)
+    {
+        random_hmac.init = &hmac_sha256_ni_init;
+        random_hmac.update = &hash_sha256_ni_update;
+        random_hmac.final = &hmac_sha256_ni_final;
+    }
+#endif
+    pthread_atfork(NULL, NULL, &random_atfork_child);
+}
+
+/**
+ * Get seed material from the operating system and, when available, the CPU.
+ * The operating system must supply all of the seed - RDRAND output is only
+ * mixed in as extra input.
+ *
+ * @param [in] seed  The buffer to hold the seed.
+ * @param [in] len   The length of the seed.
+ * @return  0 on success.<br>
+ *          1 when the operating system has no seed material.
+ */
+static int random_get_seed(unsigned char *seed, size_t len)
+{
+    int ret = 1;
+    ssize_t n;
+    size_t o = 0;
+    int fd;
+
+    while (o < len)
+    {
+        n = getrandom(seed + o, len - o, 0);
+        if (n > 0)
+            o += n;
+        else if (errno != EINTR)
+            break;
+    }
+    if (o < len)
+    {
+        fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            while (o < len)
+            {
+                n = read(fd, seed + o, len - o);
+                if (n > 0)
+                    o += n;
+                else if ((n == 0) || (errno != EINTR))
+                    break;
+            }
+            close(fd);
+        }
+    }
+    if (o < len)
+        goto end;
+    ret = 0;
+
+#if defined(OPT_HASH_RDRAND) && defined(CPU_X86_64)
+    if ((hash_cpu_flags() & HASH_CPU_FLAG_RDRAND) != 0)
+    {
+        size_t i, j;
+        uint64_t rd;
+        unsigned char ok;
+
+        /* XOR in RDRAND values - retry when the CPU has none ready. */
+        for (i=0; i<len; i+=8)
+        {
+            for (j=0; j<10; j++)
+            {
+                __asm__ __volatile__ ("rdrand %0; setc %1"
+                    : "=r" (rd), "=qm" (ok));
+                if (ok)
+                    break;
+            }
+            if (!ok)
+                continue;
+            for (j=0; (j<8) && (i+j<len); j++)
+                seed[i+j] ^= (unsigned char)(rd >> (j * 8));
+        }
+    }
+#endif
+end:
+    return ret;
+}
+
+/**
+ * HMAC_DRBG update: mix data into the key and value.
+ *
+ * @param [in] drbg  The generator.
+ * @param [in] data  The data to mix in. May be NULL.
+ * @param [in] len   The length of the data.
+ */
+static void random_update(RANDOM_DRBG *drbg, const unsigned char *data,
+    size_t len)
+{
+    HASH_SHA256 ctx[2];
+    unsigned char b;
+
+    for (b=0; b<=1; b++)
+    {
+        /* K = HMAC(K, V | b | data), V = HMAC(K, V). */
+        random_hmac.init(ctx, drbg->k, RANDOM_LEN);
+        random_hmac.update(ctx, drbg->v, RANDOM_LEN);
+        random_hmac.update(ctx, &b, 1);
+        if (len > 0)
+            random_hmac.update(ctx, data, len);
+        random_hmac.final(drbg->k, ctx);
+        random_hmac.init(ctx, drbg->k, RANDOM_LEN);
+        random_hmac.update(ctx, drbg->v, RANDOM_LEN);
+        random_hmac.final(drbg->v, ctx);
+        /* Second round only with data. */
+        if (len == 0)
+            break;
+    }
+    memset(ctx, 0, sizeof(ctx));
+}
+
+/**
+ * HMAC_DRBG instantiate or reseed with seed material.
+ * On first use the key is all zeros and the value all ones.
+ *
+ * @param [in] drbg  The generator.
+ * @param [in] seed  The seed material.
+ * @param [in] len   The length of the seed material.
+ */
+void random_drbg_seed(RANDOM_DRBG *drbg, const unsigned char *seed,
+    size_t len)
+{
+    pthread_once(&random_once, random_init);
+
+    /* A generator copied by fork() is reseeded like a new one. */
+    if ((!drbg->seeded) || (drbg->fork_gen != random_fork_gen))
+    {
+        memset(drbg->k, 0x00, RANDOM_LEN);
+        memset(drbg->v, 0x01, RANDOM_LEN);
+        memset(drbg->buf, 0, sizeof(drbg->buf));
+        drbg->o = RANDOM_BUF_LEN;
+    }
+    random_update(drbg, seed, len);
+
+    drbg->reseed = 0;
+    drbg->fork_gen = random_fork_gen;
+    drbg->seeded = 1;
+}
+
+/**
+ * HMAC_DRBG instantiate or reseed with new seed material from the system.
+ *
+ * @param [in] drbg  The generator.
+ * @return  0 on success.<br>
+ *          1 when no seed material is available.
+ */
+static int random_seed(RANDOM_DRBG *drbg)
+{
+    unsigned char seed[RANDOM_SEED_LEN];
+
+    if (random_get_seed(seed, sizeof(seed)) != 0)
+        return 1;
+    random_drbg_seed(drbg, seed, sizeof(seed));
+    memset(seed, 0, sizeof(seed));
+    return 0;
+}
+
+/**
+ * HMAC_DRBG generate: output bytes and update the state for backtracking
+ * resistance. The key is only hashed into a context once for all blocks.
+ * Seeds from the system when not seeded, after fork() and every
+ * RANDOM_RESEED_INTERVAL generates.
+ *
+ * @param [in] drbg  The generator.
+ * @param [in] r     The buffer to fill.
+ * @param [in] l     The number of bytes to output. At most RANDOM_MAX_REQ.
+ * @return  0 on success.<br>
+ *          1 when reseeding failed.
+ */
+int random_drbg_generate(RANDOM_DRBG *drbg, unsigned char *r, size_t l)
+{
+    HASH_SHA256 key[2];
+    HASH_SHA256 ctx[2];
+    size_t n;
+
+    if ((!drbg->seeded) || (drbg->fork_gen != random_fork_gen) ||
+        (drbg->reseed >= RANDOM_RESEED_INTERVAL))
+    {
+        if (random_seed(drbg) != 0)
+            return 1;
+    }
+
+    /* V = HMAC(K, V) for each block of output. */
+    random_hmac.init(key, drbg->k, RANDOM_LEN);
+    for (; l > 0; l -= n, r += n)
+    {
+        memcpy(ctx, key, sizeof(ctx));
+        random_hmac.update(ctx, drbg->v, RANDOM_LEN);
+        random_hmac.final(drbg->v, ctx);
+        n = (l < RANDOM_LEN) ? l : RANDOM_LEN;
+        memcpy(r, drbg->v, n);
+    }
+    memset(key, 0, sizeof(key));
+    memset(ctx, 0, sizeof(ctx));
+
+    random_update(drbg, NULL, 0);
+    drbg->reseed++;
+    return 0;
+}
 #endif
 
 /**
  * Fill the buffer with random bytes.
+ * Safe to call from many threads and after fork().
  *
  * @param [in] r  The buffer to fill.
  * @param [in] l  The length of the buffer in bytes.
@@ -41,25 +304,45 @@
  */
 int pseudo_random(unsigned char *r, int l)
 {
-#ifdef OPT_NTRU_OPENSSL_RAND
+#ifdef OPT_HASH_OPENSSL_RAND
     return RAND_bytes(r, l) != 1;
 #else
-#ifdef OPT_NTRU_RDRAND
-    int i;
-    uint64_t rd[4];
+    int ret = 0;
+    int n;
+    RANDOM_DRBG *drbg = &random_drbg;
 
-    for (i=0; i<4; i++)
-        asm volatile ("rdrand %0" : "=r" (rd[i]));
+    pthread_once(&random_once, random_init);
+    if (l <= 0)
+        goto end;
 
-    return hash_shake256(r, l, (unsigned char *)rd, sizeof(rd)) == 0;
-#else
-    int i;
-    static uint64_t rd[4] = { 0, 0, 0, 0 };
+    /* Buffered output was generated before the fork - discard it. */
+    if (drbg->fork_gen != random_fork_gen)
+    {
+        memset(drbg->buf, 0, sizeof(drbg->buf));
+        drbg->o = RANDOM_BUF_LEN;
+    }
 
-    for (i=0; i<4 && ++rd[i] == 0; i++) ;
+    if (l <= RANDOM_SMALL_LEN)
+    {
+        if ((!drbg->seeded) || (drbg->o + l > RANDOM_BUF_LEN))
+        {
+            ret = random_drbg_generate(drbg, drbg->buf, RANDOM_BUF_LEN);
+            if (ret != 0)
+                goto end;
+            drbg->o = 0;
+        }
+        memcpy(r, drbg->buf + drbg->o, l);
+        memset(drbg->buf + drbg->o, 0, l);
+        drbg->o += l;
+        goto end;
+    }
 
-    return hash_shake256(r, l, (unsigned char *)rd, sizeof(rd)) == 0;
-#endif
+    for (; (ret == 0) && (l > 0); l -= n, r += n)
+    {
+        n = (l < RANDOM_MAX_REQ) ? l : RANDOM_MAX_REQ;
+        ret = random_drbg_generate(drbg, r, n);
+    }
+end:
+    return ret;
 #endif
 }
-
@@ -26,5 +26,46 @@
 
 int pseudo_random(unsigned char *a, int len);
 
+#ifndef OPT_HASH_OPENSSL_RAND
+#include <stddef.h>
+#include <stdint.h>
+
+/** The length of the key and value - the HMAC-SHA-256 output. */
+#define RANDOM_LEN		32
+/** The length of the seed: 256 bits of entropy and a 128-bit nonce. */
+#define RANDOM_SEED_LEN		48
+/** The number of generates before reseeding. */
+#define RANDOM_RESEED_INTERVAL	(1 << 16)
+/** The maximum number of bytes output by one generate. */
+#define RANDOM_MAX_REQ		(1 << 16)
+/** The number of bytes of output buffered for small requests. */
+#define RANDOM_BUF_LEN		256
+/** Requests up to this length are served from the buffer. */
+#define RANDOM_SMALL_LEN	64
+
+/** The state of a thread's generator. */
+typedef struct random_drbg_st
+{
+    /** The key. */
+    unsigned char k[RANDOM_LEN];
+    /** The value. */
+    unsigned char v[RANDOM_LEN];
+    /** The number of generates since seeding. */
+    uint32_t reseed;
+    /** The fork generation the generator was seeded in. */
+    unsigned int fork_gen;
+    /** Whether the generator has been seeded. */
+    int seeded;
+    /** The offset of the unused output in the buffer. */
+    int o;
+    /** Output for small requests. Used bytes are zeroized. */
+    unsigned char buf[RANDOM_BUF_LEN];
+} RANDOM_DRBG;
+
+void random_drbg_seed(RANDOM_DRBG *drbg, const unsigned char *seed,
+    size_t len);
+int random_drbg_generate(RANDOM_DRBG *drbg, unsigned char *r, size_t l);
+#endif
+
 #endif
 
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "hash_async.hpp"
+#include "hash.hpp"
+
+using namespace hash::async;
+
+/* Message buffer to hash data from. */
+static unsigned char msg[1024 * 1024 + 123];
+/* Key for the MAC algorithms. */
+static unsigned char key[32];
+
+/* Executor with one thread that resumes coroutines in order. */
+class Executor
+{
+public:
+    Executor() : t_([this] { run(); }) {}
+    ~Executor()
+    {
+        {
+            std::lock_guard<std::mutex> l(lock_);
+            stop_ = true;
+        }
+        cond_.notify_one();
+        t_.join();
+    }
+
+    void post(std::coroutine_handle<> h)
+    {
+        {
+            std::lock_guard<std::mutex> l(lock_);
+            q_.push_back(h);
+        }
+        cond_.notify_one();
+    }
+
+    std::thread::id id() const { return t_.get_id(); }
+
+    /* Awaitable that moves the coroutine onto the executor. */
+    auto hop()
+    {
+        struct Hop
+        {
+            Executor &e;
+            bool await_ready() { return false; }
+            void await_suspend(std::coroutine_handle<> h) { e.post(h); }
+            void await_resume() {}
+        };
+        return Hop{ *this };
+    }
+
+private:
+    void run()
+    {
+        std::coroutine_handle<> h;
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> l(lock_);
+                cond_.wait(l, [&] { return stop_ || !q_.empty(); });
+                if (q_.empty())
+                    return;
+                h = q_.front();
+                q_.pop_front();
+            }
+            h.resume();
+        }
+    }
+
+    std::mutex lock_;
+    std::condition_variable cond_;
+    std::deque<std::coroutine_handle<>> q_;
+    bool stop_ = false;
+    std::thread t_;
+};
+
+/* Executor the coroutines are run on. */
+static Executor *exec;
+
+/*
+ * Create a temporary file containing the message.
+ *
+ * @return  File descriptor positioned at the start of the file.
+ */
+static int msg_file()
+{
+    FILE *f = tmpfile();
+    int fd;
+
+    fwrite(msg, 1, sizeof(msg), f);
+    fflush(f);
+    fd = dup(fileno(f));
+    fclose(f);
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+/*
+ * Write the message to a file descriptor in small pieces and close it.
+ *
+ * @param [in] fd  The file descriptor to write to.
+ * @return  Thread writing the data.
+ */
+static std::thread msg_writer(int fd)
+{
+    return std::thread([fd] {
+        size_t i, n;
+
+        for (i = 0; i < sizeof(msg); i += n)
+        {
+            n = sizeof(msg) - i;
+            if (n > 10000)
+                n = 10000;
+            n = write(fd, msg + i, n);
+            if (i % 100000 < 10000)
+                usleep(1000);
+        }
+        close(fd);
+    });
+}
+
+/*
+ * Run a digest task on the executor.
+ */
+static Task<std::vector<unsigned char>> on_exec(
+    Task<std::vector<unsigned char>> t)
+{
+    co_await exec->hop();
+    co_return co_await t;
+}
+
+/*
+ * Compare the result of a test and print it.
+ *
+ * @param [in] name  The name of the test.
+ * @param [in] a     The calculated data.
+ * @param [in] b     The expected data.
+ * @param [in] len   The length of the data.
+ * @return  0 on success.<br>
+ *          1 on failure.
+ */
+static int check(const char *name, const unsigned char *a,
+    const unsigned char *b, size_t len)
+{
+    int fail = memcmp(a, b, len) != 0;
+
+    fprintf(stderr, "%-10s: %s\n", name, fail ? "NO" : "YES");
+    return fail;
+}
+
+/*
+ * Hash a file using small buffers so that reading stalls.
+ */
+static int test_file(Reactor &r)
+{
+    unsigned char data[32];
+    int fd = msg_file();
+    std::vector<unsigned char> md;
+
+    md = sync_wait(on_exec(digest(r, HASH_ID_SHA256, fd, 2, 4096)));
+    close(fd);
+    HASH_digest(HASH_ID_SHA256, msg, sizeof(msg), data);
+    return check("File", md.data(), data, sizeof(data));
+}
+
+/*
+ * Hash the data arriving on a pipe.
+ */
+static int test_pipe(Reactor &r)
+{
+    unsigned char data[64];
+    int fds[2];
+    std::vector<unsigned char> md;
+
+    if (pipe(fds) != 0)
+        return 1;
+    std::thread w = msg_writer(fds[1]);
+    md = sync_wait(on_exec(digest(r, HASH_ID_BLAKE2B_512, fds[0])));
+    w.join();
+    close(fds[0]);
+    HASH_digest(HASH_ID_BLAKE2B_512, msg, sizeof(msg), data);
+    return check("Pipe", md.data(), data, sizeof(data));
+}
+
+/*
+ * MAC the data arriving on a socket.
+ */
+static int test_socket(Reactor &r)
+{
+    unsigned char data[32];
+    int fds[2];
+    std::vector<unsigned char> tag;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        return 1;
+    std::thread w = msg_writer(fds[1]);
+    tag = sync_wait(on_exec(mac(r, MAC_ID_SHA256,
+        std::vector<unsigned char>(key, key + sizeof(key)), fds[0])));
+    w.join();
+    close(fds[0]);
+    MAC_compute(MAC_ID_SHA256, key, sizeof(key), msg, sizeof(msg), data);
+    return check("Socket", tag.data(), data, sizeof(data));
+}
+
+/*
+ * Hash with the C++ wrapper and check each chunk is handed to the executor.
+ */
+static Task<std::vector<unsigned char>> exec_only(Reactor &r, int fd,
+    bool &on_exec)
+{
+    hash::Hasher<hash::Sha3_256> h;
+    hash::Hasher<hash::Sha3_256>::Digest md;
+
+    co_await exec->hop();
+    {
+        Stream s(r, fd, 3, 1000);
+
+        for (;;)
+        {
+            std::span<const unsigned char> c = co_await s.next();
+            on_exec &= std::this_thread::get_id() == exec->id();
+            if (c.empty())
+                break;
+            h.update(c);
+        }
+    }
+    co_await update(r, fd, h);
+    md = h.final();
+    co_return std::vector<unsigned char>(md.begin(), md.end());
+}
+
+static int test_executor(Reactor &r)
+{
+    unsigned char data[32];
+    int fds[2];
+    bool on_exec = true;
+    std::vector<unsigned char> md;
+
+    if (pipe(fds) != 0)
+        return 1;
+    std::thread w = msg_writer(fds[1]);
+    md = sync_wait(exec_only(r, fds[0], on_exec));
+    w.join();
+    close(fds[0]);
+    HASH_digest(HASH_ID_SHA3_256, msg, sizeof(msg), data);
+    fprintf(stderr, "%-10s: %s\n", "Executor", on_exec ? "YES" : "NO");
+    return check("Hasher", md.data(), data, sizeof(data)) | !on_exec;
+}
+
+int main()
+{
+    int ret = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(msg); i++)
+        msg[i] = i * 7 + (i >> 8);
+    for (i = 0; i < sizeof(key); i++)
+        key[i] = i;
+
+    Executor e;
+    exec = &e;
+    {
+        Reactor r([](std::coroutine_handle<> h) { exec->post(h); });
+
+        ret |= test_file(r);
+        ret |= test_pipe(r);
+        ret |= test_socket(r);
+        ret |= test_executor(r);
+    }
+
+    return ret;
+}
+
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hash_constexpr.hpp"
+#include "hash.h"
+
+/*
+ * Convert a hexadecimal string to bytes at compile time.
+ *
+ * @param [in] s  The hexadecimal string.
+ * @return  The bytes.
+ */
+template <std::size_t N>
+consteval std::array<unsigned char, N> hex(const char *s)
+{
+    std::array<unsigned char, N> a{};
+
+    for (std::size_t i = 0; i < N; i++)
+    {
+        char h = s[2 * i], l = s[2 * i + 1];
+        a[i] = ((h <= '9' ? h - '0' : h - 'a' + 10) << 4) |
+                (l <= '9' ? l - '0' : l - 'a' + 10);
+    }
+    return a;
+}
+
+/* Known answers for "abc" - evaluated by the compiler. */
+static_assert(hash::ct::sha256("abc") == hex<32>(
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+static_assert(hash::ct::sha3_256("abc") == hex<32>(
+    "3a985da74fe225b2045c172d6bd390bd855f086e3e9d525b46bfe24511431532"));
+static_assert(hash::ct::blake2s_256("abc") == hex<32>(
+    "508c5e8c327c14e2e1a72ba34eeb452f37458b209ed63a294d999b4c86675982"));
+/* Two blocks of SHA-256 padding. */
+static_assert(hash::ct::sha256(
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") == hex<32>(
+    "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+
+/* Message longer than a block of each algorithm, digested at compile time. */
+static constexpr char label[] =
+    "The quick brown fox jumps over the lazy dog. "
+    "The quick brown fox jumps over the lazy dog. "
+    "The quick brown fox jumps over the lazy dog. "
+    "The quick brown fox jumps over the lazy dog.";
+static constexpr auto label_sha256 = hash::ct::sha256(label);
+static constexpr auto label_sha3_256 = hash::ct::sha3_256(label);
+static constexpr auto label_blake2s_256 = hash::ct::blake2s_256(label);
+
+/* Message buffer to hash data from. */
+static unsigned char msg[300];
+
+/*
+ * Compare a constexpr digest against the library.
+ *
+ * @param [in] id    The hash algorithm identifier.
+ * @param [in] m     The message data.
+ * @param [in] mlen  The length of the message data.
+ * @param [in] md    The constexpr digest.
+ * @return  0 on success.<br>
+ *          1 on failure.
+ */
+static int check(HASH_ID id, const void *m, size_t mlen,
+    const std::array<unsigned char, 32> &md)
+{
+    unsigned char data[32];
+
+    HASH_digest(id, (const unsigned char *)m, mlen, data);
+    return memcmp(data, md.data(), sizeof(data)) != 0;
+}
+
+int main()
+{
+    int ret = 0;
+    int fail;
+    size_t i;
+
+    for (i = 0; i < sizeof(msg); i++)
+        msg[i] = i;
+
+    fail = check(HASH_ID_SHA256, label, sizeof(label) - 1, label_sha256);
+    fprintf(stderr, "SHA-256    : %s\n", fail ? "NO" : "YES");
+    ret |= fail;
+    fail = check(HASH_ID_SHA3_256, label, sizeof(label) - 1, label_sha3_256);
+    fprintf(stderr, "SHA3-256   : %s\n", fail ? "NO" : "YES");
+    ret |= fail;
+    fail = check(HASH_ID_BLAKE2S_256, label, sizeof(label) - 1,
+        label_blake2s_256);
+    fprintf(stderr, "BLAKE2s-256: %s\n", fail ? "NO" : "YES");
+    ret |= fail;
+
+    /* Every length across the block boundaries. */
+    fail = 0;
+    for (i = 0; i <= sizeof(msg); i++)
+    {
+        std::span<const unsigned char> m(msg, i);
+
+        fail |= check(HASH_ID_SHA256, msg, i, hash::ct::sha256(m));
+        fail |= check(HASH_ID_SHA3_256, msg, i, hash::ct::sha3_256(m));
+        fail |= check(HASH_ID_BLAKE2S_256, msg, i, hash::ct::blake2s_256(m));
+    }
+    fprintf(stderr, "Lengths    : %s\n", fail ? "NO" : "YES");
+    ret |= fail;
+
+    return ret;
+}
+
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include <utility>
+
+#include "hash.hpp"
+
+/* Message buffer to hash data from. */
+static unsigned char msg[1000];
+/* Key for the MAC algorithms. */
+static unsigned char key[32];
+
+/*
+ * Test the C++ hash operation against the one-shot C API.
+ * The message is hashed in two parts through a moved and a copied object.
+ *
+ * @param [in] name  The name of the algorithm.
+ * @return  0 on success.<br>
+ *          1 on failure.
+ */
+template <typename Alg>
+static int test_hasher(const char *name)
+{
+    unsigned char data[Alg::len];
+    hash::Hasher<Alg> h;
+    typename hash::Hasher<Alg>::Digest md;
+    std::span<const unsigned char> m(msg);
+    bool ok;
+
+    /* Non-cryptographic hashes are only found when asked for. */
+    if (HASH_digest(Alg::id, msg, sizeof(msg), data) == HASH_ERR_NOT_FOUND)
+    {
+        HASH *c;
+
+        HASH_new(Alg::id, HASH_METH_FLAG_NONCRYPTO, &c);
+        HASH_init(c);
+        HASH_update(c, msg, sizeof(msg));
+        HASH_final(c, data);
+        HASH_free(c);
+    }
+
+    h.update(m.first(333));
+    hash::Hasher<Alg> moved(std::move(h));
+    hash::Hasher<Alg> copied(moved);
+    md = copied.update(m.subspan(333)).final();
+    ok = memcmp(md.data(), data, md.size()) == 0;
+    md = hash::Hasher<Alg>::digest(m);
+    ok &= memcmp(md.data(), data, md.size()) == 0;
+
+    fprintf(stderr, "%-12s: %s\n", name, ok ? "YES" : "NO");
+    return !ok;
+}
+
+/*
+ * Test the C++ MAC operation against the one-shot C API.
+ *
+ * @param [in] name  The name of the algorithm.
+ * @param [in] klen  The length of key to use.
+ * @return  0 on success.<br>
+ *          1 on failure.
+ */
+template <typename Alg>
+static int test_mac(const char *name, std::size_t klen = sizeof(key))
+{
+    unsigned char data[Alg::len];
+    hash::Mac<Alg> keyed(std::span<const unsigned char>(key, klen));
+    typename hash::Mac<Alg>::Tag tag;
+    std::span<const unsigned char> m(msg);
+    bool ok;
+
+    MAC_compute(Alg::id, key, klen, msg, sizeof(msg), data);
+
+    hash::Mac<Alg> mac(keyed);
+    tag = mac.update(m.first(100)).update(m.subspan(100)).final();
+    ok = memcmp(tag.data(), data, tag.size()) == 0;
+    mac = keyed;
+    ok &= mac.update(m).verify(tag);
+    data[0] ^= 1;
+    mac = keyed;
+    ok &= !mac.update(m).verify(std::span<const unsigned char>(data,
+        tag.size()));
+
+    fprintf(stderr, "%-12s: %s\n", name, ok ? "YES" : "NO");
+    return !ok;
+}
+
+int main()
+{
+    int ret = 0;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(msg); i++)
+        msg[i] = i;
+    for (i = 0; i < sizeof(key); i++)
+        key[i] = 0x80 + i;
+
+    ret |= test_hasher<hash::Sha1>("SHA-1");
+    ret |= test_hasher<hash::Sha224>("SHA-224");
+    ret |= test_hasher<hash::Sha256>("SHA-256");
+    ret |= test_hasher<hash::Sha384>("SHA-384");
+    ret |= test_hasher<hash::Sha512>("SHA-512");
+    ret |= test_hasher<hash::Sha512_224>("SHA-512_224");
+    ret |= test_hasher<hash::Sha512_256>("SHA-512_256");
+    ret |= test_hasher<hash::Sha3_224>("SHA3-224");
+    ret |= test_hasher<hash::Sha3_256>("SHA3-256");
+    ret |= test_hasher<hash::Sha3_384>("SHA3-384");
+    ret |= test_hasher<hash::Sha3_512>("SHA3-512");
+    ret |= test_hasher<hash::Blake2b<28>>("BLAKE2b-224");
+    ret |= test_hasher<hash::Blake2b<32>>("BLAKE2b-256");
+    ret |= test_hasher<hash::Blake2b<48>>("BLAKE2b-384");
+    ret |= test_hasher<hash::Blake2b<64>>("BLAKE2b-512");
+    ret |= test_hasher<hash::Blake2s<28>>("BLAKE2s-224");
+    ret |= test_hasher<hash::Blake2s<32>>("BLAKE2s-256");
+    ret |= test_hasher<hash::Shake128>("SHAKE128");
+    ret |= test_hasher<hash::Shake256>("SHAKE256");
+    ret |= test_hasher<hash::Xxh3_64>("XXH3-64");
+    ret |= test_hasher<hash::Xxh3_128>("XXH3-128");
+    ret |= test_hasher<hash::Crc32c>("CRC32C");
+
+    ret |= test_mac<hash::HmacSha1>("HMAC-SHA-1");
+    ret |= test_mac<hash::HmacSha256>("HMAC-SHA-256");
+    ret |= test_mac<hash::HmacSha512>("HMAC-SHA-512");
+    ret |= test_mac<hash::MacSha3_256>("SHA3-256");
+    ret |= test_mac<hash::Blake2b_512Mac>("BLAKE2b-512");
+    ret |= test_mac<hash::Blake2s_256Mac>("BLAKE2s-256");
+    ret |= test_mac<hash::Poly1305Mac>("Poly1305");
+    ret |= test_mac<hash::SipHash24Mac>("SipHash-2-4", 16);
+    ret |= test_mac<hash::HalfSipHashMac>("HalfSipHash", 8);
+
+    return ret;
+}
+
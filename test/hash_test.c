@@ -25,10 +25,14 @@
 #include <string.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
 #include <string.h>
 
 #include "hash.h"
 #include "../src/random.h"
+#include "../src/hash_cpu.h"
+#include "../src/hash_meth.h"
 
 #ifdef CC_CLANG
 #define PRIu64 "llu"
@@ -52,6 +56,7 @@ HASH_ID id[] =
     HASH_ID_SHA512_224, HASH_ID_SHA512_256,
     HASH_ID_SHA3_224, HASH_ID_SHA3_256, HASH_ID_SHA3_384, HASH_ID_SHA3_512,
     HASH_ID_BLAKE2B_512, HASH_ID_BLAKE2S_256,
+    HASH_ID_SHAKE128, HASH_ID_SHAKE256,
 };
 
 /* Number of hash ids. */
@@ -82,14 +87,40 @@ void calc_cps()
     printf("Cycles/sec: %"PRIu64"\n", cps);
 }
 
+/*
+ * Perform one hash operation.
+ *
+ * @param [in] hash     The hash object to use.
+ * @param [in] id       The id of the hash algorithm.
+ * @param [in] oneshot  Whether to use the one-shot API.
+ * @param [in] msg      The data of the message.
+ * @param [in] mlen     The length of the data.
+ * @param [in] dgst     The buffer to hold the digest.
+ */
+static void hash_op(HASH *hash, HASH_ID id, int oneshot, unsigned char *msg,
+    int mlen, unsigned char *dgst)
+{
+    if (oneshot)
+        HASH_digest(id, msg, mlen, dgst);
+    else
+    {
+        HASH_init(hash);
+        HASH_update(hash, msg, mlen);
+        HASH_final(hash, dgst);
+    }
+}
+
 /*
  * Determine the number of hash operations that can be performed per second.
  *
- * @param [in] hash  The hash object to use.
- * @param [in] msg   The data of the message.
- * @param [in] mlen  The length of the data.
+ * @param [in] hash     The hash object to use.
+ * @param [in] id       The id of the hash algorithm.
+ * @param [in] oneshot  Whether to use the one-shot API.
+ * @param [in] msg      The data of the message.
+ * @param [in] mlen     The length of the data.
  */
-void hash_cycles(HASH *hash, unsigned char *msg, int mlen)
+void hash_cycles(HASH *hash, HASH_ID id, int oneshot, unsigned char *msg,
+    int mlen)
 {
     int i;
     uint64_t start, end, diff;
@@ -98,31 +129,19 @@ void hash_cycles(HASH *hash, unsigned char *msg, int mlen)
 
     /* Prime the caches, etc */
     for (i=0; i<1000; i++)
-    {
-        HASH_init(hash);
-        HASH_update(hash, msg, mlen);
-        HASH_final(hash, dgst);
-    }
+        hash_op(hash, id, oneshot, msg, mlen, dgst);
 
     /* Approximate number of ops in a second. */
     start = get_cycles();
     for (i=0; i<200; i++)
-    {
-        HASH_init(hash);
-        HASH_update(hash, msg, mlen);
-        HASH_final(hash, dgst);
-    }
+        hash_op(hash, id, oneshot, msg, mlen, dgst);
     end = get_cycles();
     num_ops = cps/((end-start)/200);
 
     /* Perform about 1 seconds worth of operations. */
     start = get_cycles();
     for (i=0; i<num_ops; i++)
-    {
-        HASH_init(hash);
-        HASH_update(hash, msg, mlen);
-        HASH_final(hash, dgst);
-    }
+        hash_op(hash, id, oneshot, msg, mlen, dgst);
     end = get_cycles();
 
     diff = end - start;
@@ -159,24 +178,1023 @@ void hash_msg(HASH *hash, const unsigned char *msg, size_t len, int cnt)
 }
 
 /*
- * Test an implementation of a hash.
+ * Hash the message in two parts, exporting the state after the first part and
+ * importing it into a new object to hash the second part.
+ * Every split of the message is checked against the digest of the whole.
+ * The state is imported into an internal implementation - all can import.
  *
- * @param [in] id     The id of the hash algorithm to test.
+ * @param [in] hash   The hash object to use.
+ * @param [in] id     The id of the hash algorithm.
  * @param [in] flags  The method implementation flags required.
- * @param [in] speed  Whether to test the speed of the implementation.
+ * @param [in] msg    The data of the message.
+ * @param [in] len    The length of the data.
+ * @return  0 when the digests match.<br>
+ *          1 otherwise.
  */
-int test_hash(HASH_ID id, int flags, int speed)
+int hash_resume(HASH *hash, HASH_ID id, int flags, const unsigned char *msg,
+    int len)
 {
+    int ret = 0;
+    int i;
+    HASH *resumed = NULL;
+    unsigned char dgst[64];
+    unsigned char rdgst[64];
+    unsigned char state[HASH_STATE_MAX_LEN];
+    int state_len;
+    int dlen;
+
+    if (HASH_get_state_len(hash, &state_len) == HASH_ERR_NOT_SUPPORTED)
+        goto end;
+
+    HASH_get_len(hash, &dlen);
+    HASH_init(hash);
+    HASH_update(hash, msg, len);
+    HASH_final(hash, dgst);
+
+    for (i=0; (ret == 0) && (i<=len); i++)
+    {
+        HASH_init(hash);
+        HASH_update(hash, msg, i);
+        state_len = sizeof(state);
+        ret = HASH_export_state(hash, state, &state_len);
+        if (ret == 0)
+            ret = HASH_new(id, flags | HASH_METH_FLAG_INTERNAL, &resumed);
+        if (ret == 0)
+            ret = HASH_import_state(resumed, state, state_len);
+        if (ret == 0)
+            ret = HASH_update(resumed, msg + i, len - i);
+        if (ret == 0)
+            ret = HASH_final(resumed, rdgst);
+        if ((ret == 0) && (memcmp(dgst, rdgst, dlen) != 0))
+            ret = 1;
+        HASH_free(resumed);
+        resumed = NULL;
+    }
+
+    printf("Resumed: %s\n", (ret == 0) ? "YES" : "NO");
+end:
+    return ret != 0;
+}
+
+/*
+ * Check the one-shot digest matches the digest of the hash object.
+ *
+ * @param [in] hash  The hash object to use.
+ * @param [in] id    The id of the hash algorithm.
+ * @param [in] msg   The data of the message.
+ * @param [in] len   The length of the data.
+ * @return  0 when the digests match.<br>
+ *          1 otherwise.
+ */
+int hash_oneshot(HASH *hash, HASH_ID id, const unsigned char *msg, int len)
+{
+    int ret = 0;
+    int i;
+    unsigned char dgst[64];
+    unsigned char odgst[64];
+    int dlen;
+
+    HASH_get_len(hash, &dlen);
+    for (i=0; (ret == 0) && (i<=len); i++)
+    {
+        HASH_init(hash);
+        HASH_update(hash, msg, i);
+        HASH_final(hash, dgst);
+        ret = HASH_digest(id, msg, i, odgst);
+        if ((ret == 0) && (memcmp(dgst, odgst, dlen) != 0))
+            ret = 1;
+    }
+
+    printf("Digest: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check digesting fragments of the message matches the one-shot digest.
+ * The message is split into three fragments at each position.
+ *
+ * @param [in] hash  The hash object to use.
+ * @param [in] id    The id of the hash algorithm.
+ * @param [in] msg   The data of the message.
+ * @param [in] len   The length of the data.
+ * @return  0 when the digests match.<br>
+ *          1 otherwise.
+ */
+int hash_vector(HASH *hash, HASH_ID id, const unsigned char *msg, int len)
+{
+    int ret = 0;
+    int i;
+    unsigned char dgst[64];
+    unsigned char vdgst[64];
+    int dlen;
+    HASH_IOVEC iov[3];
+
+    HASH_get_len(hash, &dlen);
+    HASH_digest(id, msg, len, dgst);
+    for (i=0; (ret == 0) && (i<=len); i++)
+    {
+        iov[0].data = msg;
+        iov[0].len = i;
+        iov[1].data = msg + i;
+        iov[1].len = (len - i) / 2;
+        iov[2].data = msg + i + iov[1].len;
+        iov[2].len = len - i - iov[1].len;
+
+        HASH_init(hash);
+        ret = HASH_updatev(hash, iov, 3);
+        if (ret == 0)
+            ret = HASH_final(hash, vdgst);
+        if ((ret == 0) && (memcmp(dgst, vdgst, dlen) != 0))
+            ret = 1;
+    }
+
+    printf("Vector: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check duplicating the hash object after each prefix of the message gives
+ * the same digest when both objects finish the message.
+ *
+ * @param [in] hash  The hash object to use.
+ * @param [in] id    The id of the hash algorithm.
+ * @param [in] msg   The data of the message.
+ * @param [in] len   The length of the data.
+ * @return  0 when the digests match.<br>
+ *          1 otherwise.
+ */
+int hash_dup(HASH *hash, HASH_ID id, const unsigned char *msg, int len)
+{
+    int ret = 0;
+    int i;
+    unsigned char dgst[64];
+    unsigned char ddgst[64];
+    int dlen;
+    HASH *dup;
+
+    HASH_get_len(hash, &dlen);
+    HASH_digest(id, msg, len, dgst);
+    for (i=0; (ret == 0) && (i<=len); i++)
+    {
+        HASH_init(hash);
+        HASH_update(hash, msg, i);
+        ret = HASH_dup(hash, &dup);
+        if (ret != 0)
+            break;
+        /* Overwrite the original's state to show they're independent. */
+        HASH_update(hash, msg, len);
+        HASH_update(dup, msg + i, len - i);
+        HASH_final(dup, ddgst);
+        HASH_free(dup);
+        if (memcmp(dgst, ddgst, dlen) != 0)
+            ret = 1;
+    }
+
+    printf("Dup: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check digesting a file descriptor gives the same digest as updating the hash
+ * object with the data many times.
+ *
+ * @param [in] hash  The hash object to use.
+ * @param [in] id    The id of the hash algorithm.
+ * @param [in] msg   The data of the message.
+ * @param [in] len   The length of the data.
+ * @return  0 when the digests match.<br>
+ *          1 otherwise.
+ */
+int hash_fd(HASH *hash, HASH_ID id, const unsigned char *msg, int len)
+{
+    int ret = 0;
+    int i;
+    unsigned char dgst[64];
+    unsigned char fdgst[64];
+    int dlen;
+    FILE *f;
+
+    f = tmpfile();
+    if (f == NULL)
+        ret = 1;
+
+    HASH_get_len(hash, &dlen);
+    HASH_init(hash);
+    for (i=0; (ret == 0) && (i<1000); i++)
+    {
+        HASH_update(hash, msg, len);
+        if (fwrite(msg, 1, len, f) != (size_t)len)
+            ret = 1;
+    }
+    HASH_final(hash, dgst);
+    if ((ret == 0) && (fflush(f) != 0))
+        ret = 1;
+    if (ret == 0)
+    {
+        lseek(fileno(f), 0, SEEK_SET);
+        ret = HASH_digest_fd(id, fileno(f), fdgst);
+    }
+    if ((ret == 0) && (memcmp(dgst, fdgst, dlen) != 0))
+        ret = 1;
+    if (f != NULL)
+        fclose(f);
+
+    printf("Fd: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check digesting messages of many lengths in a batch gives the same digests
+ * as digesting each message. Also checks the AVX2 implementations when the
+ * CPU has AVX2.
+ *
+ * @param [in] hash   The hash object to use.
+ * @param [in] id     The id of the hash algorithm.
+ * @param [in] flags  The method implementation flags required.
+ * @return  0 when the digests match.<br>
+ *          1 otherwise.
+ */
+int hash_batch(HASH *hash, HASH_ID id, int flags)
+{
+    int ret = 0;
+    int i, j;
+    const unsigned char *msgs[50];
+    size_t lens[50];
+    unsigned char dgst[50][64];
+    unsigned char *bdgst[50];
+    unsigned char sdgst[64];
+    int dlen;
+    int bflags[2] = { flags, HASH_METH_FLAG_AVX2 };
+    static unsigned char bmsg[5400];
+
+    HASH_get_len(hash, &dlen);
+    for (i=0; i<(int)sizeof(bmsg); i++)
+        bmsg[i] = i * 7 + (i >> 8);
+    for (i=0; i<50; i++)
+    {
+        /* Lengths around block boundaries and some much longer. */
+        lens[i] = (i * i * 37) % 300 + ((i % 7 == 0) ? 5000 : 0);
+        msgs[i] = bmsg + i;
+        bdgst[i] = dgst[i];
+    }
+
+    for (j=0; (ret == 0) && (j<2); j++)
+    {
+        ret = HASH_batch(id, bflags[j], msgs, lens, 50, bdgst);
+        /* No AVX2 implementation of algorithm or CPU doesn't have AVX2. */
+        if ((j == 1) && (ret == HASH_ERR_NOT_FOUND))
+        {
+            ret = 0;
+            break;
+        }
+        for (i=0; (ret == 0) && (i<50); i++)
+        {
+            HASH_init(hash);
+            HASH_update(hash, msgs[i], lens[i]);
+            HASH_final(hash, sdgst);
+            if (memcmp(sdgst, dgst[i], dlen) != 0)
+                ret = 1;
+        }
+    }
+
+    printf("Batch: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check the batch API uses the highest ranked implementation without flags,
+ * unless calibrated to the batch function, the multi-buffer kernels when AVX2 is required and a single stream when
+ * AVX2 is excluded.
+ *
+ * @return  0 when the expected implementations are chosen.<br>
+ *          1 otherwise.
+ */
+int hash_batch_select()
+{
+    int ret = 0;
+    int i;
+    HASH_ID ids[2] = { HASH_ID_SHA224, HASH_ID_SHA256 };
+    HASH_METH *meth, *best;
+
+    for (i=0; (ret == 0) && (i<2); i++)
+    {
+        /* Calibration may have found the batch function faster. */
+        if ((hash_meth_get(ids[i], 0, &best) != 0) ||
+            (hash_meth_get_batch(ids[i], 0, 1024, &meth) != 0) ||
+            ((meth != best) && !hash_meth_tuned_batch(ids[i], 1024)) ||
+            (hash_meth_tuned_batch(ids[i], 1024) && (meth->batch == NULL)))
+        {
+            ret = 1;
+        }
+        if (((hash_cpu_flags() & HASH_METH_FLAG_AVX2) != 0) &&
+            ((hash_meth_get_batch(ids[i], HASH_METH_FLAG_AVX2, 1024,
+                                  &meth) != 0) ||
+             (meth->batch == NULL)))
+        {
+            ret = 1;
+        }
+        if ((hash_meth_get_batch(ids[i],
+                HASH_METH_FLAG_EXCLUDE(HASH_METH_FLAG_AVX2), 1024,
+                &meth) != 0) ||
+            (meth->batch != NULL))
+        {
+            ret = 1;
+        }
+        /* Streaming never gets the batch only implementation. */
+        if (best->priority == HASH_METH_PRIO_BATCH)
+            ret = 1;
+    }
+
+    printf("Batch select: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/* Number of calls to the registered update function. */
+static int reg_updates = 0;
+
+/* Update function of registered implementation. Counts calls. */
+static int reg_update(void *ctx, const void *data, size_t len)
+{
+    HASH_IOVEC iov = { data, len };
+
+    reg_updates++;
+    return HASH_updatev(*(HASH **)ctx, &iov, 1) == 0;
+}
+
+/* Initialization function of registered implementation. */
+static int reg_init(void *ctx)
+{
+    if (((uintptr_t)ctx & 63) != 0)
+        return 0;
+    if (HASH_new(HASH_ID_SHA256, HASH_METH_FLAG_INTERNAL, (HASH **)ctx) != 0)
+        return 0;
+    return HASH_init(*(HASH **)ctx) == 0;
+}
+
+/* Final function of registered implementation. */
+static int reg_final(unsigned char *md, void *ctx)
+{
+    int ret = HASH_final(*(HASH **)ctx, md) == 0;
+
+    HASH_free(*(HASH **)ctx);
+    return ret;
+}
+
+/*
+ * Check an implementation registered by the application is used.
+ * Wraps the internal SHA-256 implementation with a 64 byte aligned context.
+ *
+ * @return  0 when the registered implementation is used.<br>
+ *          1 otherwise.
+ */
+int hash_register()
+{
+    int ret = 0;
+    static HASH_METH meth =
+    {
+        "SHA-256 Registered", 0, 1000,
+        HASH_ID_SHA256, 32, sizeof(HASH *), 64,
+        &reg_init, &reg_update, &reg_final,
+        0, NULL, NULL,
+        NULL, NULL, NULL, NULL
+    };
+    HASH *hash = NULL;
+    char *name = "";
+    unsigned char dgst[32];
+    unsigned char rdgst[32];
+
+    HASH_digest(HASH_ID_SHA256, (const unsigned char *)"abc", 3, dgst);
+    ret = HASH_METH_register(&meth);
+    if (ret == 0)
+        ret = HASH_new(HASH_ID_SHA256, 0, &hash);
+    if (ret == 0)
+        ret = HASH_get_impl_name(hash, &name);
+    if (ret == 0)
+        ret = HASH_init(hash);
+    if (ret == 0)
+        ret = HASH_update(hash, (const unsigned char *)"abc", 3);
+    if (ret == 0)
+        ret = HASH_final(hash, rdgst);
+    if ((ret == 0) && ((strcmp(name, meth.name) != 0) || (reg_updates != 1) ||
+        (memcmp(dgst, rdgst, sizeof(dgst)) != 0)))
+    {
+        ret = 1;
+    }
+    /* One-shot API uses it too. */
+    if ((ret == 0) &&
+        ((HASH_digest(HASH_ID_SHA256, (const unsigned char *)"abc", 3,
+              rdgst) != 0) || (reg_updates != 2) ||
+         (memcmp(dgst, rdgst, sizeof(dgst)) != 0)))
+    {
+        ret = 1;
+    }
+    HASH_free(hash);
+
+    printf("Register: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check digesting one stream with several algorithms gives the same digests
+ * as digesting it with each. Small updates are interleaved and the large
+ * update is hashed on threads.
+ *
+ * @return  0 when the digests match.<br>
+ *          1 otherwise.
+ */
+int hash_multi()
+{
+    int ret = 0;
+    int i;
+    HASH_ID ids[3] = { HASH_ID_SHA256, HASH_ID_SHA512, HASH_ID_BLAKE2B_512 };
+    unsigned char dgst[3][64];
+    unsigned char mdgst[3][64];
+    unsigned char *mptr[3] = { mdgst[0], mdgst[1], mdgst[2] };
+    size_t len = 3 * 1024 * 1024 + 12345;
+    int dlen;
+    unsigned char *data;
+    HASH_MULTI *multi = NULL;
+
+    data = malloc(len);
+    if (data == NULL)
+        ret = 1;
+    for (i=0; (ret == 0) && (i<(int)len); i++)
+        data[i] = i * 7 + (i >> 8);
+
+    if (ret == 0)
+        ret = HASH_MULTI_new(ids, 3, 0, &multi);
+    if (ret == 0)
+        ret = HASH_MULTI_init(multi);
+    /* Small updates then one large enough for threads. */
+    for (i=0; (ret == 0) && (i<100); i++)
+        ret = HASH_MULTI_update(multi, data + i * 1000, 1000);
+    if (ret == 0)
+        ret = HASH_MULTI_update(multi, data + 100000, len - 100000);
+    if (ret == 0)
+        ret = HASH_MULTI_final(multi, mptr);
+    for (i=0; (ret == 0) && (i<3); i++)
+    {
+        HASH_METH_get_len(ids[i], &dlen);
+        HASH_digest(ids[i], data, len, dgst[i]);
+        if (memcmp(dgst[i], mdgst[i], dlen) != 0)
+            ret = 1;
+    }
+    HASH_MULTI_free(multi);
+    free(data);
+
+    printf("Multi: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check the XXH3 known answers with every implementation, in one update and in
+ * pieces, and that the non-cryptographic hashes are only found when asked for.
+ *
+ * @return  0 when the digests match.<br>
+ *          1 otherwise.
+ */
+int hash_xxh3()
+{
+    int ret = 0;
+    int i, j, k, n;
+    int dlen;
+    size_t l, p;
+    uint64_t h;
+    HASH *hash = NULL;
+    HASH_ID ids[2] = { HASH_ID_XXH3_64, HASH_ID_XXH3_128 };
+    unsigned char dgst[16];
+    static unsigned char kmsg[5000];
+    /* Length, 64-bit digest, high and low 64 bits of 128-bit digest. */
+    static const struct { size_t len; uint64_t h[3]; } kat[] =
+    {
+        {    0, { 0x2d06800538d394c2ULL,
+                  0x99aa06d3014798d8ULL, 0x6001c324468d497fULL } },
+        {    2, { 0x9093381c8763d62eULL,
+                  0xb519c2793d896766ULL, 0x9093381c8763d62eULL } },
+        {    7, { 0x0ffc4827844c63a6ULL,
+                  0xdb0172c49725ff06ULL, 0x572ab15ffe6cbd8aULL } },
+        {   13, { 0x523759b666e1405bULL,
+                  0x99c251fd5fad98bdULL, 0xac1f61328e67e387ULL } },
+        {  100, { 0x6dbb812cf19d012eULL,
+                  0x858be3b5082c7eb7ULL, 0x3dc31a0ba04530cdULL } },
+        {  200, { 0x7c64f3b17285e96aULL,
+                  0xdbfff5e13c798ab9ULL, 0x0497bdb3d145ccd6ULL } },
+        {  241, { 0x541b19226f0052e8ULL,
+                  0x75f4da43f23cce5aULL, 0x541b19226f0052e8ULL } },
+        { 1000, { 0xd1db6a0afea2cc82ULL,
+                  0xbae798f9321bda6cULL, 0xd1db6a0afea2cc82ULL } },
+        { 2049, { 0x922549b11c04c2ebULL,
+                  0x9361f43b31289cf2ULL, 0x922549b11c04c2ebULL } },
+        { 5000, { 0xed0146266d138bd8ULL,
+                  0xe814573b3db786c4ULL, 0xed0146266d138bd8ULL } },
+    };
+
+    for (i=0; i<(int)sizeof(kmsg); i++)
+        kmsg[i] = i * 7 + (i >> 8);
+
+    for (i=0; i<2; i++)
+    {
+        /* Never selected unless the caller accepts non-cryptographic. */
+        if ((HASH_new(ids[i], 0, &hash) != HASH_ERR_NOT_FOUND) ||
+            (HASH_new(ids[i], HASH_METH_FLAG_INTERNAL, &hash) !=
+             HASH_ERR_NOT_FOUND) ||
+            (HASH_digest(ids[i], kmsg, 10, dgst) != HASH_ERR_NOT_FOUND) ||
+            (HASH_METH_get_len(ids[i], &dlen) != 0) || (dlen != 8 << i))
+        {
+            ret = 1;
+        }
+
+        for (j=0; (ret == 0) && (HASH_new_impl(ids[i], j, &hash) == 0); j++)
+        {
+            for (k=0; k<(int)(sizeof(kat)/sizeof(*kat)); k++)
+            {
+                /* Whole message then pieces that straddle the cache. */
+                for (p=kat[k].len+1; p>0; p=(p > 7) ? 7 : 0)
+                {
+                    HASH_init(hash);
+                    for (l=0; l<kat[k].len; l+=p)
+                    {
+                        HASH_update(hash, kmsg + l,
+                            (kat[k].len - l < p) ? kat[k].len - l : p);
+                    }
+                    HASH_final(hash, dgst);
+                    for (n=0; n<dlen; n+=8)
+                    {
+                        for (h=0, l=0; l<8; l++)
+                            h = (h << 8) | dgst[n + l];
+                        if (h != kat[k].h[i + n / 8])
+                            ret = 1;
+                    }
+                }
+            }
+            if (j == 0)
+            {
+                ret |= hash_resume(hash, ids[i], HASH_METH_FLAG_NONCRYPTO,
+                    kmsg, 600);
+            }
+            HASH_free(hash);
+            hash = NULL;
+        }
+    }
+
+    printf("XXH3: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Calculate a CRC32C a bit at a time to check the implementations against.
+ *
+ * @param [in] m    The message data.
+ * @param [in] len  The length of the message data.
+ * @return  The CRC32C of the message.
+ */
+static uint32_t crc32c_bits(const unsigned char *m, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+    int i;
+
+    for (; len > 0; len--)
+    {
+        crc ^= *(m++);
+        for (i=0; i<8; i++)
+            crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+/*
+ * Check CRC32C with every implementation against the known answer and a
+ * bitwise calculation, in one update and in pieces, and that combining the
+ * CRCs of pieces gives the CRC of the whole.
+ *
+ * @return  0 when the CRCs match.<br>
+ *          1 otherwise.
+ */
+int hash_crc32c()
+{
+    int ret = 0;
+    int i, j, k;
+    int dlen;
+    size_t l, p;
+    uint32_t crc, c1, c2;
+    HASH *hash = NULL;
+    unsigned char dgst[4];
+    static unsigned char kmsg[80000];
+    /* Lengths around the three-stream and folding thresholds. */
+    static const size_t lens[] = { 0, 9, 63, 256, 769, 2048, 24577, 80000 };
+
+    for (l=0; l<sizeof(kmsg); l++)
+        kmsg[l] = l * 7 + (l >> 8);
+
+    if ((HASH_new(HASH_ID_CRC32C, 0, &hash) != HASH_ERR_NOT_FOUND) ||
+        (HASH_digest(HASH_ID_CRC32C, kmsg, 10, dgst) != HASH_ERR_NOT_FOUND) ||
+        (HASH_METH_get_len(HASH_ID_CRC32C, &dlen) != 0) || (dlen != 4) ||
+        (HASH_crc32c(0, (const unsigned char *)"123456789", 9) != 0xe3069283))
+    {
+        ret = 1;
+    }
+
+    for (j=0; (ret == 0) && (HASH_new_impl(HASH_ID_CRC32C, j, &hash) == 0);
+         j++)
+    {
+        for (k=0; k<(int)(sizeof(lens)/sizeof(*lens)); k++)
+        {
+            crc = crc32c_bits(kmsg + 1, lens[k]);
+            /* Whole message, then pieces, starting unaligned. */
+            for (p=lens[k]+1; p>0; p=(p > 1000) ? 1000 : ((p > 7) ? 7 : 0))
+            {
+                HASH_init(hash);
+                for (l=0; l<lens[k]; l+=p)
+                {
+                    HASH_update(hash, kmsg + 1 + l,
+                        (lens[k] - l < p) ? lens[k] - l : p);
+                }
+                HASH_final(hash, dgst);
+                if ((((uint32_t)dgst[0] << 24) | ((uint32_t)dgst[1] << 16) |
+                     ((uint32_t)dgst[2] << 8) | dgst[3]) != crc)
+                {
+                    ret = 1;
+                }
+            }
+        }
+        if (j == 0)
+        {
+            ret |= hash_resume(hash, HASH_ID_CRC32C, HASH_METH_FLAG_NONCRYPTO,
+                kmsg, 600);
+        }
+        HASH_free(hash);
+        hash = NULL;
+    }
+
+    crc = crc32c_bits(kmsg, sizeof(kmsg));
+    if (HASH_crc32c(0, kmsg, sizeof(kmsg)) != crc)
+        ret = 1;
+    for (i=0; i<(int)(sizeof(lens)/sizeof(*lens)); i++)
+    {
+        l = lens[i];
+        c1 = HASH_crc32c(0, kmsg, l);
+        if (HASH_crc32c(c1, kmsg + l, sizeof(kmsg) - l) != crc)
+            ret = 1;
+        c2 = HASH_crc32c(0, kmsg + l, sizeof(kmsg) - l);
+        if (HASH_crc32c_combine(c1, c2, sizeof(kmsg) - l) != crc)
+            ret = 1;
+    }
+
+    printf("CRC32C: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/** The maximum number of chunk boundaries recorded. */
+#define CDC_MAX		4096
+
+/* The chunks reported by a content-defined chunker. */
+typedef struct cdc_chunks_st
+{
+    /* The hash algorithm digesting the chunks. */
+    HASH_ID id;
+    /* The stream being chunked. */
+    const unsigned char *msg;
+    /* The offset the next chunk must start at. */
+    uint64_t end;
+    /* The number of chunks. */
+    int cnt;
+    /* The end of each chunk. */
+    uint64_t cut[CDC_MAX];
+    /* Whether a chunk's data or digest was wrong. */
+    int bad;
+} CDC_CHUNKS;
+
+/*
+ * Check a chunk follows the last and has the digest of its data.
+ *
+ * @param [in] arg    The chunks found so far.
+ * @param [in] chunk  The chunk.
+ * @return  0 to continue.
+ */
+static int cdc_chunk(void *arg, const HASH_CDC_CHUNK *chunk)
+{
+    CDC_CHUNKS *c = arg;
+    unsigned char dgst[64];
+    int dlen;
+
+    HASH_METH_get_len(c->id, &dlen);
+    HASH_digest(c->id, chunk->data, chunk->len, dgst);
+    if ((chunk->off != c->end) ||
+        (memcmp(chunk->data, c->msg + chunk->off, chunk->len) != 0) ||
+        (memcmp(chunk->md, dgst, dlen) != 0) || (c->cnt == CDC_MAX))
+    {
+        c->bad = 1;
+        return 0;
+    }
+    c->end += chunk->len;
+    c->cut[c->cnt++] = c->end;
+    return 0;
+}
+
+/*
+ * Chunk a stream in pieces and record the chunks.
+ *
+ * @param [in] id       The hash algorithm identifier.
+ * @param [in] threads  The number of threads to digest on.
+ * @param [in] m        The stream.
+ * @param [in] len      The length of the stream.
+ * @param [in] piece    The length of each update.
+ * @param [in] c        The chunks found.
+ * @return  0 when the stream was chunked.<br>
+ *          1 otherwise.
+ */
+static int cdc_run(HASH_ID id, int threads, const unsigned char *m,
+    size_t len, size_t piece, CDC_CHUNKS *c)
+{
+    int ret;
+    int i;
+    size_t l;
+    HASH_CDC *cdc = NULL;
+
+    memset(c, 0, sizeof(*c));
+    c->id = id;
+    c->msg = m;
+    ret = HASH_CDC_new(id, 0, 4096, threads, cdc_chunk, c, &cdc);
+    /* Twice to check the object is reset by final. */
+    for (i=0; (ret == 0) && (i<2); i++)
+    {
+        c->end = 0;
+        c->cnt = 0;
+        for (l=0; (ret == 0) && (l<len); l+=piece)
+        {
+            ret = HASH_CDC_update(cdc, m + l,
+                (len - l < piece) ? len - l : piece);
+        }
+        if (ret == 0)
+            ret = HASH_CDC_final(cdc);
+    }
+    HASH_CDC_free(cdc);
+    return (ret != 0) || c->bad || (c->end != len);
+}
+
+/*
+ * Check the content-defined chunker: chunks are contiguous, have the right
+ * digests and lengths, are the same however the data is given and digested,
+ * and most boundaries are found again after a byte is removed from the start.
+ *
+ * @return  0 when the chunks are correct.<br>
+ *          1 otherwise.
+ */
+int hash_cdc()
+{
+    int ret = 0;
+    int i, j, same;
+    size_t l;
+    size_t len = 4 * 1024 * 1024 + 999;
+    uint32_t r = 1;
+    unsigned char *data;
+    HASH_CDC *cdc;
+    static CDC_CHUNKS a, b;
+
+    data = malloc(len);
+    if (data == NULL)
+        ret = 1;
+    for (i=0; (ret == 0) && (i<(int)len); i++)
+    {
+        r = r * 1103515245 + 12345;
+        data[i] = r >> 24;
+    }
+
+    if (HASH_CDC_new(HASH_ID_SHA256, 0, 3000, 0, cdc_chunk, &a, &cdc) !=
+        HASH_ERR_BAD_LEN)
+    {
+        ret = 1;
+    }
+
+    if (ret == 0)
+        ret = cdc_run(HASH_ID_SHA256, 0, data, len, len, &a);
+    /* Between a quarter and eight times the average, but for the last. */
+    for (i=0; (ret == 0) && (i<a.cnt); i++)
+    {
+        l = a.cut[i] - ((i == 0) ? 0 : a.cut[i-1]);
+        if (((l < 1024) && (i != a.cnt - 1)) || (l > 32768))
+            ret = 1;
+    }
+    if ((a.cnt < (int)(len / 8192)) || (a.cnt > (int)(len / 2048)))
+        ret = 1;
+
+    if (ret == 0)
+        ret = cdc_run(HASH_ID_SHA256, 4, data, len, 77777, &b);
+    if ((ret == 0) && ((b.cnt != a.cnt) ||
+        (memcmp(a.cut, b.cut, a.cnt * sizeof(*a.cut)) != 0)))
+    {
+        ret = 1;
+    }
+    if (ret == 0)
+        ret = cdc_run(HASH_ID_BLAKE2B_512, 2, data, len, 1000, &b);
+    if ((ret == 0) && ((b.cnt != a.cnt) ||
+        (memcmp(a.cut, b.cut, a.cnt * sizeof(*a.cut)) != 0)))
+    {
+        ret = 1;
+    }
+
+    /* Boundaries depend on the content, not the offset. */
+    if (ret == 0)
+        ret = cdc_run(HASH_ID_SHA256, 0, data + 1, len - 1, len, &b);
+    for (i=0, j=0, same=0; (ret == 0) && (i<a.cnt) && (j<b.cnt); )
+    {
+        if (a.cut[i] == b.cut[j] + 1)
+            same++;
+        if (a.cut[i] <= b.cut[j] + 1)
+            i++;
+        else
+            j++;
+    }
+    if (same < a.cnt - 2)
+        ret = 1;
+    free(data);
+
+    printf("CDC: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+#ifndef OPT_HASH_OPENSSL_RAND
+/** The number of threads generating random bytes at the same time. */
+#define RANDOM_THREADS	4
+/** The number of random bytes asked for in a large request. */
+#define RANDOM_LARGE	(2 * RANDOM_SMALL_LEN)
+
+/* The random bytes each thread got: a buffered and a large request. */
+static unsigned char random_out[RANDOM_THREADS + 1][16 + RANDOM_LARGE];
+
+/*
+ * Get a small, buffered, request then a large request of random bytes.
+ *
+ * @param [in] arg  The buffer to hold the random bytes.
+ * @return  NULL on success.<br>
+ *          The buffer when random bytes were not available.
+ */
+static void *random_thread(void *arg)
+{
+    unsigned char *r = arg;
+
+    if ((pseudo_random(r, 16) != 0) ||
+        (pseudo_random(r + 16, RANDOM_LARGE) != 0))
+    {
+        return r;
+    }
+    return NULL;
+}
+
+/*
+ * Check the random number generator:
+ *  - HMAC_DRBG with SHA-256 against the NIST SP 800-90A CAVP vector,
+ *  - reseeding only after the reseed interval,
+ *  - a forked child neither repeats the parent's output nor the bytes the
+ *    parent buffered,
+ *  - each thread gets its own output.
+ *
+ * @return  0 when the generator behaves.<br>
+ *          1 otherwise.
+ */
+int hash_random()
+{
+    int ret = 0;
+    int i, j;
+    int fd[2];
+    pid_t pid;
+    pthread_t thread[RANDOM_THREADS];
+    unsigned char r[2][128];
+    unsigned char child[16 + RANDOM_LARGE];
+    RANDOM_DRBG drbg[2];
+    /* HMAC_DRBG.rsp [SHA-256] no reseed, COUNT = 0: entropy then nonce. */
+    static const unsigned char seed[] = {
+        0xca, 0x85, 0x19, 0x11, 0x34, 0x93, 0x84, 0xbf,
+        0xfe, 0x89, 0xde, 0x1c, 0xbd, 0xc4, 0x6e, 0x68,
+        0x31, 0xe4, 0x4d, 0x34, 0xa4, 0xfb, 0x93, 0x5e,
+        0xe2, 0x85, 0xdd, 0x14, 0xb7, 0x1a, 0x74, 0x88,
+        0x65, 0x9b, 0xa9, 0x6c, 0x60, 0x1d, 0xc6, 0x9f,
+        0xc9, 0x02, 0x94, 0x08, 0x05, 0xec, 0x0c, 0xa8
+    };
+    /* The output of the second generate. */
+    static const unsigned char expected[] = {
+        0xe5, 0x28, 0xe9, 0xab, 0xf2, 0xde, 0xce, 0x54,
+        0xd4, 0x7c, 0x7e, 0x75, 0xe5, 0xfe, 0x30, 0x21,
+        0x49, 0xf8, 0x17, 0xea, 0x9f, 0xb4, 0xbe, 0xe6,
+        0xf4, 0x19, 0x96, 0x97, 0xd0, 0x4d, 0x5b, 0x89,
+        0xd5, 0x4f, 0xbb, 0x97, 0x8a, 0x15, 0xb5, 0xc4,
+        0x43, 0xc9, 0xec, 0x21, 0x03, 0x6d, 0x24, 0x60,
+        0xb6, 0xf7, 0x3e, 0xba, 0xd0, 0xdc, 0x2a, 0xba,
+        0x6e, 0x62, 0x4a, 0xbf, 0x07, 0x74, 0x5b, 0xc1,
+        0x07, 0x69, 0x4b, 0xb7, 0x54, 0x7b, 0xb0, 0x99,
+        0x5f, 0x70, 0xde, 0x25, 0xd6, 0xb2, 0x9e, 0x2d,
+        0x30, 0x11, 0xbb, 0x19, 0xd2, 0x76, 0x76, 0xc0,
+        0x71, 0x62, 0xc8, 0xb5, 0xcc, 0xde, 0x06, 0x68,
+        0x96, 0x1d, 0xf8, 0x68, 0x03, 0x48, 0x2c, 0xb3,
+        0x7e, 0xd6, 0xd5, 0xc0, 0xbb, 0x8d, 0x50, 0xcf,
+        0x1f, 0x50, 0xd4, 0x76, 0xaa, 0x04, 0x58, 0xbd,
+        0xab, 0xa8, 0x06, 0xf4, 0x8b, 0xe9, 0xdc, 0xb8
+    };
+
+    memset(drbg, 0, sizeof(drbg));
+    random_drbg_seed(&drbg[0], seed, sizeof(seed));
+    if ((random_drbg_generate(&drbg[0], r[0], sizeof(r[0])) != 0) ||
+        (random_drbg_generate(&drbg[0], r[0], sizeof(r[0])) != 0) ||
+        (memcmp(r[0], expected, sizeof(expected)) != 0))
+    {
+        ret = 1;
+    }
+
+    /* Copies stay in step until the interval then reseed independently. */
+    drbg[0].reseed = RANDOM_RESEED_INTERVAL - 1;
+    drbg[1] = drbg[0];
+    for (i=0; (ret == 0) && (i<2); i++)
+    {
+        for (j=0; j<2; j++)
+            ret |= random_drbg_generate(&drbg[j], r[j], sizeof(r[j]));
+        if ((ret == 0) && ((memcmp(r[0], r[1], sizeof(r[0])) == 0) != (i == 0)))
+            ret = 1;
+        if ((ret == 0) && (drbg[0].reseed != ((i == 0) ?
+                (uint32_t)RANDOM_RESEED_INTERVAL : 1)))
+        {
+            ret = 1;
+        }
+    }
+
+    /* Fill the buffer so that the child inherits unused bytes. */
+    if ((ret == 0) && ((pseudo_random(r[0], 16) != 0) || (pipe(fd) != 0)))
+        ret = 1;
+    if (ret == 0)
+    {
+        pid = fork();
+        if (pid == 0)
+        {
+            random_thread(child);
+            _exit(write(fd[1], child, sizeof(child)) != sizeof(child));
+        }
+        close(fd[1]);
+        if ((pid < 0) || (random_thread(random_out[0]) != NULL) ||
+            (read(fd[0], child, sizeof(child)) != sizeof(child)))
+        {
+            ret = 1;
+        }
+        close(fd[0]);
+        if (pid > 0)
+            waitpid(pid, NULL, 0);
+        if ((ret == 0) && ((memcmp(child, random_out[0], 16) == 0) ||
+            (memcmp(child + 16, random_out[0] + 16, RANDOM_LARGE) == 0)))
+        {
+            ret = 1;
+        }
+    }
+
+    for (i=0; (ret == 0) && (i<RANDOM_THREADS); i++)
+    {
+        if (pthread_create(&thread[i], NULL, random_thread,
+                random_out[i + 1]) != 0)
+        {
+            ret = 1;
+        }
+    }
+    for (j=0; j<i; j++)
+    {
+        void *res;
+
+        if ((pthread_join(thread[j], &res) != 0) || (res != NULL))
+            ret = 1;
+    }
+    for (i=0; (ret == 0) && (i<=RANDOM_THREADS); i++)
+    {
+        for (j=i+1; j<=RANDOM_THREADS; j++)
+        {
+            if ((memcmp(random_out[i], random_out[j], 16) == 0) ||
+                (memcmp(random_out[i] + 16, random_out[j] + 16,
+                    RANDOM_LARGE) == 0))
+            {
+                ret = 1;
+            }
+        }
+    }
+
+    printf("Random: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+#endif
+
+/*
+ * Test an implementation of a hash.
+ *
+ * @param [in] hash     The hash object of the implementation. Freed.
+ * @param [in] id       The id of the hash algorithm to test.
+ * @param [in] flags    The method implementation flags required.
+ * @param [in] speed    Whether to test the speed of the implementation.
+ * @param [in] oneshot  Whether to test the speed of the one-shot API.
+ */
+int test_hash(HASH *hash, HASH_ID id, int flags, int speed, int oneshot)
+{
+    int ret = 0;
     int i;
-    HASH *hash;
     char *name = "";
     static const char *msg_a = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
         "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
         "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
         "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
 
-    HASH_new(id, flags, &hash);
-
     HASH_get_impl_name(hash, &name);
     printf("%s\n", name);
 
@@ -185,7 +1203,7 @@ int test_hash(HASH_ID id, int flags, int speed)
         printf("%6s  %7s %5s  %7s %7s %7s %9s %8s\n", "Op", "ops", "secs",
             "c/op", "ops/s", "c/B", "B/s", "mB/s");
         for (i=0; i<(int)(sizeof(mlen)/sizeof(*mlen)); i++)
-            hash_cycles(hash, msg, mlen[i]);
+            hash_cycles(hash, id, oneshot, msg, mlen[i]);
         goto end;
     }
 
@@ -201,10 +1219,16 @@ int test_hash(HASH_ID id, int flags, int speed)
     hash_msg(hash, (unsigned char *)msg_a, 1, 128);
     hash_msg(hash, (unsigned char *)msg_a, 128, 1);
 
-    HASH_free(hash);
+    ret = hash_resume(hash, id, flags, (unsigned char *)msg_a, 128);
+    ret |= hash_oneshot(hash, id, (unsigned char *)msg_a, 128);
+    ret |= hash_vector(hash, id, (unsigned char *)msg_a, 128);
+    ret |= hash_dup(hash, id, (unsigned char *)msg_a, 128);
+    ret |= hash_fd(hash, id, (unsigned char *)msg_a, 128);
+    ret |= hash_batch(hash, id, flags);
 
 end:
-    return 0;
+    HASH_free(hash);
+    return ret;
 }
 
 /*
@@ -222,7 +1246,15 @@ end:
  *  -sha512_256  Test the SHA512-256 hash algorithm.<br>
  *  -blake2b     Test the BLAKE2b hash algorithm with 512 bits of output.<br>
  *  -blake2s     Test the BLAKE2s hash algorithm with 256 bits of output.<br>
+ *  -shake128    Test the SHAKE128 hash algorithm with 256 bits of output.<br>
+ *  -shake256    Test the SHAKE256 hash algorithm with 512 bits of output.<br>
+ *  -xxh3        Test the speed of every XXH3 64-bit implementation.<br>
+ *  -crc32c      Test the speed of every CRC32C implementation.<br>
  *  -int         Test internal implementations only.<br>
+ *  -portable    Test implementations that don't need CPU features only.<br>
+ *  -all         Test every implementation the CPU supports.<br>
+ *  -digest      Test the speed of the one-shot API.<br>
+ *  -calibrate   Calibrate the one-shot API, caching in the file that follows.<br>
  *
  * @param [in] argc  The count of command line arguments.
  * @param [in] argv  The command line arguments.
@@ -233,10 +1265,16 @@ int main(int argc, char *argv[])
 {
     int ret = 0;
     int speed = 0;
+    int oneshot = 0;
     int which = 0;
     int flags = 0;
-    int i;
+    int all = 0;
+    int calibrate = 0;
+    HASH_ID noncrypto = -1;
+    char *cache = NULL;
+    int i, j;
     HASH_ID alg_id;
+    HASH *hash;
 
     while (--argc)
     {
@@ -269,10 +1307,33 @@ int main(int argc, char *argv[])
             alg_id = HASH_ID_BLAKE2B_512;
         else if (strcmp(*argv, "-blake2s") == 0)
             alg_id = HASH_ID_BLAKE2S_256;
+        else if (strcmp(*argv, "-shake128") == 0)
+            alg_id = HASH_ID_SHAKE128;
+        else if (strcmp(*argv, "-shake256") == 0)
+            alg_id = HASH_ID_SHAKE256;
         else if (strcmp(*argv, "-sha1") == 0)
             alg_id = HASH_ID_SHA1;
+        else if (strcmp(*argv, "-xxh3") == 0)
+            noncrypto = HASH_ID_XXH3_64;
+        else if (strcmp(*argv, "-crc32c") == 0)
+            noncrypto = HASH_ID_CRC32C;
         else if (strcmp(*argv, "-int") == 0)
-            flags = HASH_METH_FLAG_INTERNAL;
+            flags |= HASH_METH_FLAG_INTERNAL;
+        else if (strcmp(*argv, "-portable") == 0)
+            flags |= HASH_METH_FLAG_EXCLUDE(HASH_METH_FLAG_CPU);
+        else if (strcmp(*argv, "-all") == 0)
+            all = 1;
+        else if (strcmp(*argv, "-digest") == 0)
+            oneshot = 1;
+        else if (strcmp(*argv, "-calibrate") == 0)
+        {
+            calibrate = 1;
+            if ((argc > 1) && (argv[1][0] != '-'))
+            {
+                argc--;
+                cache = *++argv;
+            }
+        }
 
         if (alg_id != -1)
         {
@@ -284,6 +1345,12 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (calibrate && (HASH_calibrate(cache) != 0))
+    {
+        printf("Calibrate: NO\n");
+        ret = 1;
+    }
+
     if (speed)
     {
         calc_cps();
@@ -292,8 +1359,41 @@ int main(int argc, char *argv[])
 
     for (i=0; i<NUM_ID; i++)
     {
-        if ((which == 0) || ((which & (1 << i)) != 0))
-            ret |= test_hash(id[i], flags, speed);
+        if (((which != 0) || (noncrypto != -1)) && ((which & (1 << i)) == 0))
+            continue;
+
+        if (all)
+        {
+            for (j=0; HASH_new_impl(id[i], j, &hash) == 0; j++)
+                ret |= test_hash(hash, id[i], flags, speed, oneshot);
+        }
+        else if (HASH_new(id[i], flags, &hash) == 0)
+            ret |= test_hash(hash, id[i], flags, speed, oneshot);
+        else
+            ret = 1;
+    }
+
+    /* Non-cryptographic so only through the object API. */
+    if (speed && (noncrypto != -1))
+    {
+        for (j=0; HASH_new_impl(noncrypto, j, &hash) == 0; j++)
+        {
+            ret |= test_hash(hash, noncrypto, HASH_METH_FLAG_NONCRYPTO,
+                speed, 0);
+        }
+    }
+
+    if (!speed)
+    {
+        ret |= hash_multi();
+        ret |= hash_batch_select();
+        ret |= hash_register();
+        ret |= hash_xxh3();
+        ret |= hash_crc32c();
+        ret |= hash_cdc();
+#ifndef OPT_HASH_OPENSSL_RAND
+        ret |= hash_random();
+#endif
     }
 
     return (ret != 0);
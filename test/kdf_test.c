@@ -0,0 +1,749 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "kdf.h"
+
+#ifdef CC_CLANG
+#define PRIu64 "llu"
+#else
+#define PRIu64 "lu"
+#endif
+
+/* Number of cycles/sec. */
+uint64_t cps = 0;
+
+/* Flags of the implementations to test: best, portable C and AVX2 lanes. */
+static int impl_flags[] =
+{
+    0,
+    MAC_METH_FLAG_EXCLUDE(MAC_METH_FLAG_CPU),
+    MAC_METH_FLAG_AVX2,
+};
+/* Number of implementation flags. */
+#define NUM_FLAGS	((int)(sizeof(impl_flags)/sizeof(*impl_flags)))
+
+/* PBKDF2 known answer test. */
+typedef struct pbkdf2_kat_st
+{
+    /* The MAC algorithm identifier. */
+    MAC_ID id;
+    /* The password. */
+    const char *pwd;
+    /* The length of the password. */
+    int plen;
+    /* The salt. */
+    const char *salt;
+    /* The length of the salt. */
+    size_t slen;
+    /* The number of iterations. */
+    unsigned int iter;
+    /* The expected key as a hexadecimal string. */
+    const char *key;
+} PBKDF2_KAT;
+
+/* PBKDF2 known answers: RFC 6070, RFC 7914 and others. */
+static const PBKDF2_KAT pbkdf2_kat[] =
+{
+    { MAC_ID_SHA1, "password", 8, "salt", 4, 1,
+      "0c60c80f961f0e71f3a9b524af6012062fe037a6" },
+    { MAC_ID_SHA1, "password", 8, "salt", 4, 2,
+      "ea6c014dc72d6f8ccd1ed92ace1d41f0d8de8957" },
+    { MAC_ID_SHA1, "password", 8, "salt", 4, 4096,
+      "4b007901b765489abead49d926f721d065a429c1" },
+    { MAC_ID_SHA1, "passwordPASSWORDpassword", 24,
+      "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 4096,
+      "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038" },
+    { MAC_ID_SHA1, "pass\0word", 9, "sa\0lt", 5, 4096,
+      "56fa6aa75548099dcc37d7f03425e0c3" },
+    { MAC_ID_SHA224, "password", 8, "salt", 4, 4096,
+      "218c453bf90635bd0a21a75d172703ff6108ef603f65bb821aedade1d6961683"
+      "ba8f67877d2a3f73" },
+    { MAC_ID_SHA256, "passwd", 6, "salt", 4, 1,
+      "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+      "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783" },
+    { MAC_ID_SHA256, "Password", 8, "NaCl", 4, 80000,
+      "4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56"
+      "a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d" },
+    { MAC_ID_SHA384, "password", 8, "salt", 4, 2,
+      "54f775c6d790f21930459162fc535dbf04a939185127016a04176a0730c6f1f4"
+      "fb48832ad1261baadd2cedd50814b1c806ad1bbf43ebdc9d047904bf" },
+    { MAC_ID_SHA512, "password", 8, "salt", 4, 1,
+      "867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252"
+      "c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f73b60a57fce" },
+};
+/* Number of PBKDF2 known answer tests. */
+#define NUM_PBKDF2_KAT	((int)(sizeof(pbkdf2_kat)/sizeof(*pbkdf2_kat)))
+
+/* HKDF known answer test. Fields are hexadecimal strings. */
+typedef struct hkdf_kat_st
+{
+    /* The MAC algorithm identifier. */
+    MAC_ID id;
+    /* The salt. NULL for none. */
+    const char *salt;
+    /* The input keying material. */
+    const char *ikm;
+    /* The information. */
+    const char *info;
+    /* The expected pseudo-random key. */
+    const char *prk;
+    /* The expected output keying material. */
+    const char *okm;
+} HKDF_KAT;
+
+/* HKDF known answers: RFC 5869 test cases 1 to 4 and 7. */
+static const HKDF_KAT hkdf_kat[] =
+{
+    { MAC_ID_SHA256, "000102030405060708090a0b0c",
+      "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+      "f0f1f2f3f4f5f6f7f8f9",
+      "077709362c2e32df0ddc3f0dc47bba6390b6c73bb50f9c3122ec844ad7c2b3e5",
+      "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf"
+      "34007208d5b887185865" },
+    { MAC_ID_SHA256,
+      "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+      "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+      "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf",
+      "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+      "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+      "404142434445464748494a4b4c4d4e4f",
+      "b0b1b2b3b4b5b6b7b8b9babbbcbdbebfc0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+      "d0d1d2d3d4d5d6d7d8d9dadbdcdddedfe0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+      "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff",
+      "06a6b88c5853361a06104c9ceb35b45cef760014904671014a193f40c15fc244",
+      "b11e398dc80327a1c8e7f78c596a49344f012eda2d4efad8a050cc4c19afa97c"
+      "59045a99cac7827271cb41c65e590e09da3275600c2f09b8367793a9aca3db71"
+      "cc30c58179ec3e87c14c01d5c1f3434f1d87" },
+    { MAC_ID_SHA256, "",
+      "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+      "",
+      "19ef24a32c717b167f33a91d6f648bdf96596776afdb6377ac434c1c293ccb04",
+      "8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d"
+      "9d201395faa4b61a96c8" },
+    { MAC_ID_SHA1, "000102030405060708090a0b0c",
+      "0b0b0b0b0b0b0b0b0b0b0b",
+      "f0f1f2f3f4f5f6f7f8f9",
+      "9b6c18c432a7bf8f0e71c8eb88f4b30baa2ba243",
+      "085a01ea1b10f36933068b56efa5ad81a4f14b822f5b091568a9cdd4f155fda2"
+      "c22e422478d305f3f896" },
+    { MAC_ID_SHA1, NULL,
+      "0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c",
+      "",
+      "2adccada18779e7c2077ad2eb19d3f3e731385dd",
+      "2c91117204d745f3500d636a62f64f0ab3bae548aa53d423b0d1f27ebba6f5e5"
+      "673a081d70cce7acfc48" },
+};
+/* Number of HKDF known answer tests. */
+#define NUM_HKDF_KAT	((int)(sizeof(hkdf_kat)/sizeof(*hkdf_kat)))
+
+/* scrypt known answer test. */
+typedef struct scrypt_kat_st
+{
+    /* The password. */
+    const char *pwd;
+    /* The salt. */
+    const char *salt;
+    /* The cost parameter. */
+    uint64_t n;
+    /* The block size parameter. */
+    uint32_t r;
+    /* The parallelization parameter. */
+    uint32_t p;
+    /* The expected key as a hexadecimal string. */
+    const char *key;
+} SCRYPT_KAT;
+
+/* scrypt known answers: RFC 7914. */
+static const SCRYPT_KAT scrypt_kat[] =
+{
+    { "", "", 16, 1, 1,
+      "77d6576238657b203b19ca42c18a0497f16b4844e3074ae8dfdffa3fede21442"
+      "fcd0069ded0948f8326a753a0fc81f17e8d3e0fb2e0d3628cf35e20c38d18906" },
+    { "password", "NaCl", 1024, 8, 16,
+      "fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+      "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640" },
+    { "pleaseletmein", "SodiumChloride", 16384, 8, 1,
+      "7023bdcb3afd7348461c06cd81fd38ebfda8fbba904f8e3ea9b543f6545da1f2"
+      "d5432955613f0fcf62d49705242a9af9e61e85dc0d651e40dfcf017b45575887" },
+};
+/* Number of scrypt known answer tests. */
+#define NUM_SCRYPT_KAT	((int)(sizeof(scrypt_kat)/sizeof(*scrypt_kat)))
+
+/* Argon2 known answers: RFC 9106 with P = 32 * 0x01, S = 16 * 0x02,
+ * K = 8 * 0x03, X = 12 * 0x04, t = 3, m = 32, p = 4. */
+static const char *argon2_kat[] =
+{
+    "512b391b6f1162975371d30919734294f868e3be3984f3c1a13a4db9fabe4acb",
+    "c814d9d1dc7f37aa13f0d77f2494bda1c8de6b016dd388d29952a4c4672b6ce8",
+    "0d640df58d78766c08c037a34a8b53c9d01ef0452d75b65eb52520e96b01e659",
+};
+
+/* MAC algorithm identifiers to test batches and speed with. SHA-3 has no
+ * iterate function. */
+static MAC_ID batch_id[] =
+{
+    MAC_ID_SHA1, MAC_ID_SHA256, MAC_ID_SHA512, MAC_ID_SHA3_256
+};
+/* Number of MAC algorithm identifiers for batches. */
+#define NUM_BATCH_ID	((int)(sizeof(batch_id)/sizeof(*batch_id)))
+
+/*
+ * Get the current cycle count from the CPU.
+ *
+ * @return  Cycle counter from CPU.
+ */
+uint64_t get_cycles()
+{
+    unsigned int hi, lo;
+
+    asm volatile ("rdtsc\n\t" : "=a" (lo), "=d"(hi));
+    return ((uint64_t)lo) | (((uint64_t)hi) << 32);
+}
+
+/*
+ * Calculate the number of cycles/second.
+ */
+void calc_cps()
+{
+    uint64_t end, start = get_cycles();
+    sleep(1);
+    end = get_cycles();
+    cps = end-start;
+    printf("Cycles/sec: %"PRIu64"\n", cps);
+}
+
+/*
+ * Convert a hexadecimal string to bytes.
+ *
+ * @param [in] s     The hexadecimal string.
+ * @param [in] data  The buffer to hold the bytes.
+ * @return  The number of bytes.
+ */
+size_t hex_to_bytes(const char *s, unsigned char *data)
+{
+    size_t i;
+    unsigned int b;
+
+    for (i=0; s[i*2] != '\0'; i++)
+    {
+        sscanf(s + i*2, "%2x", &b);
+        data[i] = b;
+    }
+    return i;
+}
+
+/*
+ * Get the name of the MAC implementation used with the flags.
+ *
+ * @param [in] id     The MAC algorithm identifier.
+ * @param [in] flags  The flags of the implementation.
+ * @param [in] name   The buffer to hold the name.
+ * @param [in] len    The length of the buffer.
+ * @return  0 when an implementation is found.<br>
+ *          1 otherwise.
+ */
+int impl_name(MAC_ID id, int flags, char *name, size_t len)
+{
+    MAC *mac;
+    char *n;
+
+    if (MAC_new(id, flags, &mac) != 0)
+        return 1;
+    MAC_get_impl_name(mac, &n);
+    snprintf(name, len, "%s", n);
+    MAC_free(mac);
+    return 0;
+}
+
+/*
+ * Check the PBKDF2 known answers with each implementation.
+ *
+ * @return  0 when all keys match.<br>
+ *          1 otherwise.
+ */
+int pbkdf2_kat_test()
+{
+    int ret = 0;
+    int i, j;
+    unsigned char exp[80];
+    unsigned char key[80];
+    unsigned char *k = key;
+    size_t klen;
+    const unsigned char *pwd, *salt;
+    const PBKDF2_KAT *kat;
+
+    for (i=0; (ret == 0) && (i<NUM_PBKDF2_KAT); i++)
+    {
+        kat = &pbkdf2_kat[i];
+        pwd = (const unsigned char *)kat->pwd;
+        salt = (const unsigned char *)kat->salt;
+        klen = hex_to_bytes(kat->key, exp);
+
+        if ((KDF_pbkdf2(kat->id, pwd, kat->plen, salt, kat->slen, kat->iter,
+            key, klen) != 0) || (memcmp(key, exp, klen) != 0))
+        {
+            ret = 1;
+        }
+        for (j=0; (ret == 0) && (j<NUM_FLAGS); j++)
+        {
+            memset(key, 0, sizeof(key));
+            ret = KDF_pbkdf2_batch(kat->id, impl_flags[j], &pwd, &kat->plen,
+                &salt, &kat->slen, kat->iter, 1, &k, klen);
+            /* No implementation with these flags. */
+            if (ret == HASH_ERR_NOT_FOUND)
+                ret = 0;
+            else if ((ret != 0) || (memcmp(key, exp, klen) != 0))
+                ret = 1;
+        }
+    }
+
+    printf("PBKDF2 Vector: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check deriving keys from many passwords at once gives the same keys as one
+ * at a time, and that the batch verification only fails the changed key.
+ * Passwords are of many lengths, some longer than a block, and the keys are
+ * several blocks of output.
+ *
+ * @param [in] id  The MAC algorithm identifier.
+ * @return  0 when the keys match and only the bad key isn't verified.<br>
+ *          1 otherwise.
+ */
+int pbkdf2_batch_test(MAC_ID id)
+{
+    int ret = 0;
+    int i, j;
+    const unsigned char *pwds[20];
+    int plens[20];
+    const unsigned char *salts[20];
+    size_t slens[20];
+    unsigned char exp[20][100];
+    unsigned char key[20][100];
+    unsigned char *keys[20];
+    unsigned char *k;
+    unsigned char verified[3];
+    static unsigned char data[400];
+
+    for (i=0; i<(int)sizeof(data); i++)
+        data[i] = i * 7 + (i >> 8);
+    for (i=0; i<20; i++)
+    {
+        pwds[i] = data + i;
+        plens[i] = (i * 29) % 150;
+        salts[i] = data + 200 + i;
+        slens[i] = (i * 11) % 40;
+        keys[i] = key[i];
+        k = exp[i];
+        ret |= KDF_pbkdf2_batch(id, MAC_METH_FLAG_EXCLUDE(MAC_METH_FLAG_CPU),
+            &pwds[i], &plens[i], &salts[i], &slens[i], 5, 1, &k,
+            sizeof(exp[i]));
+    }
+
+    for (j=0; (ret == 0) && (j<NUM_FLAGS); j++)
+    {
+        ret = KDF_pbkdf2_batch(id, impl_flags[j], pwds, plens, salts, slens,
+            5, 20, keys, sizeof(key[0]));
+        /* No implementation with these flags. */
+        if (ret == HASH_ERR_NOT_FOUND)
+        {
+            ret = 0;
+            continue;
+        }
+        if ((ret == 0) && (memcmp(key, exp, sizeof(key)) != 0))
+            ret = 1;
+
+        key[3][99] ^= 1;
+        if (ret == 0)
+        {
+            ret = KDF_pbkdf2_batch_verify(id, impl_flags[j], pwds, plens,
+                salts, slens, 5, 20, keys, sizeof(key[0]), verified);
+        }
+        for (i=0; (ret == 0) && (i<20); i++)
+        {
+            if (((verified[i / 8] >> (i % 8)) & 1) != (i != 3))
+                ret = 1;
+        }
+    }
+
+    printf("PBKDF2 Batch: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check the HKDF known answers: extract, expand and both in one call.
+ *
+ * @return  0 when all keys match.<br>
+ *          1 otherwise.
+ */
+int hkdf_kat_test()
+{
+    int ret = 0;
+    int i;
+    unsigned char salt[100], ikm[100], info[100];
+    unsigned char prk[64], eprk[64];
+    unsigned char okm[100], eokm[100];
+    size_t slen, klen, ilen, plen, olen;
+    const HKDF_KAT *kat;
+
+    for (i=0; (ret == 0) && (i<NUM_HKDF_KAT); i++)
+    {
+        kat = &hkdf_kat[i];
+        slen = (kat->salt == NULL) ? 0 : hex_to_bytes(kat->salt, salt);
+        klen = hex_to_bytes(kat->ikm, ikm);
+        ilen = hex_to_bytes(kat->info, info);
+        plen = hex_to_bytes(kat->prk, eprk);
+        olen = hex_to_bytes(kat->okm, eokm);
+
+        if ((KDF_hkdf_extract(kat->id, (kat->salt == NULL) ? NULL : salt,
+            slen, ikm, klen, prk) != 0) || (memcmp(prk, eprk, plen) != 0))
+        {
+            ret = 1;
+        }
+        else if ((KDF_hkdf_expand(kat->id, prk, plen, info, ilen, okm,
+            olen) != 0) || (memcmp(okm, eokm, olen) != 0))
+        {
+            ret = 1;
+        }
+        memset(okm, 0, sizeof(okm));
+        if ((ret == 0) && ((KDF_hkdf(kat->id,
+            (kat->salt == NULL) ? NULL : salt, slen, ikm, klen, info, ilen,
+            okm, olen) != 0) || (memcmp(okm, eokm, olen) != 0)))
+        {
+            ret = 1;
+        }
+    }
+
+    printf("HKDF Vector: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check expanding many labels at once gives the same output as one at a
+ * time, and that too long an output is rejected.
+ *
+ * @param [in] id  The MAC algorithm identifier.
+ * @return  0 when the outputs match.<br>
+ *          1 otherwise.
+ */
+int hkdf_batch_test(MAC_ID id)
+{
+    int ret = 0;
+    int i;
+    const unsigned char *infos[10];
+    size_t ilens[10];
+    unsigned char okm[10][200];
+    unsigned char *okms[10];
+    unsigned char exp[200];
+    size_t olens[10];
+    size_t big;
+    int len;
+    static unsigned char data[300];
+
+    for (i=0; i<(int)sizeof(data); i++)
+        data[i] = i * 13 + (i >> 8);
+    for (i=0; i<10; i++)
+    {
+        infos[i] = data + i * 3;
+        ilens[i] = (i * 37) % 200;
+        okms[i] = okm[i];
+        olens[i] = (i * 53) % 200;
+    }
+
+    ret = KDF_hkdf_expand_batch(id, data + 100, 48, infos, ilens, 10, okms,
+        olens);
+    for (i=0; (ret == 0) && (i<10); i++)
+    {
+        ret = KDF_hkdf_expand(id, data + 100, 48, infos[i], ilens[i], exp,
+            olens[i]);
+        if ((ret == 0) && (memcmp(okm[i], exp, olens[i]) != 0))
+            ret = 1;
+    }
+
+    /* At most 255 blocks of output. */
+    MAC_METH_get_len(id, &len);
+    big = 256 * (size_t)len;
+    okms[0] = malloc(big);
+    if ((ret == 0) && ((okms[0] == NULL) || (KDF_hkdf_expand(id, data, 32,
+        NULL, 0, okms[0], big - len) != 0) || (KDF_hkdf_expand(id, data, 32,
+        NULL, 0, okms[0], big - len + 1) != HASH_ERR_BAD_LEN)))
+    {
+        ret = 1;
+    }
+    free(okms[0]);
+
+    printf("HKDF Batch: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check the scrypt known answers with one thread and with a thread for each
+ * CPU, and that bad parameters are rejected.
+ *
+ * @return  0 when all keys match.<br>
+ *          1 otherwise.
+ */
+int scrypt_kat_test()
+{
+    int ret = 0;
+    int i, t;
+    unsigned char key[64], exp[64];
+    const SCRYPT_KAT *kat;
+
+    for (i=0; (ret == 0) && (i<NUM_SCRYPT_KAT); i++)
+    {
+        kat = &scrypt_kat[i];
+        hex_to_bytes(kat->key, exp);
+        for (t=0; (ret == 0) && (t<=1); t++)
+        {
+            memset(key, 0, sizeof(key));
+            if ((KDF_scrypt((const unsigned char *)kat->pwd, strlen(kat->pwd),
+                (const unsigned char *)kat->salt, strlen(kat->salt), kat->n,
+                kat->r, kat->p, t, key, sizeof(key)) != 0) ||
+                (memcmp(key, exp, sizeof(key)) != 0))
+            {
+                ret = 1;
+            }
+        }
+    }
+
+    /* N must be a power of 2 greater than 1. */
+    if ((ret == 0) && ((KDF_scrypt(NULL, 0, NULL, 0, 24, 1, 1, 1, key,
+        sizeof(key)) != HASH_ERR_BAD_DATA) || (KDF_scrypt(NULL, 0, NULL, 0,
+        1, 1, 1, 1, key, sizeof(key)) != HASH_ERR_BAD_DATA)))
+    {
+        ret = 1;
+    }
+
+    printf("scrypt Vector: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check the Argon2 known answers of each type with each implementation of the
+ * compression function, with one thread and with a thread for each lane, and
+ * that bad parameters are rejected.
+ *
+ * @return  0 when all tags match.<br>
+ *          1 otherwise.
+ */
+int argon2_kat_test()
+{
+    int ret = 0;
+    int type, t, j;
+    unsigned char pwd[32], salt[16], secret[8], ad[12];
+    unsigned char tag[32], exp[32];
+
+    memset(pwd, 0x01, sizeof(pwd));
+    memset(salt, 0x02, sizeof(salt));
+    memset(secret, 0x03, sizeof(secret));
+    memset(ad, 0x04, sizeof(ad));
+
+    for (j=0; (ret == 0) && (j<NUM_FLAGS); j++)
+    {
+        /* No implementation with these flags. */
+        if ((j > 0) && (KDF_argon2(KDF_ARGON2_ID, impl_flags[j], pwd,
+            sizeof(pwd), salt, sizeof(salt), NULL, 0, NULL, 0, 1, 32, 4, 1,
+            tag, sizeof(tag)) == HASH_ERR_NOT_FOUND))
+        {
+            continue;
+        }
+        for (type=KDF_ARGON2_D; (ret == 0) && (type<=KDF_ARGON2_ID); type++)
+        {
+            hex_to_bytes(argon2_kat[type], exp);
+            for (t=1; (ret == 0) && (t<=4); t+=3)
+            {
+                memset(tag, 0, sizeof(tag));
+                if ((KDF_argon2(type, impl_flags[j], pwd, sizeof(pwd), salt,
+                    sizeof(salt), secret, sizeof(secret), ad, sizeof(ad), 3,
+                    32, 4, t, tag, sizeof(tag)) != 0) ||
+                    (memcmp(tag, exp, sizeof(tag)) != 0))
+                {
+                    ret = 1;
+                }
+            }
+        }
+    }
+
+    /* At least 8 KiB for each lane and an 8 byte salt. */
+    if ((ret == 0) && ((KDF_argon2(KDF_ARGON2_ID, 0, pwd, sizeof(pwd), salt,
+        sizeof(salt), NULL, 0, NULL, 0, 1, 31, 4, 1, tag,
+        sizeof(tag)) != HASH_ERR_BAD_DATA) || (KDF_argon2(KDF_ARGON2_ID, 0,
+        pwd, sizeof(pwd), salt, 7, NULL, 0, NULL, 0, 1, 32, 4, 1, tag,
+        sizeof(tag)) != HASH_ERR_BAD_LEN)))
+    {
+        ret = 1;
+    }
+    /* No compression function from OpenSSL. */
+    if ((ret == 0) && (KDF_argon2(KDF_ARGON2_ID, MAC_METH_FLAG_OPENSSL, pwd,
+        sizeof(pwd), salt, sizeof(salt), NULL, 0, NULL, 0, 1, 32, 4, 1, tag,
+        sizeof(tag)) != HASH_ERR_NOT_FOUND))
+    {
+        ret = 1;
+    }
+
+    printf("Argon2 Vector: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Determine the number of PBKDF2 iterations that can be performed per second
+ * with 8 passwords at once.
+ *
+ * @param [in] id     The MAC algorithm identifier.
+ * @param [in] flags  The flags of the implementation.
+ */
+void pbkdf2_speed(MAC_ID id, int flags)
+{
+    int i;
+    uint64_t start, end, diff;
+    const unsigned char *pwds[8];
+    int plens[8];
+    const unsigned char *salts[8];
+    size_t slens[8];
+    unsigned char key[8][64];
+    unsigned char *keys[8];
+    unsigned int iter = 20000;
+    int len;
+    char name[64];
+    static char last[64];
+
+    /* Flags that don't change the implementation are only timed once. */
+    if ((impl_name(id, flags, name, sizeof(name)) != 0) ||
+        (strcmp(name, last) == 0))
+    {
+        return;
+    }
+    strcpy(last, name);
+    MAC_METH_get_len(id, &len);
+    for (i=0; i<8; i++)
+    {
+        pwds[i] = (const unsigned char *)"password";
+        plens[i] = 8 + (i & 1);
+        salts[i] = (const unsigned char *)"salt";
+        slens[i] = 4;
+        keys[i] = key[i];
+    }
+
+    start = get_cycles();
+    KDF_pbkdf2_batch(id, flags, pwds, plens, salts, slens, iter, 8, keys,
+        len);
+    end = get_cycles();
+    diff = end - start;
+
+    printf("%-24s %9.0f iter/s %7.1f c/iter\n", name,
+        8.0 * iter * cps / diff, (double)diff / (8.0 * iter));
+}
+
+/*
+ * Determine the time to derive a key with scrypt at interactive login cost:
+ * N = 2^15, r = 8 with p = 1 and p = 4.
+ */
+void scrypt_speed()
+{
+    int p;
+    uint64_t start, end, diff;
+    unsigned char key[32];
+
+    for (p=1; p<=4; p*=4)
+    {
+        start = get_cycles();
+        KDF_scrypt((const unsigned char *)"password", 8,
+            (const unsigned char *)"salt", 4, 1 << 15, 8, p, 0, key,
+            sizeof(key));
+        end = get_cycles();
+        diff = end - start;
+
+        printf("scrypt N=32768 r=8 p=%d   %9.1f ms\n", p,
+            1000.0 * diff / cps);
+    }
+}
+
+/*
+ * Determine the time to hash a password with Argon2id at the RFC 9106
+ * second recommended option: m = 64 MiB, t = 3, p = 4.
+ */
+void argon2_speed()
+{
+    uint64_t start, end, diff;
+    unsigned char tag[32];
+
+    start = get_cycles();
+    KDF_argon2(KDF_ARGON2_ID, 0, (const unsigned char *)"password", 8,
+        (const unsigned char *)"somesalt", 8, NULL, 0, NULL, 0, 3,
+        64 * 1024, 4, 0, tag, sizeof(tag));
+    end = get_cycles();
+    diff = end - start;
+
+    printf("Argon2id m=64MiB t=3 p=4 %9.1f ms\n", 1000.0 * diff / cps);
+}
+
+/*
+ * Main entry point of program.<br>
+ *  -speed       Test the speed of PBKDF2, scrypt and Argon2.<br>
+ */
+int main(int argc, char *argv[])
+{
+    int ret = 0;
+    int i, j;
+    int speed = 0;
+
+    while (--argc)
+    {
+        argv++;
+
+        if (strcmp(*argv, "-speed") == 0)
+            speed = 1;
+    }
+
+    if (speed)
+    {
+        calc_cps();
+        for (i=0; i<NUM_BATCH_ID; i++)
+        {
+            for (j=0; j<NUM_FLAGS; j++)
+                pbkdf2_speed(batch_id[i], impl_flags[j]);
+        }
+        scrypt_speed();
+        argon2_speed();
+        goto end;
+    }
+
+    ret |= pbkdf2_kat_test();
+    for (i=0; i<NUM_BATCH_ID; i++)
+        ret |= pbkdf2_batch_test(batch_id[i]);
+    ret |= hkdf_kat_test();
+    for (i=0; i<NUM_BATCH_ID; i++)
+        ret |= hkdf_batch_test(batch_id[i]);
+    ret |= scrypt_kat_test();
+    ret |= argon2_kat_test();
+
+end:
+    return (ret != 0);
+}
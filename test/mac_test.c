@@ -53,6 +53,8 @@ MAC_ID id[] =
     MAC_ID_SHA512_224, MAC_ID_SHA512_256,
     MAC_ID_SHA3_224, MAC_ID_SHA3_256, MAC_ID_SHA3_384, MAC_ID_SHA3_512,
     MAC_ID_BLAKE2B_512, MAC_ID_BLAKE2S_256,
+    MAC_ID_POLY1305,
+    MAC_ID_SIPHASH_2_4, MAC_ID_SIPHASH_1_3, MAC_ID_HALFSIPHASH_2_4,
 };
 
 /* Number of hash ids. */
@@ -229,17 +231,458 @@ void mac_msg(MAC *mac, const unsigned char *key, size_t klen,
     printf("Verified: %s\n", verified ? "YES" : "NO");
 }
 
+/*
+ * Check the one-shot MAC matches the MAC of the MAC object.
+ *
+ * @param [in] mac   The MAC object to use.
+ * @param [in] id    The id of the MAC algorithm.
+ * @param [in] key   The key data.
+ * @param [in] klen  The length of the key.
+ * @param [in] msg   The data of the message.
+ * @param [in] len   The length of the data.
+ * @return  0 when the MACs match.<br>
+ *          1 otherwise.
+ */
+int mac_oneshot(MAC *mac, MAC_ID id, const unsigned char *key, int klen,
+    const unsigned char *msg, int len)
+{
+    int ret = 0;
+    int i;
+    unsigned char dgst[64];
+    unsigned char odgst[64];
+    int dlen;
+
+    MAC_get_len(mac, &dlen);
+    for (i=0; (ret == 0) && (i<=len); i++)
+    {
+        MAC_sign_init(mac, key, klen);
+        MAC_sign_update(mac, msg, i);
+        MAC_sign_final(mac, dgst);
+        ret = MAC_compute(id, key, klen, msg, i, odgst);
+        if ((ret == 0) && (memcmp(dgst, odgst, dlen) != 0))
+            ret = 1;
+    }
+
+    printf("Compute: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check signing and verifying fragments of the message matches the one-shot
+ * MAC. The message is split into three fragments at each position.
+ *
+ * @param [in] mac   The MAC object to use.
+ * @param [in] id    The id of the MAC algorithm.
+ * @param [in] key   The key data.
+ * @param [in] klen  The length of the key.
+ * @param [in] msg   The data of the message.
+ * @param [in] len   The length of the data.
+ * @return  0 when the MACs match.<br>
+ *          1 otherwise.
+ */
+int mac_vector(MAC *mac, MAC_ID id, const unsigned char *key, int klen,
+    const unsigned char *msg, int len)
+{
+    int ret = 0;
+    int i;
+    unsigned char dgst[64];
+    unsigned char vdgst[64];
+    int dlen;
+    int verified = 0;
+    HASH_IOVEC iov[3];
+
+    MAC_get_len(mac, &dlen);
+    MAC_compute(id, key, klen, msg, len, dgst);
+    for (i=0; (ret == 0) && (i<=len); i++)
+    {
+        iov[0].data = msg;
+        iov[0].len = i;
+        iov[1].data = msg + i;
+        iov[1].len = (len - i) / 2;
+        iov[2].data = msg + i + iov[1].len;
+        iov[2].len = len - i - iov[1].len;
+
+        MAC_sign_init(mac, key, klen);
+        ret = MAC_sign_updatev(mac, iov, 3);
+        if (ret == 0)
+            ret = MAC_sign_final(mac, vdgst);
+        if ((ret == 0) && (memcmp(dgst, vdgst, dlen) != 0))
+            ret = 1;
+        if (ret == 0)
+        {
+            MAC_verify_init(mac, key, klen);
+            ret = MAC_verify_updatev(mac, iov, 3);
+        }
+        if (ret == 0)
+            ret = MAC_verify_final(mac, dgst, &verified);
+        if ((ret == 0) && !verified)
+            ret = 1;
+    }
+
+    printf("Vector: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check duplicating the MAC object after each prefix of the message gives
+ * the same MAC when both objects finish the message.
+ *
+ * @param [in] mac   The MAC object to use.
+ * @param [in] id    The id of the MAC algorithm.
+ * @param [in] key   The key data.
+ * @param [in] klen  The length of the key.
+ * @param [in] msg   The data of the message.
+ * @param [in] len   The length of the data.
+ * @return  0 when the MACs match.<br>
+ *          1 otherwise.
+ */
+int mac_dup(MAC *mac, MAC_ID id, const unsigned char *key, int klen,
+    const unsigned char *msg, int len)
+{
+    int ret = 0;
+    int i;
+    unsigned char dgst[64];
+    unsigned char ddgst[64];
+    int dlen;
+    MAC *dup;
+
+    MAC_get_len(mac, &dlen);
+    MAC_compute(id, key, klen, msg, len, dgst);
+    for (i=0; (ret == 0) && (i<=len); i++)
+    {
+        MAC_sign_init(mac, key, klen);
+        MAC_sign_update(mac, msg, i);
+        ret = MAC_dup(mac, &dup);
+        if (ret != 0)
+            break;
+        /* Overwrite the original's state to show they're independent. */
+        MAC_sign_update(mac, msg, len);
+        MAC_sign_update(dup, msg + i, len - i);
+        MAC_sign_final(dup, ddgst);
+        MAC_free(dup);
+        if (memcmp(dgst, ddgst, dlen) != 0)
+            ret = 1;
+    }
+
+    printf("Dup: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check starting MAC operations from a key object gives the same MAC as
+ * initializing with the key. The key object is used by two MAC objects and
+ * for every prefix of the message to show it isn't changed by use.
+ *
+ * @param [in] mac   The MAC object to use.
+ * @param [in] id    The id of the MAC algorithm.
+ * @param [in] key   The key data.
+ * @param [in] klen  The length of the key.
+ * @param [in] msg   The data of the message.
+ * @param [in] len   The length of the data.
+ * @return  0 when the MACs match and verify.<br>
+ *          1 otherwise.
+ */
+int mac_key(MAC *mac, MAC_ID id, const unsigned char *key, int klen,
+    const unsigned char *msg, int len)
+{
+    int ret = 0;
+    int i;
+    int verified = 0;
+    unsigned char dgst[64];
+    unsigned char kdgst[64];
+    int dlen;
+    MAC_KEY *mkey = NULL;
+    MAC *dup = NULL;
+
+    MAC_get_len(mac, &dlen);
+    ret = MAC_KEY_new(mac, key, klen, &mkey);
+    if (ret == 0)
+        ret = MAC_dup(mac, &dup);
+    for (i=0; (ret == 0) && (i<=len); i++)
+    {
+        MAC_compute(id, key, klen, msg, i, dgst);
+        MAC_sign_init_key((i & 1) ? dup : mac, mkey);
+        MAC_sign_update((i & 1) ? dup : mac, msg, i);
+        MAC_sign_final((i & 1) ? dup : mac, kdgst);
+        if (memcmp(dgst, kdgst, dlen) != 0)
+            ret = 1;
+
+        MAC_verify_init_key(mac, mkey);
+        MAC_verify_update(mac, msg, i);
+        MAC_verify_final(mac, dgst, &verified);
+        if (!verified)
+            ret = 1;
+    }
+    MAC_free(dup);
+    MAC_KEY_free(mkey);
+
+    printf("Key: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Get the length of key that a MAC algorithm requires.
+ *
+ * @param [in] mac  The MAC object to use.
+ * @return  0 when keys of other lengths are accepted.<br>
+ *          The length of the key otherwise.
+ */
+int mac_fixed_klen(MAC *mac)
+{
+    static const int klen[] = { 32, 16, 8 };
+    static const unsigned char key[32];
+    int i;
+
+    if (MAC_sign_init(mac, key, 31) == 0)
+        return 0;
+    for (i=0; i<(int)(sizeof(klen)/sizeof(*klen)); i++)
+    {
+        if (MAC_sign_init(mac, key, klen[i]) == 0)
+            return klen[i];
+    }
+    return 0;
+}
+
+/*
+ * Check signing and verifying messages of many lengths in a batch gives the
+ * same MACs as each message on its own. Runs of messages share a key and
+ * some keys are longer than a block. Also checks the AVX2 implementations
+ * when the CPU has AVX2.
+ *
+ * @param [in] mac  The MAC object to use.
+ * @param [in] id   The id of the MAC algorithm.
+ * @return  0 when the MACs match and only the bad MAC isn't verified.<br>
+ *          1 otherwise.
+ */
+int mac_batch(MAC *mac, MAC_ID id)
+{
+    int ret = 0;
+    int i, j;
+    const unsigned char *keys[40];
+    int klens[40];
+    const unsigned char *msgs[40];
+    size_t lens[40];
+    unsigned char dgst[40][64];
+    unsigned char *bdgst[40];
+    unsigned char sdgst[64];
+    unsigned char verified[5];
+    int dlen;
+    int kmax;
+    int kfix;
+    int bflags[2] = { 0, MAC_METH_FLAG_AVX2 };
+    static unsigned char bmsg[3000];
+
+    MAC_get_len(mac, &dlen);
+    for (i=0; i<(int)sizeof(bmsg); i++)
+        bmsg[i] = i * 7 + (i >> 8);
+    /* BLAKE2 keys are limited to the length of the digest. */
+    kmax = (MAC_sign_init(mac, bmsg, 200) == 0) ? 200 : 32;
+    /* Poly1305 and SipHash keys are one length. */
+    kfix = mac_fixed_klen(mac);
+    for (i=0; i<40; i++)
+    {
+        /* Key changes every 4 messages. */
+        keys[i] = bmsg + 2000 + (i / 4) * 3;
+        klens[i] = (kfix != 0) ? kfix : (i / 4) * 17 % kmax;
+        lens[i] = (i * i * 37) % 300 + ((i % 7 == 0) ? 2000 : 0);
+        msgs[i] = bmsg + i;
+        bdgst[i] = dgst[i];
+    }
+
+    for (j=0; (ret == 0) && (j<2); j++)
+    {
+        ret = MAC_batch_sign(id, bflags[j], keys, klens, msgs, lens, 40,
+            bdgst);
+        /* No AVX2 implementation of algorithm or CPU doesn't have AVX2. */
+        if ((j == 1) && (ret == HASH_ERR_NOT_FOUND))
+        {
+            ret = 0;
+            break;
+        }
+        for (i=0; (ret == 0) && (i<40); i++)
+        {
+            MAC_sign_init(mac, keys[i], klens[i]);
+            MAC_sign_update(mac, msgs[i], lens[i]);
+            MAC_sign_final(mac, sdgst);
+            if (memcmp(sdgst, dgst[i], dlen) != 0)
+                ret = 1;
+        }
+
+        dgst[5][0] ^= 1;
+        if (ret == 0)
+        {
+            ret = MAC_batch_verify(id, bflags[j], keys, klens, msgs, lens, 40,
+                bdgst, verified);
+        }
+        for (i=0; (ret == 0) && (i<40); i++)
+        {
+            if (((verified[i / 8] >> (i % 8)) & 1) != (i != 5))
+                ret = 1;
+        }
+    }
+
+    printf("Batch: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check the Poly1305 known answers: RFC 8439 section 2.5.2 and a long
+ * message that goes through the AVX2 lanes in many pieces.
+ *
+ * @param [in] mac  The MAC object to use.
+ * @return  0 when the tags match.<br>
+ *          1 otherwise.
+ */
+int mac_poly1305_kat(MAC *mac)
+{
+    int ret = 0;
+    int i;
+    unsigned char tag[16];
+    static const unsigned char key[32] = {
+        0x85, 0xd6, 0xbe, 0x78, 0x57, 0x55, 0x6d, 0x33,
+        0x7f, 0x44, 0x52, 0xfe, 0x42, 0xd5, 0x06, 0xa8,
+        0x01, 0x03, 0x80, 0x8a, 0xfb, 0x0d, 0xb2, 0xfd,
+        0x4a, 0xbf, 0xf6, 0xaf, 0x41, 0x49, 0xf5, 0x1b
+    };
+    static const unsigned char exp[16] = {
+        0xa8, 0x06, 0x1d, 0xc1, 0x30, 0x51, 0x36, 0xc6,
+        0xc2, 0x2b, 0x8b, 0xaf, 0x0c, 0x01, 0x27, 0xa9
+    };
+    /* Tag of 1000 bytes of 0, 1, 2, ... in pieces. */
+    static const unsigned char exp_long[16] = {
+        0x19, 0xe0, 0x35, 0x05, 0xa5, 0xa4, 0xcd, 0x52,
+        0x0d, 0xec, 0x7b, 0xab, 0x3d, 0x58, 0x77, 0x91
+    };
+    static unsigned char lmsg[1000];
+
+    MAC_sign_init(mac, key, sizeof(key));
+    MAC_sign_update(mac, (const unsigned char *)
+        "Cryptographic Forum Research Group", 34);
+    MAC_sign_final(mac, tag);
+    if (memcmp(tag, exp, sizeof(tag)) != 0)
+        ret = 1;
+
+    for (i=0; i<(int)sizeof(lmsg); i++)
+        lmsg[i] = i;
+    MAC_sign_init(mac, key, sizeof(key));
+    for (i=0; i<(int)sizeof(lmsg); i+=i/2+1)
+    {
+        MAC_sign_update(mac, lmsg + i,
+            (i/2+1 < (int)sizeof(lmsg)-i) ? i/2+1 : (int)sizeof(lmsg)-i);
+    }
+    MAC_sign_final(mac, tag);
+    if (memcmp(tag, exp_long, sizeof(tag)) != 0)
+        ret = 1;
+
+    printf("KAT: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
+/*
+ * Check the SipHash known answers - the reference vectors with the key
+ * 00..0f and messages 00..(n-1) - and that the one-call functions and batch
+ * give the same hashes as the MAC object.
+ *
+ * @param [in] mac  The MAC object to use.
+ * @param [in] id   The id of the MAC algorithm.
+ * @return  0 when the hashes match.<br>
+ *          1 otherwise.
+ */
+int mac_siphash_kat(MAC *mac, MAC_ID id)
+{
+    int ret = 0;
+    int i;
+    int dlen;
+    unsigned char key[16];
+    unsigned char m[100];
+    unsigned char tag[8];
+    uint64_t h, hashes[37];
+    const unsigned char *msgs[37];
+    size_t lens[37];
+    static const unsigned char exp[3][2][8] = {
+        /* SipHash-2-4: empty and 15 bytes. */
+        { { 0x31, 0x0e, 0x0e, 0xdd, 0x47, 0xdb, 0x6f, 0x72 },
+          { 0xe5, 0x45, 0xbe, 0x49, 0x61, 0xca, 0x29, 0xa1 } },
+        /* SipHash-1-3: empty and 15 bytes. */
+        { { 0xdc, 0xc4, 0x0f, 0x05, 0x58, 0x01, 0xac, 0xab },
+          { 0x56, 0x99, 0x51, 0x2a, 0x6d, 0xd8, 0x20, 0xd3 } },
+        /* HalfSipHash-2-4: empty and 15 bytes. */
+        { { 0xa9, 0x35, 0x9f, 0x5b }, { 0x74, 0xfe, 0x2b, 0x97 } },
+    };
+    int e = id - MAC_ID_SIPHASH_2_4;
+
+    MAC_get_len(mac, &dlen);
+    for (i=0; i<(int)sizeof(key); i++)
+        key[i] = i;
+    for (i=0; i<(int)sizeof(m); i++)
+        m[i] = i;
+
+    for (i=0; i<2; i++)
+    {
+        MAC_sign_init(mac, key, dlen * 2);
+        MAC_sign_update(mac, m, i * 15);
+        MAC_sign_final(mac, tag);
+        if (memcmp(tag, exp[e][i], dlen) != 0)
+            ret = 1;
+    }
+    printf("KAT: %s\n", (ret == 0) ? "YES" : "NO");
+
+    for (i=0; i<(int)sizeof(m); i++)
+    {
+        MAC_sign_init(mac, key, dlen * 2);
+        MAC_sign_update(mac, m, i);
+        MAC_sign_final(mac, tag);
+        if (id == MAC_ID_SIPHASH_2_4)
+            h = MAC_siphash_2_4(key, m, i);
+        else if (id == MAC_ID_SIPHASH_1_3)
+            h = MAC_siphash_1_3(key, m, i);
+        else
+            h = MAC_halfsiphash_2_4(key, m, i);
+        h ^= (uint64_t)tag[0] | ((uint64_t)tag[1] << 8) |
+             ((uint64_t)tag[2] << 16) | ((uint64_t)tag[3] << 24);
+        if (dlen == 8)
+        {
+            h ^= ((uint64_t)tag[4] << 32) | ((uint64_t)tag[5] << 40) |
+                 ((uint64_t)tag[6] << 48) | ((uint64_t)tag[7] << 56);
+        }
+        if (h != 0)
+            ret = 1;
+    }
+    /* Lengths of hash table keys: 8 to 64 bytes, some shorter. */
+    for (i=0; i<37; i++)
+    {
+        msgs[i] = m + i;
+        lens[i] = (i * 29) % 65;
+    }
+    if (MAC_siphash_batch(id, key, msgs, lens, 37, hashes) != 0)
+        ret = 1;
+    for (i=0; i<37; i++)
+    {
+        if (id == MAC_ID_SIPHASH_2_4)
+            h = MAC_siphash_2_4(key, msgs[i], lens[i]);
+        else if (id == MAC_ID_SIPHASH_1_3)
+            h = MAC_siphash_1_3(key, msgs[i], lens[i]);
+        else
+            h = MAC_halfsiphash_2_4(key, msgs[i], lens[i]);
+        if (h != hashes[i])
+            ret = 1;
+    }
+
+    printf("Fast: %s\n", (ret == 0) ? "YES" : "NO");
+    return ret != 0;
+}
+
 /*
  * Test an implementation of a MAC.
  *
+ * @param [in] mac    The MAC object of the implementation. Freed.
  * @param [in] id     The id of the MAC algorithm to test.
- * @param [in] flags  The method implementation flags required.
  * @param [in] speed  Whether to test the speed of the implementation.
  */
-int test_mac(MAC_ID id, int flags, int speed, int verify)
+int test_mac(MAC *mac, MAC_ID id, int speed, int verify)
 {
+    int ret = 0;
     int i;
-    MAC *mac;
     char *name = "";
     unsigned char dgst[64];
     const char *key_str = "abcdefghijklmnopqrstuvwxyz";
@@ -250,8 +693,6 @@ int test_mac(MAC_ID id, int flags, int speed, int verify)
         "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
         "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
 
-    MAC_new(id, flags, &mac);
-
     MAC_get_impl_name(mac, &name);
     printf("%s\n", name);
 
@@ -272,9 +713,22 @@ int test_mac(MAC_ID id, int flags, int speed, int verify)
         goto end;
     }
 
-    mac_msg(mac, NULL, 0, NULL, 0, 0);
-    mac_msg(mac, (uint8_t *)"key", 3,
-        (uint8_t *)"The quick brown fox jumps over the lazy dog", 43, 1);
+    /* Poly1305 and SipHash only take keys of one length. */
+    if (MAC_sign_init(mac, key, klen) != 0)
+    {
+        key = (const unsigned char *)"abcdefghijklmnopqrstuvwxyz012345";
+        klen = mac_fixed_klen(mac);
+        if (id == MAC_ID_POLY1305)
+            ret |= mac_poly1305_kat(mac);
+        else
+            ret |= mac_siphash_kat(mac, id);
+    }
+    else
+    {
+        mac_msg(mac, NULL, 0, NULL, 0, 0);
+        mac_msg(mac, (uint8_t *)"key", 3,
+            (uint8_t *)"The quick brown fox jumps over the lazy dog", 43, 1);
+    }
     mac_msg(mac, key, klen, (unsigned char *)msg_a, 1, 32);
     mac_msg(mac, key, klen, (unsigned char *)msg_a, 32, 1);
     mac_msg(mac, key, klen, (unsigned char *)msg_a, 1, 63);
@@ -286,9 +740,15 @@ int test_mac(MAC_ID id, int flags, int speed, int verify)
     mac_msg(mac, key, klen, (unsigned char *)msg_a, 1, 128);
     mac_msg(mac, key, klen, (unsigned char *)msg_a, 128, 1);
 
-    MAC_free(mac);
+    ret |= mac_oneshot(mac, id, key, klen, (unsigned char *)msg_a, 128);
+    ret |= mac_vector(mac, id, key, klen, (unsigned char *)msg_a, 128);
+    ret |= mac_dup(mac, id, key, klen, (unsigned char *)msg_a, 128);
+    ret |= mac_key(mac, id, key, klen, (unsigned char *)msg_a, 128);
+    ret |= mac_batch(mac, id);
+
 end:
-    return 0;
+    MAC_free(mac);
+    return ret;
 }
 
 /*
@@ -306,7 +766,13 @@ end:
  *  -sha512_256  Test the SHA512-256 hash algorithm.<br>
  *  -blake2b     Test the BLAKE2b hash algorithm with 512 bits of output.<br>
  *  -blake2s     Test the BLAKE2s hash algorithm with 256 bits of output.<br>
+ *  -poly1305    Test the Poly1305 one-time authenticator.<br>
+ *  -siphash     Test SipHash-2-4.<br>
+ *  -siphash13   Test SipHash-1-3.<br>
+ *  -halfsiphash Test HalfSipHash-2-4.<br>
  *  -int         Test internal implementations only.<br>
+ *  -portable    Test implementations that don't need CPU features only.<br>
+ *  -all         Test every implementation the CPU supports.<br>
  *  -verify      Test the speed of verification rather than signing.<br>
  *
  * @param [in] argc  The count of command line arguments.
@@ -321,8 +787,10 @@ int main(int argc, char *argv[])
     int verify = 0;
     int which = 0;
     int flags = 0;
-    int i;
+    int all = 0;
+    int i, j;
     MAC_ID alg_id;
+    MAC *mac;
 
     while (--argc)
     {
@@ -357,8 +825,20 @@ int main(int argc, char *argv[])
             alg_id = MAC_ID_BLAKE2S_256;
         else if (strcmp(*argv, "-sha1") == 0)
             alg_id = MAC_ID_SHA1;
+        else if (strcmp(*argv, "-poly1305") == 0)
+            alg_id = MAC_ID_POLY1305;
+        else if (strcmp(*argv, "-siphash") == 0)
+            alg_id = MAC_ID_SIPHASH_2_4;
+        else if (strcmp(*argv, "-siphash13") == 0)
+            alg_id = MAC_ID_SIPHASH_1_3;
+        else if (strcmp(*argv, "-halfsiphash") == 0)
+            alg_id = MAC_ID_HALFSIPHASH_2_4;
         else if (strcmp(*argv, "-int") == 0)
-            flags = MAC_METH_FLAG_INTERNAL;
+            flags |= MAC_METH_FLAG_INTERNAL;
+        else if (strcmp(*argv, "-portable") == 0)
+            flags |= MAC_METH_FLAG_EXCLUDE(MAC_METH_FLAG_CPU);
+        else if (strcmp(*argv, "-all") == 0)
+            all = 1;
         else if (strcmp(*argv, "-verify") == 0)
             verify = 1;
 
@@ -380,8 +860,18 @@ int main(int argc, char *argv[])
 
     for (i=0; i<NUM_ID; i++)
     {
-        if ((which == 0) || ((which & (1 << i)) != 0))
-            ret |= test_mac(id[i], flags, speed, verify);
+        if ((which != 0) && ((which & (1 << i)) == 0))
+            continue;
+
+        if (all)
+        {
+            for (j=0; MAC_new_impl(id[i], j, &mac) == 0; j++)
+                ret |= test_mac(mac, id[i], speed, verify);
+        }
+        else if (MAC_new(id[i], flags, &mac) == 0)
+            ret |= test_mac(mac, id[i], speed, verify);
+        else
+            ret = 1;
     }
 
     return (ret != 0);